@@ -2,6 +2,12 @@
 #include "Engine/Renderer/Skeleton.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include "Engine/Core/FileUtils.hpp"
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const int JOINT_BLEND_GRAIN_SIZE = 16;
 
 
 //-----------------------------------------------------------------------------------------------
@@ -15,6 +21,8 @@ Motion::Motion( const std::string& name, float timeSpan, float frameRate, Skelet
 	, m_currentTime( 0.0f )
 	, m_age( 0.0f )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_ANIMATION );
+
 	m_isPlaying = true;
 	m_keyframes = new mat44_fl[ m_frameCount * m_jointCount ];
 }
@@ -78,8 +86,9 @@ void Motion::ApplyMotionToSkeleton( Skeleton* skeleton, float time )
 	float blend;
 	GetFrameIndicesWithBlend( frame0, frame1, blend, time );
 
-	uint32_t jointCount = skeleton->GetJointCount();
-	for ( uint32_t jointIndex = 0; jointIndex < jointCount; ++jointIndex )
+	// Each joint only writes its own bone transform, so joints can be blended in parallel
+	int jointCount = ( int ) skeleton->GetJointCount();
+	ParallelFor( 0, jointCount, JOINT_BLEND_GRAIN_SIZE, [ & ]( int jointIndex )
 	{
 		mat44_fl *jointKeyframes = GetJointKeyFrames( jointIndex );
 		mat44_fl &mat0 = jointKeyframes[ frame0 ];
@@ -91,7 +100,7 @@ void Motion::ApplyMotionToSkeleton( Skeleton* skeleton, float time )
 		// (or set your matrix tree's worth to this, and set
 		// bone to model on Skeleton world's array)
 		skeleton->SetJointWorldTransform( jointIndex, newModel );
-	}
+	} );
 }
 
 
@@ -119,6 +128,8 @@ mat44_fl Motion::MatrixLerp( mat44_fl const &a, mat44_fl const &b, float const t
 //-----------------------------------------------------------------------------------------------
 void Motion::Update( Skeleton* skeleton, float deltaSeconds )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_ANIMATION );
+
 	if ( m_isPlaying )
 	{
 		m_age += deltaSeconds;
@@ -236,6 +247,8 @@ void Motion::WriteToStream( IBinaryWriter& writer )
 //-----------------------------------------------------------------------------------------------
 void Motion::ReadFromStream( IBinaryReader& reader )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_ANIMATION );
+
 	int joint_count = 0;
 	int frame_count = 0;
 
@@ -1,5 +1,6 @@
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -13,6 +14,8 @@ AudioSystem* g_theAudioSystem = nullptr;
 AudioSystem::AudioSystem()
 	: m_fmodSystem( nullptr )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_AUDIO );
+
 	InitializeFMOD();
 }
 
@@ -105,6 +108,8 @@ void AudioSystem::InitializeFMOD()
 //-----------------------------------------------------------------------------------------------
 SoundID AudioSystem::CreateOrGetSound( const char* soundFileName )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_AUDIO );
+
 	std::map< const char*, SoundID >::iterator found = m_registeredSoundIDs.find( soundFileName );
 	if ( found != m_registeredSoundIDs.end() )
 	{
@@ -141,6 +146,8 @@ void AudioSystem::StopChannel( AudioChannelHandle channel )
 //-----------------------------------------------------------------------------------------------
 AudioChannelHandle AudioSystem::PlaySound( SoundID soundID, float volumeLevel, float pitchModifier )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_AUDIO );
+
 	unsigned int numSounds = m_registeredSounds.size();
 	if ( soundID < 0 || soundID >= numSounds )
 		return nullptr;
@@ -179,6 +186,8 @@ AudioChannelHandle AudioSystem::PlaySound( SoundID soundID, float volumeLevel, f
 //---------------------------------------------------------------------------
 void AudioSystem::Update( float deltaSeconds )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_AUDIO );
+
 	deltaSeconds = 0.0f;
 	FMOD_RESULT result = m_fmodSystem->update();
 	ValidateResult( result );
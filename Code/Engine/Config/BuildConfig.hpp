@@ -3,6 +3,11 @@
 
 //-----------------------------------------------------------------------------------------------
 //#define MEMORY_TRACKING 1 // 0 - basic mode, 1 - verbose mode, undefined - no memory tracking
+//#define MEMORY_TRACKING_SAMPLE_RATE 1 // verbose mode starts off recording every Nth allocation, change it with memory_sampling
+//#define ENGINE_ALLOCATOR // if defined, operator new uses the size-class slab allocator instead of malloc
 //#define PROGRAM_LOGGING 3 // # - logs above this logging level will not be output/printed
+//#define CALLSTACK_RAW_ADDRESSES // if defined, logged callstacks are written as module+offset with a module map, symbolize them with Tools/Symbolize
 //#define PROGRAM_PROFILING
-//#define NETWORKING_SYSTEM // if defined, networking system code will be compiled
\ No newline at end of file
+//#define NETWORKING_SYSTEM // if defined, networking system code will be compiled
+//#define JOB_IDLE_POLICY 1 // 0 - latency first, 1 - balanced, 2 - power first, undefined - balanced
+//#define POOL_POISONING // if defined, freed pool blocks are filled with 0xDD and checked when reused
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Input/DeveloperConsole.hpp"
+#include "Engine/Tools/Memory/FrameAllocator.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -35,10 +36,14 @@ void InitializeEngineCommon()
 
 	g_engineEndianness = GetSystemEndianness();
 
+	InitializeCallstacks();
+
 	InitializeLogger();
 
 	InitializeMemoryAnalytics();
 
+	InitializeFrameMemory();
+
 	InitializeProfiler();
 }
 
@@ -50,7 +55,26 @@ void ShutdownEngineCommon()
 
 	ShutdownLogger();
 
+	ShutdownCallstacks();
+
 	ShutdownProfiler();
+
+	ShutdownFrameMemory();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Before the logger starts and after it stops, since the logging thread symbolizes callstacks
+void InitializeCallstacks()
+{
+	CallstackStartup();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ShutdownCallstacks()
+{
+	CallstackShutdown();
 }
 
 
@@ -68,6 +92,20 @@ void ShutdownMemoryAnalytics()
 }
 
 
+//-----------------------------------------------------------------------------------------------
+void InitializeFrameMemory()
+{
+	FrameMemoryStartup();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ShutdownFrameMemory()
+{
+	FrameMemoryShutdown();
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void InitializeLogger()
 {
@@ -154,6 +192,7 @@ void ShutdownEngineSubsystems()
 //-----------------------------------------------------------------------------------------------
 void UpdateEngineSubsystems( float deltaSeconds )
 {
+	FrameMemoryBeginFrame();
 	g_theInputSystem->Update( deltaSeconds );
 	g_theAudioSystem->Update( deltaSeconds );
 	g_theDeveloperConsole->Update( deltaSeconds );
@@ -170,4 +209,4 @@ void RenderEngineSubsystems()
 	g_theDeveloperConsole->Render();
 	g_theUISystem->Render();
 	MemoryAnalyticsRender();
-}
+}
\ No newline at end of file
@@ -76,8 +76,12 @@ enum Endianness
 //-----------------------------------------------------------------------------------------------
 void InitializeEngineCommon();
 void ShutdownEngineCommon();
+void InitializeCallstacks();
+void ShutdownCallstacks();
 void InitializeMemoryAnalytics();
 void ShutdownMemoryAnalytics();
+void InitializeFrameMemory();
+void ShutdownFrameMemory();
 void InitializeLogger();
 void ShutdownLogger();
 void InitializeProfiler();
@@ -8,6 +8,7 @@
 #include "Engine/Networking/Session.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 // Include from Game, how to avoid?
@@ -38,6 +39,8 @@ static Session* g_session = nullptr;
 //-----------------------------------------------------------------------------------------------
 NetworkingSystem::NetworkingSystem()
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_NETWORKING );
+
 	WORD wVersionRequested;
 	WSADATA wsaData;
 	int error;
@@ -91,6 +94,8 @@ NetworkingSystem::~NetworkingSystem()
 //-----------------------------------------------------------------------------------------------
 void NetworkingSystem::Update( float deltaSeconds )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_NETWORKING );
+
 	ProcessDataReceived();
 
 	if ( g_session != nullptr )
@@ -1,5 +1,6 @@
 #include "Engine/Renderer/Fonts/BitmapFont.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -14,6 +15,8 @@ STATIC StringToBitmapFontMap BitmapFont::s_fontRegistry;
 //-----------------------------------------------------------------------------------------------
 BitmapFont* BitmapFont::CreateOrGetFont( const std::string& fontFilePath )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_RENDERER );
+
 	// See if it already exists
 	//std::string lowerCaseName = GetAsLowerCase( bitmapFontName );
 	auto foundIter = s_fontRegistry.find( std::hash< std::string >()( fontFilePath ) );
@@ -3,6 +3,11 @@
 #include "Engine/Renderer/Particles/Emitter.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Math/MathUtils.hpp"
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const int PARTICLE_UPDATE_GRAIN_SIZE = 512;
 
 
 //-----------------------------------------------------------------------------------------------
@@ -85,8 +90,11 @@ void Emitter::Update( const float deltaSeconds )
 		return;
 	}
 
-	for ( auto partIter = m_particles.begin(); partIter != m_particles.end(); ++partIter )
+	// Particles are independent of each other, so large emitters are split across the job system
+	ParallelFor( 0, ( int ) m_particles.size(), PARTICLE_UPDATE_GRAIN_SIZE, [ & ]( int particleIndex )
 	{
+		Particle* partIter = &m_particles[ particleIndex ];
+
 		Vector2 totalAcceleration = Vector2::ZERO;
 		for ( auto forceIter = ( *partIter ).forces.begin(); forceIter != ( *partIter ).forces.end(); ++forceIter )
 		{
@@ -120,7 +128,7 @@ void Emitter::Update( const float deltaSeconds )
 				}
 			}
 		}
-	}
+	} );
 
 	float emissions = m_secondsSinceLastEmission * m_emissionsPerSecond;
 	if ( 1.0f < emissions )
@@ -9,6 +9,7 @@
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Renderer/Shaders/ShaderProgram.hpp"
 #include "Engine/Renderer/Lights/Light.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 #pragma comment( lib, "opengl32" ) // Link in the OpenGL32.lib static library
 #pragma comment( lib, "GLu32" ) // Link in the GLu32.lib static library
@@ -22,6 +23,8 @@ Renderer* g_theRenderer = nullptr;
 Renderer::Renderer()
 	: m_activeFBO( NULL )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_RENDERER );
+
 	glEnable( GL_BLEND );
 	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 	glEnable( GL_LINE_SMOOTH );
@@ -104,7 +104,6 @@ void SpriteGameRenderer::UnregisterSprite( Sprite* sprite )
 //-----------------------------------------------------------------------------------------------
 STATIC void SpriteGameRenderer::CopySpriteToMesh( Sprite* sprite )
 {
-	std::vector< Vertex_PCT > spriteVerts;
 	Vector2 dimensions = sprite->GetSpriteResource()->m_dimensions;
 
 	Vector2 v0 = Vector2( -sprite->GetSpriteResource()->m_pivotPoint.x, 
@@ -137,17 +136,16 @@ STATIC void SpriteGameRenderer::CopySpriteToMesh( Sprite* sprite )
 	Vector2 v2TexCoord = Vector2( topRight.x, topRight.y );
 	Vector2 v3TexCoord = Vector2( bottomLeft.x, topRight.y );
 
-	spriteVerts.push_back( Vertex_PCT( Vector3( v0Prime.x, v0Prime.y, 0.0f ), Rgba::WHITE, v0TexCoord ) );
-	spriteVerts.push_back( Vertex_PCT( Vector3( v1Prime.x, v1Prime.y, 0.0f ), Rgba::WHITE, v1TexCoord ) );
-	spriteVerts.push_back( Vertex_PCT( Vector3( v2Prime.x, v2Prime.y, 0.0f ), Rgba::WHITE, v2TexCoord ) );
-	spriteVerts.push_back( Vertex_PCT( Vector3( v3Prime.x, v3Prime.y, 0.0f ), Rgba::WHITE, v3TexCoord ) );
+	Vertex_PCT spriteVerts[ 4 ] =
+	{
+		Vertex_PCT( Vector3( v0Prime.x, v0Prime.y, 0.0f ), Rgba::WHITE, v0TexCoord ),
+		Vertex_PCT( Vector3( v1Prime.x, v1Prime.y, 0.0f ), Rgba::WHITE, v1TexCoord ),
+		Vertex_PCT( Vector3( v2Prime.x, v2Prime.y, 0.0f ), Rgba::WHITE, v2TexCoord ),
+		Vertex_PCT( Vector3( v3Prime.x, v3Prime.y, 0.0f ), Rgba::WHITE, v3TexCoord )
+	};
 
 	// Copy vertices into mesh
-	s_mesh->m_verts.clear();
-	for ( Vertex_PCT vert : spriteVerts )
-	{
-		s_mesh->m_verts.push_back( vert );
-	}
+	s_mesh->m_verts.assign( spriteVerts, spriteVerts + 4 );
 }
 
 
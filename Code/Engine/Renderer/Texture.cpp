@@ -3,6 +3,7 @@
 #include "Engine/Renderer/OpenGLExtensions.hpp"
 #include "Engine/Renderer/Texture.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -136,6 +137,8 @@ STATIC Texture* Texture::GetTextureByName( const char* imageFilePath )
 //
 STATIC Texture* Texture::CreateOrGetTexture( const char* imageFilePath )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_RENDERER );
+
 	Texture* newTexture = GetTextureByName( imageFilePath );
 
 	if ( newTexture == nullptr )
@@ -0,0 +1,371 @@
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined( __linux__ )
+#include <sched.h>
+#include <fstream>
+#endif
+
+#include <stdlib.h>
+#include <map>
+#include <thread>
+#include <algorithm>
+
+#include "Engine/Tools/Jobs/CpuTopology.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+CpuTopology::CpuTopology()
+	: m_numCores( 0 )
+	, m_numNodes( 0 )
+	, m_wasDetected( false )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CpuTopology::Detect()
+{
+	m_processors.clear();
+	m_wasDetected = DetectFromOS();
+
+	if ( !m_wasDetected )
+	{
+		m_processors.clear();
+
+		unsigned int numProcessors = std::thread::hardware_concurrency();
+		if ( numProcessors == 0 )
+		{
+			numProcessors = 1;
+		}
+
+		for ( unsigned int processorIndex = 0; processorIndex < numProcessors; ++processorIndex )
+		{
+			LogicalProcessor processor = { processorIndex, processorIndex, 0, 0 };
+			m_processors.push_back( processor );
+		}
+	}
+
+	Finalize();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Detection fills in whatever core and node numbers the OS uses. These are renumbered densely
+// from zero here, and SMT siblings are numbered within their core.
+void CpuTopology::Finalize()
+{
+	std::map< unsigned int, unsigned int > denseCores;
+	std::map< unsigned int, unsigned int > denseNodes;
+	for ( unsigned int index = 0; index < m_processors.size(); ++index )
+	{
+		denseCores[ m_processors[ index ].m_coreIndex ] = 0;
+		denseNodes[ m_processors[ index ].m_nodeIndex ] = 0;
+	}
+
+	m_numCores = 0;
+	for ( std::map< unsigned int, unsigned int >::iterator coreIter = denseCores.begin(); coreIter != denseCores.end(); ++coreIter )
+	{
+		coreIter->second = m_numCores++;
+	}
+
+	m_numNodes = 0;
+	for ( std::map< unsigned int, unsigned int >::iterator nodeIter = denseNodes.begin(); nodeIter != denseNodes.end(); ++nodeIter )
+	{
+		nodeIter->second = m_numNodes++;
+	}
+
+	for ( unsigned int index = 0; index < m_processors.size(); ++index )
+	{
+		m_processors[ index ].m_coreIndex = denseCores[ m_processors[ index ].m_coreIndex ];
+		m_processors[ index ].m_nodeIndex = denseNodes[ m_processors[ index ].m_nodeIndex ];
+	}
+
+	std::sort( m_processors.begin(), m_processors.end(), []( LogicalProcessor const &a, LogicalProcessor const &b )
+	{
+		if ( a.m_nodeIndex != b.m_nodeIndex )
+		{
+			return a.m_nodeIndex < b.m_nodeIndex;
+		}
+		if ( a.m_coreIndex != b.m_coreIndex )
+		{
+			return a.m_coreIndex < b.m_coreIndex;
+		}
+		return a.m_processorIndex < b.m_processorIndex;
+	} );
+
+	for ( unsigned int index = 0; index < m_processors.size(); ++index )
+	{
+		bool isSameCore = ( index > 0 ) && ( m_processors[ index - 1 ].m_coreIndex == m_processors[ index ].m_coreIndex );
+		m_processors[ index ].m_smtIndex = isSameCore ? m_processors[ index - 1 ].m_smtIndex + 1 : 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The order to hand processors to workers in. Every core gets a worker before any core gets a
+// second one, and nodes are filled one at a time so a small pool stays on one node. Core 0 goes
+// last, since the main thread and most interrupts tend to land there.
+void CpuTopology::GetPlacementOrder( bool onePerCore, std::vector< LogicalProcessor >& out_order ) const
+{
+	out_order.clear();
+
+	unsigned int maxSmtIndex = 0;
+	for ( unsigned int index = 0; index < m_processors.size(); ++index )
+	{
+		maxSmtIndex = std::max( maxSmtIndex, m_processors[ index ].m_smtIndex );
+	}
+
+	if ( onePerCore )
+	{
+		maxSmtIndex = 0;
+	}
+
+	for ( unsigned int smtIndex = 0; smtIndex <= maxSmtIndex; ++smtIndex )
+	{
+		size_t firstInRound = out_order.size();
+		for ( unsigned int index = 0; index < m_processors.size(); ++index )
+		{
+			if ( m_processors[ index ].m_smtIndex == smtIndex )
+			{
+				out_order.push_back( m_processors[ index ] );
+			}
+		}
+
+		if ( out_order.size() - firstInRound > 1 )
+		{
+			std::rotate( out_order.begin() + firstInRound, out_order.begin() + firstInRound + 1, out_order.end() );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+std::string CpuTopology::GetDescription() const
+{
+	return Stringf( "%u logical processors, %u cores, %u NUMA nodes%s", GetNumLogicalProcessors(), m_numCores, m_numNodes,
+		m_wasDetected ? "" : " (not detected, guessed)" );
+}
+
+
+#if defined( _WIN32 )
+//-----------------------------------------------------------------------------------------------
+// Only processor group 0 is used, which covers every machine with up to 64 hardware threads
+bool CpuTopology::DetectFromOS()
+{
+	DWORD bufferSize = 0;
+	GetLogicalProcessorInformationEx( RelationAll, nullptr, &bufferSize );
+	if ( GetLastError() != ERROR_INSUFFICIENT_BUFFER )
+	{
+		return false;
+	}
+
+	std::vector< unsigned char > buffer( bufferSize );
+	if ( !GetLogicalProcessorInformationEx( RelationAll, ( PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX ) buffer.data(), &bufferSize ) )
+	{
+		return false;
+	}
+
+	std::map< unsigned int, unsigned int > nodeByProcessor;
+	unsigned int numCoresSeen = 0;
+
+	for ( DWORD offset = 0; offset < bufferSize; )
+	{
+		PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = ( PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX ) ( buffer.data() + offset );
+		offset += info->Size;
+
+		if ( info->Relationship == RelationProcessorCore && info->Processor.GroupMask[ 0 ].Group == 0 )
+		{
+			KAFFINITY coreMask = info->Processor.GroupMask[ 0 ].Mask;
+			for ( unsigned int bitIndex = 0; bitIndex < sizeof( KAFFINITY ) * 8; ++bitIndex )
+			{
+				if ( ( coreMask & ( ( KAFFINITY ) 1 << bitIndex ) ) != 0 )
+				{
+					LogicalProcessor processor = { bitIndex, numCoresSeen, 0, 0 };
+					m_processors.push_back( processor );
+				}
+			}
+			numCoresSeen++;
+		}
+		else if ( info->Relationship == RelationNumaNode && info->NumaNode.GroupMask.Group == 0 )
+		{
+			KAFFINITY nodeMask = info->NumaNode.GroupMask.Mask;
+			for ( unsigned int bitIndex = 0; bitIndex < sizeof( KAFFINITY ) * 8; ++bitIndex )
+			{
+				if ( ( nodeMask & ( ( KAFFINITY ) 1 << bitIndex ) ) != 0 )
+				{
+					nodeByProcessor[ bitIndex ] = info->NumaNode.NodeNumber;
+				}
+			}
+		}
+	}
+
+	for ( unsigned int index = 0; index < m_processors.size(); ++index )
+	{
+		m_processors[ index ].m_nodeIndex = nodeByProcessor[ m_processors[ index ].m_processorIndex ];
+	}
+
+	return !m_processors.empty();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool PinCurrentThreadToProcessor( unsigned int processorIndex )
+{
+	if ( processorIndex >= sizeof( DWORD_PTR ) * 8 )
+	{
+		return false;
+	}
+
+	return SetThreadAffinityMask( GetCurrentThread(), ( DWORD_PTR ) 1 << processorIndex ) != 0;
+}
+
+
+#elif defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+// Parses the kernel's cpu list format, e.g. "0-3,8,10-11"
+static void ParseCpuList( std::string const &cpuList, std::vector< unsigned int >& out_cpus )
+{
+	size_t position = 0;
+	while ( position < cpuList.size() )
+	{
+		size_t commaPosition = cpuList.find( ',', position );
+		if ( commaPosition == std::string::npos )
+		{
+			commaPosition = cpuList.size();
+		}
+
+		std::string range = cpuList.substr( position, commaPosition - position );
+		position = commaPosition + 1;
+		if ( range.empty() )
+		{
+			continue;
+		}
+
+		size_t dashPosition = range.find( '-' );
+		unsigned int first = ( unsigned int ) strtoul( range.c_str(), nullptr, 10 );
+		unsigned int last = ( dashPosition == std::string::npos ) ? first : ( unsigned int ) strtoul( range.c_str() + dashPosition + 1, nullptr, 10 );
+
+		for ( unsigned int cpu = first; cpu <= last; ++cpu )
+		{
+			out_cpus.push_back( cpu );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool ReadSysfsLine( std::string const &path, std::string& out_line )
+{
+	std::ifstream sysfsFile( path );
+	return sysfsFile.is_open() && std::getline( sysfsFile, out_line ) && !out_line.empty();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Cores are keyed by package and core id, since core ids restart on every package. Machines
+// without NUMA have no node directory, and everything stays on node 0.
+bool CpuTopology::DetectFromOS()
+{
+	std::string line;
+	if ( !ReadSysfsLine( "/sys/devices/system/cpu/online", line ) )
+	{
+		return false;
+	}
+
+	std::vector< unsigned int > onlineCpus;
+	ParseCpuList( line, onlineCpus );
+
+	std::map< unsigned int, unsigned int > nodeByProcessor;
+	if ( ReadSysfsLine( "/sys/devices/system/node/online", line ) )
+	{
+		std::vector< unsigned int > onlineNodes;
+		ParseCpuList( line, onlineNodes );
+
+		for ( unsigned int nodeIndex = 0; nodeIndex < onlineNodes.size(); ++nodeIndex )
+		{
+			if ( ReadSysfsLine( Stringf( "/sys/devices/system/node/node%u/cpulist", onlineNodes[ nodeIndex ] ), line ) )
+			{
+				std::vector< unsigned int > nodeCpus;
+				ParseCpuList( line, nodeCpus );
+				for ( unsigned int cpuIndex = 0; cpuIndex < nodeCpus.size(); ++cpuIndex )
+				{
+					nodeByProcessor[ nodeCpus[ cpuIndex ] ] = onlineNodes[ nodeIndex ];
+				}
+			}
+		}
+	}
+
+	for ( unsigned int cpuIndex = 0; cpuIndex < onlineCpus.size(); ++cpuIndex )
+	{
+		unsigned int cpu = onlineCpus[ cpuIndex ];
+
+		std::string coreId;
+		std::string packageId;
+		if ( !ReadSysfsLine( Stringf( "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu ), coreId )
+			|| !ReadSysfsLine( Stringf( "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu ), packageId ) )
+		{
+			return false;
+		}
+
+		unsigned int coreKey = ( ( unsigned int ) strtoul( packageId.c_str(), nullptr, 10 ) << 16 )
+			| ( ( unsigned int ) strtoul( coreId.c_str(), nullptr, 10 ) & 0xFFFF );
+
+		LogicalProcessor processor = { cpu, coreKey, nodeByProcessor[ cpu ], 0 };
+		m_processors.push_back( processor );
+	}
+
+	return !m_processors.empty();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool PinCurrentThreadToProcessor( unsigned int processorIndex )
+{
+	if ( processorIndex >= CPU_SETSIZE )
+	{
+		return false;
+	}
+
+	cpu_set_t cpuSet;
+	CPU_ZERO( &cpuSet );
+	CPU_SET( processorIndex, &cpuSet );
+	return sched_setaffinity( 0, sizeof( cpuSet ), &cpuSet ) == 0;
+}
+
+
+#else
+//-----------------------------------------------------------------------------------------------
+bool CpuTopology::DetectFromOS()
+{
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool PinCurrentThreadToProcessor( unsigned int processorIndex )
+{
+	UNUSED( processorIndex );
+	return false;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static CpuTopology DetectCpuTopology()
+{
+	CpuTopology cpuTopology;
+	cpuTopology.Detect();
+	return cpuTopology;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Detected on first use, the topology doesn't change while running
+CpuTopology const &GetCpuTopology()
+{
+	static CpuTopology const s_cpuTopology = DetectCpuTopology();
+	return s_cpuTopology;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int INVALID_PROCESSOR_INDEX = 0xFFFFFFFF;
+
+
+//-----------------------------------------------------------------------------------------------
+struct LogicalProcessor
+{
+	unsigned int m_processorIndex; // The OS number, used for pinning
+	unsigned int m_coreIndex; // Dense, shared by SMT siblings
+	unsigned int m_nodeIndex; // Dense NUMA node
+	unsigned int m_smtIndex; // 0 for the first hardware thread on its core
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Hardware threads as the OS reports them: GetLogicalProcessorInformationEx on Windows, sysfs on
+// Linux. If neither works every hardware thread is treated as its own core on one node.
+class CpuTopology
+{
+public:
+	CpuTopology();
+
+	void Detect();
+
+	unsigned int GetNumLogicalProcessors() const { return ( unsigned int ) m_processors.size(); }
+	unsigned int GetNumPhysicalCores() const { return m_numCores; }
+	unsigned int GetNumNodes() const { return m_numNodes; }
+	void GetPlacementOrder( bool onePerCore, std::vector< LogicalProcessor >& out_order ) const;
+	std::string GetDescription() const;
+
+private:
+	bool DetectFromOS();
+	void Finalize();
+
+public:
+	std::vector< LogicalProcessor > m_processors; // Sorted by node, then core, then SMT index
+	unsigned int m_numCores;
+	unsigned int m_numNodes;
+	bool m_wasDetected;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+CpuTopology const &GetCpuTopology();
+bool PinCurrentThreadToProcessor( unsigned int processorIndex );
\ No newline at end of file
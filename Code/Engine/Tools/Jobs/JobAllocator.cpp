@@ -0,0 +1,433 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Engine/Tools/Jobs/JobAllocator.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Enable/disable pool poisoning in this file
+
+
+//-----------------------------------------------------------------------------------------------
+static_assert( sizeof( JobAllocatorCache ) == JOB_CACHE_LINE_SIZE, "JobAllocatorCache should fill one cache line" );
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned char FREED_BLOCK_POISON = 0xDD;
+const unsigned char ALLOCATED_BLOCK_POISON = 0xCD;
+
+
+//-----------------------------------------------------------------------------------------------
+// Each page starts with a cache line holding the link to the next page, the blocks follow on
+// the next line boundary. Pages count against the memory tag of the thread that grew the pool.
+struct JobPageHeader
+{
+	JobPageHeader* m_nextPage;
+	void* m_allocation; // As returned by malloc, before alignment
+	MemoryTag m_tag;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Slots are shared by every allocator, so a slot (and whatever its caches hold) is handed on to
+// the next thread that starts after its owner exits
+static std::atomic< uint64_t > s_usedThreadSlots( 0 );
+
+
+//-----------------------------------------------------------------------------------------------
+struct JobAllocatorThreadSlot
+{
+	JobAllocatorThreadSlot()
+		: m_slotIndex( -1 )
+	{
+		uint64_t usedSlots = s_usedThreadSlots.load( std::memory_order_relaxed );
+		while ( usedSlots != ~0ULL )
+		{
+			int freeSlot = 0;
+			while ( ( usedSlots & ( 1ULL << freeSlot ) ) != 0 )
+			{
+				++freeSlot;
+			}
+
+			if ( s_usedThreadSlots.compare_exchange_weak( usedSlots, usedSlots | ( 1ULL << freeSlot ),
+				std::memory_order_acquire, std::memory_order_relaxed ) )
+			{
+				m_slotIndex = freeSlot;
+				break;
+			}
+		}
+	}
+
+	~JobAllocatorThreadSlot()
+	{
+		if ( m_slotIndex >= 0 )
+		{
+			s_usedThreadSlots.fetch_and( ~( 1ULL << m_slotIndex ), std::memory_order_release );
+			m_slotIndex = -1; // Later frees from this thread's other destructors take the uncached path
+		}
+	}
+
+	int m_slotIndex;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+thread_local JobAllocatorThreadSlot t_jobAllocatorThreadSlot;
+
+
+//-----------------------------------------------------------------------------------------------
+// Blocks always hold at least a free node, so they are never smaller or less aligned than one
+JobAllocator::JobAllocator( size_t blockSize, size_t blockAlignment )
+	: m_blockSize( 0 )
+	, m_pageSize( JOB_ALLOCATOR_PAGE_SIZE )
+	, m_blocksPerPage( 0 )
+	, m_batchStack( 0 )
+	, m_pageList( nullptr )
+	, m_numPages( 0 )
+	, m_numBatchesFetched( 0 )
+	, m_numBatchesReturned( 0 )
+	, m_numUncachedAllocs( 0 )
+	, m_numUncachedFrees( 0 )
+{
+	ASSERT_OR_DIE( ( blockAlignment & ( blockAlignment - 1 ) ) == 0 && blockAlignment <= JOB_CACHE_LINE_SIZE,
+		"Job allocator alignment must be a power of two no bigger than a cache line!" );
+
+	if ( blockAlignment < alignof( JobFreeNode ) )
+	{
+		blockAlignment = alignof( JobFreeNode );
+	}
+
+	if ( blockSize < sizeof( JobFreeNode ) )
+	{
+		blockSize = sizeof( JobFreeNode );
+	}
+
+	m_blockSize = ( blockSize + blockAlignment - 1 ) & ~( blockAlignment - 1 );
+
+	// Big blocks get bigger pages, so a page always holds at least one full batch
+	if ( m_pageSize < JOB_CACHE_LINE_SIZE + JOB_BLOCKS_PER_BATCH * m_blockSize )
+	{
+		m_pageSize = JOB_CACHE_LINE_SIZE + JOB_BLOCKS_PER_BATCH * m_blockSize;
+	}
+	m_blocksPerPage = ( unsigned int ) ( ( m_pageSize - JOB_CACHE_LINE_SIZE ) / m_blockSize );
+
+	for ( int cacheIndex = 0; cacheIndex < MAX_JOB_ALLOCATOR_THREADS; ++cacheIndex )
+	{
+		JobAllocatorCache& cache = m_threadCaches[ cacheIndex ];
+		cache.m_freeList = nullptr;
+		cache.m_numFree = 0;
+		cache.m_numAllocs.store( 0, std::memory_order_relaxed );
+		cache.m_numFrees.store( 0, std::memory_order_relaxed );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobAllocator::~JobAllocator()
+{
+	Shutdown();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Adds pages to the shared pool until it has room for at least numBlocks in total
+void JobAllocator::Reserve( unsigned int numBlocks )
+{
+	while ( m_numPages.load( std::memory_order_relaxed ) * m_blocksPerPage < numBlocks )
+	{
+		JobFreeNode* firstBatch = AllocatePage();
+		ReturnBatch( firstBatch, firstBatch->m_batchCount );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Not thread safe, every block must have been freed and no thread may be allocating
+void JobAllocator::Shutdown()
+{
+	JobPageHeader* page = ( JobPageHeader* ) m_pageList.exchange( nullptr, std::memory_order_acquire );
+	while ( page != nullptr )
+	{
+		JobPageHeader* nextPage = page->m_nextPage;
+		RecordTaggedFree( page->m_tag, m_pageSize + JOB_CACHE_LINE_SIZE );
+		free( page->m_allocation );
+		page = nextPage;
+	}
+
+	m_batchStack.store( 0, std::memory_order_relaxed );
+	m_numPages.store( 0, std::memory_order_relaxed );
+	for ( int cacheIndex = 0; cacheIndex < MAX_JOB_ALLOCATOR_THREADS; ++cacheIndex )
+	{
+		m_threadCaches[ cacheIndex ].m_freeList = nullptr;
+		m_threadCaches[ cacheIndex ].m_numFree = 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* JobAllocator::Alloc()
+{
+	JobFreeNode* node = nullptr;
+	JobAllocatorCache* cache = GetThreadCache();
+
+	if ( cache != nullptr )
+	{
+		if ( cache->m_freeList == nullptr )
+		{
+			cache->m_freeList = FetchBatch();
+			cache->m_numFree = cache->m_freeList->m_batchCount;
+		}
+
+		node = cache->m_freeList;
+		cache->m_freeList = node->m_nextNode;
+		--cache->m_numFree;
+		cache->m_numAllocs.store( cache->m_numAllocs.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	}
+	else
+	{
+		// No cache to park the rest of the batch in, so hand it straight back
+		node = FetchBatch();
+		if ( node->m_batchCount > 1 )
+		{
+			ReturnBatch( node->m_nextNode, node->m_batchCount - 1 );
+		}
+		m_numUncachedAllocs.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+#ifdef POOL_POISONING
+	CheckPoison( node );
+	memset( node, ALLOCATED_BLOCK_POISON, m_blockSize );
+#endif
+
+	return node;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void JobAllocator::Free( void* block )
+{
+	JobFreeNode* node = ( JobFreeNode* ) block;
+	JobAllocatorCache* cache = GetThreadCache();
+
+#ifdef POOL_POISONING
+	PoisonBlock( node );
+#endif
+
+	if ( cache == nullptr )
+	{
+		node->m_nextNode = nullptr;
+		ReturnBatch( node, 1 );
+		m_numUncachedFrees.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	node->m_nextNode = cache->m_freeList;
+	cache->m_freeList = node;
+	++cache->m_numFree;
+	cache->m_numFrees.store( cache->m_numFrees.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+	// Keep one batch around for the next allocations and give the other back, so a thread that
+	// only frees (a consumer of another thread's jobs) doesn't hoard them
+	if ( cache->m_numFree >= 2 * JOB_BLOCKS_PER_BATCH )
+	{
+		JobFreeNode* batchHead = cache->m_freeList;
+		JobFreeNode* batchTail = batchHead;
+		for ( int nodeIndex = 1; nodeIndex < JOB_BLOCKS_PER_BATCH; ++nodeIndex )
+		{
+			batchTail = batchTail->m_nextNode;
+		}
+
+		cache->m_freeList = batchTail->m_nextNode;
+		cache->m_numFree -= JOB_BLOCKS_PER_BATCH;
+		batchTail->m_nextNode = nullptr;
+		ReturnBatch( batchHead, JOB_BLOCKS_PER_BATCH );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Counters are summed without stopping other threads, so treat the result as a snapshot
+JobAllocatorStats JobAllocator::GetStats() const
+{
+	JobAllocatorStats stats;
+	stats.m_blockSize = m_blockSize;
+	stats.m_numPages = m_numPages.load( std::memory_order_relaxed );
+	stats.m_capacity = stats.m_numPages * m_blocksPerPage;
+	stats.m_numAllocs = m_numUncachedAllocs.load( std::memory_order_relaxed );
+	stats.m_numFrees = m_numUncachedFrees.load( std::memory_order_relaxed );
+	stats.m_numBatchesFetched = m_numBatchesFetched.load( std::memory_order_relaxed );
+	stats.m_numBatchesReturned = m_numBatchesReturned.load( std::memory_order_relaxed );
+
+	for ( int cacheIndex = 0; cacheIndex < MAX_JOB_ALLOCATOR_THREADS; ++cacheIndex )
+	{
+		stats.m_numAllocs += m_threadCaches[ cacheIndex ].m_numAllocs.load( std::memory_order_relaxed );
+		stats.m_numFrees += m_threadCaches[ cacheIndex ].m_numFrees.load( std::memory_order_relaxed );
+	}
+
+	stats.m_numLiveBlocks = ( int64_t ) ( stats.m_numAllocs - stats.m_numFrees );
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobAllocatorCache* JobAllocator::GetThreadCache()
+{
+	int slotIndex = t_jobAllocatorThreadSlot.m_slotIndex;
+	if ( slotIndex < 0 )
+	{
+		return nullptr;
+	}
+
+	return &m_threadCaches[ slotIndex ];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Never fails, grows by a page when the shared pool is empty
+JobFreeNode* JobAllocator::FetchBatch()
+{
+	uint64_t head = m_batchStack.load( std::memory_order_acquire );
+	while ( UnpackPointer( head ) != nullptr )
+	{
+		// Pages are never released while running, so this read is safe even if another thread
+		// already took the batch; the tag makes the exchange fail in that case
+		JobFreeNode* batchHead = UnpackPointer( head );
+		JobFreeNode* nextBatch = batchHead->m_nextBatch.load( std::memory_order_relaxed );
+		if ( m_batchStack.compare_exchange_weak( head, PackTaggedPointer( nextBatch, UnpackTag( head ) + 1 ),
+			std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			m_numBatchesFetched.fetch_add( 1, std::memory_order_relaxed );
+			return batchHead;
+		}
+	}
+
+	return AllocatePage();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void JobAllocator::ReturnBatch( JobFreeNode* batchHead, unsigned int batchCount )
+{
+	batchHead->m_batchCount = batchCount;
+
+	uint64_t head = m_batchStack.load( std::memory_order_relaxed );
+	do
+	{
+		batchHead->m_nextBatch.store( UnpackPointer( head ), std::memory_order_relaxed );
+	} while ( !m_batchStack.compare_exchange_weak( head, PackTaggedPointer( batchHead, UnpackTag( head ) + 1 ),
+		std::memory_order_release, std::memory_order_relaxed ) );
+
+	m_numBatchesReturned.fetch_add( 1, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Keeps the first batch of the new page for the caller and shares the rest. Blocks left over
+// after the last full batch go in a smaller batch of their own.
+JobFreeNode* JobAllocator::AllocatePage()
+{
+	void* allocation = malloc( m_pageSize + JOB_CACHE_LINE_SIZE );
+	ASSERT_OR_DIE( allocation != nullptr, "Out of memory for job pages" );
+
+	uintptr_t alignedAddress = ( ( uintptr_t ) allocation + JOB_CACHE_LINE_SIZE - 1 ) & ~( uintptr_t ) ( JOB_CACHE_LINE_SIZE - 1 );
+	JobPageHeader* page = ( JobPageHeader* ) alignedAddress;
+	page->m_allocation = allocation;
+	page->m_tag = GetCurrentMemoryTag();
+	RecordTaggedAllocation( page->m_tag, m_pageSize + JOB_CACHE_LINE_SIZE );
+
+	void* expectedHead = m_pageList.load( std::memory_order_relaxed );
+	do
+	{
+		page->m_nextPage = ( JobPageHeader* ) expectedHead;
+	} while ( !m_pageList.compare_exchange_weak( expectedHead, page, std::memory_order_release, std::memory_order_relaxed ) );
+	m_numPages.fetch_add( 1, std::memory_order_relaxed );
+
+	unsigned char* blocks = ( unsigned char* ) page + JOB_CACHE_LINE_SIZE;
+	JobFreeNode* firstBatch = nullptr;
+	for ( unsigned int batchStart = 0; batchStart < m_blocksPerPage; batchStart += JOB_BLOCKS_PER_BATCH )
+	{
+		unsigned int batchEnd = batchStart + JOB_BLOCKS_PER_BATCH;
+		if ( batchEnd > m_blocksPerPage )
+		{
+			batchEnd = m_blocksPerPage;
+		}
+
+		for ( unsigned int blockIndex = batchStart; blockIndex < batchEnd; ++blockIndex )
+		{
+			JobFreeNode* node = ( JobFreeNode* ) ( blocks + blockIndex * m_blockSize );
+#ifdef POOL_POISONING
+			PoisonBlock( node );
+#endif
+			node->m_nextNode = ( blockIndex + 1 < batchEnd ) ? ( JobFreeNode* ) ( blocks + ( blockIndex + 1 ) * m_blockSize ) : nullptr;
+			new ( &node->m_nextBatch ) std::atomic< JobFreeNode* >( nullptr );
+		}
+
+		JobFreeNode* batchHead = ( JobFreeNode* ) ( blocks + batchStart * m_blockSize );
+		if ( firstBatch == nullptr )
+		{
+			firstBatch = batchHead;
+			firstBatch->m_batchCount = batchEnd - batchStart;
+		}
+		else
+		{
+			ReturnBatch( batchHead, batchEnd - batchStart );
+		}
+	}
+
+	return firstBatch;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Fills everything past the free node, which the free lists overwrite anyway
+void JobAllocator::PoisonBlock( JobFreeNode* node ) const
+{
+	memset( ( unsigned char* ) node + sizeof( JobFreeNode ), FREED_BLOCK_POISON, m_blockSize - sizeof( JobFreeNode ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Catches writes through a pointer kept after the block was freed
+void JobAllocator::CheckPoison( JobFreeNode* node ) const
+{
+	unsigned char const* blockBytes = ( unsigned char const* ) node;
+	for ( size_t byteIndex = sizeof( JobFreeNode ); byteIndex < m_blockSize; ++byteIndex )
+	{
+		if ( blockBytes[ byteIndex ] != FREED_BLOCK_POISON )
+		{
+			ERROR_AND_DIE( "Pooled block was written to after it was freed!" );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Upper bits hold a version tag: 32 bits on 32-bit targets, 16 bits above the 48-bit user address
+// space on 64-bit ones
+#if UINTPTR_MAX == 0xFFFFFFFF
+const int JOB_TAG_SHIFT = 32;
+#else
+const int JOB_TAG_SHIFT = 48;
+#endif
+const uint64_t JOB_POINTER_MASK = ( 1ULL << JOB_TAG_SHIFT ) - 1;
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t JobAllocator::PackTaggedPointer( JobFreeNode* node, uint64_t tag )
+{
+	return ( ( uint64_t ) ( uintptr_t ) node & JOB_POINTER_MASK ) | ( tag << JOB_TAG_SHIFT );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobFreeNode* JobAllocator::UnpackPointer( uint64_t taggedPointer )
+{
+	return ( JobFreeNode* ) ( uintptr_t ) ( taggedPointer & JOB_POINTER_MASK );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t JobAllocator::UnpackTag( uint64_t taggedPointer )
+{
+	return taggedPointer >> JOB_TAG_SHIFT;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t JOB_CACHE_LINE_SIZE = 64;
+const size_t JOB_ALLOCATOR_PAGE_SIZE = 32 * 1024; // Smallest page, bigger for blocks that wouldn't fit a batch
+const int JOB_BLOCKS_PER_BATCH = 32;
+const int MAX_JOB_ALLOCATOR_THREADS = 64; // Threads past this go straight to the shared pool
+
+
+//-----------------------------------------------------------------------------------------------
+// Overlaid on a free block
+struct JobFreeNode
+{
+	JobFreeNode* m_nextNode; // Within a batch
+	std::atomic< JobFreeNode* > m_nextBatch; // Only valid on the first node of a batch
+	unsigned int m_batchCount;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Only ever touched by the thread holding its slot, padded so neighbours don't share a line
+struct JobAllocatorCache
+{
+	std::atomic< uint64_t > m_numAllocs; // Written by the owner only, read by GetStats
+	std::atomic< uint64_t > m_numFrees;
+	JobFreeNode* m_freeList;
+	unsigned int m_numFree;
+	char m_padding[ 64 - 2 * sizeof( std::atomic< uint64_t > ) - sizeof( JobFreeNode* ) - sizeof( unsigned int ) ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct JobAllocatorStats
+{
+	size_t m_blockSize;
+	unsigned int m_numPages;
+	unsigned int m_capacity;
+	int64_t m_numLiveBlocks;
+	uint64_t m_numAllocs;
+	uint64_t m_numFrees;
+	uint64_t m_numBatchesFetched;
+	uint64_t m_numBatchesReturned;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Lock-free, growable allocator for fixed size blocks: jobs, the pooled blocks behind large job
+// payloads, and ConcurrentObjectPool. Each thread allocates from and frees into its own cache and
+// only talks to the shared pool a batch at a time. When the shared pool runs dry a new page is
+// carved up, so there is no hard cap. Blocks are cache line aligned unless a smaller alignment is
+// asked for; pages are only released on Shutdown.
+class JobAllocator
+{
+public:
+	explicit JobAllocator( size_t blockSize, size_t blockAlignment = JOB_CACHE_LINE_SIZE );
+	~JobAllocator();
+
+	void Reserve( unsigned int numBlocks );
+	void Shutdown();
+
+	void* Alloc();
+	void Free( void* block );
+
+	JobAllocatorStats GetStats() const;
+
+private:
+	JobAllocator( JobAllocator const & );
+	JobAllocator& operator=( JobAllocator const & );
+
+	JobAllocatorCache* GetThreadCache();
+	JobFreeNode* FetchBatch();
+	void ReturnBatch( JobFreeNode* batchHead, unsigned int batchCount );
+	JobFreeNode* AllocatePage();
+	void PoisonBlock( JobFreeNode* node ) const;
+	void CheckPoison( JobFreeNode* node ) const;
+
+	static uint64_t PackTaggedPointer( JobFreeNode* node, uint64_t tag );
+	static JobFreeNode* UnpackPointer( uint64_t taggedPointer );
+	static uint64_t UnpackTag( uint64_t taggedPointer );
+
+private:
+	size_t m_blockSize;
+	size_t m_pageSize;
+	unsigned int m_blocksPerPage;
+	std::atomic< uint64_t > m_batchStack; // Treiber stack of batches, tagged against ABA
+	std::atomic< void* > m_pageList;
+	std::atomic< unsigned int > m_numPages;
+	std::atomic< uint64_t > m_numBatchesFetched;
+	std::atomic< uint64_t > m_numBatchesReturned;
+	std::atomic< uint64_t > m_numUncachedAllocs;
+	std::atomic< uint64_t > m_numUncachedFrees;
+	JobAllocatorCache m_threadCaches[ MAX_JOB_ALLOCATOR_THREADS ];
+};
\ No newline at end of file
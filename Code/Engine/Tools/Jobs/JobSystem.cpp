@@ -1,24 +1,80 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
-#include <sysinfoapi.h>
 
 #include "Engine/Tools/Jobs/JobSystem.hpp"
 #include "Engine/Core/StringUtils.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Select the job idle policy in this file
+#include "Engine/Input/DeveloperConsole.hpp"
+#include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
 TheJobSystem* g_theJobSystem = nullptr;
+const int PARALLEL_FOR_PIECES_PER_WORKER = 8;
+const int PARALLEL_FOR_MAX_PIECES = 256; // Keeps tiny grain sizes from drowning in job overhead
 
 
 //-----------------------------------------------------------------------------------------------
-TheJobSystem::TheJobSystem( unsigned int numJobCategories, unsigned int numWorkerThreads )
+static_assert( sizeof( Job ) == 2 * JOB_CACHE_LINE_SIZE, "Job should be exactly two cache lines (header + inline payload)" );
+static_assert( MAX_JOB_CONTINUATIONS * sizeof( Job* ) <= JOB_BLOCK_SIZE, "Continuations must fit in a job block" );
+static_assert( MAX_JOB_CONTINUATIONS < JOB_CONTINUATIONS_CLOSED, "Continuation count must fit below the closed marker" );
+
+
+//-----------------------------------------------------------------------------------------------
+// Shared by every job system, since a job can be written to without knowing its system
+static JobAllocator s_jobBlockAllocator( JOB_BLOCK_SIZE );
+
+
+//-----------------------------------------------------------------------------------------------
+// Latency keeps workers awake across a whole frame of idle time; power parks them right away
+static const JobIdleSettings IDLE_SETTINGS_BY_POLICY[ NUM_JOB_IDLE_POLICIES ] =
+{
+	{ 0.002, 0.050 }, // JOB_IDLE_POLICY_LATENCY
+	{ 0.00005, 0.001 }, // JOB_IDLE_POLICY_BALANCED
+	{ 0.00001, 0.0 }, // JOB_IDLE_POLICY_POWER
+};
+
+
+//-----------------------------------------------------------------------------------------------
+#ifdef JOB_IDLE_POLICY
+const JobIdlePolicy DEFAULT_JOB_IDLE_POLICY = ( JobIdlePolicy ) JOB_IDLE_POLICY;
+#else
+const JobIdlePolicy DEFAULT_JOB_IDLE_POLICY = JOB_IDLE_POLICY_BALANCED;
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// Set on each worker thread so dispatches from inside a job can go to the worker's own deque
+static thread_local TheJobSystem* t_workerJobSystem = nullptr;
+static thread_local JobWorker* t_currentWorker = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+TheJobSystem::TheJobSystem( unsigned int numJobCategories, unsigned int numWorkerThreads,
+	JobSchedulerMode schedulerMode )
 	: m_numJobCategories( numJobCategories )
 	, m_numWorkerThreads( numWorkerThreads )
 	, m_numSystemCores( GetSystemCoreCount() )
+	, m_schedulerMode( schedulerMode )
+	, m_numWorkersStarted( 0 )
+	, m_jobAllocator( sizeof( Job ) )
 	, m_isRunning( false )
+	, m_idlePolicy( DEFAULT_JOB_IDLE_POLICY )
+	, m_numParkedWorkers( 0 )
+	, m_totalParks( 0 )
+	, m_exclusiveCategoriesMask( 0 )
+	, m_hasReservedWorkers( false )
+	, m_mainThreadCategoriesMask( DEFAULT_MAIN_THREAD_JOB_CATEGORIES_MASK )
+	, m_placementPolicy( JOB_PLACEMENT_NONE )
+	, m_preferLocalNodeSteals( false )
 {
-	m_jobPool.Initialize( 1024 );
+	for ( int categoryIndex = 0; categoryIndex < NUM_JOB_CATEGORIES; ++categoryIndex )
+	{
+		m_wakeCounts[ categoryIndex ] = 0;
+		m_numReservedWorkers[ categoryIndex ] = 0;
+	}
 
 	m_jobQueue.resize( NUM_JOB_CATEGORIES );
 
@@ -48,14 +104,68 @@ void TheJobSystem::Startup()
 		threadsToUse = m_numSystemCores + m_numWorkerThreads;
 	}
 
+	std::vector< LogicalProcessor > placementOrder;
+	if ( m_placementPolicy != JOB_PLACEMENT_NONE )
+	{
+		CpuTopology const &cpuTopology = GetCpuTopology();
+		cpuTopology.GetPlacementOrder( m_placementPolicy == JOB_PLACEMENT_PHYSICAL_CORES, placementOrder );
+		m_preferLocalNodeSteals = ( cpuTopology.GetNumNodes() > 1 );
+
+		if ( m_placementPolicy == JOB_PLACEMENT_PHYSICAL_CORES && threadsToUse > ( int ) placementOrder.size() )
+		{
+			threadsToUse = placementOrder.size();
+		}
+	}
+
 	if ( threadsToUse <= 0 )
 	{
 		threadsToUse = 1;
 	}
 
+	m_workerSettings.resize( threadsToUse );
+	for ( int i = 0; i < threadsToUse; i++ )
+	{
+		JobWorkerSettings& settings = m_workerSettings[ i ];
+		settings.m_categoryMask = ALL_JOB_CATEGORIES_MASK;
+		settings.m_processorIndex = INVALID_PROCESSOR_INDEX;
+		settings.m_nodeIndex = 0;
+
+		// More workers than hardware threads wrap around and share
+		if ( !placementOrder.empty() )
+		{
+			settings.m_processorIndex = placementOrder[ i % placementOrder.size() ].m_processorIndex;
+			settings.m_nodeIndex = placementOrder[ i % placementOrder.size() ].m_nodeIndex;
+		}
+	}
+
+	// Reserved workers are taken from the end of the list and serve nothing but their category
+	int firstReservedWorker = threadsToUse;
+	for ( int categoryIndex = 0; categoryIndex < NUM_JOB_CATEGORIES; ++categoryIndex )
+	{
+		for ( unsigned int reservedIndex = 0; reservedIndex < m_numReservedWorkers[ categoryIndex ]; ++reservedIndex )
+		{
+			--firstReservedWorker;
+			ASSERT_OR_DIE( firstReservedWorker > 0, "Reserved more job workers than there are threads!" );
+			m_workerSettings[ firstReservedWorker ].m_categoryMask = 1u << categoryIndex;
+		}
+	}
+
+	for ( int i = 0; i < firstReservedWorker; i++ )
+	{
+		m_workerSettings[ i ].m_categoryMask &= ~m_exclusiveCategoriesMask;
+	}
+
+	// Each thread creates its own worker once pinned, so its deques are first touched on its own
+	// NUMA node. All workers must exist before anyone dispatches, since any may be stolen from.
+	m_workers.resize( threadsToUse, nullptr );
 	for ( int i = 0; i < threadsToUse; i++ )
 	{
-		m_threads.push_back( std::thread( &( JobThread ) ) );
+		m_threads.push_back( std::thread( &( JobThread ), this, ( unsigned int ) i ) );
+	}
+
+	while ( m_numWorkersStarted.load( std::memory_order_acquire ) < ( unsigned int ) threadsToUse )
+	{
+		std::this_thread::yield();
 	}
 
 	LoggerPrintf( "The Job System initialized.\n" );
@@ -65,14 +175,26 @@ void TheJobSystem::Startup()
 //-----------------------------------------------------------------------------------------------
 void TheJobSystem::Shutdown()
 {
+	m_parkLock.lock();
 	m_isRunning = false;
+	m_parkLock.unlock();
+	m_parkCondition.notify_all();
 
 	for ( unsigned int i = 0; i < m_threads.size(); ++i )
 	{
 		m_threads[ i ].join();
 	}
+	m_threads.clear();
+
+	for ( unsigned int i = 0; i < m_workers.size(); ++i )
+	{
+		delete m_workers[ i ];
+	}
+	m_workers.clear();
+	m_workerSettings.clear();
+	m_numWorkersStarted = 0;
 
-	m_jobPool.Shutdown();
+	m_jobAllocator.Shutdown();
 
 	for ( int j = 0; j > JobCategory::NUM_JOB_CATEGORIES; j++ )
 	{
@@ -84,58 +206,395 @@ void TheJobSystem::Shutdown()
 
 
 //-----------------------------------------------------------------------------------------------
+// Counts hardware threads, not physical cores
 unsigned int TheJobSystem::GetSystemCoreCount() const
 {
-	SYSTEM_INFO sysinfo;
-	GetSystemInfo( &sysinfo );
+	return GetCpuTopology().GetNumLogicalProcessors();
+}
+
 
-	return ( unsigned int ) sysinfo.dwNumberOfProcessors;
+//-----------------------------------------------------------------------------------------------
+// Workers pick up the new settings on their next idle round
+void TheJobSystem::SetIdlePolicy( JobIdlePolicy idlePolicy )
+{
+	m_idlePolicy = idlePolicy;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobIdleSettings const &TheJobSystem::GetIdleSettings() const
+{
+	return IDLE_SETTINGS_BY_POLICY[ m_idlePolicy.load( std::memory_order_relaxed ) ];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Must be called before Startup. Reserved workers only run jobs of this category, which keeps
+// them free for it. Exclusive categories are also dropped by every other worker, which keeps
+// e.g. blocking IO from tying up the general workers.
+void TheJobSystem::ReserveWorkers( JobCategory category, unsigned int numWorkers, bool isExclusive )
+{
+	ASSERT_OR_DIE( m_workers.empty(), "Job workers must be reserved before the job system starts!" );
+	ASSERT_OR_DIE( !isExclusive || numWorkers > 0, "An exclusive job category needs at least one worker!" );
+
+	m_numReservedWorkers[ category ] = numWorkers;
+	m_hasReservedWorkers = true;
+
+	if ( isExclusive )
+	{
+		m_exclusiveCategoriesMask |= 1u << category;
+	}
+	else
+	{
+		m_exclusiveCategoriesMask &= ~( 1u << category );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Must be called before Startup. With JOB_PLACEMENT_PHYSICAL_CORES the number of workers is
+// capped at the number of physical cores.
+void TheJobSystem::SetPlacementPolicy( JobPlacementPolicy placementPolicy )
+{
+	ASSERT_OR_DIE( m_workers.empty(), "Job placement must be set before the job system starts!" );
+	m_placementPolicy = placementPolicy;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Categories that threads other than the workers help with while joining. Defaults to critical
+// and frame work so the main thread never picks up a long background job.
+void TheJobSystem::SetMainThreadCategories( unsigned int categoryMask )
+{
+	m_mainThreadCategoriesMask = categoryMask;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int TheJobSystem::GetMainThreadCategories() const
+{
+	return m_mainThreadCategoriesMask;
 }
 
 
 //-----------------------------------------------------------------------------------------------
 Job* TheJobSystem::JobCreate( JobCategory category, JobCallback* callback )
 {
-	Job* newJob = m_jobPool.Alloc();
+	// Jobs may be created from any thread, including inside other jobs
+	Job* newJob = new ( m_jobAllocator.Alloc() ) Job();
 
 	newJob->m_callbackFunc = callback;
 	newJob->m_jobCategory = category;
-	newJob->m_readHead = 0;
-	newJob->m_writeHead = 0;
-	newJob->m_refCount = 1;
 
 	return newJob;
 }
 
 
 //-----------------------------------------------------------------------------------------------
+// The parent does not count as finished until every child has finished, so joining the parent
+// waits on the whole group. A job with a null callback can be used as an empty group node.
+Job* TheJobSystem::JobCreateChild( Job* parent, JobCategory category, JobCallback* callback )
+{
+	ASSERT_OR_DIE( !JobIsFinished( parent ), "Cannot add a child to a job that has already finished!" );
+
+	Job* newJob = JobCreate( category, callback );
+
+	// The child keeps its parent alive until it reports back in JobFinish
+	parent->m_refCount++;
+	parent->m_unfinishedJobs++;
+	newJob->m_parentJob = parent;
+
+	return newJob;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job will not be enqueued until dependency has finished. Must be called before job is dispatched.
+// If dependency has already finished this does nothing.
+void TheJobSystem::JobAddDependency( Job* job, Job* dependency )
+{
+	while ( dependency->m_continuationLock.exchange( true, std::memory_order_acquire ) );
+
+	if ( dependency->m_numContinuations != JOB_CONTINUATIONS_CLOSED )
+	{
+		ASSERT_OR_DIE( dependency->m_numContinuations < MAX_JOB_CONTINUATIONS, "Too many continuations on one job!" );
+		if ( dependency->m_continuations == nullptr )
+		{
+			dependency->m_continuations = ( Job** ) AllocJobBlock();
+		}
+
+		job->m_pendingDependencies++;
+		dependency->m_continuations[ dependency->m_numContinuations ] = job;
+		dependency->m_numContinuations++;
+	}
+
+	dependency->m_continuationLock.store( false, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Jobs with outstanding dependencies are held back and enqueued by whichever dependency
+// finishes last
 void TheJobSystem::JobDispatch( Job* job )
 {
-	ThreadSafeQueue< Job* >* jobQueue = GetQueueForCategory( job->m_jobCategory );
 	job->m_refCount++;
-	jobQueue->Enqueue( job );
+
+	if ( --job->m_pendingDependencies == 0 )
+	{
+		JobEnqueue( job );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void TheJobSystem::JobEnqueue( Job* job )
+{
+	if ( m_telemetry.IsRecording() )
+	{
+		job->m_enqueueCount = ( uint32_t ) GetCurrentPerformanceCount() | 1;
+	}
+
+	JobWorker* currentWorker = GetCurrentWorker();
+	if ( m_schedulerMode == JOB_SCHEDULER_WORK_STEALING && currentWorker != nullptr )
+	{
+		currentWorker->m_localQueues[ job->m_jobCategory ].Push( job );
+	}
+	else
+	{
+		ThreadSafeQueue< Job* >* jobQueue = GetQueueForCategory( job->m_jobCategory );
+		jobQueue->Enqueue( job );
+	}
+
+	// Pairs with the fence in ParkWorker: either we see the parked worker, or it sees this job
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( m_numParkedWorkers.load( std::memory_order_relaxed ) > 0 )
+	{
+		WakeParkedWorker( job->m_jobCategory );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// With reserved workers the one woken might not serve this category, so wake them all and let
+// those that don't go back to sleep
+void TheJobSystem::WakeParkedWorker( JobCategory category )
+{
+	m_parkLock.lock();
+	m_wakeCounts[ category ]++;
+	m_parkLock.unlock();
+
+	if ( m_hasReservedWorkers )
+	{
+		m_parkCondition.notify_all();
+	}
+	else
+	{
+		m_parkCondition.notify_one();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Must hold m_parkLock
+unsigned int TheJobSystem::GetWakeCount( unsigned int categoryMask ) const
+{
+	unsigned int wakeCount = 0;
+	for ( int categoryIndex = 0; categoryIndex < NUM_JOB_CATEGORIES; ++categoryIndex )
+	{
+		if ( ( categoryMask & ( 1u << categoryIndex ) ) != 0 )
+		{
+			wakeCount += m_wakeCounts[ categoryIndex ];
+		}
+	}
+
+	return wakeCount;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Sleeps the calling worker until a job is enqueued or the system shuts down. The worker
+// announces itself as parked before its last look at the queues, so a job enqueued at the same
+// moment is either found here or triggers a wake.
+void TheJobSystem::ParkWorker( JobConsumer& consumer )
+{
+	unsigned int categoryMask = GetCurrentWorker()->m_categoryMask;
+
+	std::unique_lock< std::mutex > parkLock( m_parkLock );
+	unsigned int wakeCountWhenParked = GetWakeCount( categoryMask );
+	m_numParkedWorkers++;
+	parkLock.unlock();
+
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( consumer.Consume() )
+	{
+		m_numParkedWorkers--;
+		return;
+	}
+
+	m_totalParks++;
+	m_telemetry.RecordEvent( JOB_EVENT_PARK_BEGIN, 0 );
+
+	parkLock.lock();
+	while ( GetWakeCount( categoryMask ) == wakeCountWhenParked && m_isRunning )
+	{
+		m_parkCondition.wait( parkLock );
+	}
+	m_numParkedWorkers--;
+	parkLock.unlock();
+
+	m_telemetry.RecordEvent( JOB_EVENT_PARK_END, 0 );
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void TheJobSystem::JobDetach( Job* job )
 {
-	job->m_refCount--;
-	if ( job->m_refCount == 0 )
+	// Whoever drops the last reference returns the job, be it the creator or the worker
+	if ( --job->m_refCount == 0 )
 	{
-		m_jobPool.Delete( job );
+		job->~Job();
+		m_jobAllocator.Free( job );
 	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
+// Rather than spinning, the calling thread helps by running other ready jobs while it waits.
+// Worker threads help with the categories they serve, other threads with the main thread ones.
 void TheJobSystem::JobJoin( Job* job )
 {
-	while ( job->m_refCount == 2 );
+	JobWorker* currentWorker = GetCurrentWorker();
+
+	JobConsumer helper( this );
+	helper.AddCategories( ( currentWorker != nullptr ) ? currentWorker->m_categoryMask : m_mainThreadCategoriesMask );
+
+	while ( !JobIsFinished( job ) )
+	{
+		if ( !helper.Consume() )
+		{
+			std::this_thread::yield();
+		}
+	}
+
 	JobDetach( job );
 }
 
 
+//-----------------------------------------------------------------------------------------------
+bool TheJobSystem::JobIsFinished( Job* job ) const
+{
+	return ( job->m_unfinishedJobs.load( std::memory_order_acquire ) == 0 );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Called once a job's own work is done, and again on the parent for each child that finishes.
+// When the job and all of its children are done, its continuations are released and the
+// parent is told.
+void TheJobSystem::JobFinish( Job* job )
+{
+	if ( --job->m_unfinishedJobs > 0 )
+	{
+		return;
+	}
+
+	while ( job->m_continuationLock.exchange( true, std::memory_order_acquire ) );
+	int numContinuations = job->m_numContinuations;
+	job->m_numContinuations = JOB_CONTINUATIONS_CLOSED;
+	job->m_continuationLock.store( false, std::memory_order_release );
+
+	// No continuation can be added once closed, so the list can be walked without the lock
+	for ( int continuationIndex = 0; continuationIndex < numContinuations; ++continuationIndex )
+	{
+		Job* continuation = job->m_continuations[ continuationIndex ];
+		if ( --continuation->m_pendingDependencies == 0 )
+		{
+			JobEnqueue( continuation );
+		}
+	}
+
+	Job* parentJob = job->m_parentJob;
+	if ( parentJob != nullptr )
+	{
+		JobFinish( parentJob );
+		JobDetach( parentJob );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Looks for work in the calling worker's own deque first, then the shared queue, then peers
+Job* TheJobSystem::JobFetch( JobCategory category )
+{
+	Job* job = nullptr;
+
+	JobWorker* currentWorker = GetCurrentWorker();
+	if ( currentWorker != nullptr && currentWorker->m_localQueues[ category ].Pop( &job ) )
+	{
+		return job;
+	}
+
+	if ( GetQueueForCategory( category )->Dequeue( &job ) )
+	{
+		return job;
+	}
+
+	if ( m_schedulerMode == JOB_SCHEDULER_WORK_STEALING )
+	{
+		return StealJob( category, currentWorker );
+	}
+
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The calling thread runs the first piece itself, then helps with the rest until done
+void TheJobSystem::ParallelForRange( int begin, int end, int grainSize, ParallelForRangeFunction* rangeFunction,
+	void const* userFunction )
+{
+	int count = end - begin;
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	if ( grainSize <= 0 )
+	{
+		// Aim for several pieces per worker so stealing can even out uneven work
+		int numThreads = ( int ) m_workers.size() + 1;
+		grainSize = count / ( numThreads * PARALLEL_FOR_PIECES_PER_WORKER );
+	}
+
+	int minimumGrainSize = ( count + PARALLEL_FOR_MAX_PIECES - 1 ) / PARALLEL_FOR_MAX_PIECES;
+	if ( grainSize < minimumGrainSize )
+	{
+		grainSize = minimumGrainSize;
+	}
+
+	if ( count <= grainSize || m_workers.empty() )
+	{
+		( *rangeFunction )( userFunction, begin, end );
+		return;
+	}
+
+	// Never dispatched, so only children ever go through the queues
+	Job* rootJob = JobCreate( JOB_CATEGORY_GENERIC, &ParallelForJob );
+	rootJob->JobWrite< TheJobSystem* >( this );
+	rootJob->JobWrite< ParallelForRangeFunction* >( rangeFunction );
+	rootJob->JobWrite< void const* >( userFunction );
+	rootJob->JobWrite< int >( begin );
+	rootJob->JobWrite< int >( end );
+	rootJob->JobWrite< int >( grainSize );
+	rootJob->JobWrite< MemoryTag >( GetCurrentMemoryTag() );
+	rootJob->EndJobWrite();
+
+	rootJob->DoWork();
+	JobFinish( rootJob );
+	JobJoin( rootJob );
+}
+
+
 //-----------------------------------------------------------------------------------------------
 ThreadSafeQueue< Job* >* TheJobSystem::GetQueueForCategory( JobCategory category )
 {
@@ -144,7 +603,87 @@ ThreadSafeQueue< Job* >* TheJobSystem::GetQueueForCategory( JobCategory category
 
 
 //-----------------------------------------------------------------------------------------------
-JobConsumer::JobConsumer()
+// Returns nullptr when not called from one of this system's worker threads
+JobWorker* TheJobSystem::GetCurrentWorker() const
+{
+	if ( t_workerJobSystem != this )
+	{
+		return nullptr;
+	}
+
+	return t_currentWorker;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Visits every other worker once, starting from a random victim so thieves spread out. When
+// NUMA-aware, workers on the thief's own node are all tried before any remote one.
+Job* TheJobSystem::StealJob( JobCategory category, JobWorker* thief )
+{
+	unsigned int numWorkers = m_workers.size();
+	if ( numWorkers == 0 )
+	{
+		return nullptr;
+	}
+
+	unsigned int startIndex = 0;
+	if ( thief != nullptr )
+	{
+		// xorshift32
+		thief->m_randomState ^= thief->m_randomState << 13;
+		thief->m_randomState ^= thief->m_randomState >> 17;
+		thief->m_randomState ^= thief->m_randomState << 5;
+		startIndex = thief->m_randomState % numWorkers;
+	}
+
+	bool preferLocalNode = m_preferLocalNodeSteals && ( thief != nullptr );
+
+	Job* job = nullptr;
+	for ( int pass = preferLocalNode ? 0 : 1; pass < 2; ++pass )
+	{
+		for ( unsigned int offset = 0; offset < numWorkers; ++offset )
+		{
+			JobWorker* victim = m_workers[ ( startIndex + offset ) % numWorkers ];
+			if ( victim == thief )
+			{
+				continue;
+			}
+
+			// First pass local victims only, second pass remote only, or everyone if not NUMA-aware
+			if ( preferLocalNode && ( ( victim->m_nodeIndex == thief->m_nodeIndex ) != ( pass == 0 ) ) )
+			{
+				continue;
+			}
+
+			if ( victim->m_localQueues[ category ].Steal( &job ) )
+			{
+				m_telemetry.RecordEvent( JOB_EVENT_STEAL, category, victim->m_workerIndex );
+				return job;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobWorker::JobWorker( unsigned int workerIndex )
+	: m_workerIndex( workerIndex )
+	, m_categoryMask( ALL_JOB_CATEGORIES_MASK )
+	, m_randomState( 2463534242u + workerIndex * 2654435761u )
+	, m_processorIndex( INVALID_PROCESSOR_INDEX )
+	, m_nodeIndex( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobConsumer::JobConsumer( TheJobSystem* jobSystem )
+	: m_jobSystem( jobSystem )
+	, m_starvationInterval( DEFAULT_JOB_STARVATION_INTERVAL )
+	, m_numJobsRun( 0 )
+	, m_isIdle( false )
 {
 }
 
@@ -156,6 +695,20 @@ void JobConsumer::AddCategory( JobCategory category )
 }
 
 
+//-----------------------------------------------------------------------------------------------
+// Adds each category in the mask, highest priority first
+void JobConsumer::AddCategories( unsigned int categoryMask )
+{
+	for ( int categoryIndex = 0; categoryIndex < NUM_JOB_CATEGORIES; ++categoryIndex )
+	{
+		if ( ( categoryMask & ( 1u << categoryIndex ) ) != 0 )
+		{
+			AddCategory( ( JobCategory ) categoryIndex );
+		}
+	}
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void JobConsumer::ConsumeAll()
 {
@@ -166,14 +719,18 @@ void JobConsumer::ConsumeAll()
 //-----------------------------------------------------------------------------------------------
 bool JobConsumer::Consume()
 {
-	for each ( JobCategory category in m_categoriesToConsume )
+	TheJobSystem* jobSystem = ( m_jobSystem != nullptr ) ? m_jobSystem : g_theJobSystem;
+
+	unsigned int numCategories = m_categoriesToConsume.size();
+	bool isLowestFirst = ( m_starvationInterval > 0 ) && ( m_numJobsRun % m_starvationInterval == m_starvationInterval - 1 );
+
+	for ( unsigned int orderIndex = 0; orderIndex < numCategories; ++orderIndex )
 	{
-		ThreadSafeQueue< Job* >* thisQueue = g_theJobSystem->GetQueueForCategory( category );
-		Job* thisJob;
-		if ( thisQueue->Dequeue( &thisJob ) )
+		JobCategory category = m_categoriesToConsume[ isLowestFirst ? numCategories - 1 - orderIndex : orderIndex ];
+		Job* thisJob = jobSystem->JobFetch( category );
+		if ( thisJob != nullptr )
 		{
-			thisJob->DoWork();
-			thisJob->FinishJob();
+			RunJob( thisJob );
 			return true;
 		}
 	}
@@ -182,9 +739,109 @@ bool JobConsumer::Consume()
 
 
 //-----------------------------------------------------------------------------------------------
+void JobConsumer::RunJob( Job* job )
+{
+	TheJobSystem* jobSystem = ( m_jobSystem != nullptr ) ? m_jobSystem : g_theJobSystem;
+	JobTelemetry& telemetry = jobSystem->m_telemetry;
+	m_numJobsRun++;
+
+	if ( telemetry.IsRecording() )
+	{
+		if ( m_isIdle )
+		{
+			telemetry.RecordEvent( JOB_EVENT_IDLE_END, 0 );
+		}
+
+		JobWorker* currentWorker = jobSystem->GetCurrentWorker();
+		if ( currentWorker != nullptr && m_numJobsRun % JOB_QUEUE_DEPTH_SAMPLE_INTERVAL == 0 )
+		{
+			size_t queueDepth = 0;
+			for ( int categoryIndex = 0; categoryIndex < NUM_JOB_CATEGORIES; ++categoryIndex )
+			{
+				queueDepth += currentWorker->m_localQueues[ categoryIndex ].Size();
+			}
+			telemetry.RecordEvent( JOB_EVENT_QUEUE_DEPTH, 0, ( uint32_t ) queueDepth );
+		}
+
+		uint32_t queueWait = ( job->m_enqueueCount != 0 ) ? ( uint32_t ) GetCurrentPerformanceCount() - job->m_enqueueCount : JOB_QUEUE_WAIT_UNKNOWN;
+		telemetry.RecordEvent( JOB_EVENT_JOB_START, job->m_jobCategory, queueWait );
+		job->DoWork();
+		telemetry.RecordEvent( JOB_EVENT_JOB_END, job->m_jobCategory );
+	}
+	else
+	{
+		job->DoWork();
+	}
+
+	m_isIdle = false;
+	FinishJob( job );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Called by workers when they run out of jobs, the idle period ends with the next job run
+void JobConsumer::BeginIdle()
+{
+	if ( m_isIdle )
+	{
+		return;
+	}
+
+	m_isIdle = true;
+
+	TheJobSystem* jobSystem = ( m_jobSystem != nullptr ) ? m_jobSystem : g_theJobSystem;
+	jobSystem->m_telemetry.RecordEvent( JOB_EVENT_IDLE_BEGIN, 0 );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Releases dependents, then drops the reference taken by JobDispatch, returning the job to the
+// pool if already detached
 void JobConsumer::FinishJob( Job* job )
 {
-	g_theJobSystem->JobDetach( job );
+	TheJobSystem* jobSystem = ( m_jobSystem != nullptr ) ? m_jobSystem : g_theJobSystem;
+	jobSystem->JobFinish( job );
+	jobSystem->JobDetach( job );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+Job::Job()
+	: m_refCount( 1 )
+	, m_pendingDependencies( 1 )
+	, m_unfinishedJobs( 1 )
+	, m_jobCategory( JOB_CATEGORY_GENERIC )
+	, m_numContinuations( 0 )
+	, m_continuationLock( false )
+	, m_parentJob( nullptr )
+	, m_continuations( nullptr )
+	, m_callbackFunc( nullptr )
+	, m_payloadDestructor( nullptr )
+	, m_payloadBlock( nullptr )
+	, m_payloadSize( 0 )
+	, m_readHead( 0 )
+	, m_enqueueCount( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+Job::~Job()
+{
+	if ( m_payloadDestructor != nullptr )
+	{
+		( *m_payloadDestructor )( GetPayload() );
+	}
+
+	if ( m_payloadBlock != nullptr )
+	{
+		FreeJobBlock( m_payloadBlock );
+	}
+
+	if ( m_continuations != nullptr )
+	{
+		FreeJobBlock( m_continuations );
+	}
 }
 
 
@@ -196,39 +853,277 @@ void Job::EndJobRead()
 
 
 //-----------------------------------------------------------------------------------------------
+// Writes always append to the payload, so there is nothing to rewind
 void Job::EndJobWrite()
 {
-	m_writeHead = 0;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Job::DoWork()
+// Returns where the next numBytes of payload go, moving the payload out to a pooled block the
+// first time it outgrows the inline buffer
+byte_t* Job::ReservePayload( size_t numBytes )
 {
-	( *m_callbackFunc )( this );
+	size_t newPayloadSize = m_payloadSize + numBytes;
+	ASSERT_OR_DIE( newPayloadSize <= JOB_BLOCK_SIZE, "Job payload is too big!" );
+
+	if ( m_payloadBlock == nullptr && newPayloadSize > JOB_INLINE_PAYLOAD_SIZE )
+	{
+		m_payloadBlock = ( byte_t* ) AllocJobBlock();
+		memcpy( m_payloadBlock, m_inlinePayload, m_payloadSize );
+	}
+
+	byte_t* destination = GetPayload() + m_payloadSize;
+	m_payloadSize = ( unsigned short ) newPayloadSize;
+	return destination;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Job::FinishJob()
+void Job::DoWork()
 {
-	m_refCount--;
+	if ( m_callbackFunc != nullptr )
+	{
+		( *m_callbackFunc )( this );
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void JobThread()
+void JobThread( TheJobSystem* jobSystem, unsigned int workerIndex )
 {
-	JobConsumer consumer = JobConsumer();
+	JobWorkerSettings const &settings = jobSystem->m_workerSettings[ workerIndex ];
+
+	bool isPinned = ( settings.m_processorIndex != INVALID_PROCESSOR_INDEX );
+	if ( isPinned && !PinCurrentThreadToProcessor( settings.m_processorIndex ) )
+	{
+		LoggerPrintfWithTag( "jobs", "Failed to pin job worker %u to processor %u\n", workerIndex, settings.m_processorIndex );
+	}
+
+	JobWorker* worker = new JobWorker( workerIndex );
+	worker->m_categoryMask = settings.m_categoryMask;
+	worker->m_processorIndex = settings.m_processorIndex;
+	worker->m_nodeIndex = settings.m_nodeIndex;
+	jobSystem->m_workers[ workerIndex ] = worker;
 
-	consumer.AddCategory( JOB_CATEGORY_GENERIC_SLOW );
-	consumer.AddCategory( JOB_CATEGORY_GENERIC );
+	t_workerJobSystem = jobSystem;
+	t_currentWorker = worker;
 
-	while ( g_theJobSystem->m_isRunning )
+	// Wait for every peer to exist before looking for work to steal
+	jobSystem->m_numWorkersStarted++;
+	while ( jobSystem->m_numWorkersStarted.load( std::memory_order_acquire ) < jobSystem->m_workers.size() )
 	{
-		consumer.ConsumeAll();
 		std::this_thread::yield();
 	}
 
+	JobConsumer consumer = JobConsumer( jobSystem );
+	consumer.AddCategories( worker->m_categoryMask );
+
+	std::string threadName = Stringf( "Job worker %u", workerIndex );
+	if ( isPinned )
+	{
+		threadName = Stringf( "Job worker %u (cpu %u)", workerIndex, settings.m_processorIndex );
+	}
+	jobSystem->m_telemetry.SetThreadName( threadName );
+	ProfilerSetThreadName( threadName.c_str() );
+
+	// Spin, then yield, then park, starting over whenever a job turns up
+	bool isIdle = false;
+	uint64_t idleStartCount = 0;
+	while ( jobSystem->m_isRunning )
+	{
+		if ( consumer.Consume() )
+		{
+			isIdle = false;
+			continue;
+		}
+
+		if ( !isIdle )
+		{
+			isIdle = true;
+			idleStartCount = GetCurrentPerformanceCount();
+			consumer.BeginIdle();
+		}
+
+		double idleSeconds = PerformanceCountToSeconds( GetCurrentPerformanceCount() - idleStartCount );
+		JobIdleSettings const &idleSettings = jobSystem->GetIdleSettings();
+		if ( idleSeconds < idleSettings.m_spinSeconds )
+		{
+			YieldProcessor();
+		}
+		else if ( idleSeconds < idleSettings.m_spinSeconds + idleSettings.m_yieldSeconds )
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			jobSystem->ParkWorker( consumer );
+			isIdle = false;
+		}
+	}
+
 	consumer.ConsumeAll();
+
+	t_workerJobSystem = nullptr;
+	t_currentWorker = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Lazy binary splitting: a worker only splits off half of its remaining range when its own deque
+// is empty, i.e. when the piece it split off last time has been stolen. Under load it just works
+// through grain-sized chunks; when peers are idle it keeps feeding them. Threads without a deque
+// split eagerly down to the grain size.
+void ParallelForJob( Job* job )
+{
+	TheJobSystem* jobSystem = job->JobRead< TheJobSystem* >();
+	ParallelForRangeFunction* rangeFunction = job->JobRead< ParallelForRangeFunction* >();
+	void const* userFunction = job->JobRead< void const* >();
+	int begin = job->JobRead< int >();
+	int end = job->JobRead< int >();
+	int grainSize = job->JobRead< int >();
+	MemoryTag memoryTag = job->JobRead< MemoryTag >();
+	job->EndJobRead();
+
+	// Allocations on whichever worker runs a piece count against the caller's tag
+	MEMORY_TAG_SCOPE( memoryTag );
+	JobWorker* currentWorker = jobSystem->GetCurrentWorker();
+
+	while ( end - begin > grainSize )
+	{
+		bool shouldSplit = ( currentWorker == nullptr )
+			|| ( currentWorker->m_localQueues[ JOB_CATEGORY_GENERIC ].Size() == 0 );
+
+		if ( shouldSplit )
+		{
+			int middle = begin + ( end - begin ) / 2;
+
+			Job* childJob = jobSystem->JobCreateChild( job, JOB_CATEGORY_GENERIC, &ParallelForJob );
+			childJob->JobWrite< TheJobSystem* >( jobSystem );
+			childJob->JobWrite< ParallelForRangeFunction* >( rangeFunction );
+			childJob->JobWrite< void const* >( userFunction );
+			childJob->JobWrite< int >( middle );
+			childJob->JobWrite< int >( end );
+			childJob->JobWrite< int >( grainSize );
+			childJob->JobWrite< MemoryTag >( memoryTag );
+			childJob->EndJobWrite();
+			jobSystem->JobDispatch( childJob );
+			jobSystem->JobDetach( childJob );
+
+			end = middle;
+		}
+		else
+		{
+			( *rangeFunction )( userFunction, begin, begin + grainSize );
+			begin += grainSize;
+		}
+	}
+
+	( *rangeFunction )( userFunction, begin, end );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* AllocJobBlock()
+{
+	return s_jobBlockAllocator.Alloc();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FreeJobBlock( void* block )
+{
+	s_jobBlockAllocator.Free( block );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobAllocatorStats GetJobBlockStats()
+{
+	return s_jobBlockAllocator.GetStats();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_idle_policy [latency|balanced|power]
+CONSOLE_COMMAND( job_idle_policy )
+{
+	if ( g_theJobSystem == nullptr )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No job system running.", Rgba::RED );
+		return;
+	}
+
+	const char* POLICY_NAMES[ NUM_JOB_IDLE_POLICIES ] = { "latency", "balanced", "power" };
+
+	if ( args.m_argList.empty() )
+	{
+		g_theDeveloperConsole->ConsolePrint( std::string( "Job idle policy: " ) + POLICY_NAMES[ g_theJobSystem->m_idlePolicy.load() ] );
+		return;
+	}
+
+	for ( int policyIndex = 0; policyIndex < NUM_JOB_IDLE_POLICIES; ++policyIndex )
+	{
+		if ( args.m_argList[ 0 ] == POLICY_NAMES[ policyIndex ] )
+		{
+			g_theJobSystem->SetIdlePolicy( ( JobIdlePolicy ) policyIndex );
+			g_theDeveloperConsole->ConsolePrint( std::string( "Job idle policy set to " ) + POLICY_NAMES[ policyIndex ] );
+			return;
+		}
+	}
+
+	g_theDeveloperConsole->ConsolePrint( "Usage: job_idle_policy [latency|balanced|power]", Rgba::RED );
 }
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND( job_allocator_stats )
+{
+	UNUSED( args );
+
+	if ( g_theJobSystem == nullptr )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No job system running.", Rgba::RED );
+		return;
+	}
+
+	JobAllocatorStats allocatorStats[ 2 ] = { g_theJobSystem->m_jobAllocator.GetStats(), GetJobBlockStats() };
+	const char* ALLOCATOR_NAMES[ 2 ] = { "Jobs", "Job blocks" };
+
+	for ( int allocatorIndex = 0; allocatorIndex < 2; ++allocatorIndex )
+	{
+		JobAllocatorStats const &stats = allocatorStats[ allocatorIndex ];
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%s: %u pages, %u x %u bytes, %lld live", ALLOCATOR_NAMES[ allocatorIndex ],
+			stats.m_numPages, stats.m_capacity, ( unsigned int ) stats.m_blockSize, stats.m_numLiveBlocks ) );
+		g_theDeveloperConsole->ConsolePrint( Stringf( "  Allocs: %llu Frees: %llu Batches fetched: %llu returned: %llu",
+			stats.m_numAllocs, stats.m_numFrees, stats.m_numBatchesFetched, stats.m_numBatchesReturned ) );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND( job_topology )
+{
+	UNUSED( args );
+
+	CpuTopology const &cpuTopology = GetCpuTopology();
+	g_theDeveloperConsole->ConsolePrint( cpuTopology.GetDescription() );
+
+	if ( g_theJobSystem == nullptr )
+	{
+		return;
+	}
+
+	const char* PLACEMENT_NAMES[ NUM_JOB_PLACEMENT_POLICIES ] = { "none", "physical cores", "logical processors" };
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Job placement: %s, local node steals %s", PLACEMENT_NAMES[ g_theJobSystem->m_placementPolicy ],
+		g_theJobSystem->m_preferLocalNodeSteals ? "on" : "off" ) );
+
+	for ( unsigned int workerIndex = 0; workerIndex < g_theJobSystem->m_workers.size(); ++workerIndex )
+	{
+		JobWorker const* worker = g_theJobSystem->m_workers[ workerIndex ];
+		if ( worker->m_processorIndex != INVALID_PROCESSOR_INDEX )
+		{
+			g_theDeveloperConsole->ConsolePrint( Stringf( "  Worker %u: cpu %u, node %u", workerIndex, worker->m_processorIndex, worker->m_nodeIndex ) );
+		}
+	}
+}
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <new>
 #include <vector>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include "Engine/Core/EngineCommon.hpp"
-#include "Engine/Tools/Profiling/ObjectPool.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Tools/Logging/ThreadSafeQueue.hpp"
+#include "Engine/Tools/Jobs/WorkStealingDeque.hpp"
+#include "Engine/Tools/Jobs/JobAllocator.hpp"
+#include "Engine/Tools/Jobs/JobTelemetry.hpp"
+#include "Engine/Tools/Jobs/CpuTopology.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -18,68 +26,179 @@ extern TheJobSystem* g_theJobSystem;
 
 
 //-----------------------------------------------------------------------------------------------
-enum JobCategory
+// Listed from highest to lowest priority
+enum JobCategory : unsigned char
 {
-	JOB_CATEGORY_GENERIC = 0, // Can run on main thread
-	JOB_CATEGORY_GENERIC_SLOW, // Shouldn't run on main thread, but can
+	JOB_CATEGORY_CRITICAL = 0, // Latency critical frame work, runs on main thread
+	JOB_CATEGORY_GENERIC, // Frame work, can run on main thread
+	JOB_CATEGORY_GENERIC_SLOW, // Background work, shouldn't run on main thread, but can
+	JOB_CATEGORY_IO, // Blocking file and network work, never runs on main thread
 	NUM_JOB_CATEGORIES
 };
 
 
+//-----------------------------------------------------------------------------------------------
+const unsigned int ALL_JOB_CATEGORIES_MASK = ( 1u << NUM_JOB_CATEGORIES ) - 1;
+const unsigned int DEFAULT_MAIN_THREAD_JOB_CATEGORIES_MASK = ( 1u << JOB_CATEGORY_CRITICAL ) | ( 1u << JOB_CATEGORY_GENERIC );
+const unsigned int DEFAULT_JOB_STARVATION_INTERVAL = 16;
+
+
+//-----------------------------------------------------------------------------------------------
+enum JobSchedulerMode
+{
+	JOB_SCHEDULER_SHARED_QUEUE = 0, // Every worker contends on one locked queue per category
+	JOB_SCHEDULER_WORK_STEALING, // Per-worker lock-free deques, idle workers steal from peers
+	NUM_JOB_SCHEDULER_MODES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// What an idle worker does before it parks: spin on the queues, then yield its time slice, then
+// sleep until JobDispatch wakes it
+enum JobIdlePolicy
+{
+	JOB_IDLE_POLICY_LATENCY = 0, // Spin for a long time, park rarely
+	JOB_IDLE_POLICY_BALANCED,
+	JOB_IDLE_POLICY_POWER, // Park almost immediately, for shared servers and battery
+	NUM_JOB_IDLE_POLICIES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Where worker threads run. Pinned workers steal from peers on their own NUMA node first.
+enum JobPlacementPolicy
+{
+	JOB_PLACEMENT_NONE = 0, // The OS moves workers around freely
+	JOB_PLACEMENT_PHYSICAL_CORES, // Pinned, at most one worker per core so no two share SMT siblings
+	JOB_PLACEMENT_LOGICAL_PROCESSORS, // Pinned to hardware threads, every core filled before its siblings
+	NUM_JOB_PLACEMENT_POLICIES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct JobIdleSettings
+{
+	double m_spinSeconds;
+	double m_yieldSeconds; // After spinning
+};
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t JOB_INLINE_PAYLOAD_SIZE = JOB_CACHE_LINE_SIZE;
+const size_t JOB_BLOCK_SIZE = 512; // Pooled payloads past the inline size, and continuation lists
+const int MAX_JOB_CONTINUATIONS = JOB_BLOCK_SIZE / 8;
+const unsigned char JOB_CONTINUATIONS_CLOSED = 0xFF;
+
+
 //-----------------------------------------------------------------------------------------------
 typedef unsigned char byte_t;
 typedef void ( JobCallback )( Job* );
-class Job
+typedef void ( JobPayloadDestructor )( void* payload );
+typedef void ( ParallelForRangeFunction )( void const* userFunction, int begin, int end );
+
+
+//-----------------------------------------------------------------------------------------------
+// Two cache lines: the payload, then the header. Payloads up to JOB_INLINE_PAYLOAD_SIZE live in
+// the job itself; bigger ones move to a pooled block, up to JOB_BLOCK_SIZE.
+class alignas( JOB_CACHE_LINE_SIZE ) Job
 {
 public:
+	Job();
+	~Job();
+
 	template < typename T >
 	T JobRead()
 	{
-		T retData;
+		ASSERT_OR_DIE( m_readHead + sizeof( T ) <= m_payloadSize, "Read past the end of a job payload!" );
 
-		// ASSERT
-		memcpy( &retData, m_byteBuffer + m_readHead, sizeof( T ) );
-		m_readHead += sizeof( T );
+		T retData;
+		memcpy( &retData, GetPayload() + m_readHead, sizeof( T ) );
+		m_readHead = ( unsigned short ) ( m_readHead + sizeof( T ) );
 		return retData;
 	}
 
 	template < typename T >
 	void JobWrite( T const &v )
 	{
-		// ASSERT
-		memcpy( m_byteBuffer + m_writeHead, &v, sizeof( T ) );
-		m_writeHead += sizeof( T );
+		memcpy( ReservePayload( sizeof( T ) ), &v, sizeof( T ) );
 	}
 
 	void EndJobRead();
 	void EndJobWrite();
 
+	byte_t* GetPayload() { return ( m_payloadBlock != nullptr ) ? m_payloadBlock : m_inlinePayload; }
+	byte_t* ReservePayload( size_t numBytes );
 	void DoWork();
-	void FinishJob();
 
 public:
+	byte_t m_inlinePayload[ JOB_INLINE_PAYLOAD_SIZE ];
+
 	std::atomic< int > m_refCount;
-	byte_t m_byteBuffer[ 512 ];
-	unsigned int m_readHead;
-	unsigned int m_writeHead;
+	std::atomic< int > m_pendingDependencies; // Enqueued once this hits zero; JobDispatch holds one
+	std::atomic< int > m_unfinishedJobs; // This job plus any unfinished children
 	JobCategory m_jobCategory;
+	unsigned char m_numContinuations; // JOB_CONTINUATIONS_CLOSED once the job has finished
+	std::atomic< bool > m_continuationLock;
+	Job* m_parentJob;
+	Job** m_continuations; // Pooled block, taken on the first JobAddDependency
 	JobCallback* m_callbackFunc;
+	JobPayloadDestructor* m_payloadDestructor; // For callables, run when the job is freed
+	byte_t* m_payloadBlock; // Null while the payload fits inline
+	unsigned short m_payloadSize;
+	unsigned short m_readHead;
+	uint32_t m_enqueueCount; // Low bits of the performance count when queued, 0 if not recording
 };
 
 
 //-----------------------------------------------------------------------------------------------
+// One per worker thread. Jobs dispatched from a worker land in its own deque for that category;
+// jobs dispatched from any other thread go through the shared queue for the category. A worker
+// only runs, steals and helps with the categories in its mask.
+struct JobWorker
+{
+	JobWorker( unsigned int workerIndex );
+
+	WorkStealingDeque< Job* > m_localQueues[ NUM_JOB_CATEGORIES ];
+	unsigned int m_workerIndex;
+	unsigned int m_categoryMask;
+	unsigned int m_randomState;
+	unsigned int m_processorIndex; // INVALID_PROCESSOR_INDEX if not pinned
+	unsigned int m_nodeIndex;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Decided by Startup, applied by each worker thread as it starts
+struct JobWorkerSettings
+{
+	unsigned int m_categoryMask;
+	unsigned int m_processorIndex;
+	unsigned int m_nodeIndex;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Categories are tried in the order they were added. Every m_starvationInterval jobs the order
+// is reversed for one fetch, so a steady stream of urgent work can't starve the rest.
 class JobConsumer
 {
 public:
-	JobConsumer();
+	JobConsumer( TheJobSystem* jobSystem = nullptr );
 
 	void AddCategory( JobCategory category );
+	void AddCategories( unsigned int categoryMask );
 	void ConsumeAll();
 	bool Consume();
+	void RunJob( Job* job );
 	void FinishJob( Job* job );
+	void BeginIdle();
 
 public:
+	TheJobSystem* m_jobSystem;
 	std::vector< JobCategory > m_categoriesToConsume;
+	unsigned int m_starvationInterval; // 0 for strict priority order
+	unsigned int m_numJobsRun;
+	bool m_isIdle; // Only tracked for telemetry
 };
 
 
@@ -87,31 +206,146 @@ public:
 class TheJobSystem
 {
 public:
-	TheJobSystem( unsigned int numJobCategories, unsigned int numWorkerThreads );
+	TheJobSystem( unsigned int numJobCategories, unsigned int numWorkerThreads,
+		JobSchedulerMode schedulerMode = JOB_SCHEDULER_WORK_STEALING );
 	~TheJobSystem();
 
 	void Startup();
 	void Shutdown();
 
 	unsigned int GetSystemCoreCount() const;
+	void SetIdlePolicy( JobIdlePolicy idlePolicy );
+	JobIdleSettings const &GetIdleSettings() const;
+	void ReserveWorkers( JobCategory category, unsigned int numWorkers, bool isExclusive = false );
+	void SetPlacementPolicy( JobPlacementPolicy placementPolicy );
+	void SetMainThreadCategories( unsigned int categoryMask );
+	unsigned int GetMainThreadCategories() const;
 
 	Job* JobCreate( JobCategory category, JobCallback* callback);
+	Job* JobCreateChild( Job* parent, JobCategory category, JobCallback* callback );
+	template < typename Callable >
+	Job* JobCreateCallable( JobCategory category, Callable const &callable );
+	void JobAddDependency( Job* job, Job* dependency );
 	void JobDispatch( Job* job );
 	void JobDetach( Job* job );
 	void JobJoin( Job* job );
+	bool JobIsFinished( Job* job ) const;
+	Job* JobFetch( JobCategory category );
+	void JobFinish( Job* job );
+
+	template < typename Function >
+	void ParallelFor( int begin, int end, int grainSize, Function const &function );
+	void ParallelForRange( int begin, int end, int grainSize, ParallelForRangeFunction* rangeFunction,
+		void const* userFunction );
 
 	ThreadSafeQueue< Job* >* GetQueueForCategory( JobCategory category );
+	JobWorker* GetCurrentWorker() const;
+	void JobEnqueue( Job* job );
+	Job* StealJob( JobCategory category, JobWorker* thief );
+	void WakeParkedWorker( JobCategory category );
+	void ParkWorker( JobConsumer& consumer );
+	unsigned int GetWakeCount( unsigned int categoryMask ) const;
 
 public:
 	unsigned int m_numJobCategories;
 	unsigned int m_numWorkerThreads;
 	unsigned int m_numSystemCores;
+	JobSchedulerMode m_schedulerMode;
 	std::vector< ThreadSafeQueue< Job* >* > m_jobQueue;
+	std::vector< JobWorker* > m_workers;
+	std::vector< JobWorkerSettings > m_workerSettings;
+	std::atomic< unsigned int > m_numWorkersStarted;
 	std::vector< std::thread > m_threads;
-	ObjectPool< Job > m_jobPool;
-	bool m_isRunning;
+	JobAllocator m_jobAllocator;
+	std::atomic< bool > m_isRunning;
+	std::atomic< JobIdlePolicy > m_idlePolicy;
+	std::mutex m_parkLock;
+	std::condition_variable m_parkCondition;
+	std::atomic< int > m_numParkedWorkers;
+	unsigned int m_wakeCounts[ NUM_JOB_CATEGORIES ]; // Guarded by m_parkLock
+	std::atomic< unsigned int > m_totalParks;
+	unsigned int m_numReservedWorkers[ NUM_JOB_CATEGORIES ];
+	unsigned int m_exclusiveCategoriesMask; // Only served by workers reserved for them
+	bool m_hasReservedWorkers;
+	unsigned int m_mainThreadCategoriesMask;
+	JobPlacementPolicy m_placementPolicy;
+	bool m_preferLocalNodeSteals; // Only with pinned workers spread over more than one node
+	JobTelemetry m_telemetry;
 };
 
 
 //-----------------------------------------------------------------------------------------------
-void JobThread();
\ No newline at end of file
+void JobThread( TheJobSystem* jobSystem, unsigned int workerIndex );
+void ParallelForJob( Job* job );
+void* AllocJobBlock();
+void FreeJobBlock( void* block );
+JobAllocatorStats GetJobBlockStats();
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename Callable >
+void JobInvokeCallable( Job* job )
+{
+	( *( Callable* ) job->GetPayload() )();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename Callable >
+void JobDestroyCallable( void* payload )
+{
+	( ( Callable* ) payload )->~Callable();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Builds a job from anything callable with no arguments, e.g. a lambda. The callable is copied
+// into the job's payload, inline when it fits, and destroyed when the job is freed.
+template < typename Callable >
+Job* TheJobSystem::JobCreateCallable( JobCategory category, Callable const &callable )
+{
+	static_assert( alignof( Callable ) <= JOB_CACHE_LINE_SIZE, "Job callables can't be over-aligned" );
+	static_assert( sizeof( Callable ) <= JOB_BLOCK_SIZE, "Job callable is too big, capture by reference or pointer" );
+
+	Job* newJob = JobCreate( category, &JobInvokeCallable< Callable > );
+	new ( newJob->ReservePayload( sizeof( Callable ) ) ) Callable( callable );
+	newJob->m_payloadDestructor = &JobDestroyCallable< Callable >;
+	return newJob;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename Function >
+void ParallelForInvokeRange( void const* userFunction, int begin, int end )
+{
+	Function const &function = *( Function const* ) userFunction;
+	for ( int index = begin; index < end; ++index )
+	{
+		function( index );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Calls function( index ) for every index in [begin, end) and returns once all have run. Ranges
+// no bigger than grainSize run inline on the calling thread; pass 0 to pick one automatically.
+template < typename Function >
+void TheJobSystem::ParallelFor( int begin, int end, int grainSize, Function const &function )
+{
+	ParallelForRange( begin, end, grainSize, &ParallelForInvokeRange< Function >, &function );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Runs on g_theJobSystem, or serially if there isn't one
+template < typename Function >
+void ParallelFor( int begin, int end, int grainSize, Function const &function )
+{
+	if ( g_theJobSystem == nullptr )
+	{
+		ParallelForInvokeRange< Function >( &function, begin, end );
+		return;
+	}
+
+	g_theJobSystem->ParallelFor( begin, end, grainSize, function );
+}
\ No newline at end of file
@@ -0,0 +1,581 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "Engine/Tools/Jobs/JobSystemBenchmark.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+#include "Engine/Math/Noise.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Jobs per wave, the main thread joins each wave before spawning the next
+const unsigned int MAX_JOBS_IN_FLIGHT = 960;
+const unsigned int DEFAULT_BENCHMARK_JOB_COUNT = 1000000;
+const int DEFAULT_BENCHMARK_GRID_SIZE = 2048;
+const int BENCHMARK_NOISE_OCTAVES = 8;
+const int NUM_WAKE_SAMPLES = 50;
+const DWORD MILLISECONDS_BEFORE_WAKE = 20;
+const DWORD IDLE_MEASURE_MILLISECONDS = 1000;
+const int NUM_PRIORITY_SAMPLES = 50;
+const unsigned int BACKGROUND_JOBS_PER_WORKER = 16;
+const double BACKGROUND_JOB_SECONDS = 0.0005;
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkTinyJob( Job* job )
+{
+	std::atomic< unsigned int >* jobsCompleted = job->JobRead< std::atomic< unsigned int >* >();
+	job->EndJobRead();
+
+	( *jobsCompleted )++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Dispatches its children from a worker thread, which is the case work stealing is built for
+static void BenchmarkSpawnerJob( Job* job )
+{
+	TheJobSystem* jobSystem = job->JobRead< TheJobSystem* >();
+	std::atomic< unsigned int >* jobsCompleted = job->JobRead< std::atomic< unsigned int >* >();
+	unsigned int numChildren = job->JobRead< unsigned int >();
+	job->EndJobRead();
+
+	for ( unsigned int childIndex = 0; childIndex < numChildren; ++childIndex )
+	{
+		Job* childJob = jobSystem->JobCreate( JOB_CATEGORY_GENERIC, &BenchmarkTinyJob );
+		childJob->JobWrite< std::atomic< unsigned int >* >( jobsCompleted );
+		childJob->EndJobWrite();
+		jobSystem->JobDispatch( childJob );
+		jobSystem->JobDetach( childJob );
+	}
+
+	( *jobsCompleted )++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Returns seconds taken for numJobs jobs to be created, dispatched and completed
+double BenchmarkJobScheduler( JobSchedulerMode schedulerMode, unsigned int numWorkerThreads, unsigned int numJobs,
+	JobPlacementPolicy placementPolicy )
+{
+	TheJobSystem* jobSystem = new TheJobSystem( NUM_JOB_CATEGORIES, numWorkerThreads, schedulerMode );
+	jobSystem->SetPlacementPolicy( placementPolicy );
+	jobSystem->Startup();
+
+	// Placement may have capped the worker count
+	unsigned int numSpawners = jobSystem->m_workers.size();
+	unsigned int childrenPerSpawner = ( MAX_JOBS_IN_FLIGHT / numSpawners ) - 1;
+	if ( childrenPerSpawner < 1 )
+	{
+		childrenPerSpawner = 1;
+	}
+	unsigned int jobsPerWave = numSpawners * ( childrenPerSpawner + 1 );
+
+	std::atomic< unsigned int > jobsCompleted( 0 );
+	unsigned int jobsDispatched = 0;
+
+	double startSeconds = GetCurrentTimeSeconds();
+
+	while ( jobsDispatched < numJobs )
+	{
+		for ( unsigned int spawnerIndex = 0; spawnerIndex < numSpawners; ++spawnerIndex )
+		{
+			Job* spawnerJob = jobSystem->JobCreate( JOB_CATEGORY_GENERIC_SLOW, &BenchmarkSpawnerJob );
+			spawnerJob->JobWrite< TheJobSystem* >( jobSystem );
+			spawnerJob->JobWrite< std::atomic< unsigned int >* >( &jobsCompleted );
+			spawnerJob->JobWrite< unsigned int >( childrenPerSpawner );
+			spawnerJob->EndJobWrite();
+			jobSystem->JobDispatch( spawnerJob );
+			jobSystem->JobDetach( spawnerJob );
+		}
+
+		jobsDispatched += jobsPerWave;
+		while ( jobsCompleted < jobsDispatched )
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	delete jobSystem;
+
+	// Whole waves may overshoot numJobs slightly, so scale back to the requested count
+	return elapsedSeconds * ( double ) numJobs / ( double ) jobsDispatched;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Compares the shared queue scheduler against work stealing for 1 to maxWorkerThreads workers
+void RunJobSchedulerBenchmark( unsigned int maxWorkerThreads, unsigned int numJobs )
+{
+	LoggerPrintfWithTag( "jobs", "Job scheduler benchmark: %u jobs\n", numJobs );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Job scheduler benchmark: %u jobs", numJobs ) );
+
+	for ( unsigned int numWorkerThreads = 1; numWorkerThreads <= maxWorkerThreads; ++numWorkerThreads )
+	{
+		double sharedSeconds = BenchmarkJobScheduler( JOB_SCHEDULER_SHARED_QUEUE, numWorkerThreads, numJobs );
+		double stealingSeconds = BenchmarkJobScheduler( JOB_SCHEDULER_WORK_STEALING, numWorkerThreads, numJobs );
+
+		std::string result = Stringf( "%2u threads: shared %.1fms (%.0f jobs/s), stealing %.1fms (%.0f jobs/s), %.2fx",
+			numWorkerThreads,
+			sharedSeconds * 1000.0, numJobs / sharedSeconds,
+			stealingSeconds * 1000.0, numJobs / stealingSeconds,
+			sharedSeconds / stealingSeconds );
+
+		LoggerPrintfWithTag( "jobs", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Fills a gridSize x gridSize grid with octave noise, one row per index. Passing 0 worker threads
+// runs the loop serially to give the baseline.
+double BenchmarkParallelFor( unsigned int numWorkerThreads, int gridSize, JobPlacementPolicy placementPolicy )
+{
+	std::vector< float > noiseGrid( gridSize * gridSize );
+
+	auto generateNoiseRow = [ & ]( int rowIndex )
+	{
+		for ( int columnIndex = 0; columnIndex < gridSize; ++columnIndex )
+		{
+			float noiseValue = 0.0f;
+			for ( int octave = 0; octave < BENCHMARK_NOISE_OCTAVES; ++octave )
+			{
+				noiseValue += Get2dNoiseZeroToOne( columnIndex >> octave, rowIndex >> octave, octave );
+			}
+			noiseGrid[ rowIndex * gridSize + columnIndex ] = noiseValue;
+		}
+	};
+
+	if ( numWorkerThreads == 0 )
+	{
+		double startSeconds = GetCurrentTimeSeconds();
+		for ( int rowIndex = 0; rowIndex < gridSize; ++rowIndex )
+		{
+			generateNoiseRow( rowIndex );
+		}
+		return GetCurrentTimeSeconds() - startSeconds;
+	}
+
+	TheJobSystem* jobSystem = new TheJobSystem( NUM_JOB_CATEGORIES, numWorkerThreads );
+	jobSystem->SetPlacementPolicy( placementPolicy );
+	jobSystem->Startup();
+
+	double startSeconds = GetCurrentTimeSeconds();
+	jobSystem->ParallelFor( 0, gridSize, 0, generateNoiseRow );
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	delete jobSystem;
+
+	return elapsedSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Prints the ParallelFor scaling curve against the serial loop for 1 to maxWorkerThreads workers.
+// The calling thread also works, so N workers means N + 1 threads.
+void RunParallelForBenchmark( unsigned int maxWorkerThreads, int gridSize )
+{
+	double serialSeconds = BenchmarkParallelFor( 0, gridSize );
+
+	std::string header = Stringf( "ParallelFor benchmark: %dx%d noise grid, serial %.1fms", gridSize, gridSize, serialSeconds * 1000.0 );
+	LoggerPrintfWithTag( "jobs", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	for ( unsigned int numWorkerThreads = 1; numWorkerThreads <= maxWorkerThreads; ++numWorkerThreads )
+	{
+		double parallelSeconds = BenchmarkParallelFor( numWorkerThreads, gridSize );
+		double speedup = serialSeconds / parallelSeconds;
+
+		std::string result = Stringf( "%2u workers: %.1fms, %.2fx speedup, %.0f%% efficiency",
+			numWorkerThreads, parallelSeconds * 1000.0, speedup, 100.0 * speedup / ( numWorkerThreads + 1 ) );
+
+		LoggerPrintfWithTag( "jobs", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkWakeJob( Job* job )
+{
+	uint64_t* out_startCount = job->JobRead< uint64_t* >();
+	job->EndJobRead();
+
+	*out_startCount = GetCurrentPerformanceCount();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static double GetProcessCpuSeconds()
+{
+	FILETIME creationTime;
+	FILETIME exitTime;
+	FILETIME kernelTime;
+	FILETIME userTime;
+	GetProcessTimes( GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime );
+
+	ULARGE_INTEGER kernelTicks;
+	kernelTicks.LowPart = kernelTime.dwLowDateTime;
+	kernelTicks.HighPart = kernelTime.dwHighDateTime;
+
+	ULARGE_INTEGER userTicks;
+	userTicks.LowPart = userTime.dwLowDateTime;
+	userTicks.HighPart = userTime.dwHighDateTime;
+
+	// FILETIME is in 100ns ticks
+	return ( double ) ( kernelTicks.QuadPart + userTicks.QuadPart ) * 1.0e-7;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Wake latency is the time from dispatch until a worker starts the job, after the pool has sat
+// idle long enough to reach its parked state. Idle CPU is the process CPU time burned while the
+// main thread sleeps and nothing is dispatched, as a fraction of one core.
+void BenchmarkJobIdlePolicy( JobIdlePolicy idlePolicy, unsigned int numWorkerThreads, double& out_averageWakeSeconds,
+	double& out_maxWakeSeconds, double& out_idleCpuFraction )
+{
+	TheJobSystem* jobSystem = new TheJobSystem( NUM_JOB_CATEGORIES, numWorkerThreads );
+	jobSystem->SetIdlePolicy( idlePolicy );
+	jobSystem->Startup();
+
+	out_averageWakeSeconds = 0.0;
+	out_maxWakeSeconds = 0.0;
+
+	for ( int sampleIndex = 0; sampleIndex < NUM_WAKE_SAMPLES; ++sampleIndex )
+	{
+		Sleep( MILLISECONDS_BEFORE_WAKE );
+
+		// Slow category so the main thread never runs it itself while joining
+		uint64_t startCount = 0;
+		Job* wakeJob = jobSystem->JobCreate( JOB_CATEGORY_GENERIC_SLOW, &BenchmarkWakeJob );
+		wakeJob->JobWrite< uint64_t* >( &startCount );
+		wakeJob->EndJobWrite();
+
+		uint64_t dispatchCount = GetCurrentPerformanceCount();
+		jobSystem->JobDispatch( wakeJob );
+		jobSystem->JobJoin( wakeJob );
+
+		double wakeSeconds = PerformanceCountToSeconds( startCount - dispatchCount );
+		out_averageWakeSeconds += wakeSeconds;
+		if ( wakeSeconds > out_maxWakeSeconds )
+		{
+			out_maxWakeSeconds = wakeSeconds;
+		}
+	}
+	out_averageWakeSeconds /= NUM_WAKE_SAMPLES;
+
+	double startCpuSeconds = GetProcessCpuSeconds();
+	double startWallSeconds = GetCurrentTimeSeconds();
+	Sleep( IDLE_MEASURE_MILLISECONDS );
+	double elapsedCpuSeconds = GetProcessCpuSeconds() - startCpuSeconds;
+	double elapsedWallSeconds = GetCurrentTimeSeconds() - startWallSeconds;
+	out_idleCpuFraction = elapsedCpuSeconds / elapsedWallSeconds;
+
+	delete jobSystem;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RunJobIdleBenchmark( unsigned int numWorkerThreads )
+{
+	const char* POLICY_NAMES[ NUM_JOB_IDLE_POLICIES ] = { "latency", "balanced", "power" };
+
+	std::string header = Stringf( "Job idle benchmark: %u workers", numWorkerThreads );
+	LoggerPrintfWithTag( "jobs", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	for ( int policyIndex = 0; policyIndex < NUM_JOB_IDLE_POLICIES; ++policyIndex )
+	{
+		double averageWakeSeconds;
+		double maxWakeSeconds;
+		double idleCpuFraction;
+		BenchmarkJobIdlePolicy( ( JobIdlePolicy ) policyIndex, numWorkerThreads, averageWakeSeconds, maxWakeSeconds, idleCpuFraction );
+
+		std::string result = Stringf( "%-8s: wake avg %.1fus max %.1fus, idle CPU %.1f%% of a core",
+			POLICY_NAMES[ policyIndex ], averageWakeSeconds * 1000000.0, maxWakeSeconds * 1000000.0, idleCpuFraction * 100.0 );
+
+		LoggerPrintfWithTag( "jobs", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkBackgroundJob( Job* job )
+{
+	std::atomic< unsigned int >* backgroundJobsQueued = job->JobRead< std::atomic< unsigned int >* >();
+	job->EndJobRead();
+
+	uint64_t startCount = GetCurrentPerformanceCount();
+	while ( PerformanceCountToSeconds( GetCurrentPerformanceCount() - startCount ) < BACKGROUND_JOB_SECONDS )
+	{
+		YieldProcessor();
+	}
+
+	( *backgroundJobsQueued )--;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Keeps a backlog of background jobs in front of every worker, then measures how long a probe
+// job waits from dispatch until it starts. Without priorities the probe shares the background
+// category and queues behind the backlog.
+void BenchmarkJobPriorityLatency( unsigned int numWorkerThreads, bool usePriorities, bool reserveCriticalWorker,
+	double& out_averageWaitSeconds, double& out_maxWaitSeconds )
+{
+	TheJobSystem* jobSystem = new TheJobSystem( NUM_JOB_CATEGORIES, numWorkerThreads );
+	if ( reserveCriticalWorker )
+	{
+		jobSystem->ReserveWorkers( JOB_CATEGORY_CRITICAL, 1 );
+	}
+	jobSystem->Startup();
+
+	std::atomic< unsigned int > backgroundJobsQueued( 0 );
+	unsigned int backlogSize = numWorkerThreads * BACKGROUND_JOBS_PER_WORKER;
+	JobCategory probeCategory = usePriorities ? JOB_CATEGORY_CRITICAL : JOB_CATEGORY_GENERIC_SLOW;
+
+	out_averageWaitSeconds = 0.0;
+	out_maxWaitSeconds = 0.0;
+
+	for ( int sampleIndex = 0; sampleIndex < NUM_PRIORITY_SAMPLES; ++sampleIndex )
+	{
+		while ( backgroundJobsQueued.load() < backlogSize )
+		{
+			backgroundJobsQueued++;
+			Job* backgroundJob = jobSystem->JobCreate( JOB_CATEGORY_GENERIC_SLOW, &BenchmarkBackgroundJob );
+			backgroundJob->JobWrite< std::atomic< unsigned int >* >( &backgroundJobsQueued );
+			backgroundJob->EndJobWrite();
+			jobSystem->JobDispatch( backgroundJob );
+			jobSystem->JobDetach( backgroundJob );
+		}
+
+		uint64_t startCount = 0;
+		Job* probeJob = jobSystem->JobCreate( probeCategory, &BenchmarkWakeJob );
+		probeJob->JobWrite< uint64_t* >( &startCount );
+		probeJob->EndJobWrite();
+
+		uint64_t dispatchCount = GetCurrentPerformanceCount();
+		jobSystem->JobDispatch( probeJob );
+
+		// Not JobJoin, the main thread would just run a critical probe itself
+		while ( !jobSystem->JobIsFinished( probeJob ) )
+		{
+			std::this_thread::yield();
+		}
+		jobSystem->JobDetach( probeJob );
+
+		double waitSeconds = PerformanceCountToSeconds( startCount - dispatchCount );
+		out_averageWaitSeconds += waitSeconds;
+		if ( waitSeconds > out_maxWaitSeconds )
+		{
+			out_maxWaitSeconds = waitSeconds;
+		}
+	}
+	out_averageWaitSeconds /= NUM_PRIORITY_SAMPLES;
+
+	while ( backgroundJobsQueued.load() > 0 )
+	{
+		std::this_thread::yield();
+	}
+
+	delete jobSystem;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RunJobPriorityBenchmark( unsigned int numWorkerThreads )
+{
+	std::string header = Stringf( "Job priority benchmark: %u workers, %u background jobs queued", numWorkerThreads,
+		numWorkerThreads * BACKGROUND_JOBS_PER_WORKER );
+	LoggerPrintfWithTag( "jobs", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	const char* SETUP_NAMES[ 3 ] = { "one category", "priorities", "priorities + reserved worker" };
+
+	for ( int setupIndex = 0; setupIndex < 3; ++setupIndex )
+	{
+		bool usePriorities = ( setupIndex > 0 );
+		bool reserveCriticalWorker = ( setupIndex > 1 );
+		if ( reserveCriticalWorker && numWorkerThreads < 2 )
+		{
+			continue;
+		}
+
+		double averageWaitSeconds;
+		double maxWaitSeconds;
+		BenchmarkJobPriorityLatency( numWorkerThreads, usePriorities, reserveCriticalWorker, averageWaitSeconds, maxWaitSeconds );
+
+		std::string result = Stringf( "%-28s: critical wait avg %.1fus max %.1fus", SETUP_NAMES[ setupIndex ],
+			averageWaitSeconds * 1000000.0, maxWaitSeconds * 1000000.0 );
+
+		LoggerPrintfWithTag( "jobs", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Runs the scheduler and ParallelFor benchmarks under each placement policy. Tiny jobs show the
+// cost of queues and steals crossing cores and nodes; the noise grid shows SMT siblings sharing
+// a core's execution units.
+void RunJobPlacementBenchmark( unsigned int numWorkerThreads, unsigned int numJobs, int gridSize )
+{
+	const char* PLACEMENT_NAMES[ NUM_JOB_PLACEMENT_POLICIES ] = { "none", "physical cores", "logical processors" };
+
+	std::string header = Stringf( "Job placement benchmark: %u workers, %s", numWorkerThreads, GetCpuTopology().GetDescription().c_str() );
+	LoggerPrintfWithTag( "jobs", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	double baselineJobsPerSecond = 0.0;
+	double baselineGridSeconds = 0.0;
+	for ( int policyIndex = 0; policyIndex < NUM_JOB_PLACEMENT_POLICIES; ++policyIndex )
+	{
+		JobPlacementPolicy placementPolicy = ( JobPlacementPolicy ) policyIndex;
+		double schedulerSeconds = BenchmarkJobScheduler( JOB_SCHEDULER_WORK_STEALING, numWorkerThreads, numJobs, placementPolicy );
+		double gridSeconds = BenchmarkParallelFor( numWorkerThreads, gridSize, placementPolicy );
+		double jobsPerSecond = numJobs / schedulerSeconds;
+
+		if ( placementPolicy == JOB_PLACEMENT_NONE )
+		{
+			baselineJobsPerSecond = jobsPerSecond;
+			baselineGridSeconds = gridSeconds;
+		}
+
+		std::string result = Stringf( "%-18s: %.0f jobs/s (%.2fx), %dx%d grid %.1fms (%.2fx)", PLACEMENT_NAMES[ policyIndex ],
+			jobsPerSecond, jobsPerSecond / baselineJobsPerSecond, gridSize, gridSize, gridSeconds * 1000.0, baselineGridSeconds / gridSeconds );
+
+		LoggerPrintfWithTag( "jobs", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_benchmark [maxThreads] [numJobs]
+CONSOLE_COMMAND( job_benchmark )
+{
+	int maxWorkerThreads = std::thread::hardware_concurrency();
+	int numJobs = DEFAULT_BENCHMARK_JOB_COUNT;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( maxWorkerThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( numJobs, args.m_argList[ 1 ] );
+	}
+
+	if ( maxWorkerThreads <= 0 || numJobs <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: job_benchmark [maxThreads] [numJobs]", Rgba::RED );
+		return;
+	}
+
+	RunJobSchedulerBenchmark( maxWorkerThreads, numJobs );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// parallel_for_benchmark [maxThreads] [gridSize]
+CONSOLE_COMMAND( parallel_for_benchmark )
+{
+	int maxWorkerThreads = std::thread::hardware_concurrency();
+	int gridSize = DEFAULT_BENCHMARK_GRID_SIZE;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( maxWorkerThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( gridSize, args.m_argList[ 1 ] );
+	}
+
+	if ( maxWorkerThreads <= 0 || gridSize <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: parallel_for_benchmark [maxThreads] [gridSize]", Rgba::RED );
+		return;
+	}
+
+	RunParallelForBenchmark( maxWorkerThreads, gridSize );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_idle_benchmark [numThreads]
+CONSOLE_COMMAND( job_idle_benchmark )
+{
+	int numWorkerThreads = std::thread::hardware_concurrency() - 1;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( numWorkerThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( numWorkerThreads <= 0 )
+	{
+		numWorkerThreads = 1;
+	}
+
+	RunJobIdleBenchmark( numWorkerThreads );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_priority_benchmark [numThreads]
+CONSOLE_COMMAND( job_priority_benchmark )
+{
+	int numWorkerThreads = std::thread::hardware_concurrency() - 1;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( numWorkerThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( numWorkerThreads <= 0 )
+	{
+		numWorkerThreads = 1;
+	}
+
+	RunJobPriorityBenchmark( numWorkerThreads );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_placement_benchmark [numThreads] [numJobs]
+CONSOLE_COMMAND( job_placement_benchmark )
+{
+	int numWorkerThreads = GetCpuTopology().GetNumLogicalProcessors() - 1;
+	int numJobs = DEFAULT_BENCHMARK_JOB_COUNT;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( numWorkerThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( numJobs, args.m_argList[ 1 ] );
+	}
+
+	if ( numWorkerThreads <= 0 )
+	{
+		numWorkerThreads = 1;
+	}
+
+	if ( numJobs <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: job_placement_benchmark [numThreads] [numJobs]", Rgba::RED );
+		return;
+	}
+
+	RunJobPlacementBenchmark( numWorkerThreads, numJobs, DEFAULT_BENCHMARK_GRID_SIZE );
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+double BenchmarkJobScheduler( JobSchedulerMode schedulerMode, unsigned int numWorkerThreads, unsigned int numJobs,
+	JobPlacementPolicy placementPolicy = JOB_PLACEMENT_NONE );
+void RunJobSchedulerBenchmark( unsigned int maxWorkerThreads, unsigned int numJobs );
+double BenchmarkParallelFor( unsigned int numWorkerThreads, int gridSize, JobPlacementPolicy placementPolicy = JOB_PLACEMENT_NONE );
+void RunParallelForBenchmark( unsigned int maxWorkerThreads, int gridSize );
+void BenchmarkJobIdlePolicy( JobIdlePolicy idlePolicy, unsigned int numWorkerThreads, double& out_averageWakeSeconds,
+	double& out_maxWakeSeconds, double& out_idleCpuFraction );
+void RunJobIdleBenchmark( unsigned int numWorkerThreads );
+void BenchmarkJobPriorityLatency( unsigned int numWorkerThreads, bool usePriorities, bool reserveCriticalWorker,
+	double& out_averageWaitSeconds, double& out_maxWaitSeconds );
+void RunJobPriorityBenchmark( unsigned int numWorkerThreads );
+void RunJobPlacementBenchmark( unsigned int numWorkerThreads, unsigned int numJobs, int gridSize );
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "Engine/Tools/Jobs/JobTask.hpp"
+
+
+#ifdef JOB_COROUTINES_SUPPORTED
+
+
+//-----------------------------------------------------------------------------------------------
+// Never a valid frame address
+void* const TaskPromiseBase::TASK_FINISHED = ( void* ) &TaskPromiseBase::TASK_FINISHED;
+
+
+//-----------------------------------------------------------------------------------------------
+void ResumeCoroutineJob( Job* job )
+{
+	void* coroutineAddress = job->JobRead< void* >();
+	job->EndJobRead();
+
+	CoroutineHandle<>::from_address( coroutineAddress ).resume();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Runs the coroutine on the calling thread if there is no job system
+void ScheduleCoroutine( TheJobSystem* jobSystem, JobCategory category, CoroutineHandle<> handle )
+{
+	if ( jobSystem == nullptr )
+	{
+		handle.resume();
+		return;
+	}
+
+	Job* resumeJob = jobSystem->JobCreate( category, &ResumeCoroutineJob );
+	resumeJob->JobWrite< void* >( handle.address() );
+	resumeJob->EndJobWrite();
+	jobSystem->JobDispatch( resumeJob );
+	jobSystem->JobDetach( resumeJob );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The coroutine can resume, and free the awaiter that called this, as soon as the job is
+// dispatched, so only the arguments are used from there on
+void ScheduleCoroutineAfter( TheJobSystem* jobSystem, JobCategory category, Job* dependency, CoroutineHandle<> handle )
+{
+	Job* resumeJob = jobSystem->JobCreate( category, &ResumeCoroutineJob );
+	resumeJob->JobWrite< void* >( handle.address() );
+	resumeJob->EndJobWrite();
+	jobSystem->JobAddDependency( resumeJob, dependency );
+	jobSystem->JobDispatch( resumeJob );
+	jobSystem->JobDetach( resumeJob );
+}
+
+
+#endif // JOB_COROUTINES_SUPPORTED
\ No newline at end of file
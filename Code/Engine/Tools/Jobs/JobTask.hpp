@@ -0,0 +1,304 @@
+#pragma once
+
+#include <atomic>
+
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Coroutines need C++20, or /await on MSVC 2017 (JobTask.cpp sets it for the engine; projects
+// that write tasks need it too). Without either, this header is empty.
+#if defined( __cpp_impl_coroutine )
+#include <coroutine>
+#define JOB_COROUTINES_SUPPORTED
+template < typename Promise = void >
+using CoroutineHandle = std::coroutine_handle< Promise >;
+typedef std::suspend_always CoroutineSuspendAlways;
+#elif defined( _RESUMABLE_FUNCTIONS_SUPPORTED )
+#include <experimental/coroutine>
+#define JOB_COROUTINES_SUPPORTED
+template < typename Promise = void >
+using CoroutineHandle = std::experimental::coroutine_handle< Promise >;
+typedef std::experimental::suspend_always CoroutineSuspendAlways;
+#endif
+
+
+#ifdef JOB_COROUTINES_SUPPORTED
+
+
+//-----------------------------------------------------------------------------------------------
+void ResumeCoroutineJob( Job* job );
+void ScheduleCoroutine( TheJobSystem* jobSystem, JobCategory category, CoroutineHandle<> handle );
+void ScheduleCoroutineAfter( TheJobSystem* jobSystem, JobCategory category, Job* dependency, CoroutineHandle<> handle );
+
+
+//-----------------------------------------------------------------------------------------------
+// co_await ResumeOnJobSystem( JOB_CATEGORY_IO ) suspends the coroutine and queues it to carry on
+// as a job of that category, on whichever worker picks it up. Runs straight on with no system.
+class JobScheduleAwaiter
+{
+public:
+	JobScheduleAwaiter( TheJobSystem* jobSystem, JobCategory category )
+		: m_jobSystem( jobSystem )
+		, m_category( category )
+	{
+	}
+
+	bool await_ready() const { return ( m_jobSystem == nullptr ); }
+	void await_suspend( CoroutineHandle<> handle ) { ScheduleCoroutine( m_jobSystem, m_category, handle ); }
+	void await_resume() const {}
+
+private:
+	TheJobSystem* m_jobSystem;
+	JobCategory m_category;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+inline JobScheduleAwaiter ResumeOnJobSystem( JobCategory category = JOB_CATEGORY_GENERIC,
+	TheJobSystem* jobSystem = g_theJobSystem )
+{
+	return JobScheduleAwaiter( jobSystem, category );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// co_await WaitForJob( job ) suspends until job, and any children, have finished. The resume is a
+// continuation of job, so no thread waits in the meantime. The caller still owns its reference.
+class JobWaitAwaiter
+{
+public:
+	JobWaitAwaiter( TheJobSystem* jobSystem, Job* job, JobCategory resumeCategory )
+		: m_jobSystem( jobSystem )
+		, m_job( job )
+		, m_resumeCategory( resumeCategory )
+	{
+	}
+
+	bool await_ready() const { return m_jobSystem->JobIsFinished( m_job ); }
+	void await_suspend( CoroutineHandle<> handle ) { ScheduleCoroutineAfter( m_jobSystem, m_resumeCategory, m_job, handle ); }
+	void await_resume() const {}
+
+private:
+	TheJobSystem* m_jobSystem;
+	Job* m_job;
+	JobCategory m_resumeCategory;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+inline JobWaitAwaiter WaitForJob( Job* job, JobCategory resumeCategory = JOB_CATEGORY_GENERIC,
+	TheJobSystem* jobSystem = g_theJobSystem )
+{
+	return JobWaitAwaiter( jobSystem, job, resumeCategory );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Shared by the task object and the running coroutine; whichever lets go last frees the frame.
+// m_continuation is null while running, the awaiting coroutine once one suspends on the task,
+// and TASK_FINISHED once the body has returned.
+class TaskPromiseBase
+{
+public:
+	static void* const TASK_FINISHED;
+
+	class FinalAwaiter
+	{
+	public:
+		bool await_ready() const noexcept { return false; }
+		template < typename Promise >
+		void await_suspend( CoroutineHandle< Promise > handle ) noexcept { handle.promise().OnFinished( handle ); }
+		void await_resume() const noexcept {}
+	};
+
+	TaskPromiseBase()
+		: m_continuation( nullptr )
+		, m_numOwners( 2 )
+		, m_jobSystem( g_theJobSystem )
+	{
+	}
+
+	// Tasks start straight away as a job, so several can run at once before any is awaited
+	JobScheduleAwaiter initial_suspend() const { return JobScheduleAwaiter( m_jobSystem, JOB_CATEGORY_GENERIC ); }
+	FinalAwaiter final_suspend() const noexcept { return FinalAwaiter(); }
+	void unhandled_exception() const { ERROR_AND_DIE( "Unhandled exception in a job task!" ); }
+
+	bool IsFinished() const { return ( m_continuation.load( std::memory_order_acquire ) == TASK_FINISHED ); }
+
+	// False if the task had already finished, in which case the awaiter should carry straight on
+	bool SetContinuation( CoroutineHandle<> continuation )
+	{
+		void* expected = nullptr;
+		return m_continuation.compare_exchange_strong( expected, continuation.address(),
+			std::memory_order_acq_rel, std::memory_order_acquire );
+	}
+
+	template < typename Promise >
+	void OnFinished( CoroutineHandle< Promise > handle )
+	{
+		void* continuation = m_continuation.exchange( TASK_FINISHED, std::memory_order_acq_rel );
+		if ( continuation != nullptr )
+		{
+			// Queued rather than resumed here, so long chains of tasks don't pile up on the stack
+			ScheduleCoroutine( m_jobSystem, JOB_CATEGORY_GENERIC, CoroutineHandle<>::from_address( continuation ) );
+		}
+
+		ReleaseOwner( handle );
+	}
+
+	template < typename Promise >
+	void ReleaseOwner( CoroutineHandle< Promise > handle )
+	{
+		if ( --m_numOwners == 0 )
+		{
+			handle.destroy();
+		}
+	}
+
+	TheJobSystem* GetJobSystem() const { return m_jobSystem; }
+
+private:
+	std::atomic< void* > m_continuation;
+	std::atomic< int > m_numOwners;
+	TheJobSystem* m_jobSystem;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename T > class Task;
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename T >
+class TaskPromise : public TaskPromiseBase
+{
+public:
+	Task< T > get_return_object() { return Task< T >( CoroutineHandle< TaskPromise< T > >::from_promise( *this ) ); }
+	void return_value( T const &value ) { m_value = value; }
+
+	T const &GetResult() const { return m_value; }
+
+private:
+	T m_value;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template <>
+class TaskPromise< void > : public TaskPromiseBase
+{
+public:
+	Task< void > get_return_object();
+	void return_void() const {}
+
+	void GetResult() const {}
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// A coroutine job. Asset and network pipelines can be written as straight-line code:
+//
+//	Task< Texture* > LoadTexture( std::string path )
+//	{
+//		co_await ResumeOnJobSystem( JOB_CATEGORY_IO );
+//		std::vector< unsigned char > fileData = ReadFile( path );
+//		co_await ResumeOnJobSystem( JOB_CATEGORY_GENERIC );
+//		co_return DecodeTexture( fileData );
+//	}
+//
+// The body starts as soon as the task is created and suspends without holding a worker. Another
+// task gets the result with co_await; any other thread uses Wait, which helps run jobs. T must be
+// default constructible and copyable.
+template < typename T >
+class Task
+{
+public:
+	typedef TaskPromise< T > promise_type;
+
+	class Awaiter
+	{
+	public:
+		explicit Awaiter( CoroutineHandle< promise_type > handle ) : m_handle( handle ) {}
+
+		bool await_ready() const { return m_handle.promise().IsFinished(); }
+		bool await_suspend( CoroutineHandle<> awaitingHandle ) { return m_handle.promise().SetContinuation( awaitingHandle ); }
+		T await_resume() const { return m_handle.promise().GetResult(); }
+
+	private:
+		CoroutineHandle< promise_type > m_handle;
+	};
+
+	Task() : m_handle( nullptr ) {}
+	explicit Task( CoroutineHandle< promise_type > handle ) : m_handle( handle ) {}
+	Task( Task&& other ) : m_handle( other.m_handle ) { other.m_handle = nullptr; }
+	~Task() { Release(); }
+
+	Task& operator=( Task&& other )
+	{
+		if ( this != &other )
+		{
+			Release();
+			m_handle = other.m_handle;
+			other.m_handle = nullptr;
+		}
+		return *this;
+	}
+
+	Awaiter operator co_await() const { return Awaiter( m_handle ); }
+
+	bool IsValid() const { return ( bool ) m_handle; }
+	bool IsFinished() const { return m_handle.promise().IsFinished(); }
+
+	// Blocks a thread that isn't a task, running jobs it is allowed to while it waits
+	T Wait() const
+	{
+		TheJobSystem* jobSystem = m_handle.promise().GetJobSystem();
+		if ( jobSystem != nullptr )
+		{
+			JobWorker* currentWorker = jobSystem->GetCurrentWorker();
+
+			JobConsumer helper( jobSystem );
+			helper.AddCategories( ( currentWorker != nullptr ) ? currentWorker->m_categoryMask : jobSystem->GetMainThreadCategories() );
+
+			while ( !IsFinished() )
+			{
+				if ( !helper.Consume() )
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		ASSERT_OR_DIE( IsFinished(), "Task waited on without a job system to run it!" );
+		return m_handle.promise().GetResult();
+	}
+
+private:
+	Task( Task const & );
+	Task& operator=( Task const & );
+
+	// Dropping a task that is still running detaches it, the coroutine frees itself when done
+	void Release()
+	{
+		if ( m_handle )
+		{
+			m_handle.promise().ReleaseOwner( m_handle );
+			m_handle = nullptr;
+		}
+	}
+
+private:
+	CoroutineHandle< promise_type > m_handle;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+inline Task< void > TaskPromise< void >::get_return_object()
+{
+	return Task< void >( CoroutineHandle< TaskPromise< void > >::from_promise( *this ) );
+}
+
+
+#endif // JOB_COROUTINES_SUPPORTED
\ No newline at end of file
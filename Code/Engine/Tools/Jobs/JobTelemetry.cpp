@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <fstream>
+
+#include "Engine/Tools/Jobs/JobTelemetry.hpp"
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+static const char* JOB_CATEGORY_TRACE_NAMES[ NUM_JOB_CATEGORIES ] = { "critical", "frame", "background", "io" };
+static const char* DEFAULT_JOB_TRACE_FILE = "JobTrace.json";
+const unsigned int JOB_TELEMETRY_RING_SLACK = 64; // Oldest events skipped on export, a writer may still be on them
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic< unsigned int > s_nextTelemetryId( 1 );
+static thread_local unsigned int t_telemetryId = 0;
+static thread_local JobThreadTelemetry* t_threadTelemetry = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+// Counters are only written by their owning thread, so a plain add is enough
+static void AddToCounter( std::atomic< uint64_t >& counter, uint64_t amount )
+{
+	counter.store( counter.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobTelemetry::JobTelemetry()
+	: m_telemetryId( s_nextTelemetryId++ )
+	, m_isRecording( false )
+	, m_recordingStartCount( 0 )
+	, m_recordingStopCount( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobTelemetry::~JobTelemetry()
+{
+	for ( unsigned int threadIndex = 0; threadIndex < m_threads.size(); ++threadIndex )
+	{
+		free( m_threads[ threadIndex ]->m_events );
+		delete m_threads[ threadIndex ];
+	}
+	m_threads.clear();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Clears everything recorded so far
+void JobTelemetry::StartRecording()
+{
+	m_isRecording.store( false );
+
+	m_threadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < m_threads.size(); ++threadIndex )
+	{
+		ResetThread( m_threads[ threadIndex ] );
+	}
+	m_recordingStartCount = GetCurrentPerformanceCount();
+	m_recordingStopCount = 0;
+	m_isRecording.store( true, std::memory_order_release );
+	m_threadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void JobTelemetry::StopRecording()
+{
+	m_threadsLock.lock();
+	if ( m_isRecording.load() )
+	{
+		m_isRecording.store( false );
+		m_recordingStopCount = GetCurrentPerformanceCount();
+	}
+	m_threadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Names the calling thread's lane in exported traces
+void JobTelemetry::SetThreadName( std::string const &threadName )
+{
+	JobThreadTelemetry* threadTelemetry = GetThreadTelemetry();
+
+	m_threadsLock.lock();
+	threadTelemetry->m_threadName = threadName;
+	m_threadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void JobTelemetry::RecordEvent( JobEventType type, unsigned int category, uint32_t value )
+{
+	if ( !m_isRecording.load( std::memory_order_acquire ) )
+	{
+		return;
+	}
+
+	JobThreadTelemetry* threadTelemetry = GetThreadTelemetry();
+	if ( threadTelemetry->m_events == nullptr )
+	{
+		// Only threads that record while recording is on pay for a ring. Set under the lock, the
+		// export reads it under the lock too.
+		JobEvent* events = ( JobEvent* ) malloc( JOB_TELEMETRY_RING_SIZE * sizeof( JobEvent ) );
+		m_threadsLock.lock();
+		threadTelemetry->m_events = events;
+		m_threadsLock.unlock();
+	}
+
+	uint64_t timestamp = GetCurrentPerformanceCount();
+
+	switch ( type )
+	{
+	case JOB_EVENT_JOB_START:
+		if ( threadTelemetry->m_jobDepth++ == 0 )
+		{
+			threadTelemetry->m_jobStartCount = timestamp;
+		}
+		AddToCounter( threadTelemetry->m_numJobsRun, 1 );
+		if ( value != JOB_QUEUE_WAIT_UNKNOWN )
+		{
+			AddToCounter( threadTelemetry->m_queueWaitCounts, value );
+			AddToCounter( threadTelemetry->m_numQueueWaits, 1 );
+		}
+		break;
+	case JOB_EVENT_JOB_END:
+		// Only the outermost job counts, a job helping out inside a join is already busy time
+		if ( threadTelemetry->m_jobDepth > 0 && --threadTelemetry->m_jobDepth == 0 )
+		{
+			AddToCounter( threadTelemetry->m_busyCounts, timestamp - threadTelemetry->m_jobStartCount );
+		}
+		break;
+	case JOB_EVENT_STEAL:
+		AddToCounter( threadTelemetry->m_numSteals, 1 );
+		break;
+	case JOB_EVENT_PARK_BEGIN:
+		threadTelemetry->m_isParked = true;
+		threadTelemetry->m_parkStartCount = timestamp;
+		break;
+	case JOB_EVENT_PARK_END:
+		if ( threadTelemetry->m_isParked )
+		{
+			threadTelemetry->m_isParked = false;
+			AddToCounter( threadTelemetry->m_parkedCounts, timestamp - threadTelemetry->m_parkStartCount );
+			AddToCounter( threadTelemetry->m_numParks, 1 );
+		}
+		break;
+	default:
+		break;
+	}
+
+	uint64_t writeIndex = threadTelemetry->m_writeIndex.load( std::memory_order_relaxed );
+	JobEvent& newEvent = threadTelemetry->m_events[ writeIndex & ( JOB_TELEMETRY_RING_SIZE - 1 ) ];
+	newEvent.m_timestamp = timestamp;
+	newEvent.m_value = value;
+	newEvent.m_type = ( unsigned char ) type;
+	newEvent.m_category = ( unsigned char ) category;
+	threadTelemetry->m_writeIndex.store( writeIndex + 1, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Covers the current recording, or the last one if stopped
+JobTelemetrySummary JobTelemetry::GetSummary()
+{
+	JobTelemetrySummary summary;
+	summary.m_numJobsRun = 0;
+	summary.m_numSteals = 0;
+	summary.m_numParks = 0;
+	summary.m_utilization = 0.0;
+
+	m_threadsLock.lock();
+
+	uint64_t endCount = ( m_recordingStopCount != 0 ) ? m_recordingStopCount : GetCurrentPerformanceCount();
+	uint64_t windowCounts = endCount - m_recordingStartCount;
+	summary.m_seconds = ( m_recordingStartCount != 0 ) ? PerformanceCountToSeconds( windowCounts ) : 0.0;
+
+	uint64_t queueWaitCounts = 0;
+	uint64_t numQueueWaits = 0;
+	int numThreadsWithJobs = 0;
+
+	for ( unsigned int threadIndex = 0; threadIndex < m_threads.size(); ++threadIndex )
+	{
+		JobThreadTelemetry* threadTelemetry = m_threads[ threadIndex ];
+		uint64_t numJobsRun = threadTelemetry->m_numJobsRun.load( std::memory_order_relaxed );
+		double utilization = ( windowCounts > 0 ) ? ( double ) threadTelemetry->m_busyCounts.load( std::memory_order_relaxed ) / ( double ) windowCounts : 0.0;
+		double parkedFraction = ( windowCounts > 0 ) ? ( double ) threadTelemetry->m_parkedCounts.load( std::memory_order_relaxed ) / ( double ) windowCounts : 0.0;
+
+		summary.m_threadNames.push_back( threadTelemetry->m_threadName );
+		summary.m_threadUtilization.push_back( utilization );
+		summary.m_threadParkedFraction.push_back( parkedFraction );
+		summary.m_numJobsRun += numJobsRun;
+		summary.m_numSteals += threadTelemetry->m_numSteals.load( std::memory_order_relaxed );
+		summary.m_numParks += threadTelemetry->m_numParks.load( std::memory_order_relaxed );
+		queueWaitCounts += threadTelemetry->m_queueWaitCounts.load( std::memory_order_relaxed );
+		numQueueWaits += threadTelemetry->m_numQueueWaits.load( std::memory_order_relaxed );
+
+		if ( numJobsRun > 0 )
+		{
+			summary.m_utilization += utilization;
+			++numThreadsWithJobs;
+		}
+	}
+
+	m_threadsLock.unlock();
+
+	if ( numThreadsWithJobs > 0 )
+	{
+		summary.m_utilization /= numThreadsWithJobs;
+	}
+
+	summary.m_jobsPerSecond = ( summary.m_seconds > 0.0 ) ? summary.m_numJobsRun / summary.m_seconds : 0.0;
+	summary.m_averageQueueSeconds = ( numQueueWaits > 0 ) ? PerformanceCountToSeconds( queueWaitCounts / numQueueWaits ) : 0.0;
+	return summary;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Writes Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev both open. Each
+// thread gets a lane; jobs, idle and parked periods are spans, steals are instants and queue
+// depth is a counter. Stops recording first.
+bool JobTelemetry::ExportChromeTrace( std::string const &filePath )
+{
+	StopRecording();
+
+	std::ofstream traceFile( filePath.c_str(), std::ios::binary );
+	if ( !traceFile.is_open() )
+	{
+		return false;
+	}
+
+	m_threadsLock.lock();
+
+	uint64_t startCount = m_recordingStartCount;
+	uint64_t stopCount = m_recordingStopCount;
+	bool isFirstEvent = true;
+	traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	for ( unsigned int threadIndex = 0; threadIndex < m_threads.size(); ++threadIndex )
+	{
+		JobThreadTelemetry* threadTelemetry = m_threads[ threadIndex ];
+		unsigned int threadId = threadIndex + 1;
+
+		traceFile << ( isFirstEvent ? "" : ",\n" ) << Stringf( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			threadId, threadTelemetry->m_threadName.c_str() );
+		isFirstEvent = false;
+
+		if ( threadTelemetry->m_events == nullptr )
+		{
+			continue;
+		}
+
+		uint64_t endIndex = threadTelemetry->m_writeIndex.load( std::memory_order_acquire );
+		uint64_t firstIndex = ( endIndex > JOB_TELEMETRY_RING_SIZE ) ? endIndex - JOB_TELEMETRY_RING_SIZE + JOB_TELEMETRY_RING_SLACK : 0;
+
+		// Begin events wait here for their end; ends whose begin was overwritten are dropped
+		std::vector< JobEvent > openEvents;
+		for ( uint64_t eventIndex = firstIndex; eventIndex <= endIndex; ++eventIndex )
+		{
+			JobEvent traceEvent;
+			if ( eventIndex < endIndex )
+			{
+				traceEvent = threadTelemetry->m_events[ eventIndex & ( JOB_TELEMETRY_RING_SIZE - 1 ) ];
+			}
+			else if ( !openEvents.empty() )
+			{
+				// Close whatever was still running when recording stopped
+				traceEvent.m_timestamp = stopCount;
+				traceEvent.m_value = 0;
+				traceEvent.m_type = ( unsigned char ) ( openEvents.back().m_type + 1 );
+				traceEvent.m_category = openEvents.back().m_category;
+				--eventIndex;
+			}
+			else
+			{
+				break;
+			}
+
+			double timestampMicroseconds = ( traceEvent.m_timestamp > startCount ) ? PerformanceCountToSeconds( traceEvent.m_timestamp - startCount ) * 1000000.0 : 0.0;
+
+			switch ( traceEvent.m_type )
+			{
+			case JOB_EVENT_JOB_START:
+			case JOB_EVENT_IDLE_BEGIN:
+			case JOB_EVENT_PARK_BEGIN:
+				openEvents.push_back( traceEvent );
+				break;
+			case JOB_EVENT_JOB_END:
+			case JOB_EVENT_IDLE_END:
+			case JOB_EVENT_PARK_END:
+			{
+				if ( openEvents.empty() || openEvents.back().m_type + 1 != traceEvent.m_type )
+				{
+					break;
+				}
+
+				JobEvent beginEvent = openEvents.back();
+				openEvents.pop_back();
+
+				double beginMicroseconds = ( beginEvent.m_timestamp > startCount ) ? PerformanceCountToSeconds( beginEvent.m_timestamp - startCount ) * 1000000.0 : 0.0;
+				double durationMicroseconds = timestampMicroseconds - beginMicroseconds;
+
+				if ( beginEvent.m_type == JOB_EVENT_JOB_START )
+				{
+					double queueMicroseconds = ( beginEvent.m_value != JOB_QUEUE_WAIT_UNKNOWN ) ? PerformanceCountToSeconds( beginEvent.m_value ) * 1000000.0 : -1.0;
+					traceFile << Stringf( ",\n{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"queue_us\":%.3f}}",
+						JOB_CATEGORY_TRACE_NAMES[ beginEvent.m_category % NUM_JOB_CATEGORIES ], beginMicroseconds, durationMicroseconds, threadId, queueMicroseconds );
+				}
+				else
+				{
+					traceFile << Stringf( ",\n{\"name\":\"%s\",\"cat\":\"scheduler\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+						( beginEvent.m_type == JOB_EVENT_IDLE_BEGIN ) ? "idle" : "parked", beginMicroseconds, durationMicroseconds, threadId );
+				}
+				break;
+			}
+			case JOB_EVENT_STEAL:
+				traceFile << Stringf( ",\n{\"name\":\"steal\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"victim\":%u,\"category\":\"%s\"}}",
+					timestampMicroseconds, threadId, traceEvent.m_value, JOB_CATEGORY_TRACE_NAMES[ traceEvent.m_category % NUM_JOB_CATEGORIES ] );
+				break;
+			case JOB_EVENT_QUEUE_DEPTH:
+				traceFile << Stringf( ",\n{\"name\":\"%s queue\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"jobs\":%u}}",
+					threadTelemetry->m_threadName.c_str(), timestampMicroseconds, threadId, traceEvent.m_value );
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	m_threadsLock.unlock();
+
+	traceFile << "\n]}\n";
+	return traceFile.good();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Registers the calling thread the first time it records
+JobThreadTelemetry* JobTelemetry::GetThreadTelemetry()
+{
+	if ( t_telemetryId == m_telemetryId )
+	{
+		return t_threadTelemetry;
+	}
+
+	std::thread::id threadId = std::this_thread::get_id();
+	JobThreadTelemetry* threadTelemetry = nullptr;
+
+	m_threadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < m_threads.size(); ++threadIndex )
+	{
+		if ( m_threads[ threadIndex ]->m_threadId == threadId )
+		{
+			threadTelemetry = m_threads[ threadIndex ];
+			break;
+		}
+	}
+
+	if ( threadTelemetry == nullptr )
+	{
+		threadTelemetry = new JobThreadTelemetry();
+		threadTelemetry->m_threadId = threadId;
+		threadTelemetry->m_threadName = Stringf( "Thread %u", ( unsigned int ) m_threads.size() );
+		threadTelemetry->m_events = nullptr;
+		ResetThread( threadTelemetry );
+		m_threads.push_back( threadTelemetry );
+	}
+	m_threadsLock.unlock();
+
+	t_telemetryId = m_telemetryId;
+	t_threadTelemetry = threadTelemetry;
+	return threadTelemetry;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Must hold m_threadsLock. Leaves the ring alone, RecordEvent allocates it.
+void JobTelemetry::ResetThread( JobThreadTelemetry* threadTelemetry )
+{
+	threadTelemetry->m_writeIndex.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_busyCounts.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_parkedCounts.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_queueWaitCounts.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_numJobsRun.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_numQueueWaits.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_numSteals.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_numParks.store( 0, std::memory_order_relaxed );
+	threadTelemetry->m_jobStartCount = 0;
+	threadTelemetry->m_parkStartCount = 0;
+	threadTelemetry->m_jobDepth = 0;
+	threadTelemetry->m_isParked = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// job_trace [start|stop|dump [file]]
+CONSOLE_COMMAND( job_trace )
+{
+	if ( g_theJobSystem == nullptr )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No job system running.", Rgba::RED );
+		return;
+	}
+
+	JobTelemetry& telemetry = g_theJobSystem->m_telemetry;
+	std::string subCommand = args.m_argList.empty() ? "" : args.m_argList[ 0 ];
+
+	if ( subCommand == "start" )
+	{
+		telemetry.StartRecording();
+		g_theDeveloperConsole->ConsolePrint( "Job trace recording." );
+	}
+	else if ( subCommand == "stop" )
+	{
+		telemetry.StopRecording();
+		g_theDeveloperConsole->ConsolePrint( "Job trace stopped." );
+	}
+	else if ( subCommand == "dump" )
+	{
+		std::string filePath = ( args.m_argList.size() > 1 ) ? args.m_argList[ 1 ] : DEFAULT_JOB_TRACE_FILE;
+		if ( telemetry.ExportChromeTrace( filePath ) )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Job trace written to " + filePath + " (open in chrome://tracing or ui.perfetto.dev)" );
+		}
+		else
+		{
+			g_theDeveloperConsole->ConsolePrint( "Couldn't write " + filePath, Rgba::RED );
+		}
+	}
+	else
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: job_trace [start|stop|dump [file]]", Rgba::RED );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Summary of the current or last job_trace recording
+CONSOLE_COMMAND( job_stats )
+{
+	UNUSED( args );
+
+	if ( g_theJobSystem == nullptr )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No job system running.", Rgba::RED );
+		return;
+	}
+
+	JobTelemetrySummary summary = g_theJobSystem->m_telemetry.GetSummary();
+	if ( summary.m_seconds <= 0.0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Nothing recorded, use job_trace start.", Rgba::RED );
+		return;
+	}
+
+	g_theDeveloperConsole->ConsolePrint( Stringf( "%.2fs: %.1f%% utilization, %.0f jobs/sec, %.1fus average queue latency",
+		summary.m_seconds, summary.m_utilization * 100.0, summary.m_jobsPerSecond, summary.m_averageQueueSeconds * 1000000.0 ) );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "%llu jobs, %llu steals, %llu parks", summary.m_numJobsRun, summary.m_numSteals, summary.m_numParks ) );
+
+	for ( unsigned int threadIndex = 0; threadIndex < summary.m_threadNames.size(); ++threadIndex )
+	{
+		g_theDeveloperConsole->ConsolePrint( Stringf( "  %-16s %5.1f%% busy %5.1f%% parked", summary.m_threadNames[ threadIndex ].c_str(),
+			summary.m_threadUtilization[ threadIndex ] * 100.0, summary.m_threadParkedFraction[ threadIndex ] * 100.0 ) );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int JOB_TELEMETRY_RING_SIZE = 1 << 15; // Events kept per thread, a power of two
+const unsigned int JOB_QUEUE_DEPTH_SAMPLE_INTERVAL = 16; // Jobs run between queue depth samples
+const uint32_t JOB_QUEUE_WAIT_UNKNOWN = 0xFFFFFFFF;
+
+
+//-----------------------------------------------------------------------------------------------
+enum JobEventType
+{
+	JOB_EVENT_JOB_START = 0, // Value is how long the job sat in a queue, in performance counts
+	JOB_EVENT_JOB_END,
+	JOB_EVENT_STEAL, // Value is the victim worker's index
+	JOB_EVENT_IDLE_BEGIN,
+	JOB_EVENT_IDLE_END,
+	JOB_EVENT_PARK_BEGIN,
+	JOB_EVENT_PARK_END,
+	JOB_EVENT_QUEUE_DEPTH, // Value is the number of jobs in the worker's own deques
+	NUM_JOB_EVENT_TYPES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct JobEvent
+{
+	uint64_t m_timestamp;
+	uint32_t m_value;
+	unsigned char m_type;
+	unsigned char m_category;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// One per thread that has run jobs. Only the owning thread writes to it. The running totals
+// behind the summary are kept alongside the ring so they survive it wrapping.
+struct JobThreadTelemetry
+{
+	std::thread::id m_threadId;
+	std::string m_threadName;
+	JobEvent* m_events;
+	std::atomic< uint64_t > m_writeIndex;
+
+	std::atomic< uint64_t > m_busyCounts;
+	std::atomic< uint64_t > m_parkedCounts;
+	std::atomic< uint64_t > m_queueWaitCounts;
+	std::atomic< uint64_t > m_numJobsRun;
+	std::atomic< uint64_t > m_numQueueWaits;
+	std::atomic< uint64_t > m_numSteals;
+	std::atomic< uint64_t > m_numParks;
+
+	uint64_t m_jobStartCount;
+	uint64_t m_parkStartCount;
+	int m_jobDepth; // Jobs can nest when a job joins another
+	bool m_isParked;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct JobTelemetrySummary
+{
+	double m_seconds;
+	double m_utilization; // Busy fraction averaged over the threads that ran jobs
+	double m_jobsPerSecond;
+	double m_averageQueueSeconds;
+	uint64_t m_numJobsRun;
+	uint64_t m_numSteals;
+	uint64_t m_numParks;
+	std::vector< std::string > m_threadNames;
+	std::vector< double > m_threadUtilization;
+	std::vector< double > m_threadParkedFraction;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Per-thread ring buffers of scheduler events, for finding load imbalance and serialization
+// points. Costs one relaxed load per event site while not recording.
+class JobTelemetry
+{
+public:
+	JobTelemetry();
+	~JobTelemetry();
+
+	void StartRecording();
+	void StopRecording();
+	bool IsRecording() const { return m_isRecording.load( std::memory_order_relaxed ); }
+
+	void SetThreadName( std::string const &threadName );
+	void RecordEvent( JobEventType type, unsigned int category, uint32_t value = 0 );
+
+	JobTelemetrySummary GetSummary();
+	bool ExportChromeTrace( std::string const &filePath );
+
+private:
+	JobTelemetry( JobTelemetry const & );
+	JobTelemetry& operator=( JobTelemetry const & );
+
+	JobThreadTelemetry* GetThreadTelemetry();
+	void ResetThread( JobThreadTelemetry* threadTelemetry );
+
+private:
+	unsigned int m_telemetryId; // Unique per instance, so a thread's cached lookup can't go stale
+	std::atomic< bool > m_isRecording;
+	uint64_t m_recordingStartCount;
+	uint64_t m_recordingStopCount;
+	std::mutex m_threadsLock;
+	std::vector< JobThreadTelemetry* > m_threads;
+};
\ No newline at end of file
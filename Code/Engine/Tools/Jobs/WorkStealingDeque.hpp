@@ -0,0 +1,173 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+
+//-----------------------------------------------------------------------------------------------
+// Lock-free Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli - PPoPP 2013).
+// Only the owning thread may call Push and Pop; any thread may call Steal. Push and Pop work on
+// the bottom end, Steal takes from the top end, so the owner only contends with thieves when a
+// single item remains. Buffers grow on demand and retired buffers are kept alive until the deque
+// is destroyed, since a thief may still be reading from them.
+template < typename T >
+class WorkStealingDeque
+{
+private:
+	struct CircularArray
+	{
+		int64_t m_capacity;
+		std::atomic< T >* m_buffer;
+		CircularArray* m_previousArray;
+
+		T Get( int64_t index ) const
+		{
+			return m_buffer[ index & ( m_capacity - 1 ) ].load( std::memory_order_relaxed );
+		}
+
+		void Put( int64_t index, T const &value )
+		{
+			m_buffer[ index & ( m_capacity - 1 ) ].store( value, std::memory_order_relaxed );
+		}
+	};
+
+public:
+	explicit WorkStealingDeque( int64_t initialCapacity = 256 )
+		: m_top( 0 )
+		, m_bottom( 0 )
+	{
+		// Capacity must be a power of two so indices can be masked
+		int64_t capacity = 1;
+		while ( capacity < initialCapacity )
+		{
+			capacity <<= 1;
+		}
+
+		m_array.store( CreateArray( capacity, nullptr ), std::memory_order_relaxed );
+	}
+
+	~WorkStealingDeque()
+	{
+		CircularArray* currentArray = m_array.load( std::memory_order_relaxed );
+		while ( currentArray != nullptr )
+		{
+			CircularArray* previousArray = currentArray->m_previousArray;
+			free( currentArray->m_buffer );
+			free( currentArray );
+			currentArray = previousArray;
+		}
+	}
+
+	// Owner thread only
+	void Push( T const &value )
+	{
+		int64_t bottom = m_bottom.load( std::memory_order_relaxed );
+		int64_t top = m_top.load( std::memory_order_acquire );
+		CircularArray* currentArray = m_array.load( std::memory_order_relaxed );
+
+		if ( bottom - top > currentArray->m_capacity - 1 )
+		{
+			currentArray = Grow( currentArray, bottom, top );
+		}
+
+		currentArray->Put( bottom, value );
+		m_bottom.store( bottom + 1, std::memory_order_release );
+	}
+
+	// Owner thread only
+	bool Pop( T* out )
+	{
+		int64_t bottom = m_bottom.load( std::memory_order_relaxed ) - 1;
+		CircularArray* currentArray = m_array.load( std::memory_order_relaxed );
+		m_bottom.store( bottom, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		int64_t top = m_top.load( std::memory_order_relaxed );
+
+		if ( top > bottom )
+		{
+			// Deque was already empty
+			m_bottom.store( bottom + 1, std::memory_order_relaxed );
+			return false;
+		}
+
+		T value = currentArray->Get( bottom );
+		if ( top == bottom )
+		{
+			// Last item, race any thieves for it
+			bool wonRace = m_top.compare_exchange_strong( top, top + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed );
+			m_bottom.store( bottom + 1, std::memory_order_relaxed );
+			if ( !wonRace )
+			{
+				return false;
+			}
+		}
+
+		*out = value;
+		return true;
+	}
+
+	// Any thread
+	bool Steal( T* out )
+	{
+		int64_t top = m_top.load( std::memory_order_acquire );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		int64_t bottom = m_bottom.load( std::memory_order_acquire );
+
+		if ( top >= bottom )
+		{
+			return false;
+		}
+
+		CircularArray* currentArray = m_array.load( std::memory_order_acquire );
+		T value = currentArray->Get( top );
+		if ( !m_top.compare_exchange_strong( top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed ) )
+		{
+			// Lost the race to the owner or another thief
+			return false;
+		}
+
+		*out = value;
+		return true;
+	}
+
+	// Approximate, only meaningful as a hint
+	size_t Size() const
+	{
+		int64_t bottom = m_bottom.load( std::memory_order_relaxed );
+		int64_t top = m_top.load( std::memory_order_relaxed );
+		return ( bottom > top ) ? static_cast< size_t >( bottom - top ) : 0;
+	}
+
+private:
+	WorkStealingDeque( WorkStealingDeque const & );
+	WorkStealingDeque& operator=( WorkStealingDeque const & );
+
+	static CircularArray* CreateArray( int64_t capacity, CircularArray* previousArray )
+	{
+		CircularArray* newArray = ( CircularArray* ) malloc( sizeof( CircularArray ) );
+		newArray->m_capacity = capacity;
+		newArray->m_buffer = ( std::atomic< T >* ) malloc( static_cast< size_t >( capacity ) * sizeof( std::atomic< T > ) );
+		newArray->m_previousArray = previousArray;
+		return newArray;
+	}
+
+	CircularArray* Grow( CircularArray* oldArray, int64_t bottom, int64_t top )
+	{
+		CircularArray* newArray = CreateArray( oldArray->m_capacity * 2, oldArray );
+		for ( int64_t index = top; index < bottom; ++index )
+		{
+			newArray->Put( index, oldArray->Get( index ) );
+		}
+
+		m_array.store( newArray, std::memory_order_release );
+		return newArray;
+	}
+
+private:
+	std::atomic< int64_t > m_top;
+	std::atomic< int64_t > m_bottom;
+	std::atomic< CircularArray* > m_array;
+};
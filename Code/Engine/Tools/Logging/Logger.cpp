@@ -13,11 +13,13 @@
 #include "Engine/Config/BuildConfig.hpp" // Adjust logging level in this file
 #include "Engine/Tools/Logging/Logger.hpp"
 #include "Engine/Tools/Memory/MemoryAnalytics.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
 ThreadSafeQueue< LogMessage* > g_messageQueue;
 bool g_loggerIsRunning = false;
+ConcurrentObjectPool< LogMessage > g_logMessagePool; // Freed on the logging thread, so frame memory won't do
 FileBinaryWriter g_writer;
 bool g_flushLogs = false;
 int g_loggingLevel = 3;
@@ -26,6 +28,8 @@ int g_loggingLevel = 3;
 //-----------------------------------------------------------------------------------------------
 void LoggingThread( ThreadSafeQueue< LogMessage* > &messageQueue )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_LOGGING );
+
 	UNUSED( messageQueue );
 #ifdef PROGRAM_LOGGING
 #if PROGRAM_LOGGING == 0 
@@ -61,6 +65,7 @@ void LoggingThread( ThreadSafeQueue< LogMessage* > &messageQueue )
 	char filename[ 100 ];
 	sprintf_s( filename, "sd5a2_%s.log", timeChar );
 	g_writer.Open( filename );
+	WriteCallstackModuleMap();
 
 	while ( g_loggerIsRunning )
 	{
@@ -79,6 +84,30 @@ void LoggingThread( ThreadSafeQueue< LogMessage* > &messageQueue )
 }
 
 
+//-----------------------------------------------------------------------------------------------
+// Raw callstack addresses only mean something next to where each module was loaded this run,
+// so the map goes at the top of the log for Tools/Symbolize to read
+void WriteCallstackModuleMap()
+{
+#ifdef PROGRAM_LOGGING
+	if ( CallstackGetSymbolMode() != CALLSTACK_SYMBOLS_RAW_ADDRESSES )
+	{
+		return;
+	}
+
+	static CallstackModule modules[ MAX_CALLSTACK_MODULES ]; // Only used on the logging thread
+	unsigned int numModules = CallstackGetModules( modules, MAX_CALLSTACK_MODULES );
+	char moduleText[ MAX_CALLSTACK_MODULE_PATH_LENGTH + 64 ];
+	for ( unsigned int moduleIndex = 0; moduleIndex < numModules; ++moduleIndex )
+	{
+		CallstackFormatModule( modules[ moduleIndex ], moduleText, sizeof( moduleText ) );
+		g_writer.WriteStringText( moduleText );
+		g_writer.WriteStringText( "\n" );
+	}
+#endif
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void HandleMessage( LogMessage* msg )
 {
@@ -92,18 +121,6 @@ void HandleMessage( LogMessage* msg )
 
 	// Print to Output
 	DebuggerPrintf( "\n%i %s %s %s\n", msg->logLevel, msg->time, msg->tag, msg->contents );
-	if ( msg->cs != nullptr )
-	{
-		// Message does have an associated callstack
-		CallstackLine* line = CallstackGetLines( msg->cs );
-
-		for ( size_t i = 0; i < msg->cs->framecount; ++i )
-		{
-			DebuggerPrintf( "\t%s(%u): %s\n", line[ i ].filename, line[ i ].line, line[ i ].functionName );
-		}
-		DebuggerPrintf( "\n" );
-	}
-	DebuggerPrintf( "\n" );
 
 	// Print to File
 	g_writer.WriteStringText( msg->time );
@@ -113,19 +130,22 @@ void HandleMessage( LogMessage* msg )
 	g_writer.WriteStringText( msg->tag );
 	g_writer.WriteStringText( " " );
 	g_writer.WriteStringText( msg->contents );
+
 	if ( msg->cs != nullptr )
 	{
-		CallstackLine* line = CallstackGetLines( msg->cs );
-
+		// Each frame is formatted once for both, from the symbol cache or as a raw address
+		char frameText[ 2048 ];
 		for ( size_t i = 0; i < msg->cs->framecount; ++i )
 		{
+			CallstackFormatFrame( msg->cs->frames[ i ], frameText, sizeof( frameText ) );
+			DebuggerPrintf( "\t%s\n", frameText );
 			g_writer.WriteStringText( "\t" );
-			g_writer.WriteStringText( line[ i ].filename );
-			g_writer.WriteStringText( std::to_string( line[ i ].line ) );
-			g_writer.WriteStringText( line[ i ].functionName );
+			g_writer.WriteStringText( frameText );
 			g_writer.WriteStringText( "\n" );
 		}
+		DebuggerPrintf( "\n" );
 	}
+	DebuggerPrintf( "\n" );
 #endif
 }
 
@@ -140,7 +160,11 @@ void HandleRemainingMessages( ThreadSafeQueue< LogMessage* > &messageQueue )
 	{
 		messageQueue.Dequeue( &msg );
 		HandleMessage( msg );
-		delete msg;
+		if ( msg->cs != nullptr )
+		{
+			FreeCallstack( msg->cs );
+		}
+		g_logMessagePool.Delete( msg );
 	}
 
 	if ( g_flushLogs )
@@ -155,6 +179,8 @@ void HandleRemainingMessages( ThreadSafeQueue< LogMessage* > &messageQueue )
 //-----------------------------------------------------------------------------------------------
 void LoggerPrintf( const char* messageFormat, ... )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_LOGGING );
+
 	UNUSED( messageFormat );
 #ifdef PROGRAM_LOGGING
 	const int MESSAGE_MAX_LENGTH = 2048;
@@ -165,7 +191,7 @@ void LoggerPrintf( const char* messageFormat, ... )
 	va_end( variableArgumentList );
 	messageLiteral[ MESSAGE_MAX_LENGTH - 1 ] = '\0'; // In case vsnprintf overran (doesn't auto-terminate)
 
-	LogMessage* thisMessage = new LogMessage();
+	LogMessage* thisMessage = g_logMessagePool.Alloc();
 
 	// Log message time
 	time_t     now = time( 0 );
@@ -191,6 +217,8 @@ void LoggerPrintf( const char* messageFormat, ... )
 //-----------------------------------------------------------------------------------------------
 void LoggerPrintfWithCallstack( Callstack* cs, const char* messageFormat, ... )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_LOGGING );
+
 	UNUSED( cs );
 	UNUSED( messageFormat );
 #ifdef PROGRAM_LOGGING
@@ -202,7 +230,7 @@ void LoggerPrintfWithCallstack( Callstack* cs, const char* messageFormat, ... )
 	va_end( variableArgumentList );
 	messageLiteral[ MESSAGE_MAX_LENGTH - 1 ] = '\0'; // In case vsnprintf overran (doesn't auto-terminate)
 
-	LogMessage* thisMessage = new LogMessage();
+	LogMessage* thisMessage = g_logMessagePool.Alloc();
 
 	// Log message time
 	time_t     now = time( 0 );
@@ -231,6 +259,8 @@ void LoggerPrintfWithCallstack( Callstack* cs, const char* messageFormat, ... )
 //-----------------------------------------------------------------------------------------------
 void LoggerPrintfWithTag( const char* tag, const char* messageFormat, ... )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_LOGGING );
+
 	UNUSED( tag );
 	UNUSED( messageFormat );
 #ifdef PROGRAM_LOGGING
@@ -242,7 +272,7 @@ void LoggerPrintfWithTag( const char* tag, const char* messageFormat, ... )
 	va_end( variableArgumentList );
 	messageLiteral[ MESSAGE_MAX_LENGTH - 1 ] = '\0'; // In case vsnprintf overran (doesn't auto-terminate)
 
-	LogMessage* thisMessage = new LogMessage();
+	LogMessage* thisMessage = g_logMessagePool.Alloc();
 
 	// Log message time
 	time_t     now = time( 0 );
@@ -268,6 +298,8 @@ void LoggerPrintfWithTag( const char* tag, const char* messageFormat, ... )
 //-----------------------------------------------------------------------------------------------
 void LoggerPrintfWithLevel( int logLevel, const char* messageFormat, ... )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_LOGGING );
+
 	UNUSED( logLevel );
 	UNUSED( messageFormat );
 #ifdef PROGRAM_LOGGING
@@ -279,7 +311,7 @@ void LoggerPrintfWithLevel( int logLevel, const char* messageFormat, ... )
 	va_end( variableArgumentList );
 	messageLiteral[ MESSAGE_MAX_LENGTH - 1 ] = '\0'; // In case vsnprintf overran (doesn't auto-terminate)
 
-	LogMessage* thisMessage = new LogMessage();
+	LogMessage* thisMessage = g_logMessagePool.Alloc();
 
 	// Log message time
 	time_t     now = time( 0 );
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine/Tools/Logging/ThreadSafeQueue.hpp"
+#include "Engine/Tools/Profiling/ConcurrentObjectPool.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -33,6 +34,7 @@ struct LogMessage
 //-----------------------------------------------------------------------------------------------
 extern ThreadSafeQueue< LogMessage* > g_messageQueue;
 extern bool g_loggerIsRunning;
+extern ConcurrentObjectPool< LogMessage > g_logMessagePool;
 extern FileBinaryWriter g_writer;
 extern bool g_flushLogs;
 extern int g_loggingLevel;
@@ -40,6 +42,7 @@ extern int g_loggingLevel;
 
 //-----------------------------------------------------------------------------------------------
 void LoggingThread( ThreadSafeQueue< LogMessage* > &messageQueue );
+void WriteCallstackModuleMap();
 void HandleMessage( LogMessage* msg );
 void HandleRemainingMessages( ThreadSafeQueue< LogMessage* > &messageQueue );
 void LoggerPrintf( const char* messageFormat, ... );
@@ -0,0 +1,151 @@
+#include <string.h>
+#include <atomic>
+
+#include "Engine/Tools/Memory/AllocationCounters.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int NUM_ALLOCATION_COUNTER_SHARDS = 64; // Threads past this many share shards
+const unsigned int NUM_RATE_FRAMES = 256; // Enough frames to cover a second at 256 fps
+const float RATE_WINDOW_SECONDS = 1.0f;
+
+
+//-----------------------------------------------------------------------------------------------
+// Nearly always written by only one thread, but still atomic so the threads that share a shard
+// and the thread summing them never lose a count
+struct alignas( 64 ) AllocationCounterShard
+{
+	std::atomic< uint64_t > m_numAllocations;
+	std::atomic< uint64_t > m_numFrees;
+	std::atomic< uint64_t > m_bytesAllocated;
+	std::atomic< uint64_t > m_bytesFreed;
+	std::atomic< uint64_t > m_sizeHistogram[ NUM_ALLOCATION_SIZE_BUCKETS ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationRateFrame
+{
+	uint64_t m_numAllocations;
+	uint64_t m_numBytes;
+	float m_seconds;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Zero initialized before any constructor runs, operator new can get here first
+static AllocationCounterShard s_shards[ NUM_ALLOCATION_COUNTER_SHARDS ];
+static std::atomic< unsigned int > s_numShardsHandedOut( 0 );
+static thread_local AllocationCounterShard* t_shard = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+// Only touched by AllocationCountersFrameMark and GetAllocationFrameStats, on the main thread
+static AllocationCounterTotals s_totalsAtFrameStart;
+static AllocationFrameStats s_lastFrameStats;
+static AllocationRateFrame s_rateFrames[ NUM_RATE_FRAMES ];
+static unsigned int s_numRateFrames = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+static AllocationCounterShard& GetThreadShard()
+{
+	if ( t_shard == nullptr )
+	{
+		unsigned int shardIndex = s_numShardsHandedOut.fetch_add( 1, std::memory_order_relaxed ) % NUM_ALLOCATION_COUNTER_SHARDS;
+		t_shard = &s_shards[ shardIndex ];
+	}
+
+	return *t_shard;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void AddToAllocationCounters( size_t numBytes )
+{
+	AllocationCounterShard& shard = GetThreadShard();
+	shard.m_numAllocations.fetch_add( 1, std::memory_order_relaxed );
+	shard.m_bytesAllocated.fetch_add( numBytes, std::memory_order_relaxed );
+	shard.m_sizeHistogram[ SlabGetSizeClass( numBytes ) ].fetch_add( 1, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Usually lands in a different shard than the allocation did, which is fine since only the sums mean anything
+void RemoveFromAllocationCounters( size_t numBytes )
+{
+	AllocationCounterShard& shard = GetThreadShard();
+	shard.m_numFrees.fetch_add( 1, std::memory_order_relaxed );
+	shard.m_bytesFreed.fetch_add( numBytes, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+AllocationCounterTotals GetAllocationCounterTotals()
+{
+	uint64_t numFrees = 0;
+	uint64_t bytesFreed = 0;
+	AllocationCounterTotals totals;
+	memset( &totals, 0, sizeof( totals ) );
+
+	for ( unsigned int shardIndex = 0; shardIndex < NUM_ALLOCATION_COUNTER_SHARDS; ++shardIndex )
+	{
+		AllocationCounterShard const &shard = s_shards[ shardIndex ];
+		totals.m_numTotalAllocations += shard.m_numAllocations.load( std::memory_order_relaxed );
+		totals.m_totalBytesAllocated += shard.m_bytesAllocated.load( std::memory_order_relaxed );
+		numFrees += shard.m_numFrees.load( std::memory_order_relaxed );
+		bytesFreed += shard.m_bytesFreed.load( std::memory_order_relaxed );
+		for ( int bucketIndex = 0; bucketIndex < NUM_ALLOCATION_SIZE_BUCKETS; ++bucketIndex )
+		{
+			totals.m_sizeHistogram[ bucketIndex ] += shard.m_sizeHistogram[ bucketIndex ].load( std::memory_order_relaxed );
+		}
+	}
+
+	// A free summed before its allocation was would briefly make these negative
+	totals.m_numLiveAllocations = ( totals.m_numTotalAllocations > numFrees ) ? totals.m_numTotalAllocations - numFrees : 0;
+	totals.m_liveBytes = ( totals.m_totalBytesAllocated > bytesFreed ) ? totals.m_totalBytesAllocated - bytesFreed : 0;
+	return totals;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The rates cover however many of the most recent frames add up to a second
+void AllocationCountersFrameMark( float deltaSeconds )
+{
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	s_lastFrameStats.m_numAllocations = totals.m_numTotalAllocations - s_totalsAtFrameStart.m_numTotalAllocations;
+	s_lastFrameStats.m_numBytes = totals.m_totalBytesAllocated - s_totalsAtFrameStart.m_totalBytesAllocated;
+	for ( int bucketIndex = 0; bucketIndex < NUM_ALLOCATION_SIZE_BUCKETS; ++bucketIndex )
+	{
+		s_lastFrameStats.m_sizeHistogram[ bucketIndex ] = totals.m_sizeHistogram[ bucketIndex ] - s_totalsAtFrameStart.m_sizeHistogram[ bucketIndex ];
+	}
+	s_totalsAtFrameStart = totals;
+
+	AllocationRateFrame& newFrame = s_rateFrames[ s_numRateFrames % NUM_RATE_FRAMES ];
+	newFrame.m_numAllocations = s_lastFrameStats.m_numAllocations;
+	newFrame.m_numBytes = s_lastFrameStats.m_numBytes;
+	newFrame.m_seconds = deltaSeconds;
+	++s_numRateFrames;
+
+	uint64_t numAllocations = 0;
+	uint64_t numBytes = 0;
+	float seconds = 0.0f;
+	unsigned int numFramesToSum = ( s_numRateFrames < NUM_RATE_FRAMES ) ? s_numRateFrames : NUM_RATE_FRAMES;
+	for ( unsigned int frameIndex = 0; frameIndex < numFramesToSum && seconds < RATE_WINDOW_SECONDS; ++frameIndex )
+	{
+		AllocationRateFrame const &frame = s_rateFrames[ ( s_numRateFrames - 1 - frameIndex ) % NUM_RATE_FRAMES ];
+		numAllocations += frame.m_numAllocations;
+		numBytes += frame.m_numBytes;
+		seconds += frame.m_seconds;
+	}
+
+	s_lastFrameStats.m_allocationsPerSecond = ( seconds > 0.0f ) ? ( float ) numAllocations / seconds : 0.0f;
+	s_lastFrameStats.m_bytesPerSecond = ( seconds > 0.0f ) ? ( float ) numBytes / seconds : 0.0f;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+AllocationFrameStats GetAllocationFrameStats()
+{
+	return s_lastFrameStats;
+}
\ No newline at end of file
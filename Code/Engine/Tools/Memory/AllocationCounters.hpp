@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Engine/Tools/Memory/SlabAllocator.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const int NUM_ALLOCATION_SIZE_BUCKETS = NUM_SLAB_SIZE_CLASSES + 1; // One per slab size class, the last for anything bigger
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationCounterTotals
+{
+	uint64_t m_numLiveAllocations;
+	uint64_t m_liveBytes;
+	uint64_t m_numTotalAllocations; // Every allocation ever made, freed or not
+	uint64_t m_totalBytesAllocated;
+	uint64_t m_sizeHistogram[ NUM_ALLOCATION_SIZE_BUCKETS ]; // Allocations ever made in each size class
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationFrameStats
+{
+	uint64_t m_numAllocations; // Made during the last frame
+	uint64_t m_numBytes;
+	uint64_t m_sizeHistogram[ NUM_ALLOCATION_SIZE_BUCKETS ];
+	float m_allocationsPerSecond; // Over the frames making up the last second
+	float m_bytesPerSecond;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// 64-bit allocation counts for the tracked operator new. Each thread adds to its own cache line
+// of counters, so counting never contends, and the shards are summed when someone asks. Sums are
+// taken without stopping other threads, so they can be a few allocations behind.
+void AddToAllocationCounters( size_t numBytes );
+void RemoveFromAllocationCounters( size_t numBytes );
+AllocationCounterTotals GetAllocationCounterTotals();
+void AllocationCountersFrameMark( float deltaSeconds ); // Once a frame, closes the frame's stats
+AllocationFrameStats GetAllocationFrameStats();
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <thread>
+
+#include "Engine/Tools/Memory/AllocationTracker.hpp"
+#include "Engine/Tools/Memory/Callstack.hpp"
+#include "Engine/Config/BuildConfig.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int NUM_ALLOCATION_STRIPES = 64; // Picked by the top bits of the address hash
+const unsigned int NUM_CALLSTACK_STRIPES = 16;
+const unsigned int INITIAL_STRIPE_CAPACITY = 256;
+#ifdef MEMORY_TRACKING_SAMPLE_RATE
+const size_t DEFAULT_SAMPLING_INTERVAL = MEMORY_TRACKING_SAMPLE_RATE;
+#else
+const size_t DEFAULT_SAMPLING_INTERVAL = 1;
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// Spins rather than using std::mutex, which isn't constant initialized everywhere and operator new
+// can run before any constructor does
+struct TrackerLock
+{
+	void Lock()
+	{
+		while ( m_isLocked.exchange( true, std::memory_order_acquire ) )
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Unlock()
+	{
+		m_isLocked.store( false, std::memory_order_release );
+	}
+
+	std::atomic< bool > m_isLocked;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct TrackedAllocation
+{
+	void* m_address; // nullptr for an empty slot
+	TrackedCallstack* m_callstack;
+	size_t m_numBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Open addressing with linear probing, grown by doubling and deleted from by shifting entries back
+// so there are no tombstones
+struct alignas( 64 ) AllocationStripe
+{
+	TrackerLock m_lock;
+	TrackedAllocation* m_slots;
+	unsigned int m_capacity; // Always a power of two
+	unsigned int m_numUsed;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct alignas( 64 ) CallstackStripe
+{
+	TrackerLock m_lock;
+	TrackedCallstack** m_slots;
+	unsigned int m_capacity; // Always a power of two
+	unsigned int m_numUsed;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static AllocationStripe s_allocationStripes[ NUM_ALLOCATION_STRIPES ];
+static CallstackStripe s_callstackStripes[ NUM_CALLSTACK_STRIPES ];
+static std::atomic< uint64_t > s_numTrackedAllocations( 0 );
+static std::atomic< uint64_t > s_trackedBytes( 0 );
+static std::atomic< unsigned int > s_numCallstacks( 0 );
+static std::atomic< int > s_samplingMode( ALLOCATION_SAMPLING_BY_COUNT );
+static std::atomic< size_t > s_samplingInterval( DEFAULT_SAMPLING_INTERVAL );
+
+
+//-----------------------------------------------------------------------------------------------
+static thread_local bool t_isTracking = false; // Set while the tracker is running, so its own allocations aren't tracked
+static thread_local size_t t_allocationsUntilSample = 0;
+static thread_local size_t t_bytesUntilSample = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+static uint64_t HashAddress( void* ptr )
+{
+	uint64_t key = ( uint64_t ) ( uintptr_t ) ptr;
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return key;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static uint64_t HashFrames( void** frames, unsigned int numFrames, MemoryTag tag )
+{
+	uint64_t hash = 14695981039346656037ULL ^ ( uint64_t ) tag;
+	for ( unsigned int frameIndex = 0; frameIndex < numFrames; ++frameIndex )
+	{
+		hash ^= ( uint64_t ) ( uintptr_t ) frames[ frameIndex ];
+		hash *= 1099511628211ULL;
+	}
+	return hash ^ ( hash >> 29 );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int CaptureAllocationFrames( void** out_frames, unsigned int numSkipFrames )
+{
+	return CallstackCaptureFrames( out_frames, MAX_TRACKED_CALLSTACK_DEPTH, 1 + numSkipFrames );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool ShouldSampleAllocation( size_t numBytes )
+{
+	size_t interval = s_samplingInterval.load( std::memory_order_relaxed );
+	if ( interval <= 1 )
+	{
+		return true;
+	}
+
+	if ( s_samplingMode.load( std::memory_order_relaxed ) == ALLOCATION_SAMPLING_BY_BYTES )
+	{
+		// Anything at least as big as the interval is always recorded
+		if ( t_bytesUntilSample > numBytes )
+		{
+			t_bytesUntilSample -= numBytes;
+			return false;
+		}
+
+		t_bytesUntilSample = interval;
+		return true;
+	}
+
+	if ( t_allocationsUntilSample > 0 )
+	{
+		--t_allocationsUntilSample;
+		return false;
+	}
+
+	t_allocationsUntilSample = interval - 1;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool GrowCallstackStripe( CallstackStripe& stripe )
+{
+	unsigned int newCapacity = ( stripe.m_capacity == 0 ) ? INITIAL_STRIPE_CAPACITY : stripe.m_capacity * 2;
+	TrackedCallstack** newSlots = ( TrackedCallstack** ) calloc( newCapacity, sizeof( TrackedCallstack* ) );
+	if ( newSlots == nullptr )
+	{
+		return false;
+	}
+
+	unsigned int mask = newCapacity - 1;
+	for ( unsigned int slotIndex = 0; slotIndex < stripe.m_capacity; ++slotIndex )
+	{
+		TrackedCallstack* callstack = stripe.m_slots[ slotIndex ];
+		if ( callstack != nullptr )
+		{
+			unsigned int newIndex = ( unsigned int ) callstack->m_hash & mask;
+			while ( newSlots[ newIndex ] != nullptr )
+			{
+				newIndex = ( newIndex + 1 ) & mask;
+			}
+			newSlots[ newIndex ] = callstack;
+		}
+	}
+
+	free( stripe.m_slots );
+	stripe.m_slots = newSlots;
+	stripe.m_capacity = newCapacity;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Returns the one shared copy of this callstack, storing it the first time it's seen
+static TrackedCallstack* InternCallstack( void** frames, unsigned int numFrames, MemoryTag tag )
+{
+	uint64_t hash = HashFrames( frames, numFrames, tag );
+	CallstackStripe& stripe = s_callstackStripes[ hash >> 60 ];
+
+	stripe.m_lock.Lock();
+	if ( ( stripe.m_numUsed + 1 ) * 4 > stripe.m_capacity * 3 && !GrowCallstackStripe( stripe ) )
+	{
+		stripe.m_lock.Unlock();
+		return nullptr;
+	}
+
+	unsigned int mask = stripe.m_capacity - 1;
+	unsigned int slotIndex = ( unsigned int ) hash & mask;
+	while ( stripe.m_slots[ slotIndex ] != nullptr )
+	{
+		TrackedCallstack* callstack = stripe.m_slots[ slotIndex ];
+		if ( callstack->m_hash == hash && callstack->m_numFrames == numFrames && callstack->m_tag == tag
+			&& memcmp( callstack->m_frames, frames, numFrames * sizeof( void* ) ) == 0 )
+		{
+			stripe.m_lock.Unlock();
+			return callstack;
+		}
+		slotIndex = ( slotIndex + 1 ) & mask;
+	}
+
+	TrackedCallstack* callstack = ( TrackedCallstack* ) malloc( sizeof( TrackedCallstack ) );
+	if ( callstack != nullptr )
+	{
+		new ( callstack ) TrackedCallstack();
+		callstack->m_hash = hash;
+		callstack->m_numFrames = numFrames;
+		callstack->m_tag = tag;
+		callstack->m_numLiveAllocations.store( 0, std::memory_order_relaxed );
+		callstack->m_liveBytes.store( 0, std::memory_order_relaxed );
+		callstack->m_numTotalAllocations.store( 0, std::memory_order_relaxed );
+		memcpy( callstack->m_frames, frames, numFrames * sizeof( void* ) );
+
+		stripe.m_slots[ slotIndex ] = callstack;
+		++stripe.m_numUsed;
+		s_numCallstacks.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	stripe.m_lock.Unlock();
+	return callstack;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool GrowAllocationStripe( AllocationStripe& stripe )
+{
+	unsigned int newCapacity = ( stripe.m_capacity == 0 ) ? INITIAL_STRIPE_CAPACITY : stripe.m_capacity * 2;
+	TrackedAllocation* newSlots = ( TrackedAllocation* ) calloc( newCapacity, sizeof( TrackedAllocation ) );
+	if ( newSlots == nullptr )
+	{
+		return false;
+	}
+
+	unsigned int mask = newCapacity - 1;
+	for ( unsigned int slotIndex = 0; slotIndex < stripe.m_capacity; ++slotIndex )
+	{
+		TrackedAllocation const &allocation = stripe.m_slots[ slotIndex ];
+		if ( allocation.m_address != nullptr )
+		{
+			unsigned int newIndex = ( unsigned int ) HashAddress( allocation.m_address ) & mask;
+			while ( newSlots[ newIndex ].m_address != nullptr )
+			{
+				newIndex = ( newIndex + 1 ) & mask;
+			}
+			newSlots[ newIndex ] = allocation;
+		}
+	}
+
+	free( stripe.m_slots );
+	stripe.m_slots = newSlots;
+	stripe.m_capacity = newCapacity;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CountAllocation( TrackedAllocation const &allocation, bool isAdding )
+{
+	if ( isAdding )
+	{
+		allocation.m_callstack->m_numLiveAllocations.fetch_add( 1, std::memory_order_relaxed );
+		allocation.m_callstack->m_liveBytes.fetch_add( allocation.m_numBytes, std::memory_order_relaxed );
+		allocation.m_callstack->m_numTotalAllocations.fetch_add( 1, std::memory_order_relaxed );
+		s_numTrackedAllocations.fetch_add( 1, std::memory_order_relaxed );
+		s_trackedBytes.fetch_add( allocation.m_numBytes, std::memory_order_relaxed );
+	}
+	else
+	{
+		allocation.m_callstack->m_numLiveAllocations.fetch_sub( 1, std::memory_order_relaxed );
+		allocation.m_callstack->m_liveBytes.fetch_sub( allocation.m_numBytes, std::memory_order_relaxed );
+		s_numTrackedAllocations.fetch_sub( 1, std::memory_order_relaxed );
+		s_trackedBytes.fetch_sub( allocation.m_numBytes, std::memory_order_relaxed );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void TrackAllocation( void* ptr, size_t numBytes, MemoryTag tag, unsigned int numSkipFrames )
+{
+	if ( ptr == nullptr || t_isTracking || !ShouldSampleAllocation( numBytes ) )
+	{
+		return;
+	}
+
+	t_isTracking = true;
+
+	void* frames[ MAX_TRACKED_CALLSTACK_DEPTH ];
+	unsigned int numFrames = CaptureAllocationFrames( frames, 1 + numSkipFrames );
+	TrackedCallstack* callstack = InternCallstack( frames, numFrames, tag );
+	if ( callstack == nullptr )
+	{
+		t_isTracking = false;
+		return;
+	}
+
+	TrackedAllocation allocation;
+	allocation.m_address = ptr;
+	allocation.m_callstack = callstack;
+	allocation.m_numBytes = numBytes;
+
+	uint64_t hash = HashAddress( ptr );
+	AllocationStripe& stripe = s_allocationStripes[ hash >> 58 ];
+
+	stripe.m_lock.Lock();
+	if ( ( stripe.m_numUsed + 1 ) * 4 <= stripe.m_capacity * 3 || GrowAllocationStripe( stripe ) )
+	{
+		unsigned int mask = stripe.m_capacity - 1;
+		unsigned int slotIndex = ( unsigned int ) hash & mask;
+		while ( stripe.m_slots[ slotIndex ].m_address != nullptr && stripe.m_slots[ slotIndex ].m_address != ptr )
+		{
+			slotIndex = ( slotIndex + 1 ) & mask;
+		}
+
+		// Only there if it was freed without going through UntrackAllocation
+		if ( stripe.m_slots[ slotIndex ].m_address == ptr )
+		{
+			CountAllocation( stripe.m_slots[ slotIndex ], false );
+		}
+		else
+		{
+			++stripe.m_numUsed;
+		}
+
+		stripe.m_slots[ slotIndex ] = allocation;
+		CountAllocation( allocation, true );
+	}
+	stripe.m_lock.Unlock();
+
+	t_isTracking = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void UntrackAllocation( void* ptr )
+{
+	if ( ptr == nullptr || s_numTrackedAllocations.load( std::memory_order_relaxed ) == 0 )
+	{
+		return;
+	}
+
+	uint64_t hash = HashAddress( ptr );
+	AllocationStripe& stripe = s_allocationStripes[ hash >> 58 ];
+
+	stripe.m_lock.Lock();
+	if ( stripe.m_numUsed == 0 )
+	{
+		stripe.m_lock.Unlock();
+		return;
+	}
+
+	unsigned int mask = stripe.m_capacity - 1;
+	unsigned int slotIndex = ( unsigned int ) hash & mask;
+	while ( stripe.m_slots[ slotIndex ].m_address != ptr )
+	{
+		if ( stripe.m_slots[ slotIndex ].m_address == nullptr )
+		{
+			// Wasn't sampled
+			stripe.m_lock.Unlock();
+			return;
+		}
+		slotIndex = ( slotIndex + 1 ) & mask;
+	}
+
+	CountAllocation( stripe.m_slots[ slotIndex ], false );
+	--stripe.m_numUsed;
+
+	// Shift back any entry that probed past the hole, unless that would move it before its home
+	unsigned int holeIndex = slotIndex;
+	unsigned int nextIndex = ( holeIndex + 1 ) & mask;
+	while ( stripe.m_slots[ nextIndex ].m_address != nullptr )
+	{
+		unsigned int homeIndex = ( unsigned int ) HashAddress( stripe.m_slots[ nextIndex ].m_address ) & mask;
+		bool canMove = ( holeIndex <= nextIndex ) ? ( homeIndex <= holeIndex || homeIndex > nextIndex )
+			: ( homeIndex <= holeIndex && homeIndex > nextIndex );
+		if ( canMove )
+		{
+			stripe.m_slots[ holeIndex ] = stripe.m_slots[ nextIndex ];
+			holeIndex = nextIndex;
+		}
+		nextIndex = ( nextIndex + 1 ) & mask;
+	}
+	stripe.m_slots[ holeIndex ].m_address = nullptr;
+
+	stripe.m_lock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Changing the interval doesn't reset the countdowns already running on each thread
+void SetAllocationSampling( AllocationSamplingMode mode, size_t interval )
+{
+	s_samplingMode.store( mode, std::memory_order_relaxed );
+	s_samplingInterval.store( ( interval == 0 ) ? 1 : interval, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+AllocationTrackerStats GetAllocationTrackerStats()
+{
+	AllocationTrackerStats stats;
+	stats.m_numTrackedAllocations = s_numTrackedAllocations.load( std::memory_order_relaxed );
+	stats.m_trackedBytes = s_trackedBytes.load( std::memory_order_relaxed );
+	stats.m_numCallstacks = s_numCallstacks.load( std::memory_order_relaxed );
+	stats.m_samplingMode = ( AllocationSamplingMode ) s_samplingMode.load( std::memory_order_relaxed );
+	stats.m_samplingInterval = s_samplingInterval.load( std::memory_order_relaxed );
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Allocations made by the callback aren't tracked, it runs with a callstack stripe locked
+void ForEachTrackedCallstack( TrackedCallstackCallback callback, void* userData )
+{
+	bool wasTracking = t_isTracking;
+	t_isTracking = true;
+
+	for ( unsigned int stripeIndex = 0; stripeIndex < NUM_CALLSTACK_STRIPES; ++stripeIndex )
+	{
+		CallstackStripe& stripe = s_callstackStripes[ stripeIndex ];
+		stripe.m_lock.Lock();
+		for ( unsigned int slotIndex = 0; slotIndex < stripe.m_capacity; ++slotIndex )
+		{
+			if ( stripe.m_slots[ slotIndex ] != nullptr )
+			{
+				callback( *stripe.m_slots[ slotIndex ], userData );
+			}
+		}
+		stripe.m_lock.Unlock();
+	}
+
+	t_isTracking = wasTracking;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int MAX_TRACKED_CALLSTACK_DEPTH = 32;
+
+
+//-----------------------------------------------------------------------------------------------
+enum AllocationSamplingMode
+{
+	ALLOCATION_SAMPLING_BY_COUNT = 0, // Record every Nth allocation on each thread
+	ALLOCATION_SAMPLING_BY_BYTES, // Record one allocation per N bytes allocated on each thread
+	NUM_ALLOCATION_SAMPLING_MODES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Stored once per callstack and tag no matter how many allocations share it, and never freed
+struct TrackedCallstack
+{
+	uint64_t m_hash;
+	unsigned int m_numFrames;
+	MemoryTag m_tag;
+	std::atomic< uint64_t > m_numLiveAllocations;
+	std::atomic< uint64_t > m_liveBytes;
+	std::atomic< uint64_t > m_numTotalAllocations;
+	void* m_frames[ MAX_TRACKED_CALLSTACK_DEPTH ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationTrackerStats
+{
+	uint64_t m_numTrackedAllocations;
+	uint64_t m_trackedBytes;
+	unsigned int m_numCallstacks;
+	AllocationSamplingMode m_samplingMode;
+	size_t m_samplingInterval;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+typedef void ( *TrackedCallstackCallback )( TrackedCallstack const &callstack, void* userData );
+
+
+//-----------------------------------------------------------------------------------------------
+// Live allocations and the callstacks that made them, for MEMORY_TRACKING verbose mode. Safe to
+// call from any thread: allocations are spread over lock-striped hash tables, and callstacks are
+// interned by hash along with the allocation's memory tag, so each distinct one is stored once.
+// Only sampled allocations are recorded, so totals here are of the sample. Uses malloc, never
+// operator new.
+void TrackAllocation( void* ptr, size_t numBytes, MemoryTag tag, unsigned int numSkipFrames );
+void UntrackAllocation( void* ptr );
+void SetAllocationSampling( AllocationSamplingMode mode, size_t interval ); // Interval 1 records everything
+AllocationTrackerStats GetAllocationTrackerStats();
+void ForEachTrackedCallstack( TrackedCallstackCallback callback, void* userData );
+unsigned int CaptureAllocationFrames( void** out_frames, unsigned int numSkipFrames ); // Up to MAX_TRACKED_CALLSTACK_DEPTH, innermost first
\ No newline at end of file
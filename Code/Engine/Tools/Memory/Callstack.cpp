@@ -0,0 +1,888 @@
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma warning (disable: 4091)
+#include <DbgHelp.h>
+#include <tlhelp32.h>
+#elif defined( __linux__ )
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <unistd.h>
+#include <cxxabi.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "Engine/Tools/Memory/Callstack.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Choose raw callstack addresses in this file
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int INITIAL_SYMBOL_CACHE_CAPACITY = 1024; // Always a power of two
+const size_t SYMBOL_STRING_BLOCK_SIZE = 64 * 1024;
+const size_t MAX_SYMBOL_TEXT_LENGTH = 1024;
+char const* const UNKNOWN_FILENAME = "N/A";
+
+
+//-----------------------------------------------------------------------------------------------
+struct CachedFrameSymbol
+{
+	void* m_address; // nullptr for an empty slot
+	CallstackLine m_line;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Symbol strings are copied in here and never moved, so lines can point at them
+struct SymbolStringBlock
+{
+	SymbolStringBlock* m_next;
+	size_t m_numUsedBytes;
+	char m_text[ SYMBOL_STRING_BLOCK_SIZE ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Everything below is guarded by s_symbolLock, dbghelp isn't thread safe either. Only uses malloc
+// so the allocation tracker can symbolize while it holds its own locks.
+static std::mutex s_symbolLock;
+static std::atomic< bool > s_isStarted( false );
+static std::atomic< int > s_symbolMode( CALLSTACK_SYMBOLS_ONLINE );
+static CachedFrameSymbol* s_symbolSlots = nullptr;
+static unsigned int s_symbolCapacity = 0;
+static unsigned int s_numCachedSymbols = 0;
+static SymbolStringBlock* s_stringBlocks = nullptr;
+static size_t s_numStringBytes = 0;
+static uint64_t s_numLookups = 0;
+static uint64_t s_numMisses = 0;
+static CallstackModule s_modules[ MAX_CALLSTACK_MODULES ];
+static unsigned int s_numModules = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+static thread_local CallstackLine t_lineBuffer[ MAX_DEPTH ];
+
+
+#if defined( _WIN32 )
+//-----------------------------------------------------------------------------------------------
+typedef BOOL( __stdcall *sym_initialize_t )( IN HANDLE hProcess, IN PSTR UserSearchPath, IN BOOL fInvadeProcess );
+typedef BOOL( __stdcall *sym_cleanup_t )( IN HANDLE hProcess );
+typedef BOOL( __stdcall *sym_from_addr_t )( IN HANDLE hProcess, IN DWORD64 Address, OUT PDWORD64 Displacement, OUT PSYMBOL_INFO Symbol );
+typedef BOOL( __stdcall *sym_get_line_t )( IN HANDLE hProcess, IN DWORD64 dwAddr, OUT PDWORD pdwDisplacement, OUT PIMAGEHLP_LINE64 Symbol );
+typedef DWORD( __stdcall *sym_set_options_t )( IN DWORD SymOptions );
+typedef DWORD64( __stdcall *sym_load_module_ex_t )( IN HANDLE hProcess, IN HANDLE hFile, IN PCSTR ImageName, IN PCSTR ModuleName,
+	IN DWORD64 BaseOfDll, IN DWORD DllSize, IN PMODLOAD_DATA Data, IN DWORD Flags );
+
+
+//-----------------------------------------------------------------------------------------------
+static HMODULE s_debugHelp = NULL;
+static sym_initialize_t LSymInitialize;
+static sym_cleanup_t LSymCleanup;
+static sym_from_addr_t LSymFromAddr;
+static sym_get_line_t LSymGetLineFromAddr64;
+static sym_set_options_t LSymSetOptions;
+static sym_load_module_ex_t LSymLoadModuleEx;
+static SYMBOL_INFO* s_symbol = nullptr;
+static bool s_isProcessSymbolSessionOpen = false;
+static bool s_isOfflineSymbolSessionOpen = false;
+static int s_offlineSymbolSession; // Its address names the offline session, dbghelp only needs a unique handle
+static uintptr_t s_offlineModuleBases[ MAX_CALLSTACK_MODULES ];
+static unsigned int s_numOfflineModules = 0;
+#elif defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+static char s_executablePath[ MAX_CALLSTACK_MODULE_PATH_LENGTH ];
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static char const* InternSymbolString( char const* text )
+{
+	size_t numBytes = strlen( text ) + 1;
+	if ( numBytes > SYMBOL_STRING_BLOCK_SIZE )
+	{
+		numBytes = SYMBOL_STRING_BLOCK_SIZE;
+	}
+
+	if ( s_stringBlocks == nullptr || s_stringBlocks->m_numUsedBytes + numBytes > SYMBOL_STRING_BLOCK_SIZE )
+	{
+		SymbolStringBlock* newBlock = ( SymbolStringBlock* ) malloc( sizeof( SymbolStringBlock ) );
+		if ( newBlock == nullptr )
+		{
+			return UNKNOWN_FILENAME;
+		}
+
+		newBlock->m_next = s_stringBlocks;
+		newBlock->m_numUsedBytes = 0;
+		s_stringBlocks = newBlock;
+	}
+
+	char* internedText = &s_stringBlocks->m_text[ s_stringBlocks->m_numUsedBytes ];
+	memcpy( internedText, text, numBytes - 1 );
+	internedText[ numBytes - 1 ] = '\0';
+	s_stringBlocks->m_numUsedBytes += numBytes;
+	s_numStringBytes += numBytes;
+	return internedText;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static char const* GetModuleFilename( CallstackModule const &module )
+{
+	char const* filename = module.m_path;
+	for ( char const* c = module.m_path; *c != '\0'; ++c )
+	{
+		if ( *c == '/' || *c == '\\' )
+		{
+			filename = c + 1;
+		}
+	}
+	return filename;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsModuleEarlier( CallstackModule const &first, CallstackModule const &second )
+{
+	return first.m_startAddress < second.m_startAddress;
+}
+
+
+#if defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+// The main program comes first with an empty name
+static int AddLoadedModule( struct dl_phdr_info* info, size_t infoSize, void* userData )
+{
+	( void ) infoSize;
+	( void ) userData;
+	if ( s_numModules >= MAX_CALLSTACK_MODULES )
+	{
+		return 1;
+	}
+
+	uintptr_t startAddress = UINTPTR_MAX;
+	uintptr_t endAddress = 0;
+	for ( int headerIndex = 0; headerIndex < info->dlpi_phnum; ++headerIndex )
+	{
+		ElfW( Phdr ) const &header = info->dlpi_phdr[ headerIndex ];
+		if ( header.p_type != PT_LOAD )
+		{
+			continue;
+		}
+
+		uintptr_t segmentStart = info->dlpi_addr + header.p_vaddr;
+		startAddress = ( segmentStart < startAddress ) ? segmentStart : startAddress;
+		endAddress = ( segmentStart + header.p_memsz > endAddress ) ? segmentStart + header.p_memsz : endAddress;
+	}
+
+	if ( endAddress == 0 )
+	{
+		return 0;
+	}
+
+	// addr2line wants addresses relative to the load bias, which is 0 for a non-PIE executable
+	CallstackModule& module = s_modules[ s_numModules++ ];
+	module.m_baseAddress = info->dlpi_addr;
+	module.m_startAddress = startAddress;
+	module.m_endAddress = endAddress;
+	char const* path = ( info->dlpi_name != nullptr && info->dlpi_name[ 0 ] != '\0' ) ? info->dlpi_name : s_executablePath;
+	snprintf( module.m_path, MAX_CALLSTACK_MODULE_PATH_LENGTH, "%s", path );
+	return 0;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static void RefreshModules()
+{
+	s_numModules = 0;
+
+#if defined( _WIN32 )
+	HANDLE snapshot = CreateToolhelp32Snapshot( TH32CS_SNAPMODULE, GetCurrentProcessId() );
+	if ( snapshot == INVALID_HANDLE_VALUE )
+	{
+		return;
+	}
+
+	MODULEENTRY32W entry;
+	entry.dwSize = sizeof( entry );
+	for ( BOOL hasModule = Module32FirstW( snapshot, &entry ); hasModule && s_numModules < MAX_CALLSTACK_MODULES;
+		hasModule = Module32NextW( snapshot, &entry ) )
+	{
+		CallstackModule& module = s_modules[ s_numModules++ ];
+		module.m_baseAddress = ( uintptr_t ) entry.modBaseAddr;
+		module.m_startAddress = ( uintptr_t ) entry.modBaseAddr;
+		module.m_endAddress = ( uintptr_t ) entry.modBaseAddr + entry.modBaseSize;
+		WideCharToMultiByte( CP_UTF8, 0, entry.szExePath, -1, module.m_path, MAX_CALLSTACK_MODULE_PATH_LENGTH, NULL, NULL );
+	}
+	CloseHandle( snapshot );
+#elif defined( __linux__ )
+	if ( s_executablePath[ 0 ] == '\0' )
+	{
+		ssize_t pathLength = readlink( "/proc/self/exe", s_executablePath, MAX_CALLSTACK_MODULE_PATH_LENGTH - 1 );
+		s_executablePath[ ( pathLength > 0 ) ? pathLength : 0 ] = '\0';
+	}
+	dl_iterate_phdr( AddLoadedModule, nullptr );
+#endif
+
+	std::sort( s_modules, s_modules + s_numModules, IsModuleEarlier );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Modules loaded since the last look are picked up the first time one of their addresses misses
+static CallstackModule const* FindModule( void* address )
+{
+	uintptr_t frameAddress = ( uintptr_t ) address;
+	for ( int attempt = 0; attempt < 2; ++attempt )
+	{
+		if ( attempt > 0 )
+		{
+			RefreshModules();
+		}
+
+		CallstackModule const* nextModule = std::upper_bound( s_modules, s_modules + s_numModules, frameAddress,
+			[]( uintptr_t moduleAddress, CallstackModule const &module ) { return moduleAddress < module.m_startAddress; } );
+		if ( nextModule != s_modules && frameAddress < ( nextModule - 1 )->m_endAddress )
+		{
+			return nextModule - 1;
+		}
+	}
+
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FormatRawFrame( void* address, CallstackModule const* module, char* out_text, size_t maxTextLength )
+{
+	if ( module == nullptr )
+	{
+		snprintf( out_text, maxTextLength, "0x%016llx ?+0x0", ( unsigned long long ) ( uintptr_t ) address );
+		return;
+	}
+
+	snprintf( out_text, maxTextLength, "0x%016llx %s+0x%llx", ( unsigned long long ) ( uintptr_t ) address, GetModuleFilename( *module ),
+		( unsigned long long ) ( ( uintptr_t ) address - module->m_baseAddress ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void SetUnknownLine( void* address, CallstackModule const* module, CallstackLine& out_line )
+{
+	char text[ MAX_SYMBOL_TEXT_LENGTH ];
+	FormatRawFrame( address, module, text, MAX_SYMBOL_TEXT_LENGTH );
+	out_line.functionName = InternSymbolString( text );
+	out_line.filename = UNKNOWN_FILENAME;
+	out_line.line = 0;
+	out_line.offset = 0;
+}
+
+
+#if defined( _WIN32 )
+//-----------------------------------------------------------------------------------------------
+static bool LoadDebugHelp()
+{
+	if ( s_debugHelp != NULL )
+	{
+		return true;
+	}
+
+	s_debugHelp = LoadLibraryA( "dbghelp.dll" );
+	if ( s_debugHelp == NULL )
+	{
+		return false;
+	}
+
+	LSymInitialize = ( sym_initialize_t ) GetProcAddress( s_debugHelp, "SymInitialize" );
+	LSymCleanup = ( sym_cleanup_t ) GetProcAddress( s_debugHelp, "SymCleanup" );
+	LSymFromAddr = ( sym_from_addr_t ) GetProcAddress( s_debugHelp, "SymFromAddr" );
+	LSymGetLineFromAddr64 = ( sym_get_line_t ) GetProcAddress( s_debugHelp, "SymGetLineFromAddr64" );
+	LSymSetOptions = ( sym_set_options_t ) GetProcAddress( s_debugHelp, "SymSetOptions" );
+	LSymLoadModuleEx = ( sym_load_module_ex_t ) GetProcAddress( s_debugHelp, "SymLoadModuleEx" );
+
+	s_symbol = ( SYMBOL_INFO* ) malloc( sizeof( SYMBOL_INFO ) + MAX_SYMBOL_TEXT_LENGTH );
+	s_symbol->MaxNameLen = MAX_SYMBOL_TEXT_LENGTH;
+	s_symbol->SizeOfStruct = sizeof( SYMBOL_INFO );
+
+	// Deferred, so a module's symbols are only read once one of its addresses is looked up
+	LSymSetOptions( SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void ResolveDebugHelpSymbol( HANDLE process, DWORD64 address, void* frameAddress, CallstackModule const* module, CallstackLine& out_line )
+{
+	DWORD64 symbolDisplacement = 0;
+	if ( !LSymFromAddr( process, address, &symbolDisplacement, s_symbol ) )
+	{
+		SetUnknownLine( frameAddress, module, out_line );
+		return;
+	}
+	out_line.functionName = InternSymbolString( s_symbol->Name );
+
+	IMAGEHLP_LINE64 lineInfo;
+	DWORD lineDisplacement = 0; // Displacement from the beginning of the line
+	lineInfo.SizeOfStruct = sizeof( IMAGEHLP_LINE64 );
+	if ( LSymGetLineFromAddr64( process, address, &lineDisplacement, &lineInfo ) )
+	{
+		out_line.filename = InternSymbolString( lineInfo.FileName );
+		out_line.line = lineInfo.LineNumber;
+		out_line.offset = lineDisplacement;
+	}
+	else
+	{
+		out_line.filename = UNKNOWN_FILENAME;
+		out_line.line = 0;
+		out_line.offset = 0;
+	}
+}
+#elif defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+// The DWARF line tables are read by addr2line rather than parsed here, one process per address
+// missed, which the cache keeps to once per address per run
+static bool ResolveWithAddr2Line( CallstackModule const &module, uint64_t offset, CallstackLine& out_line )
+{
+	if ( strchr( module.m_path, '\'' ) != nullptr )
+	{
+		return false;
+	}
+
+	char command[ MAX_CALLSTACK_MODULE_PATH_LENGTH + 64 ];
+	snprintf( command, sizeof( command ), "addr2line -C -f -e '%s' 0x%llx 2>/dev/null", module.m_path, ( unsigned long long ) offset );
+	FILE* addr2line = popen( command, "r" );
+	if ( addr2line == nullptr )
+	{
+		return false;
+	}
+
+	char functionName[ MAX_SYMBOL_TEXT_LENGTH ];
+	char location[ MAX_SYMBOL_TEXT_LENGTH ];
+	bool hasOutput = fgets( functionName, MAX_SYMBOL_TEXT_LENGTH, addr2line ) != nullptr && fgets( location, MAX_SYMBOL_TEXT_LENGTH, addr2line ) != nullptr;
+	pclose( addr2line );
+	if ( !hasOutput )
+	{
+		return false;
+	}
+
+	functionName[ strcspn( functionName, "\r\n" ) ] = '\0';
+	location[ strcspn( location, "\r\n" ) ] = '\0';
+	char* discriminator = strstr( location, " (discriminator" );
+	if ( discriminator != nullptr )
+	{
+		*discriminator = '\0';
+	}
+
+	char* lineSeparator = strrchr( location, ':' );
+	unsigned int lineNumber = 0;
+	if ( lineSeparator != nullptr )
+	{
+		lineNumber = ( unsigned int ) strtoul( lineSeparator + 1, nullptr, 10 );
+		*lineSeparator = '\0';
+	}
+
+	bool hasFunction = strcmp( functionName, "??" ) != 0;
+	bool hasFile = location[ 0 ] != '\0' && strcmp( location, "??" ) != 0;
+	if ( !hasFunction && !hasFile )
+	{
+		return false;
+	}
+
+	out_line.functionName = hasFunction ? InternSymbolString( functionName ) : nullptr;
+	out_line.filename = hasFile ? InternSymbolString( location ) : UNKNOWN_FILENAME;
+	out_line.line = hasFile ? lineNumber : 0;
+	out_line.offset = 0;
+	return true;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static void ResolveSymbol( void* address, CallstackLine& out_line )
+{
+	CallstackModule const* module = FindModule( address );
+
+#if defined( _WIN32 )
+	if ( !LoadDebugHelp() )
+	{
+		SetUnknownLine( address, module, out_line );
+		return;
+	}
+
+	if ( !s_isProcessSymbolSessionOpen )
+	{
+		LSymInitialize( GetCurrentProcess(), NULL, TRUE );
+		s_isProcessSymbolSessionOpen = true;
+	}
+
+	ResolveDebugHelpSymbol( GetCurrentProcess(), ( DWORD64 ) address, address, module, out_line );
+#elif defined( __linux__ )
+	out_line.functionName = nullptr;
+	if ( module == nullptr || !ResolveWithAddr2Line( *module, ( uintptr_t ) address - module->m_baseAddress, out_line ) )
+	{
+		SetUnknownLine( address, module, out_line );
+	}
+
+	// Stripped or inlined frames can still have an exported name
+	Dl_info info;
+	if ( out_line.functionName == nullptr && dladdr( address, &info ) != 0 && info.dli_sname != nullptr )
+	{
+		int demangleStatus = 0;
+		char* demangledName = abi::__cxa_demangle( info.dli_sname, nullptr, nullptr, &demangleStatus );
+		out_line.functionName = InternSymbolString( ( demangleStatus == 0 ) ? demangledName : info.dli_sname );
+		out_line.offset = ( unsigned int ) ( ( uintptr_t ) address - ( uintptr_t ) info.dli_saddr );
+		free( demangledName );
+	}
+
+	if ( out_line.functionName == nullptr )
+	{
+		char text[ MAX_SYMBOL_TEXT_LENGTH ];
+		FormatRawFrame( address, module, text, MAX_SYMBOL_TEXT_LENGTH );
+		out_line.functionName = InternSymbolString( text );
+	}
+#else
+	SetUnknownLine( address, module, out_line );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static uint64_t HashFrameAddress( void* address )
+{
+	uint64_t key = ( uint64_t ) ( uintptr_t ) address;
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return key;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static CachedFrameSymbol* FindCachedSymbolSlot( CachedFrameSymbol* slots, unsigned int capacity, void* address )
+{
+	unsigned int mask = capacity - 1;
+	unsigned int slotIndex = ( unsigned int ) HashFrameAddress( address ) & mask;
+	while ( slots[ slotIndex ].m_address != nullptr && slots[ slotIndex ].m_address != address )
+	{
+		slotIndex = ( slotIndex + 1 ) & mask;
+	}
+	return &slots[ slotIndex ];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Kept at most half full
+static bool GrowSymbolCache()
+{
+	unsigned int newCapacity = ( s_symbolCapacity == 0 ) ? INITIAL_SYMBOL_CACHE_CAPACITY : s_symbolCapacity * 2;
+	CachedFrameSymbol* newSlots = ( CachedFrameSymbol* ) calloc( newCapacity, sizeof( CachedFrameSymbol ) );
+	if ( newSlots == nullptr )
+	{
+		return false;
+	}
+
+	for ( unsigned int slotIndex = 0; slotIndex < s_symbolCapacity; ++slotIndex )
+	{
+		if ( s_symbolSlots[ slotIndex ].m_address != nullptr )
+		{
+			*FindCachedSymbolSlot( newSlots, newCapacity, s_symbolSlots[ slotIndex ].m_address ) = s_symbolSlots[ slotIndex ];
+		}
+	}
+
+	free( s_symbolSlots );
+	s_symbolSlots = newSlots;
+	s_symbolCapacity = newCapacity;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// With s_symbolLock held
+static void SymbolizeLocked( void* address, CallstackLine& out_line )
+{
+	++s_numLookups;
+	if ( s_symbolCapacity > 0 )
+	{
+		CachedFrameSymbol* slot = FindCachedSymbolSlot( s_symbolSlots, s_symbolCapacity, address );
+		if ( slot->m_address == address )
+		{
+			out_line = slot->m_line;
+			return;
+		}
+	}
+
+	++s_numMisses;
+	ResolveSymbol( address, out_line );
+	if ( address == nullptr || ( ( s_numCachedSymbols + 1 ) * 2 > s_symbolCapacity && !GrowSymbolCache() ) )
+	{
+		return;
+	}
+
+	CachedFrameSymbol* slot = FindCachedSymbolSlot( s_symbolSlots, s_symbolCapacity, address );
+	slot->m_address = address;
+	slot->m_line = out_line;
+	++s_numCachedSymbols;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackStartup()
+{
+#ifdef CALLSTACK_RAW_ADDRESSES
+	s_symbolMode.store( CALLSTACK_SYMBOLS_RAW_ADDRESSES, std::memory_order_relaxed );
+#endif
+	s_isStarted.store( true, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackShutdown()
+{
+	s_isStarted.store( false, std::memory_order_release );
+
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+#if defined( _WIN32 )
+	if ( s_isProcessSymbolSessionOpen )
+	{
+		LSymCleanup( GetCurrentProcess() );
+		s_isProcessSymbolSessionOpen = false;
+	}
+
+	if ( s_isOfflineSymbolSessionOpen )
+	{
+		LSymCleanup( ( HANDLE ) &s_offlineSymbolSession );
+		s_isOfflineSymbolSessionOpen = false;
+		s_numOfflineModules = 0;
+	}
+
+	if ( s_debugHelp != NULL )
+	{
+		FreeLibrary( s_debugHelp );
+		s_debugHelp = NULL;
+		free( s_symbol );
+		s_symbol = nullptr;
+	}
+#endif
+
+	free( s_symbolSlots );
+	s_symbolSlots = nullptr;
+	s_symbolCapacity = 0;
+	s_numCachedSymbols = 0;
+
+	while ( s_stringBlocks != nullptr )
+	{
+		SymbolStringBlock* nextBlock = s_stringBlocks->m_next;
+		free( s_stringBlocks );
+		s_stringBlocks = nextBlock;
+	}
+	s_numStringBytes = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool CallstackCanSymbolize()
+{
+	return s_isStarted.load( std::memory_order_acquire );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int CallstackCaptureFrames( void** out_frames, unsigned int maxFrames, unsigned int numSkipFrames )
+{
+	maxFrames = ( maxFrames > MAX_DEPTH ) ? MAX_DEPTH : maxFrames;
+
+#if defined( _WIN32 )
+	return CaptureStackBackTrace( 1 + numSkipFrames, maxFrames, out_frames, NULL );
+#elif defined( __linux__ )
+	void* frames[ MAX_DEPTH + 16 ];
+	int numFramesToSkip = ( int ) ( 1 + numSkipFrames );
+	int numFramesWanted = ( int ) maxFrames + numFramesToSkip;
+	numFramesWanted = ( numFramesWanted > ( int ) ( MAX_DEPTH + 16 ) ) ? ( int ) ( MAX_DEPTH + 16 ) : numFramesWanted;
+	int numFrames = backtrace( frames, numFramesWanted ) - numFramesToSkip;
+	if ( numFrames <= 0 )
+	{
+		return 0;
+	}
+
+	numFrames = ( numFrames > ( int ) maxFrames ) ? maxFrames : numFrames;
+	memcpy( out_frames, frames + numFramesToSkip, numFrames * sizeof( void* ) );
+	return numFrames;
+#else
+	( void ) out_frames;
+	( void ) numSkipFrames;
+	return 0;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// One allocation for the struct and its frames
+Callstack* CallstackFetch( unsigned int numSkipFrames )
+{
+	void* stack[ MAX_DEPTH ];
+	unsigned int numFrames = CallstackCaptureFrames( stack, MAX_DEPTH, 1 + numSkipFrames );
+
+	Callstack* cs = ( Callstack* ) malloc( sizeof( Callstack ) + numFrames * sizeof( void* ) );
+	cs->framecount = numFrames;
+	cs->frames = ( void** ) ( cs + 1 );
+	memcpy( cs->frames, stack, numFrames * sizeof( void* ) );
+
+	return cs;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FreeCallstack( Callstack* cs )
+{
+	free( cs );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CallstackLine* CallstackGetLines( Callstack* cs )
+{
+	size_t numFrames = ( cs->framecount > MAX_DEPTH ) ? MAX_DEPTH : cs->framecount;
+
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	for ( size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex )
+	{
+		SymbolizeLocked( cs->frames[ frameIndex ], t_lineBuffer[ frameIndex ] );
+	}
+
+	return t_lineBuffer;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackSymbolizeAddress( void* address, CallstackLine& out_line )
+{
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	SymbolizeLocked( address, out_line );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackFormatFrame( void* address, char* out_text, size_t maxTextLength )
+{
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	if ( s_symbolMode.load( std::memory_order_relaxed ) == CALLSTACK_SYMBOLS_RAW_ADDRESSES )
+	{
+		FormatRawFrame( address, FindModule( address ), out_text, maxTextLength );
+		return;
+	}
+
+	CallstackLine line;
+	SymbolizeLocked( address, line );
+	snprintf( out_text, maxTextLength, "%s(%u): %s", line.filename, line.line, line.functionName );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackSetSymbolMode( CallstackSymbolMode mode )
+{
+	s_symbolMode.store( mode, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CallstackSymbolMode CallstackGetSymbolMode()
+{
+	return ( CallstackSymbolMode ) s_symbolMode.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int CallstackGetModules( CallstackModule* out_modules, unsigned int maxModules )
+{
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	RefreshModules();
+
+	unsigned int numModules = ( s_numModules < maxModules ) ? s_numModules : maxModules;
+	memcpy( out_modules, s_modules, numModules * sizeof( CallstackModule ) );
+	return numModules;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CallstackFormatModule( CallstackModule const &module, char* out_text, size_t maxTextLength )
+{
+	snprintf( out_text, maxTextLength, "module 0x%llx 0x%llx %s", ( unsigned long long ) module.m_baseAddress,
+		( unsigned long long ) ( module.m_endAddress - module.m_baseAddress ), module.m_path );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool CallstackWriteModuleMap( char const* filename )
+{
+	FILE* file = fopen( filename, "w" );
+	if ( file == nullptr )
+	{
+		return false;
+	}
+
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	RefreshModules();
+	for ( unsigned int moduleIndex = 0; moduleIndex < s_numModules; ++moduleIndex )
+	{
+		char text[ MAX_CALLSTACK_MODULE_PATH_LENGTH + 64 ];
+		CallstackFormatModule( s_modules[ moduleIndex ], text, sizeof( text ) );
+		fprintf( file, "%s\n", text );
+	}
+
+	fclose( file );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CallstackSymbolCacheStats CallstackGetSymbolCacheStats()
+{
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	CallstackSymbolCacheStats stats;
+	stats.m_numLookups = s_numLookups;
+	stats.m_numMisses = s_numMisses;
+	stats.m_numCachedAddresses = s_numCachedSymbols;
+	stats.m_numStringBytes = s_numStringBytes;
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool CallstackParseModule( char const* text, CallstackModule& out_module )
+{
+	unsigned long long baseAddress = 0;
+	unsigned long long numBytes = 0;
+	int pathStart = 0;
+	if ( sscanf( text, "module 0x%llx 0x%llx %n", &baseAddress, &numBytes, &pathStart ) != 2 || pathStart == 0 )
+	{
+		return false;
+	}
+
+	out_module.m_baseAddress = ( uintptr_t ) baseAddress;
+	out_module.m_startAddress = ( uintptr_t ) baseAddress;
+	out_module.m_endAddress = ( uintptr_t ) ( baseAddress + numBytes );
+	snprintf( out_module.m_path, MAX_CALLSTACK_MODULE_PATH_LENGTH, "%s", text + pathStart );
+	out_module.m_path[ strcspn( out_module.m_path, "\r\n" ) ] = '\0';
+	return out_module.m_path[ 0 ] != '\0';
+}
+
+
+//-----------------------------------------------------------------------------------------------
+char const* CallstackFindRawFrame( char const* text, char* out_moduleName, size_t maxModuleNameLength, uint64_t& out_offset,
+	size_t& out_textLength )
+{
+	for ( char const* frameStart = strstr( text, "0x" ); frameStart != nullptr; frameStart = strstr( frameStart + 2, "0x" ) )
+	{
+		char* addressEnd = nullptr;
+		strtoull( frameStart + 2, &addressEnd, 16 );
+		if ( addressEnd == frameStart + 2 || *addressEnd != ' ' )
+		{
+			continue;
+		}
+
+		char const* moduleName = addressEnd + 1;
+		size_t moduleNameLength = strcspn( moduleName, "+ \t\r\n" );
+		if ( moduleNameLength == 0 || moduleNameLength >= maxModuleNameLength || strncmp( moduleName + moduleNameLength, "+0x", 3 ) != 0 )
+		{
+			continue;
+		}
+
+		char* offsetEnd = nullptr;
+		char const* offsetStart = moduleName + moduleNameLength + 3;
+		out_offset = strtoull( offsetStart, &offsetEnd, 16 );
+		if ( offsetEnd == offsetStart )
+		{
+			continue;
+		}
+
+		memcpy( out_moduleName, moduleName, moduleNameLength );
+		out_moduleName[ moduleNameLength ] = '\0';
+		out_textLength = offsetEnd - frameStart;
+		return frameStart;
+	}
+
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Cached by where the frame was in the run that recorded it
+bool CallstackSymbolizeOffline( CallstackModule const &module, uint64_t offset, CallstackLine& out_line )
+{
+	void* recordedAddress = ( void* ) ( module.m_baseAddress + ( uintptr_t ) offset );
+	std::lock_guard< std::mutex > lock( s_symbolLock );
+	++s_numLookups;
+	if ( s_symbolCapacity > 0 )
+	{
+		CachedFrameSymbol* slot = FindCachedSymbolSlot( s_symbolSlots, s_symbolCapacity, recordedAddress );
+		if ( slot->m_address == recordedAddress )
+		{
+			out_line = slot->m_line;
+			return true;
+		}
+	}
+	++s_numMisses;
+
+#if defined( _WIN32 )
+	if ( !LoadDebugHelp() )
+	{
+		return false;
+	}
+
+	HANDLE session = ( HANDLE ) &s_offlineSymbolSession;
+	if ( !s_isOfflineSymbolSessionOpen )
+	{
+		LSymInitialize( session, NULL, FALSE );
+		s_isOfflineSymbolSessionOpen = true;
+	}
+
+	// Loaded where it was in the recorded run, so recorded addresses can be used as they are
+	bool isModuleLoaded = false;
+	for ( unsigned int moduleIndex = 0; moduleIndex < s_numOfflineModules && !isModuleLoaded; ++moduleIndex )
+	{
+		isModuleLoaded = s_offlineModuleBases[ moduleIndex ] == module.m_baseAddress;
+	}
+
+	if ( !isModuleLoaded )
+	{
+		if ( s_numOfflineModules >= MAX_CALLSTACK_MODULES || LSymLoadModuleEx( session, NULL, module.m_path, NULL, module.m_baseAddress,
+			( DWORD ) ( module.m_endAddress - module.m_baseAddress ), NULL, 0 ) == 0 )
+		{
+			return false;
+		}
+		s_offlineModuleBases[ s_numOfflineModules++ ] = module.m_baseAddress;
+	}
+
+	ResolveDebugHelpSymbol( session, ( DWORD64 ) recordedAddress, recordedAddress, &module, out_line );
+#elif defined( __linux__ )
+	if ( !ResolveWithAddr2Line( module, offset, out_line ) )
+	{
+		return false;
+	}
+
+	if ( out_line.functionName == nullptr )
+	{
+		char text[ MAX_SYMBOL_TEXT_LENGTH ];
+		FormatRawFrame( recordedAddress, &module, text, MAX_SYMBOL_TEXT_LENGTH );
+		out_line.functionName = InternSymbolString( text );
+	}
+#else
+	( void ) out_line;
+	return false;
+#endif
+
+	if ( ( s_numCachedSymbols + 1 ) * 2 <= s_symbolCapacity || GrowSymbolCache() )
+	{
+		CachedFrameSymbol* slot = FindCachedSymbolSlot( s_symbolSlots, s_symbolCapacity, recordedAddress );
+		slot->m_address = recordedAddress;
+		slot->m_line = out_line;
+		++s_numCachedSymbols;
+	}
+	return true;
+}
\ No newline at end of file
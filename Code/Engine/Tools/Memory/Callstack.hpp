@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_DEPTH 128
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int MAX_CALLSTACK_MODULES = 256;
+const unsigned int MAX_CALLSTACK_MODULE_PATH_LENGTH = 260;
+
+
+//-----------------------------------------------------------------------------------------------
+struct Callstack
+{
+	void **frames; // array of void *
+	size_t framecount;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// The strings live in the symbol cache and stay valid until CallstackShutdown
+struct CallstackLine
+{
+	char const* filename;
+	char const* functionName;
+	unsigned int line;
+	unsigned int offset;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+enum CallstackSymbolMode
+{
+	CALLSTACK_SYMBOLS_ONLINE = 0, // Symbolized in process when printed, each address looked up once
+	CALLSTACK_SYMBOLS_RAW_ADDRESSES, // Printed as module+offset, run Tools/Symbolize on the output later
+	NUM_CALLSTACK_SYMBOL_MODES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// A loaded image. Raw frames are printed as offsets from m_baseAddress, which is where the
+// debugger or addr2line expects the image to be loaded.
+struct CallstackModule
+{
+	uintptr_t m_baseAddress;
+	uintptr_t m_startAddress;
+	uintptr_t m_endAddress;
+	char m_path[ MAX_CALLSTACK_MODULE_PATH_LENGTH ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct CallstackSymbolCacheStats
+{
+	uint64_t m_numLookups;
+	uint64_t m_numMisses; // Lookups that went to dbghelp or addr2line
+	unsigned int m_numCachedAddresses;
+	size_t m_numStringBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Capture is CaptureStackBackTrace on Windows and backtrace on Linux. Symbols come from dbghelp or
+// addr2line and dladdr, loaded the first time something is symbolized, then cached by address for
+// every thread. Raw output is one frame per line as "0x<address> <module>+0x<offset>", and the
+// module map as "module 0x<base> 0x<size> <path>" lines.
+void CallstackStartup();
+void CallstackShutdown();
+bool CallstackCanSymbolize(); // Between startup and shutdown
+unsigned int CallstackCaptureFrames( void** out_frames, unsigned int maxFrames, unsigned int numSkipFrames ); // Innermost first
+Callstack* CallstackFetch( unsigned int numSkipFrames );
+void FreeCallstack( Callstack* cs );
+CallstackLine* CallstackGetLines( Callstack* cs ); // A buffer per thread, good until the thread's next call
+void CallstackSymbolizeAddress( void* address, CallstackLine& out_line );
+void CallstackFormatFrame( void* address, char* out_text, size_t maxTextLength ); // Symbolized or raw, by the symbol mode
+void CallstackSetSymbolMode( CallstackSymbolMode mode );
+CallstackSymbolMode CallstackGetSymbolMode();
+unsigned int CallstackGetModules( CallstackModule* out_modules, unsigned int maxModules ); // Sorted by start address
+void CallstackFormatModule( CallstackModule const &module, char* out_text, size_t maxTextLength );
+bool CallstackWriteModuleMap( char const* filename );
+CallstackSymbolCacheStats CallstackGetSymbolCacheStats();
+
+
+//-----------------------------------------------------------------------------------------------
+// For Tools/Symbolize, which reads raw output from another run
+bool CallstackParseModule( char const* text, CallstackModule& out_module );
+char const* CallstackFindRawFrame( char const* text, char* out_moduleName, size_t maxModuleNameLength, uint64_t& out_offset,
+	size_t& out_textLength ); // Where the first raw frame starts, or nullptr
+bool CallstackSymbolizeOffline( CallstackModule const &module, uint64_t offset, CallstackLine& out_line );
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "Engine/Tools/Memory/FrameAllocationChecker.hpp"
+#include "Engine/Tools/Memory/Callstack.hpp"
+#include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int MAX_ALLOCATION_OFFENDERS = 4096; // Always a power of two
+const unsigned int MAX_LOGGED_OFFENDER_FRAMES = 16;
+char const* const WHOLE_FRAME_REGION_NAME = "frame";
+char const* const NO_SCOPE_NAME = "no profile scope";
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationOffenderSlot
+{
+	uint64_t m_hash; // 0 for an empty slot
+	AllocationOffender m_offender;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Zero initialized before any constructor runs, operator new can get here first
+static std::atomic< bool > s_isChecking( false );
+static std::atomic< bool > s_isWholeFrameAllocationFree( false );
+static std::atomic< int > s_failureMode( ALLOCATION_CHECK_LOG );
+static std::atomic< uint64_t > s_frameNumber( 0 );
+static std::atomic< uint64_t > s_numFrameAllocations( 0 );
+static std::atomic< uint64_t > s_numFrameBytes( 0 );
+static std::atomic< uint64_t > s_numFrameViolations( 0 );
+static std::atomic< uint64_t > s_numTotalViolations( 0 );
+static std::atomic< bool > s_isOffenderTableLocked( false );
+static AllocationOffenderSlot* s_offenderSlots = nullptr; // Open addressing on the callstack hash, malloc'd on first use
+static unsigned int s_numOffenders = 0;
+static unsigned int s_numDroppedOffenders = 0;
+static FrameAllocationStats s_lastFrameStats; // Only touched by the frame thread
+
+
+//-----------------------------------------------------------------------------------------------
+static thread_local char const* t_regionName = nullptr;
+static thread_local bool t_isChecking = false; // Set while the checker is running, so its own allocations aren't counted
+
+
+//-----------------------------------------------------------------------------------------------
+static void LockOffenderTable()
+{
+	while ( s_isOffenderTableLocked.exchange( true, std::memory_order_acquire ) )
+	{
+		std::this_thread::yield();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void UnlockOffenderTable()
+{
+	s_isOffenderTableLocked.store( false, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Region and scope names are string literals, so their addresses are enough to tell them apart
+static uint64_t HashOffender( char const* regionName, char const* scopeName, void** frames, unsigned int numFrames )
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = ( hash ^ ( uint64_t ) ( uintptr_t ) regionName ) * 1099511628211ULL;
+	hash = ( hash ^ ( uint64_t ) ( uintptr_t ) scopeName ) * 1099511628211ULL;
+	for ( unsigned int frameIndex = 0; frameIndex < numFrames; ++frameIndex )
+	{
+		hash = ( hash ^ ( uint64_t ) ( uintptr_t ) frames[ frameIndex ] ) * 1099511628211ULL;
+	}
+	return ( hash == 0 ) ? 1 : hash;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void RecordOffender( char const* regionName, char const* scopeName, size_t numBytes, void** frames, unsigned int numFrames,
+	uint64_t frameNumber )
+{
+	uint64_t hash = HashOffender( regionName, scopeName, frames, numFrames );
+
+	LockOffenderTable();
+	if ( s_offenderSlots == nullptr )
+	{
+		s_offenderSlots = ( AllocationOffenderSlot* ) calloc( MAX_ALLOCATION_OFFENDERS, sizeof( AllocationOffenderSlot ) );
+		if ( s_offenderSlots == nullptr )
+		{
+			UnlockOffenderTable();
+			return;
+		}
+	}
+
+	unsigned int mask = MAX_ALLOCATION_OFFENDERS - 1;
+	unsigned int slotIndex = ( unsigned int ) hash & mask;
+	for ( unsigned int probeCount = 0; probeCount < MAX_ALLOCATION_OFFENDERS; ++probeCount )
+	{
+		AllocationOffenderSlot& slot = s_offenderSlots[ slotIndex ];
+		AllocationOffender& offender = slot.m_offender;
+		if ( slot.m_hash == 0 )
+		{
+			// Kept under three quarters full so probes stay short
+			if ( ( s_numOffenders + 1 ) * 4 > MAX_ALLOCATION_OFFENDERS * 3 )
+			{
+				break;
+			}
+
+			slot.m_hash = hash;
+			offender.m_regionName = regionName;
+			offender.m_scopeName = scopeName;
+			offender.m_numAllocations = 0;
+			offender.m_numBytes = 0;
+			offender.m_firstFrame = frameNumber;
+			offender.m_numFrames = numFrames;
+			memcpy( offender.m_frames, frames, numFrames * sizeof( void* ) );
+			++s_numOffenders;
+		}
+
+		if ( slot.m_hash == hash && offender.m_regionName == regionName && offender.m_scopeName == scopeName
+			&& offender.m_numFrames == numFrames && memcmp( offender.m_frames, frames, numFrames * sizeof( void* ) ) == 0 )
+		{
+			++offender.m_numAllocations;
+			offender.m_numBytes += numBytes;
+			offender.m_lastFrame = frameNumber;
+			UnlockOffenderTable();
+			return;
+		}
+
+		slotIndex = ( slotIndex + 1 ) & mask;
+	}
+
+	++s_numDroppedOffenders;
+	UnlockOffenderTable();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+AllocationFreeScope::AllocationFreeScope( char const* regionName )
+	: m_previousRegionName( t_regionName )
+{
+	t_regionName = regionName;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+AllocationFreeScope::~AllocationFreeScope()
+{
+	t_regionName = m_previousRegionName;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CheckFrameAllocation( size_t numBytes )
+{
+	if ( !s_isChecking.load( std::memory_order_relaxed ) || t_isChecking )
+	{
+		return;
+	}
+
+	t_isChecking = true;
+
+	char const* regionName = t_regionName;
+	if ( regionName == nullptr && s_isWholeFrameAllocationFree.load( std::memory_order_relaxed ) )
+	{
+		regionName = WHOLE_FRAME_REGION_NAME;
+	}
+
+	ProfileSample* currentSample = ProfilerGetCurrentSample();
+	char const* scopeName = ( currentSample != nullptr ) ? currentSample->tag : NO_SCOPE_NAME;
+
+	s_numFrameAllocations.fetch_add( 1, std::memory_order_relaxed );
+	s_numFrameBytes.fetch_add( numBytes, std::memory_order_relaxed );
+	if ( regionName != nullptr )
+	{
+		s_numFrameViolations.fetch_add( 1, std::memory_order_relaxed );
+		s_numTotalViolations.fetch_add( 1, std::memory_order_relaxed );
+
+		// Skips this and operator new, so the innermost frame is whoever allocated
+		void* frames[ MAX_TRACKED_CALLSTACK_DEPTH ];
+		unsigned int numFrames = CaptureAllocationFrames( frames, 2 );
+		RecordOffender( regionName, scopeName, numBytes, frames, numFrames, s_frameNumber.load( std::memory_order_relaxed ) );
+	}
+
+	t_isChecking = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CollectNewOffender( AllocationOffender const &offender, void* userData )
+{
+	if ( offender.m_firstFrame == s_lastFrameStats.m_frameNumber )
+	{
+		( ( std::vector< AllocationOffender >* ) userData )->push_back( offender );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// To the output window and log, once the engine has started callstacks
+static void PrintOffenderCallstack( AllocationOffender const &offender )
+{
+	if ( !CallstackCanSymbolize() )
+	{
+		return;
+	}
+
+	Callstack cs;
+	cs.frames = ( void** ) offender.m_frames;
+	cs.framecount = ( offender.m_numFrames < MAX_LOGGED_OFFENDER_FRAMES ) ? offender.m_numFrames : MAX_LOGGED_OFFENDER_FRAMES;
+	CallstackLine* lines = CallstackGetLines( &cs );
+	for ( size_t frameIndex = 0; frameIndex < cs.framecount; ++frameIndex )
+	{
+		DebuggerPrintf( "    %s(%u): %s\n", lines[ frameIndex ].filename, lines[ frameIndex ].line, lines[ frameIndex ].functionName );
+		LoggerPrintfWithTag( "memory", "    %s(%u): %s\n", lines[ frameIndex ].filename, lines[ frameIndex ].line, lines[ frameIndex ].functionName );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Only the first frame a callstack offends in is logged, so a steady leak doesn't flood the log.
+// Asserting doesn't wait for a new callstack, every frame with a violation fails.
+static void ReportViolations()
+{
+	std::vector< AllocationOffender > newOffenders;
+	ForEachAllocationOffender( CollectNewOffender, &newOffenders );
+
+	for ( unsigned int offenderIndex = 0; offenderIndex < newOffenders.size(); ++offenderIndex )
+	{
+		AllocationOffender const &offender = newOffenders[ offenderIndex ];
+		std::string summary = Stringf( "Frame %llu: %llu allocs, %llu bytes in allocation-free region %s under %s\n",
+			( unsigned long long ) offender.m_firstFrame, ( unsigned long long ) offender.m_numAllocations,
+			( unsigned long long ) offender.m_numBytes, offender.m_regionName, offender.m_scopeName );
+		DebuggerPrintf( "%s", summary.c_str() );
+		LoggerPrintfWithTag( "memory", "%s", summary.c_str() );
+
+		PrintOffenderCallstack( offender );
+	}
+
+	if ( s_failureMode.load( std::memory_order_relaxed ) == ALLOCATION_CHECK_ASSERT )
+	{
+		ERROR_RECOVERABLE( Stringf( "%llu allocations in allocation-free regions during frame %llu, %u from new callstacks, see the log",
+			( unsigned long long ) s_lastFrameStats.m_numViolations, ( unsigned long long ) s_lastFrameStats.m_frameNumber,
+			( unsigned int ) newOffenders.size() ) );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FrameAllocationCheckerFrameMark()
+{
+	bool wasChecking = t_isChecking;
+	t_isChecking = true;
+
+	uint64_t frameNumber = s_frameNumber.load( std::memory_order_relaxed );
+	s_lastFrameStats.m_frameNumber = frameNumber;
+	s_lastFrameStats.m_numAllocations = s_numFrameAllocations.exchange( 0, std::memory_order_relaxed );
+	s_lastFrameStats.m_numBytes = s_numFrameBytes.exchange( 0, std::memory_order_relaxed );
+	s_lastFrameStats.m_numViolations = s_numFrameViolations.exchange( 0, std::memory_order_relaxed );
+
+	if ( s_lastFrameStats.m_numViolations > 0 )
+	{
+		ReportViolations();
+	}
+
+	s_frameNumber.store( frameNumber + 1, std::memory_order_relaxed );
+	t_isChecking = wasChecking;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetFrameAllocationChecking( bool isEnabled )
+{
+	s_isChecking.store( isEnabled, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetWholeFrameAllocationFree( bool isAllocationFree )
+{
+	s_isWholeFrameAllocationFree.store( isAllocationFree, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetAllocationCheckFailureMode( AllocationCheckFailureMode failureMode )
+{
+	s_failureMode.store( failureMode, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ClearAllocationOffenders()
+{
+	LockOffenderTable();
+	if ( s_offenderSlots != nullptr )
+	{
+		memset( s_offenderSlots, 0, MAX_ALLOCATION_OFFENDERS * sizeof( AllocationOffenderSlot ) );
+	}
+	s_numOffenders = 0;
+	s_numDroppedOffenders = 0;
+	UnlockOffenderTable();
+
+	s_numTotalViolations.store( 0, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+FrameAllocationStats GetFrameAllocationStats()
+{
+	FrameAllocationStats stats = s_lastFrameStats;
+	stats.m_numTotalViolations = s_numTotalViolations.load( std::memory_order_relaxed );
+
+	LockOffenderTable();
+	stats.m_numOffenders = s_numOffenders;
+	stats.m_numDroppedOffenders = s_numDroppedOffenders;
+	UnlockOffenderTable();
+
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Allocations made by the callback aren't checked, it runs with the offender table locked
+void ForEachAllocationOffender( AllocationOffenderCallback callback, void* userData )
+{
+	bool wasChecking = t_isChecking;
+	t_isChecking = true;
+
+	LockOffenderTable();
+	for ( unsigned int slotIndex = 0; s_offenderSlots != nullptr && slotIndex < MAX_ALLOCATION_OFFENDERS; ++slotIndex )
+	{
+		if ( s_offenderSlots[ slotIndex ].m_hash != 0 )
+		{
+			callback( s_offenderSlots[ slotIndex ].m_offender, userData );
+		}
+	}
+	UnlockOffenderTable();
+
+	t_isChecking = wasChecking;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CollectOffender( AllocationOffender const &offender, void* userData )
+{
+	( ( std::vector< AllocationOffender >* ) userData )->push_back( offender );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool HasMoreAllocations( AllocationOffender const &first, AllocationOffender const &second )
+{
+	return first.m_numAllocations > second.m_numAllocations;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void PrintAllocationOffenders( unsigned int maxOffenders )
+{
+	std::vector< AllocationOffender > offenders;
+	ForEachAllocationOffender( CollectOffender, &offenders );
+	std::sort( offenders.begin(), offenders.end(), HasMoreAllocations );
+
+	FrameAllocationStats stats = GetFrameAllocationStats();
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Last frame: %llu allocs, %llu bytes, %llu in allocation-free regions. %llu violations, %u callstacks since cleared",
+		( unsigned long long ) stats.m_numAllocations, ( unsigned long long ) stats.m_numBytes, ( unsigned long long ) stats.m_numViolations,
+		( unsigned long long ) stats.m_numTotalViolations, stats.m_numOffenders ), ( stats.m_numTotalViolations > 0 ) ? Rgba::RED : Rgba::WHITE );
+	if ( stats.m_numDroppedOffenders > 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%u callstacks didn't fit in the offender table", stats.m_numDroppedOffenders ), Rgba::RED );
+	}
+
+	for ( unsigned int offenderIndex = 0; offenderIndex < offenders.size() && offenderIndex < maxOffenders; ++offenderIndex )
+	{
+		AllocationOffender const &offender = offenders[ offenderIndex ];
+		std::string summary = Stringf( "%llu allocs, %llu bytes under %s in %s, frames %llu-%llu", ( unsigned long long ) offender.m_numAllocations,
+			( unsigned long long ) offender.m_numBytes, offender.m_scopeName, offender.m_regionName,
+			( unsigned long long ) offender.m_firstFrame, ( unsigned long long ) offender.m_lastFrame );
+		g_theDeveloperConsole->ConsolePrint( summary, Rgba::RED );
+		DebuggerPrintf( "%s\n", summary.c_str() );
+		LoggerPrintfWithTag( "memory", "%s\n", summary.c_str() );
+
+		PrintOffenderCallstack( offender );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Engine/Tools/Memory/AllocationTracker.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+enum AllocationCheckFailureMode
+{
+	ALLOCATION_CHECK_LOG = 0, // Log new offenders at the end of the frame and keep going
+	ALLOCATION_CHECK_ASSERT, // Log, then raise a recoverable error
+	NUM_ALLOCATION_CHECK_FAILURE_MODES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Every allocation from one callstack under one profile scope inside one allocation-free region
+struct AllocationOffender
+{
+	char const* m_regionName; // Innermost allocation-free region, or "frame" for a whole frame
+	char const* m_scopeName; // Innermost profile sample on the allocating thread
+	uint64_t m_numAllocations;
+	uint64_t m_numBytes;
+	uint64_t m_firstFrame;
+	uint64_t m_lastFrame;
+	unsigned int m_numFrames;
+	void* m_frames[ MAX_TRACKED_CALLSTACK_DEPTH ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct FrameAllocationStats
+{
+	uint64_t m_frameNumber;
+	uint64_t m_numAllocations; // During the last frame, on every thread
+	uint64_t m_numBytes;
+	uint64_t m_numViolations; // Of those, made inside an allocation-free region
+	uint64_t m_numTotalViolations; // Since checking was last cleared
+	unsigned int m_numOffenders;
+	unsigned int m_numDroppedOffenders; // Callstacks that didn't fit in the offender table
+};
+
+
+//-----------------------------------------------------------------------------------------------
+typedef void ( *AllocationOffenderCallback )( AllocationOffender const &offender, void* userData );
+
+
+//-----------------------------------------------------------------------------------------------
+// Marks the calling thread's code as allocation-free while this is alive. Regions nest, the
+// innermost one's name is reported.
+class AllocationFreeScope
+{
+public:
+	AllocationFreeScope( char const* regionName );
+	~AllocationFreeScope();
+
+private:
+	char const* m_previousRegionName;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+#define ALLOCATION_FREE_SCOPE( regionName ) AllocationFreeScope _allocationFreeScope( regionName )
+
+
+//-----------------------------------------------------------------------------------------------
+// Checks the tracked operator new between ProfileFrameMark calls, for MEMORY_TRACKING builds.
+// While enabled every allocation is counted. The ones made inside an allocation-free region, or
+// anywhere once the whole frame is marked allocation-free, are offenders, grouped by profile scope
+// and callstack and reported when the frame ends. Capturing a callstack per offending allocation
+// is slow, so this is for steady-state checks rather than normal play.
+void CheckFrameAllocation( size_t numBytes ); // From operator new
+void FrameAllocationCheckerFrameMark(); // From ProfileFrameMark, on the thread that owns the profiler
+void SetFrameAllocationChecking( bool isEnabled );
+void SetWholeFrameAllocationFree( bool isAllocationFree );
+void SetAllocationCheckFailureMode( AllocationCheckFailureMode failureMode );
+void ClearAllocationOffenders();
+FrameAllocationStats GetFrameAllocationStats();
+void ForEachAllocationOffender( AllocationOffenderCallback callback, void* userData );
+void PrintAllocationOffenders( unsigned int maxOffenders ); // Most allocations first, callstacks to the output window and log
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <stdint.h>
+
+#include "Engine/Tools/Memory/FrameAllocationHarness.hpp"
+#include "Engine/Tools/Memory/FrameAllocationChecker.hpp"
+#include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Networking/Message.hpp"
+#include "Engine/Renderer/Particles/Emitter.hpp"
+#include "Engine/Config/BuildConfig.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int DEFAULT_HARNESS_FRAMES = 600;
+const unsigned int DEFAULT_HARNESS_WARMUP_FRAMES = 120;
+const unsigned int NUM_HARNESS_JOBS = 16;
+const unsigned int NUM_HARNESS_JOB_VALUES = 256;
+const unsigned int NUM_HARNESS_MESSAGE_VALUES = 32;
+const unsigned int NUM_REPORTED_HARNESS_OFFENDERS = 8;
+const float HARNESS_DELTA_SECONDS = 1.0f / 60.0f;
+
+
+//-----------------------------------------------------------------------------------------------
+static void HarnessSumJob( Job* job )
+{
+	uint32_t const* values = job->JobRead< uint32_t const* >();
+	uint32_t* out_sum = job->JobRead< uint32_t* >();
+	job->EndJobRead();
+
+	uint32_t sum = 0;
+	for ( unsigned int valueIndex = 0; valueIndex < NUM_HARNESS_JOB_VALUES; ++valueIndex )
+	{
+		sum += values[ valueIndex ];
+	}
+	*out_sum = sum;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void RunHarnessJobs( uint32_t const* values, uint32_t* out_sums )
+{
+	if ( g_theJobSystem == nullptr )
+	{
+		return;
+	}
+
+	Job* jobs[ NUM_HARNESS_JOBS ];
+	for ( unsigned int jobIndex = 0; jobIndex < NUM_HARNESS_JOBS; ++jobIndex )
+	{
+		jobs[ jobIndex ] = g_theJobSystem->JobCreate( JOB_CATEGORY_GENERIC, &HarnessSumJob );
+		jobs[ jobIndex ]->JobWrite< uint32_t const* >( values );
+		jobs[ jobIndex ]->JobWrite< uint32_t* >( &out_sums[ jobIndex ] );
+		jobs[ jobIndex ]->EndJobWrite();
+		g_theJobSystem->JobDispatch( jobs[ jobIndex ] );
+	}
+
+	for ( unsigned int jobIndex = 0; jobIndex < NUM_HARNESS_JOBS; ++jobIndex )
+	{
+		g_theJobSystem->JobJoin( jobs[ jobIndex ] );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Stands in for a socket loopback: written the way Session sends an update, copied the way a
+// received message is, then read back out
+static void RunHarnessNetworking( unsigned int frameIndex )
+{
+	Message outgoingMessage( GAMENETMSG_UPDATE );
+	for ( unsigned int valueIndex = 0; valueIndex < NUM_HARNESS_MESSAGE_VALUES; ++valueIndex )
+	{
+		outgoingMessage.Write< float >( ( float ) ( frameIndex + valueIndex ) );
+	}
+
+	Message incomingMessage( &outgoingMessage );
+	incomingMessage.ResetOffset();
+	for ( unsigned int valueIndex = 0; valueIndex < NUM_HARNESS_MESSAGE_VALUES; ++valueIndex )
+	{
+		float value = 0.0f;
+		incomingMessage.Read< float >( &value );
+		ASSERT_OR_DIE( value == ( float ) ( frameIndex + valueIndex ), "Harness message didn't survive the loopback" );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Each frame's samples are thrown away when it ends, so the harness doesn't pile hundreds of
+// frames of children onto whatever frame the profiler has open
+static void RunHarnessFrame( unsigned int frameIndex, Emitter& emitter, uint32_t const* jobValues, uint32_t* jobSums )
+{
+	PushProfileSample( "harness_frame" );
+
+	PushProfileSample( "harness_jobs" );
+	RunHarnessJobs( jobValues, jobSums );
+	PopProfileSample();
+
+	PushProfileSample( "harness_logger" );
+	LoggerPrintfWithTag( "harness", "Frame %u\n", frameIndex );
+	PopProfileSample();
+
+	PushProfileSample( "harness_networking" );
+	RunHarnessNetworking( frameIndex );
+	PopProfileSample();
+
+	PushProfileSample( "harness_particles" );
+	emitter.Update( HARNESS_DELTA_SECONDS );
+	PopProfileSample();
+
+	PopAndDeleteProfileSample();
+
+	FrameAllocationCheckerFrameMark();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+FrameAllocationHarnessResults RunFrameAllocationHarness( unsigned int numFrames, unsigned int numWarmupFrames )
+{
+	FrameAllocationHarnessResults results;
+	results.m_numFrames = numFrames;
+	results.m_numAllocations = 0;
+	results.m_numViolations = 0;
+
+	uint32_t jobValues[ NUM_HARNESS_JOB_VALUES ];
+	uint32_t jobSums[ NUM_HARNESS_JOBS ];
+	for ( unsigned int valueIndex = 0; valueIndex < NUM_HARNESS_JOB_VALUES; ++valueIndex )
+	{
+		jobValues[ valueIndex ] = valueIndex;
+	}
+
+	Emitter* emitter = new Emitter( Vector2( 800.0f, 450.0f ), Vector2( 0.0f, 1.0f ), 200.0f, 500, EMITTER_TYPE_FOUNTAIN );
+	emitter->m_isLooping = true;
+
+	SetFrameAllocationChecking( false );
+	for ( unsigned int frameIndex = 0; frameIndex < numWarmupFrames; ++frameIndex )
+	{
+		RunHarnessFrame( frameIndex, *emitter, jobValues, jobSums );
+	}
+
+	ClearAllocationOffenders();
+	SetWholeFrameAllocationFree( true );
+	SetFrameAllocationChecking( true );
+	for ( unsigned int frameIndex = 0; frameIndex < numFrames; ++frameIndex )
+	{
+		RunHarnessFrame( numWarmupFrames + frameIndex, *emitter, jobValues, jobSums );
+
+		FrameAllocationStats frameStats = GetFrameAllocationStats();
+		results.m_numAllocations += frameStats.m_numAllocations;
+		results.m_numViolations += frameStats.m_numViolations;
+	}
+	SetFrameAllocationChecking( false );
+	SetWholeFrameAllocationFree( false );
+
+	results.m_numOffenders = GetFrameAllocationStats().m_numOffenders;
+
+	delete emitter;
+	return results;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_frame_harness [frames] [warmupFrames]
+CONSOLE_COMMAND( memory_frame_harness )
+{
+	int numFrames = DEFAULT_HARNESS_FRAMES;
+	int numWarmupFrames = DEFAULT_HARNESS_WARMUP_FRAMES;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( numFrames, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( numWarmupFrames, args.m_argList[ 1 ] );
+	}
+
+	if ( numFrames <= 0 || numWarmupFrames < 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_frame_harness [frames] [warmupFrames]", Rgba::RED );
+		return;
+	}
+
+#ifndef MEMORY_TRACKING
+	g_theDeveloperConsole->ConsolePrint( "memory_frame_harness needs MEMORY_TRACKING defined in BuildConfig.hpp", Rgba::RED );
+#else
+	FrameAllocationHarnessResults results = RunFrameAllocationHarness( numFrames, numWarmupFrames );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "%u steady-state frames after %d warmup: %llu allocs, %llu in allocation-free frames, %u callstacks",
+		results.m_numFrames, numWarmupFrames, ( unsigned long long ) results.m_numAllocations, ( unsigned long long ) results.m_numViolations,
+		results.m_numOffenders ), ( results.m_numViolations > 0 ) ? Rgba::RED : Rgba::GREEN );
+	PrintAllocationOffenders( NUM_REPORTED_HARNESS_OFFENDERS );
+#endif
+}
\ No newline at end of file
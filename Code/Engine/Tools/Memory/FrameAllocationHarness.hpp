@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------------------------
+struct FrameAllocationHarnessResults
+{
+	unsigned int m_numFrames; // Checked frames, after the warmup
+	uint64_t m_numAllocations;
+	uint64_t m_numViolations;
+	unsigned int m_numOffenders; // Distinct callstacks that allocated in the checked frames
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Runs the CPU side of the engine for numWarmupFrames, then checks numFrames more with the whole
+// frame marked allocation-free. Needs MEMORY_TRACKING, and the renderer for the particle texture.
+FrameAllocationHarnessResults RunFrameAllocationHarness( unsigned int numFrames, unsigned int numWarmupFrames );
\ No newline at end of file
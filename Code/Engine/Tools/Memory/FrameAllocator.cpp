@@ -0,0 +1,360 @@
+#include <stdlib.h>
+
+#include "Engine/Tools/Memory/FrameAllocator.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t ARENA_BUFFER_ALIGNMENT = 64;
+
+
+//-----------------------------------------------------------------------------------------------
+static LinearArena s_frameArenas[ NUM_FRAME_ARENAS ];
+static std::atomic< int > s_currentFrameArena( 0 );
+
+
+//-----------------------------------------------------------------------------------------------
+// Every live scratch arena, for stats
+static std::mutex s_scratchArenasLock;
+static std::vector< LinearArena* > s_scratchArenas;
+
+
+//-----------------------------------------------------------------------------------------------
+// Created the first time a thread asks for scratch memory, freed when the thread exits
+struct ScratchArenaHolder
+{
+	ScratchArenaHolder()
+		: m_arena( nullptr )
+	{
+	}
+
+	~ScratchArenaHolder()
+	{
+		if ( m_arena == nullptr )
+		{
+			return;
+		}
+
+		s_scratchArenasLock.lock();
+		for ( unsigned int arenaIndex = 0; arenaIndex < s_scratchArenas.size(); ++arenaIndex )
+		{
+			if ( s_scratchArenas[ arenaIndex ] == m_arena )
+			{
+				s_scratchArenas.erase( s_scratchArenas.begin() + arenaIndex );
+				break;
+			}
+		}
+		s_scratchArenasLock.unlock();
+
+		delete m_arena;
+	}
+
+	LinearArena* m_arena;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static thread_local ScratchArenaHolder t_scratchArena;
+
+
+//-----------------------------------------------------------------------------------------------
+LinearArena::LinearArena()
+	: m_buffer( nullptr )
+	, m_allocation( nullptr )
+	, m_capacity( 0 )
+	, m_tag( MEMORY_TAG_UNTAGGED )
+	, m_offset( 0 )
+	, m_highWaterBytes( 0 )
+	, m_numOverflows( 0 )
+	, m_overflowList( nullptr )
+	, m_overflowBytes( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+LinearArena::~LinearArena()
+{
+	Shutdown();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LinearArena::Initialize( size_t capacity )
+{
+	ASSERT_OR_DIE( m_buffer == nullptr, "Linear arena is already initialized!" );
+
+	m_allocation = malloc( capacity + ARENA_BUFFER_ALIGNMENT );
+	ASSERT_OR_DIE( m_allocation != nullptr, "Out of memory for a linear arena" );
+
+	m_buffer = ( unsigned char* ) ( ( ( uintptr_t ) m_allocation + ARENA_BUFFER_ALIGNMENT - 1 ) & ~( uintptr_t ) ( ARENA_BUFFER_ALIGNMENT - 1 ) );
+	m_capacity = capacity;
+	m_tag = GetCurrentMemoryTag();
+	m_offset = 0;
+	RecordTaggedAllocation( m_tag, capacity );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LinearArena::Shutdown()
+{
+	FreeOverflows();
+
+	if ( m_allocation != nullptr )
+	{
+		RecordTaggedFree( m_tag, m_capacity );
+	}
+
+	free( m_allocation );
+	m_allocation = nullptr;
+	m_buffer = nullptr;
+	m_capacity = 0;
+	m_offset = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* LinearArena::Alloc( size_t numBytes, size_t alignment )
+{
+	ASSERT_OR_DIE( alignment <= ARENA_BUFFER_ALIGNMENT, "Linear arenas only align up to a cache line!" );
+
+	size_t offset = m_offset.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		size_t alignedOffset = ( offset + alignment - 1 ) & ~( alignment - 1 );
+		size_t newOffset = alignedOffset + numBytes;
+		if ( newOffset > m_capacity )
+		{
+			return AllocOverflow( numBytes, alignment );
+		}
+
+		if ( m_offset.compare_exchange_weak( offset, newOffset, std::memory_order_relaxed ) )
+		{
+			return m_buffer + alignedOffset;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t LinearArena::GetMarker() const
+{
+	return m_offset.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Overflow allocations are only freed when rewinding all the way to the start
+void LinearArena::ResetToMarker( size_t marker )
+{
+	size_t usedBytes = m_offset.load( std::memory_order_relaxed );
+	ASSERT_OR_DIE( marker <= usedBytes, "Linear arena marker is past the end of the arena!" );
+
+	m_overflowLock.lock();
+	UpdateHighWater( usedBytes + m_overflowBytes );
+	m_overflowLock.unlock();
+
+	m_offset.store( marker, std::memory_order_relaxed );
+	if ( marker == 0 )
+	{
+		FreeOverflows();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LinearArena::Reset()
+{
+	ResetToMarker( 0 );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+LinearArenaStats LinearArena::GetStats() const
+{
+	LinearArenaStats stats;
+	stats.m_capacity = m_capacity;
+	stats.m_usedBytes = m_offset.load( std::memory_order_relaxed );
+	stats.m_highWaterBytes = m_highWaterBytes.load( std::memory_order_relaxed );
+	stats.m_numOverflows = m_numOverflows.load( std::memory_order_relaxed );
+
+	if ( stats.m_usedBytes > stats.m_highWaterBytes )
+	{
+		stats.m_highWaterBytes = stats.m_usedBytes;
+	}
+
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Each overflow block starts with the link to the next one, the caller's memory follows aligned
+void* LinearArena::AllocOverflow( size_t numBytes, size_t alignment )
+{
+	void* allocation = malloc( sizeof( void* ) + alignment + numBytes );
+	ASSERT_OR_DIE( allocation != nullptr, "Out of memory for a linear arena overflow" );
+
+	m_overflowLock.lock();
+	*( void** ) allocation = m_overflowList;
+	m_overflowList = allocation;
+	m_overflowBytes += numBytes;
+	m_overflowLock.unlock();
+
+	m_numOverflows.fetch_add( 1, std::memory_order_relaxed );
+	RecordTaggedAllocation( m_tag, numBytes );
+
+	uintptr_t userAddress = ( uintptr_t ) allocation + sizeof( void* );
+	return ( void* ) ( ( userAddress + alignment - 1 ) & ~( uintptr_t ) ( alignment - 1 ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LinearArena::FreeOverflows()
+{
+	m_overflowLock.lock();
+	void* allocation = m_overflowList;
+	size_t overflowBytes = m_overflowBytes;
+	m_overflowList = nullptr;
+	m_overflowBytes = 0;
+	m_overflowLock.unlock();
+
+	uint64_t numFreed = 0;
+	while ( allocation != nullptr )
+	{
+		void* nextAllocation = *( void** ) allocation;
+		free( allocation );
+		allocation = nextAllocation;
+		++numFreed;
+	}
+
+	if ( numFreed > 0 )
+	{
+		RecordTaggedFree( m_tag, overflowBytes, numFreed );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LinearArena::UpdateHighWater( size_t usedBytes )
+{
+	size_t highWaterBytes = m_highWaterBytes.load( std::memory_order_relaxed );
+	while ( usedBytes > highWaterBytes
+		&& !m_highWaterBytes.compare_exchange_weak( highWaterBytes, usedBytes, std::memory_order_relaxed ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ScratchScope::ScratchScope()
+	: m_arena( &GetScratchArena() )
+	, m_marker( m_arena->GetMarker() )
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ScratchScope::~ScratchScope()
+{
+	m_arena->ResetToMarker( m_marker );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FrameMemoryStartup( size_t frameArenaSize )
+{
+	for ( int arenaIndex = 0; arenaIndex < NUM_FRAME_ARENAS; ++arenaIndex )
+	{
+		s_frameArenas[ arenaIndex ].Initialize( frameArenaSize );
+	}
+
+	s_currentFrameArena = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FrameMemoryShutdown()
+{
+	for ( int arenaIndex = 0; arenaIndex < NUM_FRAME_ARENAS; ++arenaIndex )
+	{
+		s_frameArenas[ arenaIndex ].Shutdown();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The arena being reset was last used two frames ago, so anything still reading from it has
+// held on to frame memory for too long
+void FrameMemoryBeginFrame()
+{
+	int nextArena = ( s_currentFrameArena.load( std::memory_order_relaxed ) + 1 ) % NUM_FRAME_ARENAS;
+	s_frameArenas[ nextArena ].Reset();
+	s_currentFrameArena.store( nextArena, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* FrameAlloc( size_t numBytes, size_t alignment )
+{
+	return GetFrameArena().Alloc( numBytes, alignment );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+LinearArena& GetFrameArena()
+{
+	return s_frameArenas[ s_currentFrameArena.load( std::memory_order_acquire ) ];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Each thread, job workers included, gets its own so scratch allocations never contend
+LinearArena& GetScratchArena()
+{
+	if ( t_scratchArena.m_arena == nullptr )
+	{
+		LinearArena* newArena = new LinearArena();
+		newArena->Initialize( DEFAULT_SCRATCH_ARENA_SIZE );
+
+		s_scratchArenasLock.lock();
+		s_scratchArenas.push_back( newArena );
+		s_scratchArenasLock.unlock();
+
+		t_scratchArena.m_arena = newArena;
+	}
+
+	return *t_scratchArena.m_arena;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+FrameMemoryStats GetFrameMemoryStats()
+{
+	FrameMemoryStats stats;
+	stats.m_frameArena = GetFrameArena().GetStats();
+	for ( int arenaIndex = 0; arenaIndex < NUM_FRAME_ARENAS; ++arenaIndex )
+	{
+		LinearArenaStats arenaStats = s_frameArenas[ arenaIndex ].GetStats();
+		if ( arenaStats.m_highWaterBytes > stats.m_frameArena.m_highWaterBytes )
+		{
+			stats.m_frameArena.m_highWaterBytes = arenaStats.m_highWaterBytes;
+		}
+	}
+
+	stats.m_numScratchArenas = 0;
+	stats.m_scratchHighWaterBytes = 0;
+	stats.m_numScratchOverflows = 0;
+
+	s_scratchArenasLock.lock();
+	stats.m_numScratchArenas = ( unsigned int ) s_scratchArenas.size();
+	for ( unsigned int arenaIndex = 0; arenaIndex < s_scratchArenas.size(); ++arenaIndex )
+	{
+		LinearArenaStats arenaStats = s_scratchArenas[ arenaIndex ]->GetStats();
+		if ( arenaStats.m_highWaterBytes > stats.m_scratchHighWaterBytes )
+		{
+			stats.m_scratchHighWaterBytes = arenaStats.m_highWaterBytes;
+		}
+		stats.m_numScratchOverflows += arenaStats.m_numOverflows;
+	}
+	s_scratchArenasLock.unlock();
+
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t DEFAULT_ARENA_ALIGNMENT = 16;
+const size_t DEFAULT_FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+const size_t DEFAULT_SCRATCH_ARENA_SIZE = 256 * 1024;
+const int NUM_FRAME_ARENAS = 3; // Frame memory stays valid until two more frames have begun
+
+
+//-----------------------------------------------------------------------------------------------
+struct LinearArenaStats
+{
+	size_t m_capacity;
+	size_t m_usedBytes;
+	size_t m_highWaterBytes; // Including overflow
+	uint64_t m_numOverflows; // Allocations that didn't fit and went to malloc
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Bump allocator over one fixed buffer. Allocating is lock-free and safe from any thread; nothing
+// is freed on its own, the whole arena (or everything past a marker) is released at once.
+// Allocations that don't fit go to malloc and are freed on the next full reset, so running out
+// costs speed rather than crashing. The buffer and overflows count against the memory tag that
+// was current when the arena was initialized.
+class LinearArena
+{
+public:
+	LinearArena();
+	~LinearArena();
+
+	void Initialize( size_t capacity );
+	void Shutdown();
+
+	void* Alloc( size_t numBytes, size_t alignment = DEFAULT_ARENA_ALIGNMENT );
+	size_t GetMarker() const;
+	void ResetToMarker( size_t marker ); // Only when no other thread is allocating
+	void Reset();
+
+	LinearArenaStats GetStats() const;
+
+private:
+	LinearArena( LinearArena const & );
+	LinearArena& operator=( LinearArena const & );
+
+	void* AllocOverflow( size_t numBytes, size_t alignment );
+	void FreeOverflows();
+	void UpdateHighWater( size_t usedBytes );
+
+private:
+	unsigned char* m_buffer;
+	void* m_allocation; // As returned by malloc, before alignment
+	size_t m_capacity;
+	MemoryTag m_tag;
+	std::atomic< size_t > m_offset;
+	std::atomic< size_t > m_highWaterBytes;
+	std::atomic< uint64_t > m_numOverflows;
+	std::mutex m_overflowLock;
+	void* m_overflowList;
+	size_t m_overflowBytes; // Guarded by m_overflowLock
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Rewinds the calling thread's scratch arena when it goes out of scope. Scopes nest like the
+// stack, so anything allocated inside must not outlive it.
+class ScratchScope
+{
+public:
+	ScratchScope();
+	~ScratchScope();
+
+	LinearArena& GetArena() { return *m_arena; }
+	void* Alloc( size_t numBytes, size_t alignment = DEFAULT_ARENA_ALIGNMENT ) { return m_arena->Alloc( numBytes, alignment ); }
+
+private:
+	LinearArena* m_arena;
+	size_t m_marker;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct FrameMemoryStats
+{
+	LinearArenaStats m_frameArena; // The current frame's arena, high water across all of them
+	unsigned int m_numScratchArenas;
+	size_t m_scratchHighWaterBytes; // Highest of any thread
+	uint64_t m_numScratchOverflows;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+void FrameMemoryStartup( size_t frameArenaSize = DEFAULT_FRAME_ARENA_SIZE );
+void FrameMemoryShutdown();
+void FrameMemoryBeginFrame();
+void* FrameAlloc( size_t numBytes, size_t alignment = DEFAULT_ARENA_ALIGNMENT );
+LinearArena& GetFrameArena();
+LinearArena& GetScratchArena();
+FrameMemoryStats GetFrameMemoryStats();
+
+
+//-----------------------------------------------------------------------------------------------
+// STL allocator over a LinearArena, the current frame's unless told otherwise. Deallocation does
+// nothing, so reserve up front rather than letting containers grow.
+template < typename T >
+class TArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template < typename U >
+	struct rebind
+	{
+		typedef TArenaAllocator< U > other;
+	};
+
+public:
+	TArenaAllocator() : m_arena( &GetFrameArena() ) {}
+	explicit TArenaAllocator( LinearArena* arena ) : m_arena( arena ) {}
+	template < typename U >
+	TArenaAllocator( TArenaAllocator< U > const &other ) : m_arena( other.m_arena ) {}
+
+	pointer allocate( size_type count )
+	{
+		size_t alignment = ( alignof( T ) > DEFAULT_ARENA_ALIGNMENT ) ? alignof( T ) : DEFAULT_ARENA_ALIGNMENT;
+		return ( pointer ) m_arena->Alloc( count * sizeof( T ), alignment );
+	}
+
+	void deallocate( pointer p, size_type count )
+	{
+		( void ) p;
+		( void ) count;
+	}
+
+	template < typename U >
+	bool operator==( TArenaAllocator< U > const &other ) const { return m_arena == other.m_arena; }
+	template < typename U >
+	bool operator!=( TArenaAllocator< U > const &other ) const { return m_arena != other.m_arena; }
+
+public:
+	LinearArena* m_arena;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Valid until two more frames have begun
+template < typename T >
+using FrameVector = std::vector< T, TArenaAllocator< T > >;
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <algorithm>
+
+#include "Engine/Tools/Memory/HeapSnapshot.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// File layout, little endian:
+//   header:  magic, version, capture seconds, total allocs and bytes, sampling mode and interval,
+//            string count, group count
+//   strings: uint16 length then the characters, tags and frames share one deduplicated table
+//   groups:  tag string, frame count, alloc count, byte count, then a string index per frame
+const uint32_t HEAP_SNAPSHOT_MAGIC = 0x50534848; // "HHSP"
+const uint32_t HEAP_SNAPSHOT_VERSION = 1;
+const size_t MAX_SNAPSHOT_STRING_LENGTH = 0xFFFF;
+
+
+//-----------------------------------------------------------------------------------------------
+static FILE* OpenSnapshotFile( std::string const &filename, char const* mode )
+{
+#if defined( _MSC_VER )
+	FILE* file = nullptr;
+	fopen_s( &file, filename.c_str(), mode );
+	return file;
+#else
+	return fopen( filename.c_str(), mode );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename T >
+static void AppendValue( std::vector< unsigned char >& buffer, T const &value )
+{
+	unsigned char const* bytes = ( unsigned char const* ) &value;
+	buffer.insert( buffer.end(), bytes, bytes + sizeof( T ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template < typename T >
+static bool ReadValue( std::vector< unsigned char > const &buffer, size_t& readOffset, T& out_value )
+{
+	if ( readOffset + sizeof( T ) > buffer.size() )
+	{
+		return false;
+	}
+
+	memcpy( &out_value, &buffer[ readOffset ], sizeof( T ) );
+	readOffset += sizeof( T );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static uint32_t GetStringIndex( std::string const &string, std::map< std::string, uint32_t >& stringIndices,
+	std::vector< std::string const* >& strings )
+{
+	std::map< std::string, uint32_t >::iterator found = stringIndices.find( string );
+	if ( found != stringIndices.end() )
+	{
+		return found->second;
+	}
+
+	uint32_t stringIndex = ( uint32_t ) strings.size();
+	found = stringIndices.insert( std::make_pair( string, stringIndex ) ).first;
+	strings.push_back( &found->first );
+	return stringIndex;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool SaveHeapSnapshot( HeapSnapshot const &snapshot, std::string const &filename )
+{
+	std::map< std::string, uint32_t > stringIndices;
+	std::vector< std::string const* > strings;
+	std::vector< unsigned char > groupBytes;
+
+	for ( unsigned int groupIndex = 0; groupIndex < snapshot.m_groups.size(); ++groupIndex )
+	{
+		HeapSnapshotGroup const &group = snapshot.m_groups[ groupIndex ];
+		AppendValue( groupBytes, GetStringIndex( group.m_tag, stringIndices, strings ) );
+		AppendValue( groupBytes, ( uint32_t ) group.m_frames.size() );
+		AppendValue( groupBytes, group.m_numAllocations );
+		AppendValue( groupBytes, group.m_numBytes );
+		for ( unsigned int frameIndex = 0; frameIndex < group.m_frames.size(); ++frameIndex )
+		{
+			AppendValue( groupBytes, GetStringIndex( group.m_frames[ frameIndex ], stringIndices, strings ) );
+		}
+	}
+
+	std::vector< unsigned char > fileBytes;
+	AppendValue( fileBytes, HEAP_SNAPSHOT_MAGIC );
+	AppendValue( fileBytes, HEAP_SNAPSHOT_VERSION );
+	AppendValue( fileBytes, snapshot.m_captureSeconds );
+	AppendValue( fileBytes, snapshot.m_totalAllocations );
+	AppendValue( fileBytes, snapshot.m_totalBytes );
+	AppendValue( fileBytes, snapshot.m_samplingMode );
+	AppendValue( fileBytes, snapshot.m_samplingInterval );
+	AppendValue( fileBytes, ( uint32_t ) strings.size() );
+	AppendValue( fileBytes, ( uint32_t ) snapshot.m_groups.size() );
+
+	for ( unsigned int stringIndex = 0; stringIndex < strings.size(); ++stringIndex )
+	{
+		std::string const &string = *strings[ stringIndex ];
+		uint16_t length = ( uint16_t ) std::min( string.size(), MAX_SNAPSHOT_STRING_LENGTH );
+		AppendValue( fileBytes, length );
+		fileBytes.insert( fileBytes.end(), string.begin(), string.begin() + length );
+	}
+	fileBytes.insert( fileBytes.end(), groupBytes.begin(), groupBytes.end() );
+
+	FILE* file = OpenSnapshotFile( filename, "wb" );
+	if ( file == nullptr )
+	{
+		return false;
+	}
+
+	bool wasWritten = fwrite( &fileBytes[ 0 ], 1, fileBytes.size(), file ) == fileBytes.size();
+	fclose( file );
+	return wasWritten;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Fails on anything truncated or out of range rather than trusting the file
+bool LoadHeapSnapshot( std::string const &filename, HeapSnapshot& out_snapshot )
+{
+	FILE* file = OpenSnapshotFile( filename, "rb" );
+	if ( file == nullptr )
+	{
+		return false;
+	}
+
+	std::vector< unsigned char > fileBytes;
+	unsigned char chunk[ 4096 ];
+	size_t numBytesRead;
+	while ( ( numBytesRead = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+	{
+		fileBytes.insert( fileBytes.end(), chunk, chunk + numBytesRead );
+	}
+	fclose( file );
+
+	size_t readOffset = 0;
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t numStrings = 0;
+	uint32_t numGroups = 0;
+	if ( !ReadValue( fileBytes, readOffset, magic ) || magic != HEAP_SNAPSHOT_MAGIC
+		|| !ReadValue( fileBytes, readOffset, version ) || version != HEAP_SNAPSHOT_VERSION
+		|| !ReadValue( fileBytes, readOffset, out_snapshot.m_captureSeconds )
+		|| !ReadValue( fileBytes, readOffset, out_snapshot.m_totalAllocations )
+		|| !ReadValue( fileBytes, readOffset, out_snapshot.m_totalBytes )
+		|| !ReadValue( fileBytes, readOffset, out_snapshot.m_samplingMode )
+		|| !ReadValue( fileBytes, readOffset, out_snapshot.m_samplingInterval )
+		|| !ReadValue( fileBytes, readOffset, numStrings )
+		|| !ReadValue( fileBytes, readOffset, numGroups ) )
+	{
+		return false;
+	}
+
+	std::vector< std::string > strings;
+	for ( uint32_t stringIndex = 0; stringIndex < numStrings; ++stringIndex )
+	{
+		uint16_t length = 0;
+		if ( !ReadValue( fileBytes, readOffset, length ) || readOffset + length > fileBytes.size() )
+		{
+			return false;
+		}
+
+		strings.push_back( std::string( ( char const* ) &fileBytes[ 0 ] + readOffset, length ) );
+		readOffset += length;
+	}
+
+	out_snapshot.m_groups.clear();
+	for ( uint32_t groupIndex = 0; groupIndex < numGroups; ++groupIndex )
+	{
+		HeapSnapshotGroup group;
+		uint32_t tagIndex = 0;
+		uint32_t numFrames = 0;
+		if ( !ReadValue( fileBytes, readOffset, tagIndex ) || tagIndex >= strings.size()
+			|| !ReadValue( fileBytes, readOffset, numFrames )
+			|| !ReadValue( fileBytes, readOffset, group.m_numAllocations )
+			|| !ReadValue( fileBytes, readOffset, group.m_numBytes ) )
+		{
+			return false;
+		}
+
+		group.m_tag = strings[ tagIndex ];
+		for ( uint32_t frameIndex = 0; frameIndex < numFrames; ++frameIndex )
+		{
+			uint32_t stringIndex = 0;
+			if ( !ReadValue( fileBytes, readOffset, stringIndex ) || stringIndex >= strings.size() )
+			{
+				return false;
+			}
+			group.m_frames.push_back( strings[ stringIndex ] );
+		}
+
+		out_snapshot.m_groups.push_back( group );
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Groups match by tag and symbolized frames, so snapshots from different runs still line up
+static std::string GetGroupKey( HeapSnapshotGroup const &group )
+{
+	std::string key = group.m_tag;
+	for ( unsigned int frameIndex = 0; frameIndex < group.m_frames.size(); ++frameIndex )
+	{
+		key += '\n';
+		key += group.m_frames[ frameIndex ];
+	}
+	return key;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Groups that symbolize the same, two return addresses on one line say, are counted as one
+struct HeapSnapshotKeyTotals
+{
+	HeapSnapshotGroup const* m_group; // The first with the key
+	uint64_t m_numAllocations;
+	uint64_t m_numBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static void MergeGroupsByKey( HeapSnapshot const &snapshot, std::map< std::string, HeapSnapshotKeyTotals >& out_totals )
+{
+	for ( unsigned int groupIndex = 0; groupIndex < snapshot.m_groups.size(); ++groupIndex )
+	{
+		HeapSnapshotGroup const &group = snapshot.m_groups[ groupIndex ];
+		std::pair< std::map< std::string, HeapSnapshotKeyTotals >::iterator, bool > inserted =
+			out_totals.insert( std::make_pair( GetGroupKey( group ), HeapSnapshotKeyTotals() ) );
+		HeapSnapshotKeyTotals& totals = inserted.first->second;
+		if ( inserted.second )
+		{
+			totals.m_group = &group;
+			totals.m_numAllocations = 0;
+			totals.m_numBytes = 0;
+		}
+
+		totals.m_numAllocations += group.m_numAllocations;
+		totals.m_numBytes += group.m_numBytes;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Biggest byte growth first, groups that shrank or went away last
+void DiffHeapSnapshots( HeapSnapshot const &before, HeapSnapshot const &after, std::vector< HeapSnapshotGrowth >& out_growth )
+{
+	std::map< std::string, HeapSnapshotKeyTotals > beforeTotals;
+	std::map< std::string, HeapSnapshotKeyTotals > afterTotals;
+	MergeGroupsByKey( before, beforeTotals );
+	MergeGroupsByKey( after, afterTotals );
+	out_growth.clear();
+
+	for ( std::map< std::string, HeapSnapshotKeyTotals >::const_iterator afterIter = afterTotals.begin(); afterIter != afterTotals.end(); ++afterIter )
+	{
+		HeapSnapshotKeyTotals const &afterGroup = afterIter->second;
+		HeapSnapshotGrowth growth;
+		growth.m_group = afterGroup.m_group;
+		growth.m_allocationDelta = ( int64_t ) afterGroup.m_numAllocations;
+		growth.m_byteDelta = ( int64_t ) afterGroup.m_numBytes;
+
+		std::map< std::string, HeapSnapshotKeyTotals >::const_iterator found = beforeTotals.find( afterIter->first );
+		if ( found != beforeTotals.end() )
+		{
+			growth.m_allocationDelta -= ( int64_t ) found->second.m_numAllocations;
+			growth.m_byteDelta -= ( int64_t ) found->second.m_numBytes;
+		}
+
+		if ( growth.m_allocationDelta != 0 || growth.m_byteDelta != 0 )
+		{
+			out_growth.push_back( growth );
+		}
+	}
+
+	for ( std::map< std::string, HeapSnapshotKeyTotals >::const_iterator beforeIter = beforeTotals.begin(); beforeIter != beforeTotals.end(); ++beforeIter )
+	{
+		if ( afterTotals.find( beforeIter->first ) == afterTotals.end() )
+		{
+			HeapSnapshotGrowth growth;
+			growth.m_group = beforeIter->second.m_group;
+			growth.m_allocationDelta = -( int64_t ) beforeIter->second.m_numAllocations;
+			growth.m_byteDelta = -( int64_t ) beforeIter->second.m_numBytes;
+			out_growth.push_back( growth );
+		}
+	}
+
+	std::sort( out_growth.begin(), out_growth.end(), []( HeapSnapshotGrowth const &a, HeapSnapshotGrowth const &b )
+	{
+		return a.m_byteDelta > b.m_byteDelta;
+	} );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// One line per group followed by its innermost frames, indented
+void FormatHeapSnapshotGrowth( std::vector< HeapSnapshotGrowth > const &growth, unsigned int maxGroups, unsigned int maxFrames,
+	std::vector< std::string >& out_lines )
+{
+	char line[ 1024 ];
+	for ( unsigned int growthIndex = 0; growthIndex < growth.size() && growthIndex < maxGroups; ++growthIndex )
+	{
+		HeapSnapshotGrowth const &groupGrowth = growth[ growthIndex ];
+		snprintf( line, sizeof( line ), "%+lld bytes %+lld allocs [%s]", ( long long ) groupGrowth.m_byteDelta,
+			( long long ) groupGrowth.m_allocationDelta, groupGrowth.m_group->m_tag.c_str() );
+		out_lines.push_back( line );
+
+		std::vector< std::string > const &frames = groupGrowth.m_group->m_frames;
+		for ( unsigned int frameIndex = 0; frameIndex < frames.size() && frameIndex < maxFrames; ++frameIndex )
+		{
+			out_lines.push_back( "    " + frames[ frameIndex ] );
+		}
+	}
+}
\ No newline at end of file
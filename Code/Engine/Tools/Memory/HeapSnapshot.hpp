@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+const char* const HEAP_SNAPSHOT_EXTENSION = ".heapsnap";
+
+
+//-----------------------------------------------------------------------------------------------
+// Live allocations that share a callstack and tag
+struct HeapSnapshotGroup
+{
+	std::string m_tag;
+	std::vector< std::string > m_frames; // Symbolized when captured, innermost first
+	uint64_t m_numAllocations;
+	uint64_t m_numBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct HeapSnapshot
+{
+	double m_captureSeconds;
+	uint64_t m_totalAllocations; // Every live allocation, sampled or not
+	uint64_t m_totalBytes;
+	uint32_t m_samplingMode; // AllocationSamplingMode the groups were recorded with
+	uint64_t m_samplingInterval;
+	std::vector< HeapSnapshotGroup > m_groups;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct HeapSnapshotGrowth
+{
+	HeapSnapshotGroup const* m_group; // From the later snapshot, or the earlier one if it went away
+	int64_t m_allocationDelta;
+	int64_t m_byteDelta;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Reading, writing and diffing only need the standard library, so the offline heap diff tool can
+// build this file on its own. Capturing lives with the allocation tracking in MemoryAnalytics.
+bool SaveHeapSnapshot( HeapSnapshot const &snapshot, std::string const &filename );
+bool LoadHeapSnapshot( std::string const &filename, HeapSnapshot& out_snapshot );
+void DiffHeapSnapshots( HeapSnapshot const &before, HeapSnapshot const &after, std::vector< HeapSnapshotGrowth >& out_growth );
+void FormatHeapSnapshotGrowth( std::vector< HeapSnapshotGrowth > const &growth, unsigned int maxGroups, unsigned int maxFrames,
+	std::vector< std::string >& out_lines );
\ No newline at end of file
@@ -1,242 +1,362 @@
+#include <map>
+#include <vector>
+
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
 #include "Engine/Config/BuildConfig.hpp" // Enable/disable memory tracking in this file
 #include "Engine/Input/DeveloperConsole.hpp"
 #include "Engine/Renderer/Renderer.hpp"
 #include "Engine/Tools/Memory/MemoryAnalytics.hpp"
+#include "Engine/Tools/Memory/FrameAllocator.hpp"
+#include "Engine/Tools/Memory/SlabAllocator.hpp"
+#include "Engine/Tools/Memory/AllocationTracker.hpp"
+#include "Engine/Tools/Memory/HeapSnapshot.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+#include "Engine/Tools/Memory/AllocationCounters.hpp"
+#include "Engine/Tools/Memory/FrameAllocationChecker.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
-// SymInitialize()
-typedef BOOL( __stdcall *sym_initialize_t )( IN HANDLE hProcess, IN PSTR UserSearchPath, IN BOOL fInvadeProcess );
-typedef BOOL( __stdcall *sym_cleanup_t )( IN HANDLE hProcess );
-typedef BOOL( __stdcall *sym_from_addr_t )( IN HANDLE hProcess, IN DWORD64 Address, OUT PDWORD64 Displacement, OUT PSYMBOL_INFO Symbol );
-typedef BOOL( __stdcall *sym_get_line_t )( IN HANDLE hProcess, IN DWORD64 dwAddr, OUT PDWORD pdwDisplacement, OUT PIMAGEHLP_LINE64 Symbol );
+// Live counts come from the sharded allocation counters, see GetAllocationCounterTotals
+uint64_t g_highwaterTotalBytesAllocated = 0;
+uint64_t g_numberOfAllocationsStartup = 0;
+bool g_displayMemoryInformation = true;
 
 
 //-----------------------------------------------------------------------------------------------
-AllocationToCallstackMap g_callstackRegistry;
-HMODULE gDebugHelp;
-HANDLE gProcess;
-SYMBOL_INFO  *gSymbol;
-
-// only called from single thread - so can use a shared buffer
-char gFileName[ MAX_FILENAME_LENGTH ];
-CallstackLine gCallstackBuffer[ MAX_DEPTH ];
-
-static sym_initialize_t LSymInitialize;
-static sym_cleanup_t LSymCleanup;
-static sym_from_addr_t LSymFromAddr;
-static sym_get_line_t LSymGetLineFromAddr64;
-
+void MemoryAnalyticsStartup()
+{
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	g_numberOfAllocationsStartup = totals.m_numLiveAllocations;
 
-//-----------------------------------------------------------------------------------------------
-unsigned int g_numberOfAllocations = 0;
-unsigned int g_totalBytesAllocated = 0;
-unsigned int g_highwaterTotalBytesAllocated = 0;
-unsigned int g_numberOfAllocationsStartup = 0;
-bool g_displayMemoryInformation = true;
+	DebuggerPrintf( "Live allocations at startup: %llu\n", g_numberOfAllocationsStartup );
+	DebuggerPrintf( "Live bytes at startup: %llu\n", totals.m_liveBytes );
+	LoggerPrintf( "Live allocations at startup: %llu\n", g_numberOfAllocationsStartup );
+	LoggerPrintf( "Live bytes at startup: %llu\n", totals.m_liveBytes );
+}
 
 
 //-----------------------------------------------------------------------------------------------
-Callstack* CallstackFetch( unsigned int numSkipFrames )
+void MemoryAnalyticsShutdown()
 {
-	void *stack[ MAX_DEPTH ];
-	unsigned int frames = CaptureStackBackTrace( 1 + numSkipFrames, MAX_DEPTH, stack, NULL );
-
-	Callstack* cs = ( Callstack* ) malloc( sizeof( Callstack ) );
-	cs->framecount = frames;
-	cs->frames = ( void** ) malloc( frames * sizeof( void* ) );
-	memcpy( cs->frames, stack, frames * sizeof( void* ) );
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	DebuggerPrintf( "Live allocations at shutdown: %llu\n", totals.m_numLiveAllocations );
+	DebuggerPrintf( "Live bytes at shutdown: %llu\n", totals.m_liveBytes );
+	LoggerPrintf( "Live allocations at shutdown: %llu\n", totals.m_numLiveAllocations );
+	LoggerPrintf( "Live bytes at shutdown: %llu\n", totals.m_liveBytes );
 
-	return cs;
+#ifdef MEMORY_TRACKING
+#if MEMORY_TRACKING == 0 // Basic mode
+	//ASSERT_RECOVERABLE( totals.m_numLiveAllocations == g_numberOfAllocationsStartup, "Differing number of allocations on startup and shutdown!" );
+#elif MEMORY_TRACKING == 1 // Verbose mode
+	PrintMemoryFlush();
+#endif
+#endif
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void FreeCallstack( Callstack* cs )
+void MemoryAnalyticsUpdate( float deltaSeconds )
 {
-	free( cs->frames );
-	free( cs );
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	if ( totals.m_liveBytes > g_highwaterTotalBytesAllocated )
+	{
+		g_highwaterTotalBytesAllocated = totals.m_liveBytes;
+	}
+
+	AllocationCountersFrameMark( deltaSeconds );
+	UpdateMemoryTags( deltaSeconds );
 }
 
 
 //-----------------------------------------------------------------------------------------------
-CallstackLine* CallstackGetLines( Callstack* cs )
+void MemoryAnalyticsRender()
 {
-	IMAGEHLP_LINE64 LineInfo;
-	DWORD LineDisplacement = 0; // Displacement from the beginning of the line 
-	LineInfo.SizeOfStruct = sizeof( IMAGEHLP_LINE64 );
+	if ( !g_displayMemoryInformation )
+	{
+		return;
+	}
 
-	unsigned int count = cs->framecount;
-	for ( unsigned int i = 0; i < count; ++i )
+	if ( !g_debugMode )
 	{
-		CallstackLine* line = &( gCallstackBuffer[ i ] );
-		DWORD64 ptr = ( DWORD64 ) ( cs->frames[ i ] );
-		LSymFromAddr( gProcess, ptr, 0, gSymbol );
+		return;
+	}
 
-		strcpy_s( line->functionName, 1024, gSymbol->Name );
+	g_theRenderer->SetOrtho( Vector2( 0.0f, 0.0f ), Vector2( 700.0f, 900.0f ) );
 
-		BOOL bRet = LSymGetLineFromAddr64(
-			GetCurrentProcess(), // Process handle of the current process 
-			ptr, // Address 
-			&LineDisplacement, // Displacement will be stored here by the function 
-			&LineInfo );         // File name / line information will be stored here 
+	static BitmapFont* fixedFont = BitmapFont::CreateOrGetFont( "Data/Fonts/SquirrelFixedFont.png" );
 
-		if ( bRet )
-		{
-			line->line = LineInfo.LineNumber;
+	// Allocation churn over the last frame and the last second
+	AllocationFrameStats allocationFrameStats = GetAllocationFrameStats();
+	g_theRenderer->DrawText2D( Vector2( 0.0f, 885.0f ), "F#Alloc:"
+		+ Stringf( "%llu", allocationFrameStats.m_numAllocations ), 15.0f, Rgba::GREEN, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 200.0f, 885.0f ), "F#Bytes:"
+		+ Stringf( "%llu", allocationFrameStats.m_numBytes ), 15.0f, Rgba::GREEN, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 450.0f, 885.0f ), "Alloc/s:"
+		+ Stringf( "%.0f", allocationFrameStats.m_allocationsPerSecond ), 15.0f, Rgba::GREEN, fixedFont );
 
-			// 			char const *filename = StringFindLast( LineInfo.FileName, "\\src" );
-			// 			if ( filename == NULL ) 
-			// 			{
-			// 				filename = LineInfo.FileName;
-			// 			}
-			// 			else 
-			// 			{
-			// 				filename += 5; // skip to the important bit - so that it can be double clicked in Output
-			// 			}
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	g_theRenderer->DrawText2D( Vector2( 0.0f, 865.0f ), "#Alloc:"
+		+ Stringf( "%llu", totals.m_numLiveAllocations ), 15.0f, Rgba::GREEN, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 200.0f, 865.0f ), "#Bytes:"
+		+ Stringf( "%llu", totals.m_liveBytes ), 15.0f, Rgba::GREEN, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 450.0f, 865.0f ), "HWBytes:"
+		+ Stringf( "%llu", g_highwaterTotalBytesAllocated ), 15.0f, Rgba::GREEN, fixedFont );
+
+	// Frame and scratch arenas, overflows mean an arena is too small
+	FrameMemoryStats frameStats = GetFrameMemoryStats();
+	Rgba frameColor = ( frameStats.m_frameArena.m_numOverflows + frameStats.m_numScratchOverflows > 0 ) ? Rgba::RED : Rgba::GREEN;
+	g_theRenderer->DrawText2D( Vector2( 0.0f, 845.0f ), "Frame:"
+		+ Stringf( "%uK/%uK", ( unsigned int ) ( frameStats.m_frameArena.m_usedBytes / 1024 ),
+		( unsigned int ) ( frameStats.m_frameArena.m_capacity / 1024 ) ), 15.0f, frameColor, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 200.0f, 845.0f ), "FrameHW:"
+		+ Stringf( "%uK", ( unsigned int ) ( frameStats.m_frameArena.m_highWaterBytes / 1024 ) ), 15.0f, frameColor, fixedFont );
+	g_theRenderer->DrawText2D( Vector2( 450.0f, 845.0f ), "ScratchHW:"
+		+ Stringf( "%uKx%u", ( unsigned int ) ( frameStats.m_scratchHighWaterBytes / 1024 ), frameStats.m_numScratchArenas ),
+		15.0f, frameColor, fixedFont );
+
+	// One bar per tag, scaled to its budget or to the biggest tag when it has none
+	uint64_t largestTagBytes = 1;
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS; ++tagIndex )
+	{
+		MemoryTagStats tagStats = GetMemoryTagStats( ( MemoryTag ) tagIndex );
+		largestTagBytes = ( tagStats.m_peakBytes > largestTagBytes ) ? tagStats.m_peakBytes : largestTagBytes;
+	}
 
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS; ++tagIndex )
+	{
+		MemoryTagStats tagStats = GetMemoryTagStats( ( MemoryTag ) tagIndex );
+		float rowY = 825.0f - 20.0f * tagIndex;
+		uint64_t fullBarBytes = ( tagStats.m_budgetBytes > 0 ) ? tagStats.m_budgetBytes : largestTagBytes;
+		float liveFraction = ( float ) tagStats.m_liveBytes / ( float ) fullBarBytes;
+		float peakFraction = ( float ) tagStats.m_peakBytes / ( float ) fullBarBytes;
+		Rgba barColor = tagStats.m_isOverBudget ? Rgba::RED : Rgba::GREEN;
+
+		g_theRenderer->DrawQuad( Vector2( 150.0f, rowY ), Vector2( 150.0f + 200.0f * ClampFloatZeroToOne( peakFraction ), rowY + 15.0f ), Rgba::GRAY );
+		g_theRenderer->DrawQuad( Vector2( 150.0f, rowY ), Vector2( 150.0f + 200.0f * ClampFloatZeroToOne( liveFraction ), rowY + 15.0f ), barColor );
+		g_theRenderer->DrawText2D( Vector2( 0.0f, rowY ), GetMemoryTagName( ( MemoryTag ) tagIndex ), 15.0f, barColor, fixedFont );
+		g_theRenderer->DrawText2D( Vector2( 360.0f, rowY ), Stringf( "%lluK/%lluK %.0f/s", ( unsigned long long ) ( tagStats.m_liveBytes / 1024 ),
+			( unsigned long long ) ( fullBarBytes / 1024 ), tagStats.m_allocationsPerSecond ), 15.0f, barColor, fixedFont );
+	}
+}
 
-			strcpy_s( line->filename, 1024, LineInfo.FileName );
-			line->offset = LineDisplacement;
-		}
-		else
-		{
-			line->line = 0;
-			line->offset = 0;
-			strcpy_s( line->filename, 1024, "N/A" );
-		}
+
+//-----------------------------------------------------------------------------------------------
+struct CapturedCallstack
+{
+	uint64_t m_numAllocations;
+	uint64_t m_numBytes;
+	MemoryTag m_tag;
+	unsigned int m_numFrames;
+	void* m_frames[ MAX_TRACKED_CALLSTACK_DEPTH ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static void CaptureTrackedCallstack( TrackedCallstack const &callstack, void* userData )
+{
+	CapturedCallstack captured;
+	captured.m_numAllocations = callstack.m_numLiveAllocations.load( std::memory_order_relaxed );
+	captured.m_numBytes = callstack.m_liveBytes.load( std::memory_order_relaxed );
+	if ( captured.m_numAllocations == 0 )
+	{
+		return;
 	}
 
-	return gCallstackBuffer;
+	captured.m_tag = callstack.m_tag;
+	captured.m_numFrames = callstack.m_numFrames;
+	memcpy( captured.m_frames, callstack.m_frames, callstack.m_numFrames * sizeof( void* ) );
+	( ( std::vector< CapturedCallstack >* ) userData )->push_back( captured );
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsStartup()
+// Symbolizing can take a while, so this is after the tracker's locks are released
+static void PrintCapturedCallstack( CapturedCallstack const &captured )
 {
-	gDebugHelp = LoadLibraryA( "dbghelp.dll" );
-	ASSERT_OR_DIE( gDebugHelp != nullptr, "gDebugHelp == nullptr" );
-	LSymInitialize = ( sym_initialize_t ) GetProcAddress( gDebugHelp, "SymInitialize" );
-	LSymCleanup = ( sym_cleanup_t ) GetProcAddress( gDebugHelp, "SymCleanup" );
-	LSymFromAddr = ( sym_from_addr_t ) GetProcAddress( gDebugHelp, "SymFromAddr" );
-	LSymGetLineFromAddr64 = ( sym_get_line_t ) GetProcAddress( gDebugHelp, "SymGetLineFromAddr64" );
+	DebuggerPrintf( "%llu allocs, %llu bytes\n", captured.m_numAllocations, captured.m_numBytes );
 
-	gProcess = GetCurrentProcess();
-	LSymInitialize( gProcess, NULL, TRUE );
+	Callstack cs;
+	cs.frames = ( void** ) captured.m_frames;
+	cs.framecount = captured.m_numFrames;
+	CallstackLine* line = CallstackGetLines( &cs );
 
-	gSymbol = ( SYMBOL_INFO * ) malloc( sizeof( SYMBOL_INFO ) + ( MAX_FILENAME_LENGTH * sizeof( char ) ) );
-	gSymbol->MaxNameLen = MAX_FILENAME_LENGTH;
-	gSymbol->SizeOfStruct = sizeof( SYMBOL_INFO );
+	for ( size_t i = 0; i < cs.framecount; ++i )
+	{
+		DebuggerPrintf( line[ i ].filename );
+		DebuggerPrintf( "(" );
+		DebuggerPrintf( "%u", line[ i ].line );
+		DebuggerPrintf( "): " );
+		DebuggerPrintf( line[ i ].functionName );
+		DebuggerPrintf( "\n" );
+	}
+	DebuggerPrintf( "\n" );
+}
 
-	g_numberOfAllocationsStartup = g_numberOfAllocations;
 
-	DebuggerPrintf( "g_numberOfAllocations Startup: %u\n", g_numberOfAllocationsStartup );
-	DebuggerPrintf( "g_totalBytesAllocated Startup: %u\n", g_totalBytesAllocated );
-	LoggerPrintf( "g_numberOfAllocations Startup: %u\n", g_numberOfAllocationsStartup );
-	LoggerPrintf( "g_totalBytesAllocated Startup: %u\n", g_totalBytesAllocated );
+//-----------------------------------------------------------------------------------------------
+// Live allocations grouped by the callstack that made them. Only sampled allocations are counted.
+void PrintMemoryFlush()
+{
+	AllocationTrackerStats stats = GetAllocationTrackerStats();
+	DebuggerPrintf( "%llu tracked allocs, %llu bytes, %u callstacks, sampling every %u %s\n", stats.m_numTrackedAllocations,
+		stats.m_trackedBytes, stats.m_numCallstacks, ( unsigned int ) stats.m_samplingInterval,
+		( stats.m_samplingMode == ALLOCATION_SAMPLING_BY_BYTES ) ? "bytes" : "allocs" );
+
+	std::vector< CapturedCallstack > capturedCallstacks;
+	ForEachTrackedCallstack( CaptureTrackedCallstack, &capturedCallstacks );
+	for ( unsigned int callstackIndex = 0; callstackIndex < capturedCallstacks.size(); ++callstackIndex )
+	{
+		PrintCapturedCallstack( capturedCallstacks[ callstackIndex ] );
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsShutdown()
+// Verbose mode groups live allocations by tag and callstack, symbolized after the tracker's locks
+// are released. Other modes only know the totals for each tag.
+void CaptureHeapSnapshot( HeapSnapshot& out_snapshot )
 {
-	DebuggerPrintf( "g_numberOfAllocations Shutdown: %u\n", g_numberOfAllocations );
-	DebuggerPrintf( "g_totalBytesAllocated Shutdown: %u\n", g_totalBytesAllocated );
-	LoggerPrintf( "g_numberOfAllocations Shutdown: %u\n", g_numberOfAllocations );
-	LoggerPrintf( "g_totalBytesAllocated Shutdown: %u\n", g_totalBytesAllocated );
+	AllocationTrackerStats stats = GetAllocationTrackerStats();
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	out_snapshot.m_captureSeconds = GetCurrentTimeSeconds();
+	out_snapshot.m_totalAllocations = totals.m_numLiveAllocations;
+	out_snapshot.m_totalBytes = totals.m_liveBytes;
+	out_snapshot.m_samplingMode = stats.m_samplingMode;
+	out_snapshot.m_samplingInterval = stats.m_samplingInterval;
+	out_snapshot.m_groups.clear();
+	bool hasCallstacks = false;
 
 #ifdef MEMORY_TRACKING
-#if MEMORY_TRACKING == 0 // Basic mode
-	//ASSERT_RECOVERABLE( g_numberOfAllocations == g_numberOfAllocationsStartup, "Differing number of allocations on startup and shutdown!" );
-#endif
-#endif
+#if MEMORY_TRACKING == 1 // Verbose mode
+	hasCallstacks = true;
+	std::vector< CapturedCallstack > capturedCallstacks;
+	ForEachTrackedCallstack( CaptureTrackedCallstack, &capturedCallstacks );
 
-	for ( auto const &p : g_callstackRegistry )
+	for ( unsigned int callstackIndex = 0; callstackIndex < capturedCallstacks.size(); ++callstackIndex )
 	{
-		DebuggerPrintf( "Alloc %p\n", p.first );
-		CallstackLine* line = CallstackGetLines( p.second );
-
-		for ( size_t i = 0; i < p.second->framecount; ++i )
+		CapturedCallstack& captured = capturedCallstacks[ callstackIndex ];
+		HeapSnapshotGroup group;
+		group.m_tag = GetMemoryTagName( captured.m_tag );
+		group.m_numAllocations = captured.m_numAllocations;
+		group.m_numBytes = captured.m_numBytes;
+
+		Callstack cs;
+		cs.frames = captured.m_frames;
+		cs.framecount = captured.m_numFrames;
+		CallstackLine* line = CallstackGetLines( &cs );
+		for ( unsigned int frameIndex = 0; frameIndex < captured.m_numFrames; ++frameIndex )
 		{
-			DebuggerPrintf( line[ i ].filename );
-			DebuggerPrintf( "(" );
-			DebuggerPrintf( "%u", line[ i ].line );
-			DebuggerPrintf( "): " );
-			DebuggerPrintf( line[ i ].functionName );
-			DebuggerPrintf( "\n" );
+			group.m_frames.push_back( Stringf( "%s %s(%u)", line[ frameIndex ].functionName, line[ frameIndex ].filename, line[ frameIndex ].line ) );
 		}
-		DebuggerPrintf( "\n" );
-	}
 
-	LSymCleanup( gProcess );
+		out_snapshot.m_groups.push_back( group );
+	}
+#endif
+#endif
 
-	FreeLibrary( gDebugHelp );
-	gDebugHelp = NULL;
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS && !hasCallstacks; ++tagIndex )
+	{
+		MemoryTagStats tagStats = GetMemoryTagStats( ( MemoryTag ) tagIndex );
+		if ( tagStats.m_numLiveAllocations == 0 )
+		{
+			continue;
+		}
 
-	free( gSymbol );
+		HeapSnapshotGroup group;
+		group.m_tag = GetMemoryTagName( ( MemoryTag ) tagIndex );
+		group.m_numAllocations = tagStats.m_numLiveAllocations;
+		group.m_numBytes = tagStats.m_liveBytes;
+		out_snapshot.m_groups.push_back( group );
+	}
 }
 
 
+#ifndef MEMORY_TRACKING
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsUpdate( float deltaSeconds )
+static void* EngineAlloc( size_t numBytes )
 {
-	UNUSED( deltaSeconds );
-
-	if ( g_totalBytesAllocated > g_highwaterTotalBytesAllocated )
-	{
-		g_highwaterTotalBytesAllocated = g_totalBytesAllocated;
-	}
+#ifdef ENGINE_ALLOCATOR
+	return SlabAlloc( numBytes );
+#else
+	return malloc( numBytes );
+#endif
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsRender()
+static void EngineFree( void* ptr )
 {
-	if ( !g_displayMemoryInformation )
-	{
-		return;
-	}
+#ifdef ENGINE_ALLOCATOR
+	SlabFree( ptr );
+#else
+	free( ptr );
+#endif
+}
+#endif
 
-	if ( !g_debugMode )
-	{
-		return;
-	}
 
-	g_theRenderer->SetOrtho( Vector2( 0.0f, 0.0f ), Vector2( 700.0f, 900.0f ) );
+#ifdef MEMORY_TRACKING
+#ifndef ENGINE_ALLOCATOR
+//-----------------------------------------------------------------------------------------------
+// In front of every tracked malloc so freeing knows its size and tag whichever scope frees it.
+// Sixteen bytes keeps the caller's memory as aligned as malloc made it. Slab blocks keep both in
+// their slab instead.
+struct alignas( 16 ) TrackedAllocationHeader
+{
+	size_t m_numBytes;
+	MemoryTag m_tag;
+};
+#endif
 
-	static BitmapFont* fixedFont = BitmapFont::CreateOrGetFont( "Data/Fonts/SquirrelFixedFont.png" );
 
-	g_theRenderer->DrawText2D( Vector2( 0.0f, 865.0f ), "#Alloc:"
-		+ Stringf( "%u", g_numberOfAllocations ), 15.0f, Rgba::GREEN, fixedFont );
-	g_theRenderer->DrawText2D( Vector2( 200.0f, 865.0f ), "#Bytes:"
-		+ Stringf( "%u", g_totalBytesAllocated ), 15.0f, Rgba::GREEN, fixedFont );
-	g_theRenderer->DrawText2D( Vector2( 450.0f, 865.0f ), "HWBytes:"
-		+ Stringf( "%u", g_highwaterTotalBytesAllocated ), 15.0f, Rgba::GREEN, fixedFont );
+//-----------------------------------------------------------------------------------------------
+// Counts the allocation against the calling thread's memory tag. With the slab allocator, tracked
+// bytes include size class rounding, and out_trackedBytes is what everything else should be told.
+static void* TrackedAlloc( size_t numBytes, size_t& out_trackedBytes )
+{
+	MemoryTag tag = GetCurrentMemoryTag();
+#ifdef ENGINE_ALLOCATOR
+	void* ptr = SlabAlloc( numBytes );
+	numBytes = SlabGetBlockSize( ptr );
+	SlabSetBlockTag( ptr, ( unsigned char ) tag );
+#else
+	TrackedAllocationHeader* header = ( TrackedAllocationHeader* ) malloc( numBytes + sizeof( TrackedAllocationHeader ) );
+	header->m_numBytes = numBytes;
+	header->m_tag = tag;
+	void* ptr = header + 1;
+#endif
+	//DebuggerPrintf( "Alloc %p of %u bytes.\n", ptr, numBytes );
+	AddToAllocationCounters( numBytes );
+	RecordTaggedAllocation( tag, numBytes );
+	out_trackedBytes = numBytes;
+	return ptr;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void PrintMemoryFlush()
+static void TrackedFree( void* ptr )
 {
-	for ( auto const &p : g_callstackRegistry )
+	if ( ptr == nullptr )
 	{
-		DebuggerPrintf( "Alloc %p\n", p.first );
-		CallstackLine* line = CallstackGetLines( p.second );
-
-		for ( size_t i = 0; i < p.second->framecount; ++i )
-		{
-			DebuggerPrintf( line[ i ].filename );
-			DebuggerPrintf( "(" );
-			DebuggerPrintf( "%u", line[ i ].line );
-			DebuggerPrintf( "): " );
-			DebuggerPrintf( line[ i ].functionName );
-			DebuggerPrintf( "\n" );
-		}
-		DebuggerPrintf( "\n" );
+		return;
 	}
+
+#ifdef ENGINE_ALLOCATOR
+	size_t numBytes = SlabGetBlockSize( ptr );
+	MemoryTag tag = ( MemoryTag ) SlabGetBlockTag( ptr );
+	RemoveFromAllocationCounters( numBytes );
+	RecordTaggedFree( tag, numBytes );
+	SlabFree( ptr );
+#else
+	TrackedAllocationHeader* header = ( TrackedAllocationHeader* ) ptr - 1;
+	RemoveFromAllocationCounters( header->m_numBytes );
+	RecordTaggedFree( header->m_tag, header->m_numBytes );
+	free( header );
+#endif
 }
+#endif
 
 
 //-----------------------------------------------------------------------------------------------
@@ -244,27 +364,20 @@ void* operator new( size_t numBytes )
 {
 #ifdef MEMORY_TRACKING
 #if MEMORY_TRACKING == 0 // Basic mode
-	size_t* ptr = ( size_t* ) malloc( numBytes + sizeof( size_t ) );
-//DebuggerPrintf( "Alloc %p of %u bytes.\n", ptr, numBytes );
-++g_numberOfAllocations;
-g_totalBytesAllocated += numBytes;
-*ptr = numBytes;
-ptr++;
-return ptr;
+	size_t trackedBytes;
+	void* ptr = TrackedAlloc( numBytes, trackedBytes );
+	CheckFrameAllocation( trackedBytes );
+	return ptr;
 #elif MEMORY_TRACKING == 1 // Verbose mode
-	size_t* ptr = ( size_t* ) malloc( numBytes + sizeof( size_t ) );
-//DebuggerPrintf( "Alloc %p of %u bytes.\n", ptr, numBytes );
-++g_numberOfAllocations;
-g_totalBytesAllocated += numBytes;
-*ptr = numBytes;
-ptr++;
-g_callstackRegistry.insert( AllocationToCallstackPair( ( void* ) ptr, CallstackFetch( 2 ) ) );
-return ptr;
+	size_t trackedBytes;
+	void* ptr = TrackedAlloc( numBytes, trackedBytes );
+	TrackAllocation( ptr, trackedBytes, GetCurrentMemoryTag(), 1 );
+	CheckFrameAllocation( trackedBytes );
+	return ptr;
 #endif
 #else
 	// No memory tracking
-	void* ptr = malloc( numBytes );
-	return ptr;
+	return EngineAlloc( numBytes );
 #endif
 }
 
@@ -274,26 +387,20 @@ void* operator new[]( size_t numBytes )
 {
 #ifdef MEMORY_TRACKING
 #if MEMORY_TRACKING == 0 // Basic mode
-	size_t* ptr = ( size_t* ) malloc( numBytes + sizeof( size_t ) );
-	//DebuggerPrintf( "Alloc %p of %u bytes.\n", ptr, numBytes );
-	++g_numberOfAllocations;
-	g_totalBytesAllocated += numBytes;
-	*ptr = numBytes;
-	ptr++;
+	size_t trackedBytes;
+	void* ptr = TrackedAlloc( numBytes, trackedBytes );
+	CheckFrameAllocation( trackedBytes );
 	return ptr;
 #elif MEMORY_TRACKING == 1 // Verbose mode
-	size_t* ptr = ( size_t* ) malloc( numBytes + sizeof( size_t ) );
-	//DebuggerPrintf( "Alloc %p of %u bytes.\n", ptr, numBytes );
-	++g_numberOfAllocations;
-	g_totalBytesAllocated += numBytes;
-	*ptr = numBytes;
-	ptr++;
+	size_t trackedBytes;
+	void* ptr = TrackedAlloc( numBytes, trackedBytes );
+	TrackAllocation( ptr, trackedBytes, GetCurrentMemoryTag(), 1 );
+	CheckFrameAllocation( trackedBytes );
 	return ptr;
 #endif
 #else
 	// No memory tracking
-	void* ptr = malloc( numBytes );
-	return ptr;
+	return EngineAlloc( numBytes );
 #endif
 }
 
@@ -303,29 +410,15 @@ void operator delete( void* ptr )
 {
 #ifdef MEMORY_TRACKING
 #if MEMORY_TRACKING == 0 // Basic mode
-	size_t* ptr_size = ( size_t* ) ptr;
-	--ptr_size;
-	size_t numBytes = *ptr_size;
-	--g_numberOfAllocations;
-	g_totalBytesAllocated -= numBytes;
-	free( ptr_size );
+	TrackedFree( ptr );
 #elif MEMORY_TRACKING == 1 // Verbose mode
-	size_t* ptr_size = ( size_t* ) ptr;
-	--ptr_size;
-	size_t numBytes = *ptr_size;
-	--g_numberOfAllocations;
-	g_totalBytesAllocated -= numBytes;
-	free( ptr_size );
-	AllocationToCallstackMapIter ptrIter = g_callstackRegistry.find( ptr );
-	if ( ptrIter != g_callstackRegistry.end() )
-	{
-		FreeCallstack( ptrIter->second );
-		g_callstackRegistry.erase( ptrIter );
-	}
+	// Before the memory can be reused and tracked again by another thread
+	UntrackAllocation( ptr );
+	TrackedFree( ptr );
 #endif
 #else
 	// No memory tracking
-	free( ptr );
+	EngineFree( ptr );
 #endif
 }
 
@@ -335,23 +428,14 @@ void operator delete[]( void* ptr )
 {
 #ifdef MEMORY_TRACKING
 #if MEMORY_TRACKING == 0 // Basic mode
-	size_t* ptr_size = ( size_t* ) ptr;
-	--ptr_size;
-	size_t numBytes = *ptr_size;
-	--g_numberOfAllocations;
-	g_totalBytesAllocated -= numBytes;
-	free( ptr_size );
+	TrackedFree( ptr );
 #elif MEMORY_TRACKING == 1 // Verbose mode
-	size_t* ptr_size = ( size_t* ) ptr;
-	--ptr_size;
-	size_t numBytes = *ptr_size;
-	--g_numberOfAllocations;
-	g_totalBytesAllocated -= numBytes;
-	free( ptr_size );
+	UntrackAllocation( ptr );
+	TrackedFree( ptr );
 #endif
 #else
 	// No memory tracking
-	free( ptr );
+	EngineFree( ptr );
 #endif
 }
 
@@ -373,8 +457,287 @@ CONSOLE_COMMAND( memory_debug )
 CONSOLE_COMMAND( memory_flush )
 {
 	UNUSED( args );
-	/*			PrintMemoryFlush();*/
+	PrintMemoryFlush();
 	g_theDeveloperConsole->ConsolePrint( "Check Output window for current allocations." );
 }
+// memory_sampling <count|bytes> <interval>
+CONSOLE_COMMAND( memory_sampling )
+{
+	int interval = 0;
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( interval, args.m_argList[ 1 ] );
+	}
+
+	if ( args.m_argList.size() < 2 || interval <= 0 || ( args.m_argList[ 0 ] != "count" && args.m_argList[ 0 ] != "bytes" ) )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_sampling <count|bytes> <interval>", Rgba::RED );
+		return;
+	}
+
+	AllocationSamplingMode mode = ( args.m_argList[ 0 ] == "bytes" ) ? ALLOCATION_SAMPLING_BY_BYTES : ALLOCATION_SAMPLING_BY_COUNT;
+	SetAllocationSampling( mode, interval );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Tracking one allocation every %d %s", interval,
+		( mode == ALLOCATION_SAMPLING_BY_BYTES ) ? "bytes" : "allocations" ) );
+}
+#endif
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+#ifdef MEMORY_TRACKING
+CONSOLE_COMMAND( memory_tags )
+{
+	UNUSED( args );
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS; ++tagIndex )
+	{
+		MemoryTagStats tagStats = GetMemoryTagStats( ( MemoryTag ) tagIndex );
+		std::string budget = ( tagStats.m_budgetBytes > 0 ) ? Stringf( "%lluK", ( unsigned long long ) ( tagStats.m_budgetBytes / 1024 ) ) : "none";
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%s: %lluK live in %llu allocs, %lluK peak, %.0f allocs/s, budget %s",
+			GetMemoryTagName( ( MemoryTag ) tagIndex ), ( unsigned long long ) ( tagStats.m_liveBytes / 1024 ),
+			( unsigned long long ) tagStats.m_numLiveAllocations, ( unsigned long long ) ( tagStats.m_peakBytes / 1024 ),
+			tagStats.m_allocationsPerSecond, budget.c_str() ), tagStats.m_isOverBudget ? Rgba::RED : Rgba::WHITE );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_histogram, allocations made in each size class over the run and in the last frame
+CONSOLE_COMMAND( memory_histogram )
+{
+	UNUSED( args );
+	AllocationCounterTotals totals = GetAllocationCounterTotals();
+	AllocationFrameStats frameStats = GetAllocationFrameStats();
+	for ( int bucketIndex = 0; bucketIndex < NUM_ALLOCATION_SIZE_BUCKETS; ++bucketIndex )
+	{
+		if ( totals.m_sizeHistogram[ bucketIndex ] == 0 )
+		{
+			continue;
+		}
+
+		std::string sizeName = ( bucketIndex < NUM_SLAB_SIZE_CLASSES ) ? Stringf( "<=%u", ( unsigned int ) SlabGetSizeClassBlockSize( bucketIndex ) )
+			: Stringf( ">%u", ( unsigned int ) MAX_SLAB_BLOCK_SIZE );
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%s bytes: %llu allocs, %llu last frame", sizeName.c_str(),
+			totals.m_sizeHistogram[ bucketIndex ], frameStats.m_sizeHistogram[ bucketIndex ] ) );
+	}
+	g_theDeveloperConsole->ConsolePrint( Stringf( "%llu allocs, %llu bytes in total, %.0f allocs/s, %.0fK/s", totals.m_numTotalAllocations,
+		totals.m_totalBytesAllocated, frameStats.m_allocationsPerSecond, frameStats.m_bytesPerSecond / 1024.0f ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_budget <tag> <megabytes>, 0 megabytes removes the budget
+CONSOLE_COMMAND( memory_budget )
+{
+	MemoryTag tag = MEMORY_TAG_UNTAGGED;
+	float budgetMegabytes = -1.0f;
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( budgetMegabytes, args.m_argList[ 1 ] );
+	}
+
+	if ( args.m_argList.size() < 2 || budgetMegabytes < 0.0f || !GetMemoryTagFromName( args.m_argList[ 0 ], tag ) )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_budget <tag> <megabytes>", Rgba::RED );
+		return;
+	}
+
+	SetMemoryTagBudget( tag, ( size_t ) ( budgetMegabytes * 1024.0f * 1024.0f ) );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Budget for %s set to %.1fMB", GetMemoryTagName( tag ), budgetMegabytes ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_frame_check <off|regions|frame> [assert], regions only checks ALLOCATION_FREE_SCOPEs,
+// frame treats every allocation between frame marks as an offender
+CONSOLE_COMMAND( memory_frame_check )
+{
+	bool isValidMode = args.m_argList.size() > 0 && ( args.m_argList[ 0 ] == "off" || args.m_argList[ 0 ] == "regions" || args.m_argList[ 0 ] == "frame" );
+	bool isValidFailureMode = args.m_argList.size() < 2 || args.m_argList[ 1 ] == "assert";
+	if ( !isValidMode || !isValidFailureMode )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_frame_check <off|regions|frame> [assert]", Rgba::RED );
+		return;
+	}
+
+	if ( args.m_argList[ 0 ] == "off" )
+	{
+		SetFrameAllocationChecking( false );
+		g_theDeveloperConsole->ConsolePrint( "Frame allocation checking off" );
+		return;
+	}
+
+	ClearAllocationOffenders();
+	SetWholeFrameAllocationFree( args.m_argList[ 0 ] == "frame" );
+	SetAllocationCheckFailureMode( ( args.m_argList.size() > 1 ) ? ALLOCATION_CHECK_ASSERT : ALLOCATION_CHECK_LOG );
+	SetFrameAllocationChecking( true );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Checking %s for allocations, offenders are %s", ( args.m_argList[ 0 ] == "frame" ) ? "whole frames"
+		: "allocation-free regions", ( args.m_argList.size() > 1 ) ? "errors" : "logged" ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_frame_report [count], the callstacks that allocated most since checking was turned on
+CONSOLE_COMMAND( memory_frame_report )
+{
+	int maxOffenders = 10;
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( maxOffenders, args.m_argList[ 0 ] );
+	}
+
+	if ( maxOffenders <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_frame_report [count]", Rgba::RED );
+		return;
+	}
+
+	PrintAllocationOffenders( maxOffenders );
+}
 #endif
+
+
+//-----------------------------------------------------------------------------------------------
+// callstack_symbols <online|raw>, raw logs module+offset for each frame, symbolize with Tools/Symbolize
+CONSOLE_COMMAND( callstack_symbols )
+{
+	if ( args.m_argList.size() < 1 || ( args.m_argList[ 0 ] != "online" && args.m_argList[ 0 ] != "raw" ) )
+	{
+		CallstackSymbolCacheStats stats = CallstackGetSymbolCacheStats();
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%u addresses cached in %uK, %llu of %llu lookups missed", stats.m_numCachedAddresses,
+			( unsigned int ) ( stats.m_numStringBytes / 1024 ), stats.m_numMisses, stats.m_numLookups ) );
+		g_theDeveloperConsole->ConsolePrint( "Usage: callstack_symbols <online|raw>", Rgba::RED );
+		return;
+	}
+
+	CallstackSetSymbolMode( ( args.m_argList[ 0 ] == "raw" ) ? CALLSTACK_SYMBOLS_RAW_ADDRESSES : CALLSTACK_SYMBOLS_ONLINE );
+	if ( args.m_argList[ 0 ] == "raw" )
+	{
+		CallstackWriteModuleMap( "callstack_modules.txt" );
+		g_theDeveloperConsole->ConsolePrint( "Logging raw callstacks, module map written to callstack_modules.txt" );
+		return;
+	}
+
+	g_theDeveloperConsole->ConsolePrint( "Logging symbolized callstacks" );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// callstack_modules [filename], where each module is loaded this run
+CONSOLE_COMMAND( callstack_modules )
+{
+	std::string filename = ( args.m_argList.size() > 0 ) ? args.m_argList[ 0 ] : "callstack_modules.txt";
+	if ( !CallstackWriteModuleMap( filename.c_str() ) )
+	{
+		g_theDeveloperConsole->ConsolePrint( Stringf( "Couldn't write %s", filename.c_str() ), Rgba::RED );
+		return;
+	}
+
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Module map written to %s", filename.c_str() ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+#ifdef MEMORY_TRACKING
+static HeapSnapshot s_recentSnapshots[ 2 ]; // The last two memory_snapshot took, newest second
+static unsigned int s_numSnapshotsTaken = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+// Top growers to the console, with callstacks to the output window and log
+static void PrintHeapSnapshotDiff( HeapSnapshot const &before, HeapSnapshot const &after, unsigned int maxGroups )
+{
+	std::vector< HeapSnapshotGrowth > growth;
+	DiffHeapSnapshots( before, after, growth );
+
+	std::string summary = Stringf( "Heap grew %+lld bytes, %+lld allocs over %.1fs", ( long long ) ( after.m_totalBytes - before.m_totalBytes ),
+		( long long ) ( after.m_totalAllocations - before.m_totalAllocations ), after.m_captureSeconds - before.m_captureSeconds );
+	g_theDeveloperConsole->ConsolePrint( summary );
+	DebuggerPrintf( "%s\n", summary.c_str() );
+	LoggerPrintfWithTag( "memory", "%s\n", summary.c_str() );
+
+	std::vector< std::string > consoleLines;
+	FormatHeapSnapshotGrowth( growth, maxGroups, 1, consoleLines );
+	for ( unsigned int lineIndex = 0; lineIndex < consoleLines.size(); ++lineIndex )
+	{
+		g_theDeveloperConsole->ConsolePrint( consoleLines[ lineIndex ] );
+	}
+
+	std::vector< std::string > fullLines;
+	FormatHeapSnapshotGrowth( growth, maxGroups, MAX_TRACKED_CALLSTACK_DEPTH, fullLines );
+	for ( unsigned int lineIndex = 0; lineIndex < fullLines.size(); ++lineIndex )
+	{
+		DebuggerPrintf( "%s\n", fullLines[ lineIndex ].c_str() );
+		LoggerPrintfWithTag( "memory", "%s\n", fullLines[ lineIndex ].c_str() );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_snapshot [name]
+CONSOLE_COMMAND( memory_snapshot )
+{
+	std::string name = ( args.m_argList.size() > 0 ) ? args.m_argList[ 0 ] : Stringf( "snapshot_%u", s_numSnapshotsTaken );
+	std::string filename = name + HEAP_SNAPSHOT_EXTENSION;
+
+	s_recentSnapshots[ 0 ] = s_recentSnapshots[ 1 ];
+	CaptureHeapSnapshot( s_recentSnapshots[ 1 ] );
+	++s_numSnapshotsTaken;
+
+	if ( !SaveHeapSnapshot( s_recentSnapshots[ 1 ], filename ) )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Couldn't write " + filename, Rgba::RED );
+		return;
+	}
+
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Saved %s: %u groups", filename.c_str(), ( unsigned int ) s_recentSnapshots[ 1 ].m_groups.size() ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// memory_diff [before after] [count], without files it diffs the last two snapshots taken
+CONSOLE_COMMAND( memory_diff )
+{
+	int maxGroups = 10;
+	if ( args.m_argList.size() == 1 || args.m_argList.size() == 3 )
+	{
+		SetTypeFromString( maxGroups, args.m_argList.back() );
+	}
+
+	if ( maxGroups <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: memory_diff [before after] [count]", Rgba::RED );
+		return;
+	}
+
+	if ( args.m_argList.size() < 2 )
+	{
+		if ( s_numSnapshotsTaken < 2 )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Take two snapshots with memory_snapshot first", Rgba::RED );
+			return;
+		}
+
+		PrintHeapSnapshotDiff( s_recentSnapshots[ 0 ], s_recentSnapshots[ 1 ], maxGroups );
+		return;
+	}
+
+	HeapSnapshot snapshots[ 2 ];
+	for ( int snapshotIndex = 0; snapshotIndex < 2; ++snapshotIndex )
+	{
+		std::string filename = args.m_argList[ snapshotIndex ];
+		if ( filename.find( '.' ) == std::string::npos )
+		{
+			filename += HEAP_SNAPSHOT_EXTENSION;
+		}
+
+		if ( !LoadHeapSnapshot( filename, snapshots[ snapshotIndex ] ) )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Couldn't read " + filename, Rgba::RED );
+			return;
+		}
+	}
+
+	PrintHeapSnapshotDiff( snapshots[ 0 ], snapshots[ 1 ], maxGroups );
+}
 #endif
\ No newline at end of file
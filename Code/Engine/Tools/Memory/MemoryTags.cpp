@@ -0,0 +1,186 @@
+#include <atomic>
+
+#include "Engine/Tools/Memory/MemoryTags.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Enable/disable memory tracking in this file
+
+
+//-----------------------------------------------------------------------------------------------
+static char const* const MEMORY_TAG_NAMES[ NUM_MEMORY_TAGS ] =
+{
+	"untagged",
+	"renderer",
+	"networking",
+	"audio",
+	"ui",
+	"animation",
+	"logging"
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Written from any thread that allocates, so each tag gets its own cache line
+struct alignas( 64 ) MemoryTagCounters
+{
+	std::atomic< uint64_t > m_liveBytes;
+	std::atomic< uint64_t > m_peakBytes;
+	std::atomic< uint64_t > m_numLiveAllocations;
+	std::atomic< uint64_t > m_numTotalAllocations;
+	std::atomic< uint64_t > m_budgetBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Only touched by UpdateMemoryTags
+struct MemoryTagRate
+{
+	uint64_t m_numAllocationsAtWindowStart;
+	float m_allocationsPerSecond;
+	bool m_isOverBudget;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Zero initialized before any constructor runs, operator new can get here first
+static MemoryTagCounters s_tagCounters[ NUM_MEMORY_TAGS ];
+static MemoryTagRate s_tagRates[ NUM_MEMORY_TAGS ];
+static float s_secondsInRateWindow = 0.0f;
+static thread_local MemoryTag t_currentMemoryTag = MEMORY_TAG_UNTAGGED;
+
+
+//-----------------------------------------------------------------------------------------------
+MemoryTagScope::MemoryTagScope( MemoryTag tag )
+	: m_previousTag( t_currentMemoryTag )
+{
+	t_currentMemoryTag = tag;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+MemoryTagScope::~MemoryTagScope()
+{
+	t_currentMemoryTag = m_previousTag;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+MemoryTag GetCurrentMemoryTag()
+{
+	return t_currentMemoryTag;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+char const* GetMemoryTagName( MemoryTag tag )
+{
+	return ( tag < NUM_MEMORY_TAGS ) ? MEMORY_TAG_NAMES[ tag ] : "invalid";
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool GetMemoryTagFromName( std::string const &name, MemoryTag& out_tag )
+{
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS; ++tagIndex )
+	{
+		if ( name == MEMORY_TAG_NAMES[ tagIndex ] )
+		{
+			out_tag = ( MemoryTag ) tagIndex;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RecordTaggedAllocation( MemoryTag tag, size_t numBytes )
+{
+	( void ) tag;
+	( void ) numBytes;
+#ifdef MEMORY_TRACKING
+	MemoryTagCounters& counters = s_tagCounters[ tag ];
+	uint64_t liveBytes = counters.m_liveBytes.fetch_add( numBytes, std::memory_order_relaxed ) + numBytes;
+	counters.m_numLiveAllocations.fetch_add( 1, std::memory_order_relaxed );
+	counters.m_numTotalAllocations.fetch_add( 1, std::memory_order_relaxed );
+
+	uint64_t peakBytes = counters.m_peakBytes.load( std::memory_order_relaxed );
+	while ( liveBytes > peakBytes
+		&& !counters.m_peakBytes.compare_exchange_weak( peakBytes, liveBytes, std::memory_order_relaxed ) );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RecordTaggedFree( MemoryTag tag, size_t numBytes, uint64_t numAllocations )
+{
+	( void ) tag;
+	( void ) numBytes;
+	( void ) numAllocations;
+#ifdef MEMORY_TRACKING
+	MemoryTagCounters& counters = s_tagCounters[ tag ];
+	counters.m_liveBytes.fetch_sub( numBytes, std::memory_order_relaxed );
+	counters.m_numLiveAllocations.fetch_sub( numAllocations, std::memory_order_relaxed );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetMemoryTagBudget( MemoryTag tag, size_t budgetBytes )
+{
+	s_tagCounters[ tag ].m_budgetBytes.store( budgetBytes, std::memory_order_relaxed );
+	s_tagRates[ tag ].m_isOverBudget = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Warns once each time a tag goes over its budget rather than every frame it stays over
+void UpdateMemoryTags( float deltaSeconds )
+{
+	s_secondsInRateWindow += deltaSeconds;
+	bool isRateWindowDone = s_secondsInRateWindow >= 1.0f;
+
+	for ( int tagIndex = 0; tagIndex < NUM_MEMORY_TAGS; ++tagIndex )
+	{
+		MemoryTagCounters& counters = s_tagCounters[ tagIndex ];
+		MemoryTagRate& rate = s_tagRates[ tagIndex ];
+
+		if ( isRateWindowDone )
+		{
+			uint64_t numTotalAllocations = counters.m_numTotalAllocations.load( std::memory_order_relaxed );
+			rate.m_allocationsPerSecond = ( float ) ( numTotalAllocations - rate.m_numAllocationsAtWindowStart ) / s_secondsInRateWindow;
+			rate.m_numAllocationsAtWindowStart = numTotalAllocations;
+		}
+
+		uint64_t budgetBytes = counters.m_budgetBytes.load( std::memory_order_relaxed );
+		uint64_t liveBytes = counters.m_liveBytes.load( std::memory_order_relaxed );
+		bool isOverBudget = ( budgetBytes > 0 ) && ( liveBytes > budgetBytes );
+		if ( isOverBudget && !rate.m_isOverBudget )
+		{
+			LoggerPrintfWithLevel( LOG_RECOVERABLE, "Memory tag %s is over budget: %lluK of %lluK\n", MEMORY_TAG_NAMES[ tagIndex ],
+				( unsigned long long ) ( liveBytes / 1024 ), ( unsigned long long ) ( budgetBytes / 1024 ) );
+		}
+		rate.m_isOverBudget = isOverBudget;
+	}
+
+	if ( isRateWindowDone )
+	{
+		s_secondsInRateWindow = 0.0f;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+MemoryTagStats GetMemoryTagStats( MemoryTag tag )
+{
+	MemoryTagCounters const &counters = s_tagCounters[ tag ];
+	MemoryTagStats stats;
+	stats.m_liveBytes = counters.m_liveBytes.load( std::memory_order_relaxed );
+	stats.m_peakBytes = counters.m_peakBytes.load( std::memory_order_relaxed );
+	stats.m_numLiveAllocations = counters.m_numLiveAllocations.load( std::memory_order_relaxed );
+	stats.m_numTotalAllocations = counters.m_numTotalAllocations.load( std::memory_order_relaxed );
+	stats.m_budgetBytes = counters.m_budgetBytes.load( std::memory_order_relaxed );
+	stats.m_allocationsPerSecond = s_tagRates[ tag ].m_allocationsPerSecond;
+	stats.m_isOverBudget = s_tagRates[ tag ].m_isOverBudget;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+
+//-----------------------------------------------------------------------------------------------
+enum MemoryTag
+{
+	MEMORY_TAG_UNTAGGED = 0,
+	MEMORY_TAG_RENDERER,
+	MEMORY_TAG_NETWORKING,
+	MEMORY_TAG_AUDIO,
+	MEMORY_TAG_UI,
+	MEMORY_TAG_ANIMATION,
+	MEMORY_TAG_LOGGING,
+	NUM_MEMORY_TAGS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct MemoryTagStats
+{
+	uint64_t m_liveBytes;
+	uint64_t m_peakBytes;
+	uint64_t m_numLiveAllocations;
+	uint64_t m_numTotalAllocations;
+	uint64_t m_budgetBytes; // 0 for no budget
+	float m_allocationsPerSecond; // Over the last full second
+	bool m_isOverBudget;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Everything the calling thread allocates while this is alive is counted against the tag, until
+// an inner scope changes it. Scopes nest like the stack.
+class MemoryTagScope
+{
+public:
+	MemoryTagScope( MemoryTag tag );
+	~MemoryTagScope();
+
+private:
+	MemoryTag m_previousTag;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// The tag is per thread. ParallelFor carries it into the jobs it splits the loop into; other jobs
+// start untagged, so put a scope in the job function for work that should count against a tag.
+#define MEMORY_TAG_SCOPE( tag ) MemoryTagScope _memoryTagScope( tag )
+
+
+//-----------------------------------------------------------------------------------------------
+// Counting only happens with MEMORY_TRACKING defined, otherwise the recording calls do nothing.
+// The allocator records the tag with each allocation so it's freed from the same tag no matter
+// which scope frees it.
+MemoryTag GetCurrentMemoryTag();
+char const* GetMemoryTagName( MemoryTag tag );
+bool GetMemoryTagFromName( std::string const &name, MemoryTag& out_tag );
+void RecordTaggedAllocation( MemoryTag tag, size_t numBytes );
+void RecordTaggedFree( MemoryTag tag, size_t numBytes, uint64_t numAllocations = 1 );
+void SetMemoryTagBudget( MemoryTag tag, size_t budgetBytes ); // 0 removes the budget
+void UpdateMemoryTags( float deltaSeconds ); // Once a frame, works out rates and warns about budgets
+MemoryTagStats GetMemoryTagStats( MemoryTag tag );
\ No newline at end of file
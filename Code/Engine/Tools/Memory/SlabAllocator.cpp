@@ -0,0 +1,671 @@
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined( __linux__ )
+#include <sys/mman.h>
+#endif
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <thread>
+
+#include "Engine/Config/BuildConfig.hpp"
+#include "Engine/Tools/Memory/SlabAllocator.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Address space reserved up front for slabs, committed one slab at a time. Running out is not
+// fatal, small blocks then go to the OS like large ones.
+#if UINTPTR_MAX > 0xFFFFFFFF
+const size_t SLAB_REGION_SIZE = ( size_t ) 16 * 1024 * 1024 * 1024;
+#else
+const size_t SLAB_REGION_SIZE = 256 * 1024 * 1024;
+#endif
+const size_t SLAB_HEADER_SIZE = 64; // Blocks start on the cache line after the header
+const size_t LARGE_BLOCK_HEADER_SIZE = 16; // Keeps large blocks 16 byte aligned
+#ifdef MEMORY_TRACKING
+const size_t SLAB_BLOCK_TAG_SIZE = 1; // Between the header and the blocks, one per block
+#else
+const size_t SLAB_BLOCK_TAG_SIZE = 0;
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+struct SlabHeap;
+
+
+//-----------------------------------------------------------------------------------------------
+// Lives at the start of every slab. Only the owning thread touches it, other threads read
+// m_ownerHeap to hand blocks back, which can't change while they hold one of its blocks.
+struct SlabHeader
+{
+	SlabHeader* m_prev; // In the owner's list for this size class while it has free blocks
+	SlabHeader* m_next; // Also links the shared list of empty slabs
+	SlabHeap* m_ownerHeap;
+	void* m_freeList;
+	unsigned char* m_bumpCursor; // Blocks past here have never been handed out
+	unsigned char* m_bumpEnd;
+	unsigned int m_sizeClass;
+	unsigned int m_blockSize;
+	unsigned int m_numUsedBlocks; // Includes blocks freed by other threads until the owner collects them
+	bool m_isInList;
+};
+static_assert( sizeof( SlabHeader ) <= SLAB_HEADER_SIZE, "SlabHeader overlaps the first block" );
+
+
+//-----------------------------------------------------------------------------------------------
+// Per-thread allocation state. Heaps are never destroyed: when a thread exits its heap is parked
+// with all its slabs, and the next new thread adopts it.
+struct SlabHeap
+{
+	SlabHeader* m_availableSlabs[ NUM_SLAB_SIZE_CLASSES ];
+	std::atomic< void* > m_remoteFrees; // Blocks other threads freed, linked through their first word
+	SlabHeap* m_nextParkedHeap;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct LargeBlockHeader
+{
+	size_t m_numBytes; // As asked for, LARGE_BLOCK_HEADER_SIZE more are mapped
+	unsigned char m_tag;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Everything here is constant initialized, operator new can run before any constructor does
+static std::atomic_flag s_slabLock = ATOMIC_FLAG_INIT;
+static std::atomic< uintptr_t > s_regionBegin( 0 );
+static std::atomic< uintptr_t > s_regionEnd( 0 );
+static uintptr_t s_regionCursor = 0; // Guarded by s_slabLock, as is everything below
+static bool s_wasRegionReserved = false;
+static SlabHeader* s_emptySlabs = nullptr;
+static SlabHeap* s_parkedHeaps = nullptr;
+
+static std::atomic< unsigned int > s_numSlabs( 0 );
+static std::atomic< unsigned int > s_numEmptySlabs( 0 );
+static std::atomic< unsigned int > s_numHeaps( 0 );
+static std::atomic< uint64_t > s_numLargeBlocks( 0 );
+static std::atomic< uint64_t > s_largeBytes( 0 );
+
+
+//-----------------------------------------------------------------------------------------------
+static void LockSlabs()
+{
+	while ( s_slabLock.test_and_set( std::memory_order_acquire ) )
+	{
+		std::this_thread::yield();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void UnlockSlabs()
+{
+	s_slabLock.clear( std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* ReserveAddressSpace( size_t numBytes )
+{
+#if defined( _WIN32 )
+	return VirtualAlloc( nullptr, numBytes, MEM_RESERVE, PAGE_NOACCESS );
+#elif defined( __linux__ )
+	void* address = mmap( nullptr, numBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+	return ( address == MAP_FAILED ) ? nullptr : address;
+#else
+	( void ) numBytes;
+	return nullptr;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool CommitAddressSpace( void* address, size_t numBytes )
+{
+#if defined( _WIN32 )
+	return VirtualAlloc( address, numBytes, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+#elif defined( __linux__ )
+	return mprotect( address, numBytes, PROT_READ | PROT_WRITE ) == 0;
+#else
+	( void ) address;
+	( void ) numBytes;
+	return false;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* AllocateFromOS( size_t numBytes )
+{
+#if defined( _WIN32 )
+	return VirtualAlloc( nullptr, numBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+#elif defined( __linux__ )
+	void* address = mmap( nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	return ( address == MAP_FAILED ) ? nullptr : address;
+#else
+	return malloc( numBytes );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FreeToOS( void* address, size_t numBytes )
+{
+#if defined( _WIN32 )
+	( void ) numBytes;
+	VirtualFree( address, 0, MEM_RELEASE );
+#elif defined( __linux__ )
+	munmap( address, numBytes );
+#else
+	( void ) numBytes;
+	free( address );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static unsigned int FindHighestBit( unsigned int value )
+{
+#if defined( _MSC_VER )
+	unsigned long bitIndex;
+	_BitScanReverse( &bitIndex, value );
+	return bitIndex;
+#else
+	return 31 - __builtin_clz( value );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// 16 byte steps up to 128, then four steps per power of two up to MAX_SLAB_BLOCK_SIZE, so no more
+// than a quarter of a block is ever wasted on rounding past 128 bytes
+static int GetSizeClass( size_t numBytes )
+{
+	if ( numBytes <= 128 )
+	{
+		return ( numBytes == 0 ) ? 0 : ( int ) ( ( numBytes + 15 ) >> 4 ) - 1;
+	}
+
+	unsigned int highestBit = FindHighestBit( ( unsigned int ) numBytes - 1 );
+	unsigned int step = ( ( unsigned int ) ( numBytes - 1 ) >> ( highestBit - 2 ) ) & 3;
+	return 8 + ( highestBit - 7 ) * 4 + step;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int SlabGetSizeClass( size_t numBytes )
+{
+	return ( numBytes > MAX_SLAB_BLOCK_SIZE ) ? NUM_SLAB_SIZE_CLASSES : GetSizeClass( numBytes );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t SlabGetSizeClassBlockSize( int sizeClass )
+{
+	if ( sizeClass < 8 )
+	{
+		return ( sizeClass + 1 ) * 16;
+	}
+
+	int group = ( sizeClass - 8 ) / 4;
+	int step = ( sizeClass - 8 ) % 4;
+	return ( ( size_t ) 128 << group ) + ( step + 1 ) * ( ( size_t ) 32 << group );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsInSlabRegion( void* ptr )
+{
+	// The end is published last, so a non-zero end always comes with the right beginning
+	uintptr_t address = ( uintptr_t ) ptr;
+	uintptr_t regionEnd = s_regionEnd.load( std::memory_order_acquire );
+	return address < regionEnd && address >= s_regionBegin.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static SlabHeader* GetSlab( void* ptr )
+{
+	return ( SlabHeader* ) ( ( uintptr_t ) ptr & ~( uintptr_t ) ( SLAB_SIZE - 1 ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Parks the calling thread's heap when the thread exits
+struct SlabHeapHolder
+{
+	~SlabHeapHolder()
+	{
+		if ( m_heap == nullptr )
+		{
+			return;
+		}
+
+		LockSlabs();
+		m_heap->m_nextParkedHeap = s_parkedHeaps;
+		s_parkedHeaps = m_heap;
+		UnlockSlabs();
+
+		m_heap = nullptr;
+		m_wasReleased = true;
+	}
+
+	SlabHeap* m_heap;
+	bool m_wasReleased; // Allocations this late in a thread's exit go to the OS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static thread_local SlabHeapHolder t_slabHeap;
+
+
+//-----------------------------------------------------------------------------------------------
+static SlabHeap* GetThreadHeap()
+{
+	if ( t_slabHeap.m_heap != nullptr || t_slabHeap.m_wasReleased )
+	{
+		return t_slabHeap.m_heap;
+	}
+
+	LockSlabs();
+	SlabHeap* heap = s_parkedHeaps;
+	if ( heap != nullptr )
+	{
+		s_parkedHeaps = heap->m_nextParkedHeap;
+	}
+	UnlockSlabs();
+
+	if ( heap == nullptr )
+	{
+		heap = ( SlabHeap* ) AllocateFromOS( sizeof( SlabHeap ) );
+		if ( heap == nullptr )
+		{
+			return nullptr;
+		}
+
+		for ( int sizeClass = 0; sizeClass < NUM_SLAB_SIZE_CLASSES; ++sizeClass )
+		{
+			heap->m_availableSlabs[ sizeClass ] = nullptr;
+		}
+		new ( &heap->m_remoteFrees ) std::atomic< void* >( nullptr );
+		s_numHeaps.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	heap->m_nextParkedHeap = nullptr;
+	t_slabHeap.m_heap = heap;
+	return heap;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* AllocLargeBlock( size_t numBytes )
+{
+	size_t numMappedBytes = numBytes + LARGE_BLOCK_HEADER_SIZE;
+	LargeBlockHeader* header = ( LargeBlockHeader* ) AllocateFromOS( numMappedBytes );
+	if ( header == nullptr )
+	{
+		return nullptr;
+	}
+
+	header->m_numBytes = numBytes;
+	header->m_tag = 0;
+	s_numLargeBlocks.fetch_add( 1, std::memory_order_relaxed );
+	s_largeBytes.fetch_add( numBytes, std::memory_order_relaxed );
+	return ( unsigned char* ) header + LARGE_BLOCK_HEADER_SIZE;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FreeLargeBlock( void* ptr )
+{
+	LargeBlockHeader* header = ( LargeBlockHeader* ) ( ( unsigned char* ) ptr - LARGE_BLOCK_HEADER_SIZE );
+	s_numLargeBlocks.fetch_sub( 1, std::memory_order_relaxed );
+	s_largeBytes.fetch_sub( header->m_numBytes, std::memory_order_relaxed );
+	FreeToOS( header, header->m_numBytes + LARGE_BLOCK_HEADER_SIZE );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Reuses an empty slab if there is one, otherwise commits the next one in the region
+static SlabHeader* AcquireSlab()
+{
+	LockSlabs();
+
+	SlabHeader* slab = s_emptySlabs;
+	if ( slab != nullptr )
+	{
+		s_emptySlabs = slab->m_next;
+		s_numEmptySlabs.fetch_sub( 1, std::memory_order_relaxed );
+		UnlockSlabs();
+		return slab;
+	}
+
+	if ( !s_wasRegionReserved )
+	{
+		s_wasRegionReserved = true;
+		void* region = ReserveAddressSpace( SLAB_REGION_SIZE + SLAB_SIZE );
+		if ( region != nullptr )
+		{
+			uintptr_t regionBegin = ( ( uintptr_t ) region + SLAB_SIZE - 1 ) & ~( uintptr_t ) ( SLAB_SIZE - 1 );
+			s_regionCursor = regionBegin;
+			s_regionBegin.store( regionBegin, std::memory_order_relaxed );
+			s_regionEnd.store( regionBegin + SLAB_REGION_SIZE, std::memory_order_release );
+		}
+	}
+
+	if ( s_regionCursor == 0 || s_regionCursor >= s_regionEnd.load( std::memory_order_relaxed ) )
+	{
+		UnlockSlabs();
+		return nullptr;
+	}
+
+	slab = ( SlabHeader* ) s_regionCursor;
+	if ( !CommitAddressSpace( slab, SLAB_SIZE ) )
+	{
+		UnlockSlabs();
+		return nullptr;
+	}
+
+	s_regionCursor += SLAB_SIZE;
+	s_numSlabs.fetch_add( 1, std::memory_order_relaxed );
+	UnlockSlabs();
+	return slab;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Stays committed, the next size class to need a slab picks it up
+static void ReleaseSlab( SlabHeader* slab )
+{
+	LockSlabs();
+	slab->m_next = s_emptySlabs;
+	s_emptySlabs = slab;
+	s_numEmptySlabs.fetch_add( 1, std::memory_order_relaxed );
+	UnlockSlabs();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void LinkSlab( SlabHeap* heap, SlabHeader* slab )
+{
+	SlabHeader*& head = heap->m_availableSlabs[ slab->m_sizeClass ];
+	slab->m_prev = nullptr;
+	slab->m_next = head;
+	if ( head != nullptr )
+	{
+		head->m_prev = slab;
+	}
+	head = slab;
+	slab->m_isInList = true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void UnlinkSlab( SlabHeap* heap, SlabHeader* slab )
+{
+	if ( slab->m_prev != nullptr )
+	{
+		slab->m_prev->m_next = slab->m_next;
+	}
+	else
+	{
+		heap->m_availableSlabs[ slab->m_sizeClass ] = slab->m_next;
+	}
+
+	if ( slab->m_next != nullptr )
+	{
+		slab->m_next->m_prev = slab->m_prev;
+	}
+
+	slab->m_prev = nullptr;
+	slab->m_next = nullptr;
+	slab->m_isInList = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Block tags, when there are any, take a cache line aligned run after the header
+static size_t GetNumSlabBlocks( size_t blockSize )
+{
+	return ( SLAB_SIZE - SLAB_HEADER_SIZE * ( 1 + SLAB_BLOCK_TAG_SIZE ) ) / ( blockSize + SLAB_BLOCK_TAG_SIZE );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static size_t GetFirstSlabBlockOffset( size_t blockSize )
+{
+	size_t numTagBytes = GetNumSlabBlocks( blockSize ) * SLAB_BLOCK_TAG_SIZE;
+	return SLAB_HEADER_SIZE + ( ( numTagBytes + SLAB_HEADER_SIZE - 1 ) & ~( SLAB_HEADER_SIZE - 1 ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Blocks are carved lazily, so a fresh slab's pages aren't touched until they're handed out
+static void InitializeSlab( SlabHeader* slab, SlabHeap* heap, int sizeClass )
+{
+	size_t blockSize = SlabGetSizeClassBlockSize( sizeClass );
+	size_t numBlocks = GetNumSlabBlocks( blockSize );
+
+	slab->m_prev = nullptr;
+	slab->m_next = nullptr;
+	slab->m_ownerHeap = heap;
+	slab->m_freeList = nullptr;
+	slab->m_bumpCursor = ( unsigned char* ) slab + GetFirstSlabBlockOffset( blockSize );
+	slab->m_bumpEnd = slab->m_bumpCursor + numBlocks * blockSize;
+	slab->m_sizeClass = sizeClass;
+	slab->m_blockSize = ( unsigned int ) blockSize;
+	slab->m_numUsedBlocks = 0;
+	slab->m_isInList = false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Slabs in a heap's lists always have a block to give, full ones drop out until one is freed
+static void* TakeBlock( SlabHeap* heap, SlabHeader* slab )
+{
+	void* block = slab->m_freeList;
+	if ( block != nullptr )
+	{
+		slab->m_freeList = *( void** ) block;
+	}
+	else
+	{
+		block = slab->m_bumpCursor;
+		slab->m_bumpCursor += slab->m_blockSize;
+	}
+
+	++slab->m_numUsedBlocks;
+	if ( slab->m_freeList == nullptr && slab->m_bumpCursor == slab->m_bumpEnd )
+	{
+		UnlinkSlab( heap, slab );
+	}
+
+	return block;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FreeLocal( SlabHeap* heap, SlabHeader* slab, void* ptr )
+{
+	*( void** ) ptr = slab->m_freeList;
+	slab->m_freeList = ptr;
+	--slab->m_numUsedBlocks;
+
+	if ( !slab->m_isInList )
+	{
+		LinkSlab( heap, slab );
+	}
+	else if ( slab->m_numUsedBlocks == 0 && ( slab->m_prev != nullptr || slab->m_next != nullptr ) )
+	{
+		// Keep one slab per size class around so alloc/free at the edge doesn't bounce slabs
+		UnlinkSlab( heap, slab );
+		ReleaseSlab( slab );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CollectRemoteFrees( SlabHeap* heap )
+{
+	if ( heap->m_remoteFrees.load( std::memory_order_relaxed ) == nullptr )
+	{
+		return;
+	}
+
+	void* block = heap->m_remoteFrees.exchange( nullptr, std::memory_order_acquire );
+	while ( block != nullptr )
+	{
+		void* nextBlock = *( void** ) block;
+		FreeLocal( heap, GetSlab( block ), block );
+		block = nextBlock;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* AllocSlow( SlabHeap* heap, size_t numBytes, int sizeClass )
+{
+	CollectRemoteFrees( heap );
+
+	SlabHeader* slab = heap->m_availableSlabs[ sizeClass ];
+	if ( slab == nullptr )
+	{
+		slab = AcquireSlab();
+		if ( slab == nullptr )
+		{
+			return AllocLargeBlock( numBytes );
+		}
+
+		InitializeSlab( slab, heap, sizeClass );
+		LinkSlab( heap, slab );
+	}
+
+	return TakeBlock( heap, slab );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* SlabAlloc( size_t numBytes )
+{
+	if ( numBytes > MAX_SLAB_BLOCK_SIZE )
+	{
+		return AllocLargeBlock( numBytes );
+	}
+
+	SlabHeap* heap = GetThreadHeap();
+	if ( heap == nullptr )
+	{
+		return AllocLargeBlock( numBytes );
+	}
+
+	int sizeClass = GetSizeClass( numBytes );
+	SlabHeader* slab = heap->m_availableSlabs[ sizeClass ];
+	if ( slab == nullptr )
+	{
+		return AllocSlow( heap, numBytes, sizeClass );
+	}
+
+	return TakeBlock( heap, slab );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SlabFree( void* ptr )
+{
+	if ( ptr == nullptr )
+	{
+		return;
+	}
+
+	if ( !IsInSlabRegion( ptr ) )
+	{
+		FreeLargeBlock( ptr );
+		return;
+	}
+
+	SlabHeader* slab = GetSlab( ptr );
+	SlabHeap* ownerHeap = slab->m_ownerHeap;
+	if ( ownerHeap == t_slabHeap.m_heap )
+	{
+		FreeLocal( ownerHeap, slab, ptr );
+		return;
+	}
+
+	// Hand it back to the owner, it collects these the next time it runs out
+	void* head = ownerHeap->m_remoteFrees.load( std::memory_order_relaxed );
+	do
+	{
+		*( void** ) ptr = head;
+	}
+	while ( !ownerHeap->m_remoteFrees.compare_exchange_weak( head, ptr, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t SlabGetBlockSize( void* ptr )
+{
+	if ( IsInSlabRegion( ptr ) )
+	{
+		return GetSlab( ptr )->m_blockSize;
+	}
+
+	LargeBlockHeader* header = ( LargeBlockHeader* ) ( ( unsigned char* ) ptr - LARGE_BLOCK_HEADER_SIZE );
+	return header->m_numBytes;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Where the block's tag lives, or null for a slab block in a build without tags
+static unsigned char* GetBlockTag( void* ptr )
+{
+	if ( !IsInSlabRegion( ptr ) )
+	{
+		LargeBlockHeader* header = ( LargeBlockHeader* ) ( ( unsigned char* ) ptr - LARGE_BLOCK_HEADER_SIZE );
+		return &header->m_tag;
+	}
+
+	if ( SLAB_BLOCK_TAG_SIZE == 0 )
+	{
+		return nullptr;
+	}
+
+	SlabHeader* slab = GetSlab( ptr );
+	size_t blockOffset = ( unsigned char* ) ptr - ( unsigned char* ) slab - GetFirstSlabBlockOffset( slab->m_blockSize );
+	size_t blockIndex = blockOffset / slab->m_blockSize;
+	return ( unsigned char* ) slab + SLAB_HEADER_SIZE + blockIndex;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SlabSetBlockTag( void* ptr, unsigned char tag )
+{
+	unsigned char* blockTag = GetBlockTag( ptr );
+	if ( blockTag != nullptr )
+	{
+		*blockTag = tag;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned char SlabGetBlockTag( void* ptr )
+{
+	unsigned char* blockTag = GetBlockTag( ptr );
+	return ( blockTag != nullptr ) ? *blockTag : 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SlabAllocatorStats GetSlabAllocatorStats()
+{
+	SlabAllocatorStats stats;
+	stats.m_numSlabs = s_numSlabs.load( std::memory_order_relaxed );
+	stats.m_numEmptySlabs = s_numEmptySlabs.load( std::memory_order_relaxed );
+	stats.m_numHeaps = s_numHeaps.load( std::memory_order_relaxed );
+	stats.m_numLargeBlocks = s_numLargeBlocks.load( std::memory_order_relaxed );
+	stats.m_largeBytes = s_largeBytes.load( std::memory_order_relaxed );
+	return stats;
+}
\ No newline at end of file
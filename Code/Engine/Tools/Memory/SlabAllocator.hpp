@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t SLAB_SIZE = 256 * 1024; // Slabs are aligned to their size, so a block finds its slab by masking
+const size_t MAX_SLAB_BLOCK_SIZE = 32 * 1024; // Anything bigger goes straight to the OS
+const int NUM_SLAB_SIZE_CLASSES = 40; // 16 byte steps to 128, then four per power of two
+
+
+//-----------------------------------------------------------------------------------------------
+struct SlabAllocatorStats
+{
+	unsigned int m_numSlabs; // Committed, in use or empty
+	unsigned int m_numEmptySlabs; // Waiting to be reused by any size class
+	unsigned int m_numHeaps; // One per thread that has allocated, kept for reuse after it exits
+	uint64_t m_numLargeBlocks;
+	uint64_t m_largeBytes;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// General purpose allocator for the global operator new when ENGINE_ALLOCATOR is defined. Small
+// blocks come from size-class slabs owned by the allocating thread, so the common case takes no
+// lock and no atomic. Blocks freed by another thread are handed back to the owner to reuse.
+// Blocks carry no header: the size class lives in the slab they were carved from.
+void* SlabAlloc( size_t numBytes );
+void SlabFree( void* ptr );
+size_t SlabGetBlockSize( void* ptr ); // Usable size, at least what was asked for
+void SlabSetBlockTag( void* ptr, unsigned char tag ); // One byte kept beside the block, for memory tags. Slab blocks only have one with MEMORY_TRACKING.
+unsigned char SlabGetBlockTag( void* ptr ); // Zero until set
+int SlabGetSizeClass( size_t numBytes ); // NUM_SLAB_SIZE_CLASSES for anything too big for a slab
+size_t SlabGetSizeClassBlockSize( int sizeClass );
+SlabAllocatorStats GetSlabAllocatorStats();
\ No newline at end of file
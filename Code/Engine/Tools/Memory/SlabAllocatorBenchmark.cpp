@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Engine/Tools/Memory/SlabAllocatorBenchmark.hpp"
+#include "Engine/Tools/Memory/SlabAllocator.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int SLAB_BENCHMARK_BATCH_SIZE = 256; // Objects per frame, or per hand off between threads
+const unsigned int SLAB_BENCHMARK_LIVE_SET_SIZE = 4096;
+const unsigned int DEFAULT_SLAB_BENCHMARK_ALLOCS = 1000000;
+
+
+//-----------------------------------------------------------------------------------------------
+typedef void* ( *BenchmarkAllocFunction )( size_t numBytes );
+typedef void ( *BenchmarkFreeFunction )( void* ptr );
+
+
+//-----------------------------------------------------------------------------------------------
+static uint32_t NextRandom( uint32_t& state )
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Mostly small objects like messages, joints, render commands and named properties, some strings
+// and small arrays, and the odd vertex buffer
+static unsigned int GetEngineLikeSize( uint32_t& state )
+{
+	unsigned int bucket = NextRandom( state ) % 100;
+	unsigned int random = NextRandom( state );
+
+	if ( bucket < 40 )
+	{
+		return 16 + random % 48;
+	}
+	else if ( bucket < 70 )
+	{
+		return 64 + random % 192;
+	}
+	else if ( bucket < 90 )
+	{
+		return 256 + random % 1792;
+	}
+	else if ( bucket < 99 )
+	{
+		return 2048 + random % 30720;
+	}
+
+	return 32768 + random % 229376;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Sizes are generated up front, so both allocators replay exactly the same trace
+static void GenerateTrace( unsigned int threadIndex, unsigned int numAllocs, std::vector< unsigned int >& out_sizes )
+{
+	uint32_t state = 0x9E3779B9 ^ ( threadIndex * 7919 + 1 );
+	out_sizes.resize( numAllocs );
+	for ( unsigned int allocIndex = 0; allocIndex < numAllocs; ++allocIndex )
+	{
+		out_sizes[ allocIndex ] = GetEngineLikeSize( state );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* TouchBlock( void* ptr, unsigned int value )
+{
+	*( unsigned char* ) ptr = ( unsigned char ) value;
+	return ptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void RunFrameTemporaries( std::vector< unsigned int > const &sizes, BenchmarkAllocFunction allocFunction,
+	BenchmarkFreeFunction freeFunction )
+{
+	void* batch[ SLAB_BENCHMARK_BATCH_SIZE ];
+	unsigned int numAllocs = ( unsigned int ) sizes.size();
+
+	for ( unsigned int allocIndex = 0; allocIndex + SLAB_BENCHMARK_BATCH_SIZE <= numAllocs; allocIndex += SLAB_BENCHMARK_BATCH_SIZE )
+	{
+		for ( unsigned int batchIndex = 0; batchIndex < SLAB_BENCHMARK_BATCH_SIZE; ++batchIndex )
+		{
+			batch[ batchIndex ] = TouchBlock( allocFunction( sizes[ allocIndex + batchIndex ] ), batchIndex );
+		}
+
+		for ( unsigned int batchIndex = 0; batchIndex < SLAB_BENCHMARK_BATCH_SIZE; ++batchIndex )
+		{
+			freeFunction( batch[ batchIndex ] );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void RunLongLivedChurn( std::vector< unsigned int > const &sizes, BenchmarkAllocFunction allocFunction,
+	BenchmarkFreeFunction freeFunction )
+{
+	void* liveSet[ SLAB_BENCHMARK_LIVE_SET_SIZE ] = {};
+	unsigned int numAllocs = ( unsigned int ) sizes.size();
+	uint32_t state = numAllocs | 1;
+
+	for ( unsigned int allocIndex = 0; allocIndex < numAllocs; ++allocIndex )
+	{
+		unsigned int slotIndex = NextRandom( state ) % SLAB_BENCHMARK_LIVE_SET_SIZE;
+		freeFunction( liveSet[ slotIndex ] );
+		liveSet[ slotIndex ] = TouchBlock( allocFunction( sizes[ allocIndex ] ), allocIndex );
+	}
+
+	for ( unsigned int slotIndex = 0; slotIndex < SLAB_BENCHMARK_LIVE_SET_SIZE; ++slotIndex )
+	{
+		freeFunction( liveSet[ slotIndex ] );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Each thread fills a batch, hands it to the next thread over and frees the batch it's handed
+static void RunCrossThread( std::vector< unsigned int > const &sizes, BenchmarkAllocFunction allocFunction,
+	BenchmarkFreeFunction freeFunction, std::atomic< void** >* ownMailbox, std::atomic< void** >* nextMailbox )
+{
+	void* batch[ SLAB_BENCHMARK_BATCH_SIZE ];
+	unsigned int numAllocs = ( unsigned int ) sizes.size();
+
+	for ( unsigned int allocIndex = 0; allocIndex + SLAB_BENCHMARK_BATCH_SIZE <= numAllocs; allocIndex += SLAB_BENCHMARK_BATCH_SIZE )
+	{
+		while ( nextMailbox->load( std::memory_order_acquire ) != nullptr )
+		{
+			std::this_thread::yield();
+		}
+
+		for ( unsigned int batchIndex = 0; batchIndex < SLAB_BENCHMARK_BATCH_SIZE; ++batchIndex )
+		{
+			batch[ batchIndex ] = TouchBlock( allocFunction( sizes[ allocIndex + batchIndex ] ), batchIndex );
+		}
+		nextMailbox->store( batch, std::memory_order_release );
+
+		void** receivedBatch;
+		while ( ( receivedBatch = ownMailbox->load( std::memory_order_acquire ) ) == nullptr )
+		{
+			std::this_thread::yield();
+		}
+
+		for ( unsigned int batchIndex = 0; batchIndex < SLAB_BENCHMARK_BATCH_SIZE; ++batchIndex )
+		{
+			freeFunction( receivedBatch[ batchIndex ] );
+		}
+		ownMailbox->store( nullptr, std::memory_order_release );
+	}
+
+	// The last batch handed to us has to be freed before anyone leaves, it lives on our stack
+	while ( nextMailbox->load( std::memory_order_acquire ) != nullptr )
+	{
+		std::this_thread::yield();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Returns the wall time from releasing the threads until the last one finishes
+double BenchmarkSlabAllocator( SlabBenchmarkTrace trace, bool useSlabAllocator, unsigned int numThreads, unsigned int numAllocsPerThread )
+{
+	ASSERT_OR_DIE( trace >= 0 && trace < NUM_SLAB_BENCHMARK_TRACES, "Unknown slab benchmark trace" );
+
+	BenchmarkAllocFunction allocFunction = useSlabAllocator ? SlabAlloc : malloc;
+	BenchmarkFreeFunction freeFunction = useSlabAllocator ? SlabFree : free;
+
+	std::vector< std::vector< unsigned int > > traceSizes( numThreads );
+	std::vector< std::atomic< void** > > mailboxes( numThreads );
+	for ( unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex )
+	{
+		GenerateTrace( threadIndex, numAllocsPerThread, traceSizes[ threadIndex ] );
+		mailboxes[ threadIndex ].store( nullptr );
+	}
+
+	std::atomic< bool > isStarted( false );
+	std::atomic< unsigned int > numThreadsReady( 0 );
+
+	auto benchmarkThread = [ & ]( unsigned int threadIndex )
+	{
+		numThreadsReady++;
+		while ( !isStarted.load( std::memory_order_acquire ) )
+		{
+			std::this_thread::yield();
+		}
+
+		std::vector< unsigned int > const &sizes = traceSizes[ threadIndex ];
+		switch ( trace )
+		{
+			case SLAB_TRACE_FRAME_TEMPORARIES:
+				RunFrameTemporaries( sizes, allocFunction, freeFunction );
+				break;
+			case SLAB_TRACE_LONG_LIVED_CHURN:
+				RunLongLivedChurn( sizes, allocFunction, freeFunction );
+				break;
+			case SLAB_TRACE_CROSS_THREAD:
+				RunCrossThread( sizes, allocFunction, freeFunction, &mailboxes[ threadIndex ], &mailboxes[ ( threadIndex + 1 ) % numThreads ] );
+				break;
+			default:
+				break;
+		}
+	};
+
+	std::vector< std::thread > threads;
+	for ( unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex )
+	{
+		threads.push_back( std::thread( benchmarkThread, threadIndex ) );
+	}
+
+	while ( numThreadsReady.load() < numThreads )
+	{
+		std::this_thread::yield();
+	}
+
+	double startSeconds = GetCurrentTimeSeconds();
+	isStarted.store( true, std::memory_order_release );
+	for ( unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex )
+	{
+		threads[ threadIndex ].join();
+	}
+
+	return GetCurrentTimeSeconds() - startSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Prints nanoseconds per alloc and free pair for malloc and the slab allocator on each trace
+void RunSlabAllocatorBenchmark( unsigned int maxThreads, unsigned int numAllocsPerThread )
+{
+	const char* TRACE_NAMES[ NUM_SLAB_BENCHMARK_TRACES ] = { "frame", "churn", "cross-thread" };
+
+	std::string header = Stringf( "Slab allocator benchmark: %u allocs per thread, ns per alloc+free (malloc/slab)", numAllocsPerThread );
+	LoggerPrintfWithTag( "memory", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	for ( unsigned int numThreads = 1; numThreads <= maxThreads; ++numThreads )
+	{
+		std::string result = Stringf( "%2u threads:", numThreads );
+		for ( int traceIndex = 0; traceIndex < NUM_SLAB_BENCHMARK_TRACES; ++traceIndex )
+		{
+			double mallocSeconds = BenchmarkSlabAllocator( ( SlabBenchmarkTrace ) traceIndex, false, numThreads, numAllocsPerThread );
+			double slabSeconds = BenchmarkSlabAllocator( ( SlabBenchmarkTrace ) traceIndex, true, numThreads, numAllocsPerThread );
+
+			// Threads run side by side, so this is the time per pair as seen by one thread
+			result += Stringf( " %s %.1f/%.1f", TRACE_NAMES[ traceIndex ], mallocSeconds * 1000000000.0 / numAllocsPerThread,
+				slabSeconds * 1000000000.0 / numAllocsPerThread );
+		}
+
+		LoggerPrintfWithTag( "memory", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+
+	SlabAllocatorStats stats = GetSlabAllocatorStats();
+	std::string statsLine = Stringf( "Slabs: %u committed (%u empty), %u heaps, %u large blocks", stats.m_numSlabs, stats.m_numEmptySlabs,
+		stats.m_numHeaps, ( unsigned int ) stats.m_numLargeBlocks );
+	LoggerPrintfWithTag( "memory", "%s\n", statsLine.c_str() );
+	g_theDeveloperConsole->ConsolePrint( statsLine );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// slab_benchmark [maxThreads] [allocsPerThread]
+CONSOLE_COMMAND( slab_benchmark )
+{
+	int maxThreads = std::thread::hardware_concurrency();
+	int numAllocsPerThread = DEFAULT_SLAB_BENCHMARK_ALLOCS;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( maxThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( numAllocsPerThread, args.m_argList[ 1 ] );
+	}
+
+	if ( maxThreads <= 0 || numAllocsPerThread <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: slab_benchmark [maxThreads] [allocsPerThread]", Rgba::RED );
+		return;
+	}
+
+	RunSlabAllocatorBenchmark( maxThreads, numAllocsPerThread );
+}
\ No newline at end of file
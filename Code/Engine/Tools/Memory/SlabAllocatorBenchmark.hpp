@@ -0,0 +1,16 @@
+#pragma once
+
+
+//-----------------------------------------------------------------------------------------------
+enum SlabBenchmarkTrace
+{
+	SLAB_TRACE_FRAME_TEMPORARIES = 0, // Allocated during a frame, all freed at the end of it
+	SLAB_TRACE_LONG_LIVED_CHURN, // A large live set where random objects are replaced
+	SLAB_TRACE_CROSS_THREAD, // Allocated on one thread, freed on another, like job results
+	NUM_SLAB_BENCHMARK_TRACES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+double BenchmarkSlabAllocator( SlabBenchmarkTrace trace, bool useSlabAllocator, unsigned int numThreads, unsigned int numAllocsPerThread );
+void RunSlabAllocatorBenchmark( unsigned int maxThreads, unsigned int numAllocsPerThread );
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <new>
+
+#include "Engine/Tools/Jobs/JobAllocator.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Thread safe ObjectPool. Any thread may allocate or delete, objects may be deleted on a different
+// thread than allocated them, and the pool grows a page at a time instead of running dry. Slots
+// are packed to T's own alignment unless cache line alignment is asked for, which keeps objects
+// used by different threads from sharing a line.
+template < typename T >
+class ConcurrentObjectPool
+{
+public:
+	static_assert( alignof( T ) <= JOB_CACHE_LINE_SIZE, "Pooled objects can't be over-aligned" );
+
+	explicit ConcurrentObjectPool( bool isCacheLineAligned = false )
+		: m_allocator( sizeof( T ), isCacheLineAligned ? JOB_CACHE_LINE_SIZE : alignof( T ) )
+	{
+	}
+
+	// Optional, the pool grows on demand either way
+	void Initialize( const size_t& numberOfObjects )
+	{
+		m_allocator.Reserve( ( unsigned int ) numberOfObjects );
+	}
+
+	// Every object must have been deleted first
+	void Shutdown()
+	{
+		m_allocator.Shutdown();
+	}
+
+	T* Alloc()
+	{
+		return new ( m_allocator.Alloc() ) T();
+	}
+
+	void Delete( T* t )
+	{
+		t->~T();
+		m_allocator.Free( t );
+	}
+
+	JobAllocatorStats GetStats() const
+	{
+		return m_allocator.GetStats();
+	}
+
+private:
+	JobAllocator m_allocator;
+};
\ No newline at end of file
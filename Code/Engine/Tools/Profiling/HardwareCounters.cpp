@@ -0,0 +1,247 @@
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined( __linux__ )
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+#include <atomic>
+
+#include "Engine/Tools/Profiling/HardwareCounters.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+static char const* HARDWARE_COUNTER_NAMES[ NUM_HARDWARE_COUNTERS ] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+
+
+//-----------------------------------------------------------------------------------------------
+// m_groupIndices is where each counter lands in a group read, or -1 if it couldn't be opened.
+// Closing the leader doesn't close the rest of the group, so every counter keeps its own fd.
+struct ThreadHardwareCounters
+{
+	ThreadHardwareCounters();
+	~ThreadHardwareCounters();
+
+	bool m_hasTriedToOpen;
+	int m_groupFd;
+	int m_counterFds[ NUM_HARDWARE_COUNTERS ];
+	int m_groupIndices[ NUM_HARDWARE_COUNTERS ];
+	unsigned int m_numOpenCounters;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic< bool > s_isCounting( false );
+static thread_local ThreadHardwareCounters t_counters;
+
+
+//-----------------------------------------------------------------------------------------------
+ThreadHardwareCounters::ThreadHardwareCounters()
+	: m_hasTriedToOpen( false )
+	, m_groupFd( -1 )
+	, m_numOpenCounters( 0 )
+{
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		m_counterFds[ counterIndex ] = -1;
+		m_groupIndices[ counterIndex ] = -1;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// When the thread exits
+ThreadHardwareCounters::~ThreadHardwareCounters()
+{
+#if defined( __linux__ )
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		if ( m_counterFds[ counterIndex ] != -1 )
+		{
+			close( m_counterFds[ counterIndex ] );
+		}
+	}
+#endif
+}
+
+
+#if defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+static int OpenPerfCounter( uint32_t type, uint64_t config, int groupFd )
+{
+	perf_event_attr attributes;
+	memset( &attributes, 0, sizeof( attributes ) );
+	attributes.size = sizeof( attributes );
+	attributes.type = type;
+	attributes.config = config;
+	attributes.disabled = ( groupFd == -1 ) ? 1 : 0; // The leader starts the whole group once it's built
+	attributes.exclude_kernel = 1; // Allowed at the default perf_event_paranoid level
+	attributes.exclude_hv = 1;
+	attributes.read_format = PERF_FORMAT_GROUP;
+
+	return ( int ) syscall( __NR_perf_event_open, &attributes, 0, -1, groupFd, 0 );
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static void OpenThreadHardwareCounters()
+{
+	t_counters.m_hasTriedToOpen = true;
+
+#if defined( _WIN32 )
+	t_counters.m_groupIndices[ HARDWARE_COUNTER_CYCLES ] = 0;
+	t_counters.m_numOpenCounters = 1;
+#elif defined( __linux__ )
+	uint32_t types[ NUM_HARDWARE_COUNTERS ] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+	uint64_t configs[ NUM_HARDWARE_COUNTERS ] =
+	{
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	// Whatever the CPU or VM doesn't support is left out of the group
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		int counterFd = OpenPerfCounter( types[ counterIndex ], configs[ counterIndex ], t_counters.m_groupFd );
+		if ( counterFd < 0 )
+		{
+			continue;
+		}
+
+		if ( t_counters.m_groupFd == -1 )
+		{
+			t_counters.m_groupFd = counterFd;
+		}
+		t_counters.m_counterFds[ counterIndex ] = counterFd;
+		t_counters.m_groupIndices[ counterIndex ] = ( int ) t_counters.m_numOpenCounters++;
+	}
+
+	if ( t_counters.m_groupFd != -1 )
+	{
+		ioctl( t_counters.m_groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+		ioctl( t_counters.m_groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+	}
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetHardwareCounting( bool isEnabled )
+{
+	s_isCounting.store( isEnabled, std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool IsHardwareCounting()
+{
+	return s_isCounting.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool ReadHardwareCounters( HardwareCounterValues& out_values )
+{
+	if ( !s_isCounting.load( std::memory_order_relaxed ) )
+	{
+		return false;
+	}
+
+	if ( !t_counters.m_hasTriedToOpen )
+	{
+		OpenThreadHardwareCounters();
+	}
+
+	if ( t_counters.m_numOpenCounters == 0 )
+	{
+		return false;
+	}
+
+	memset( &out_values, 0, sizeof( out_values ) );
+
+#if defined( _WIN32 )
+	ULONG64 cycles = 0;
+	QueryThreadCycleTime( GetCurrentThread(), &cycles );
+	out_values.m_values[ HARDWARE_COUNTER_CYCLES ] = cycles;
+	return true;
+#elif defined( __linux__ )
+	// A group read is the number of counters followed by their values
+	uint64_t groupValues[ 1 + NUM_HARDWARE_COUNTERS ];
+	ssize_t numBytesRead = read( t_counters.m_groupFd, groupValues, sizeof( groupValues ) );
+	if ( numBytesRead < ( ssize_t ) ( ( 1 + t_counters.m_numOpenCounters ) * sizeof( uint64_t ) ) )
+	{
+		return false;
+	}
+
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		int groupIndex = t_counters.m_groupIndices[ counterIndex ];
+		if ( groupIndex >= 0 )
+		{
+			out_values.m_values[ counterIndex ] = groupValues[ 1 + groupIndex ];
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool IsHardwareCounterAvailable( HardwareCounter counter )
+{
+	if ( !t_counters.m_hasTriedToOpen )
+	{
+		OpenThreadHardwareCounters();
+	}
+
+	return t_counters.m_groupIndices[ counter ] >= 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+char const* GetHardwareCounterName( HardwareCounter counter )
+{
+	return HARDWARE_COUNTER_NAMES[ counter ];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// profile_counters [on|off]
+CONSOLE_COMMAND( profile_counters )
+{
+	std::string subCommand = args.m_argList.empty() ? "" : args.m_argList[ 0 ];
+	if ( subCommand == "on" || subCommand == "off" )
+	{
+		SetHardwareCounting( subCommand == "on" );
+	}
+	else if ( !subCommand.empty() )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: profile_counters [on|off]", Rgba::RED );
+		return;
+	}
+
+	std::string availableCounters;
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		if ( IsHardwareCounterAvailable( ( HardwareCounter ) counterIndex ) )
+		{
+			availableCounters += availableCounters.empty() ? "" : ", ";
+			availableCounters += GetHardwareCounterName( ( HardwareCounter ) counterIndex );
+		}
+	}
+
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Hardware counting is %s, counting %s", IsHardwareCounting() ? "on" : "off",
+		availableCounters.empty() ? "nothing on this machine" : availableCounters.c_str() ) );
+}
\ No newline at end of file
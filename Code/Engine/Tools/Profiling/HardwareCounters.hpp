@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------------------------
+enum HardwareCounter
+{
+	HARDWARE_COUNTER_CYCLES = 0,
+	HARDWARE_COUNTER_INSTRUCTIONS,
+	HARDWARE_COUNTER_L1D_MISSES, // Level 1 data cache read misses
+	HARDWARE_COUNTER_LLC_MISSES, // Last level cache misses
+	HARDWARE_COUNTER_BRANCH_MISSES,
+	NUM_HARDWARE_COUNTERS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct HardwareCounterValues
+{
+	uint64_t m_values[ NUM_HARDWARE_COUNTERS ];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// The calling thread's user mode counters. Linux reads them all as one perf_event_open group.
+// Windows has no user mode access to the PMU, so only cycles are counted, from
+// QueryThreadCycleTime, and the rest read as zero. A thread opens its counters the first time
+// it reads one while counting is on, and they stay open until it exits. Each read is a system
+// call on Linux, so counting is for investigating a scope rather than leaving on.
+void SetHardwareCounting( bool isEnabled );
+bool IsHardwareCounting();
+bool ReadHardwareCounters( HardwareCounterValues& out_values ); // False if not counting or nothing could be opened
+bool IsHardwareCounterAvailable( HardwareCounter counter ); // On the calling thread, opening its counters if need be
+char const* GetHardwareCounterName( HardwareCounter counter );
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Engine/Tools/Profiling/HitchDetector.hpp"
+#include "Engine/Tools/Profiling/ProfileEvents.hpp"
+#include "Engine/Tools/Profiling/ProfileReport.hpp"
+#include "Engine/Tools/Memory/AllocationCounters.hpp"
+#include "Engine/Tools/Jobs/JobSystem.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Enable/disable profiling in this file
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int HITCH_WARMUP_FRAMES = 60; // Before the median means anything
+const unsigned int HITCH_CAPTURE_COOLDOWN_FRAMES = 120;
+const unsigned int NUM_HITCH_WORST_SCOPES = 10;
+
+
+//-----------------------------------------------------------------------------------------------
+struct HitchScopeTotals
+{
+	char const* m_tag;
+	uint64_t m_numCalls;
+	uint64_t m_exclusiveCycles;
+	double m_averageMilliseconds; // Over the report window
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Main thread only
+static float s_frameMilliseconds[ HITCH_HISTORY_FRAMES ];
+static unsigned int s_histogram[ HITCH_HISTOGRAM_BUCKETS ];
+static unsigned int s_numHistoryFrames = 0;
+static unsigned int s_nextHistoryIndex = 0;
+static float s_budgetMilliseconds = DEFAULT_HITCH_BUDGET_MILLISECONDS;
+static float s_medianMultiple = DEFAULT_HITCH_MEDIAN_MULTIPLE;
+#ifdef PROGRAM_PROFILING
+static bool s_isCaptureEnabled = true;
+#else
+static bool s_isCaptureEnabled = false;
+#endif
+static unsigned int s_maxCaptures = DEFAULT_MAX_HITCH_CAPTURES;
+static uint64_t s_numFramesSeen = 0;
+static uint64_t s_lastCaptureFrame = 0;
+static uint64_t s_numHitches = 0;
+static uint64_t s_numCaptures = 0;
+static AllocationCounterTotals s_allocationTotalsAtFrameStart;
+
+
+//-----------------------------------------------------------------------------------------------
+static unsigned int GetHistogramBucket( float frameMilliseconds )
+{
+	unsigned int bucketIndex = ( unsigned int ) ( frameMilliseconds / HITCH_HISTOGRAM_BUCKET_MILLISECONDS );
+	return std::min( bucketIndex, HITCH_HISTOGRAM_BUCKETS - 1 );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// The upper edge of the bucket the percentile lands in
+static float GetHistogramPercentile( float percentile )
+{
+	if ( s_numHistoryFrames == 0 )
+	{
+		return 0.0f;
+	}
+
+	unsigned int rank = std::max( 1u, ( unsigned int ) ( percentile * s_numHistoryFrames + 0.5f ) );
+	unsigned int numFramesBelow = 0;
+	for ( unsigned int bucketIndex = 0; bucketIndex < HITCH_HISTOGRAM_BUCKETS; ++bucketIndex )
+	{
+		numFramesBelow += s_histogram[ bucketIndex ];
+		if ( numFramesBelow >= rank )
+		{
+			return ( bucketIndex + 1 ) * HITCH_HISTOGRAM_BUCKET_MILLISECONDS;
+		}
+	}
+
+	return HITCH_HISTOGRAM_BUCKETS * HITCH_HISTOGRAM_BUCKET_MILLISECONDS;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AddFrameToHistogram( float frameMilliseconds )
+{
+	if ( s_numHistoryFrames == HITCH_HISTORY_FRAMES )
+	{
+		s_histogram[ GetHistogramBucket( s_frameMilliseconds[ s_nextHistoryIndex ] ) ]--;
+	}
+	else
+	{
+		s_numHistoryFrames++;
+	}
+
+	s_frameMilliseconds[ s_nextHistoryIndex ] = frameMilliseconds;
+	s_histogram[ GetHistogramBucket( frameMilliseconds ) ]++;
+	s_nextHistoryIndex = ( s_nextHistoryIndex + 1 ) % HITCH_HISTORY_FRAMES;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AddToScopeTotals( ProfileSample* sample, std::map< std::string, HitchScopeTotals >& scopeTotals )
+{
+	HitchScopeTotals& totals = scopeTotals[ sample->tag ];
+	totals.m_tag = sample->tag;
+	totals.m_numCalls++;
+	totals.m_exclusiveCycles += sample->GetSelfCycles();
+
+	for ( ProfileSample* childSample = sample->firstChildSample; childSample != nullptr; childSample = childSample->nextSample )
+	{
+		AddToScopeTotals( childSample, scopeTotals );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsWorseThanUsual( HitchScopeTotals const &first, HitchScopeTotals const &second )
+{
+	double firstExcess = PerformanceCountToSeconds( first.m_exclusiveCycles ) * 1000.0 - first.m_averageMilliseconds;
+	double secondExcess = PerformanceCountToSeconds( second.m_exclusiveCycles ) * 1000.0 - second.m_averageMilliseconds;
+	return firstExcess > secondExcess;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Every tag in the frame by how far its exclusive time was over its average in the report
+// window, which hasn't taken this frame yet
+static void WriteWorstScopes( std::ofstream& captureFile, ProfileFrameView const &frameView )
+{
+	std::map< std::string, HitchScopeTotals > scopeTotals;
+	for ( unsigned int laneIndex = 0; laneIndex < frameView.m_lanes.size(); ++laneIndex )
+	{
+		for ( ProfileSample* rootSample = frameView.m_lanes[ laneIndex ].m_firstRootSample; rootSample != nullptr; rootSample = rootSample->nextSample )
+		{
+			AddToScopeTotals( rootSample, scopeTotals );
+		}
+	}
+
+	std::vector< ProfileScopeStats > reportScopes;
+	GetProfileReport( PROFILE_REPORT_FLAT, reportScopes );
+
+	std::vector< HitchScopeTotals > worstScopes;
+	for ( std::map< std::string, HitchScopeTotals >::iterator totalsIter = scopeTotals.begin(); totalsIter != scopeTotals.end(); ++totalsIter )
+	{
+		HitchScopeTotals totals = totalsIter->second;
+		totals.m_averageMilliseconds = 0.0;
+		for ( unsigned int scopeIndex = 0; scopeIndex < reportScopes.size(); ++scopeIndex )
+		{
+			if ( reportScopes[ scopeIndex ].m_name == totalsIter->first )
+			{
+				totals.m_averageMilliseconds = reportScopes[ scopeIndex ].m_exclusive.m_average;
+				break;
+			}
+		}
+		worstScopes.push_back( totals );
+	}
+
+	std::sort( worstScopes.begin(), worstScopes.end(), IsWorseThanUsual );
+	if ( worstScopes.size() > NUM_HITCH_WORST_SCOPES )
+	{
+		worstScopes.resize( NUM_HITCH_WORST_SCOPES );
+	}
+
+	captureFile << Stringf( "Worst scopes, exclusive ms this frame against the average over %u frames:\n", GetProfileReportNumFrames() );
+	for ( unsigned int scopeIndex = 0; scopeIndex < worstScopes.size(); ++scopeIndex )
+	{
+		HitchScopeTotals const &totals = worstScopes[ scopeIndex ];
+		double frameMilliseconds = PerformanceCountToSeconds( totals.m_exclusiveCycles ) * 1000.0;
+		captureFile << Stringf( "  %-36s %9.3f %9.3f %+9.3f %6llu calls\n", totals.m_tag, frameMilliseconds, totals.m_averageMilliseconds,
+			frameMilliseconds - totals.m_averageMilliseconds, totals.m_numCalls );
+	}
+	captureFile << "\n";
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void WriteSampleTree( std::ofstream& captureFile, ProfileSample* sample, unsigned int depth )
+{
+	std::string label = std::string( depth * 2, ' ' ) + sample->tag;
+	captureFile << Stringf( "%-48s %9.3f %9.3f\n", label.c_str(), sample->GetSeconds() * 1000.0,
+		PerformanceCountToSeconds( sample->GetSelfCycles() ) * 1000.0 );
+
+	for ( ProfileSample* childSample = sample->firstChildSample; childSample != nullptr; childSample = childSample->nextSample )
+	{
+		WriteSampleTree( captureFile, childSample, depth + 1 );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CaptureHitch( uint64_t frameNumber, float frameMilliseconds, float medianMilliseconds, ProfileFrameView const* frameView,
+	AllocationCounterTotals const &allocationTotals )
+{
+	std::string captureName = Stringf( "Hitch_%llu", frameNumber );
+	std::ofstream captureFile( ( captureName + ".txt" ).c_str(), std::ios::binary );
+	if ( !captureFile.is_open() )
+	{
+		LoggerPrintfWithTag( "profiler", "Couldn't write %s.txt\n", captureName.c_str() );
+		return;
+	}
+
+	captureFile << Stringf( "Hitch on frame %llu: %.3fms, budget %.3fms, median %.3fms\n\n", frameNumber, frameMilliseconds,
+		s_budgetMilliseconds, medianMilliseconds );
+
+#ifdef MEMORY_TRACKING
+	captureFile << Stringf( "Allocations during the frame: %llu, %llu bytes\n\n",
+		allocationTotals.m_numTotalAllocations - s_allocationTotalsAtFrameStart.m_numTotalAllocations,
+		allocationTotals.m_totalBytesAllocated - s_allocationTotalsAtFrameStart.m_totalBytesAllocated );
+#else
+	UNUSED( allocationTotals );
+	captureFile << "Allocations during the frame: not counted, build with MEMORY_TRACKING\n\n";
+#endif
+
+	// Everything recorded since the frame started, and a median frame before it for context
+	double traceSeconds = ( frameMilliseconds + medianMilliseconds ) / 1000.0;
+	if ( ExportProfileEventsChromeTrace( ( captureName + ".json" ).c_str(), traceSeconds ) )
+	{
+		captureFile << "Profile events: " << captureName << ".json\n";
+	}
+
+	// Exporting stops the job trace. Restarting it here would reset rings the workers are still
+	// writing, so only the first capture after job_trace start gets a timeline.
+	if ( g_theJobSystem != nullptr && g_theJobSystem->m_telemetry.IsRecording() )
+	{
+		if ( g_theJobSystem->m_telemetry.ExportChromeTrace( captureName + "_jobs.json" ) )
+		{
+			captureFile << "Job timeline: " << captureName << "_jobs.json\n";
+		}
+	}
+	else
+	{
+		captureFile << "Job timeline: not recording, use job_trace start to capture the next one\n";
+	}
+	captureFile << "\n";
+
+	if ( frameView == nullptr )
+	{
+		captureFile << "Profiling was off for this frame, use toggle_profiling to capture its scopes.\n";
+	}
+	else
+	{
+		WriteWorstScopes( captureFile, *frameView );
+
+		captureFile << Stringf( "%-48s %9s %9s\n", "Frame tree", "incl ms", "excl ms" );
+		for ( unsigned int laneIndex = 0; laneIndex < frameView->m_lanes.size(); ++laneIndex )
+		{
+			ProfileLane const &lane = frameView->m_lanes[ laneIndex ];
+			captureFile << lane.m_threadName << "\n";
+			for ( ProfileSample* rootSample = lane.m_firstRootSample; rootSample != nullptr; rootSample = rootSample->nextSample )
+			{
+				WriteSampleTree( captureFile, rootSample, 1 );
+			}
+		}
+	}
+
+	s_numCaptures++;
+	LoggerPrintfWithTag( "profiler", "Hitch on frame %llu took %.3fms, captured to %s.txt\n", frameNumber, frameMilliseconds, captureName.c_str() );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool HitchDetectorFrameMark( uint64_t frameNumber, uint64_t frameCycles, ProfileFrameView const* frameView )
+{
+	float frameMilliseconds = ( float ) ( PerformanceCountToSeconds( frameCycles ) * 1000.0 );
+	float medianMilliseconds = GetHistogramPercentile( 0.5f );
+	AllocationCounterTotals allocationTotals = GetAllocationCounterTotals();
+
+	// Judged against the frames before it
+	bool isHitch = false;
+	if ( s_numFramesSeen >= HITCH_WARMUP_FRAMES )
+	{
+		bool isOverBudget = ( s_budgetMilliseconds > 0.0f && frameMilliseconds > s_budgetMilliseconds );
+		bool isOverMedian = ( s_medianMultiple > 0.0f && frameMilliseconds > medianMilliseconds * s_medianMultiple );
+		isHitch = isOverBudget || isOverMedian;
+	}
+
+	AddFrameToHistogram( frameMilliseconds );
+	s_numFramesSeen++;
+
+	bool wasCaptured = false;
+	if ( isHitch )
+	{
+		s_numHitches++;
+		bool isUnderLimit = ( s_maxCaptures == 0 || s_numCaptures < s_maxCaptures );
+		if ( s_isCaptureEnabled && isUnderLimit && ( s_numCaptures == 0 || frameNumber >= s_lastCaptureFrame + HITCH_CAPTURE_COOLDOWN_FRAMES ) )
+		{
+			CaptureHitch( frameNumber, frameMilliseconds, medianMilliseconds, frameView, allocationTotals );
+			s_lastCaptureFrame = frameNumber;
+			wasCaptured = true;
+
+			if ( s_numCaptures == s_maxCaptures )
+			{
+				LoggerPrintfWithTag( "profiler", "Captured %u hitches, the limit for this session, see profile_hitch limit\n", s_maxCaptures );
+			}
+		}
+	}
+
+	s_allocationTotalsAtFrameStart = allocationTotals;
+	return wasCaptured;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetHitchBudget( float milliseconds )
+{
+	s_budgetMilliseconds = milliseconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetHitchMedianMultiple( float medianMultiple )
+{
+	s_medianMultiple = medianMultiple;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetHitchCapture( bool isEnabled )
+{
+	s_isCaptureEnabled = isEnabled;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetHitchMaxCaptures( unsigned int maxCaptures )
+{
+	s_maxCaptures = maxCaptures;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+FrameTimeStats GetFrameTimeStats()
+{
+	FrameTimeStats stats;
+	stats.m_numFrames = s_numHistoryFrames;
+	stats.m_median = GetHistogramPercentile( 0.5f );
+	stats.m_p95 = GetHistogramPercentile( 0.95f );
+	stats.m_p99 = GetHistogramPercentile( 0.99f );
+	stats.m_max = 0.0f;
+	for ( unsigned int frameIndex = 0; frameIndex < s_numHistoryFrames; ++frameIndex )
+	{
+		stats.m_max = std::max( stats.m_max, s_frameMilliseconds[ frameIndex ] );
+	}
+	stats.m_numHitches = s_numHitches;
+	stats.m_numCaptures = s_numCaptures;
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void GetFrameTimeHistogram( unsigned int* out_buckets )
+{
+	for ( unsigned int bucketIndex = 0; bucketIndex < HITCH_HISTOGRAM_BUCKETS; ++bucketIndex )
+	{
+		out_buckets[ bucketIndex ] = s_histogram[ bucketIndex ];
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// profile_hitch [budget <ms>|multiple <x>|capture <on|off>|limit <captures>]
+CONSOLE_COMMAND( profile_hitch )
+{
+	std::string subCommand = args.m_argList.empty() ? "" : args.m_argList[ 0 ];
+	std::string value = ( args.m_argList.size() > 1 ) ? args.m_argList[ 1 ] : "";
+
+	if ( subCommand == "budget" && !value.empty() )
+	{
+		float milliseconds = 0.0f;
+		SetTypeFromString( milliseconds, value );
+		SetHitchBudget( milliseconds );
+	}
+	else if ( subCommand == "multiple" && !value.empty() )
+	{
+		float medianMultiple = 0.0f;
+		SetTypeFromString( medianMultiple, value );
+		SetHitchMedianMultiple( medianMultiple );
+	}
+	else if ( subCommand == "capture" && ( value == "on" || value == "off" ) )
+	{
+		SetHitchCapture( value == "on" );
+	}
+	else if ( subCommand == "limit" && !value.empty() )
+	{
+		int maxCaptures = 0;
+		SetTypeFromString( maxCaptures, value );
+		SetHitchMaxCaptures( ( unsigned int ) std::max( maxCaptures, 0 ) );
+	}
+	else if ( !subCommand.empty() )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: profile_hitch [budget <ms>|multiple <x>|capture <on|off>|limit <captures>]", Rgba::RED );
+		return;
+	}
+
+	FrameTimeStats stats = GetFrameTimeStats();
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Last %u frames: median %.1fms, p95 %.1fms, p99 %.1fms, max %.1fms", stats.m_numFrames,
+		stats.m_median, stats.m_p95, stats.m_p99, stats.m_max ) );
+	std::string captureLimit = ( s_maxCaptures > 0 ) ? Stringf( " of %u", s_maxCaptures ) : " (no limit)";
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Hitch over %.1fms or %.1fx the median, %llu hitches, %llu captured%s, capture %s",
+		s_budgetMilliseconds, s_medianMultiple, stats.m_numHitches, stats.m_numCaptures, captureLimit.c_str(), s_isCaptureEnabled ? "on" : "off" ) );
+
+	// Bars in 2ms steps, each # is 1% of the frames
+	unsigned int buckets[ HITCH_HISTOGRAM_BUCKETS ];
+	GetFrameTimeHistogram( buckets );
+	unsigned int bucketsPerBar = ( unsigned int ) ( 2.0f / HITCH_HISTOGRAM_BUCKET_MILLISECONDS );
+	for ( unsigned int firstBucket = 0; firstBucket < HITCH_HISTOGRAM_BUCKETS; firstBucket += bucketsPerBar )
+	{
+		unsigned int numFrames = 0;
+		for ( unsigned int bucketIndex = firstBucket; bucketIndex < firstBucket + bucketsPerBar && bucketIndex < HITCH_HISTOGRAM_BUCKETS; ++bucketIndex )
+		{
+			numFrames += buckets[ bucketIndex ];
+		}
+
+		if ( numFrames == 0 )
+		{
+			continue;
+		}
+
+		unsigned int barLength = std::max( 1u, numFrames * 100 / std::max( 1u, stats.m_numFrames ) );
+		bool isLastBar = ( firstBucket + bucketsPerBar >= HITCH_HISTOGRAM_BUCKETS );
+		g_theDeveloperConsole->ConsolePrint( Stringf( "%5.0fms%s %5u %s", firstBucket * HITCH_HISTOGRAM_BUCKET_MILLISECONDS, isLastBar ? "+" : " ",
+			numFrames, std::string( barLength, '#' ).c_str() ) );
+	}
+}
\ No newline at end of file
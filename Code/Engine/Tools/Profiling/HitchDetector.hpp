@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Engine/Tools/Profiling/Profiler.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int HITCH_HISTORY_FRAMES = 600; // Frames in the rolling histogram
+const unsigned int HITCH_HISTOGRAM_BUCKETS = 200; // The last one holds everything past the others
+const float HITCH_HISTOGRAM_BUCKET_MILLISECONDS = 0.5f;
+const float DEFAULT_HITCH_BUDGET_MILLISECONDS = 50.0f;
+const float DEFAULT_HITCH_MEDIAN_MULTIPLE = 2.0f;
+const unsigned int DEFAULT_MAX_HITCH_CAPTURES = 10; // Per session
+
+
+//-----------------------------------------------------------------------------------------------
+// Over the frames in the histogram. Percentiles are to the bucket, the max is exact.
+struct FrameTimeStats
+{
+	unsigned int m_numFrames;
+	float m_median;
+	float m_p95;
+	float m_p99;
+	float m_max;
+	uint64_t m_numHitches; // Since startup
+	uint64_t m_numCaptures;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Times every frame between ProfileFrameMark calls into a rolling histogram. A frame over the
+// budget, or over a multiple of the median, is a hitch. With capture on, a hitch writes
+// Hitch_<frame>.txt with the worst scopes against their usual cost, the frame's allocation
+// counts and its profile tree, plus Chrome traces of the profile events around it. The job
+// timeline is only included while job_trace is recording, and exporting it stops the recording,
+// so it comes with the first capture after a job_trace start. Captures are spaced out so a long slowdown doesn't write one every frame, and stop
+// at a limit so a long slowdown, such as loading, doesn't keep writing them.
+bool HitchDetectorFrameMark( uint64_t frameNumber, uint64_t frameCycles, ProfileFrameView const* frameView ); // True if it spent time capturing
+void SetHitchBudget( float milliseconds ); // 0 for no fixed budget
+void SetHitchMedianMultiple( float medianMultiple ); // 0 to ignore the median
+void SetHitchCapture( bool isEnabled );
+void SetHitchMaxCaptures( unsigned int maxCaptures ); // 0 for no limit
+FrameTimeStats GetFrameTimeStats();
+void GetFrameTimeHistogram( unsigned int* out_buckets ); // HITCH_HISTOGRAM_BUCKETS counts
\ No newline at end of file
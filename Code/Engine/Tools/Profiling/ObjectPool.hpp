@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
 
 //-----------------------------------------------------------------------------------------------
 struct PageNode
@@ -9,14 +11,17 @@ struct PageNode
 
 
 //-----------------------------------------------------------------------------------------------
+// Fixed size and single threaded, see ConcurrentObjectPool for a pool that grows and can be
+// shared between threads
 template < typename T >
 class ObjectPool
 {
 public:
+	static_assert( sizeof( T ) >= sizeof( PageNode ), "Pooled objects must be big enough to hold a free list link" );
+
 	void Initialize( const size_t& numberOfObjects )
 	{
 		size_t bufferSize = sizeof( T ) * numberOfObjects;
-		/*ASSERT( sizeof( T ) >= sizeof( page_node ) );*/
 		m_buffer = ( T* ) malloc( bufferSize );
 		m_freeStack = nullptr;
 
@@ -36,6 +41,8 @@ public:
 
 	T* Alloc()
 	{
+		ASSERT_OR_DIE( m_freeStack != nullptr, "Object pool is out of objects!" );
+
 		T* t = ( T* ) m_freeStack;
 		m_freeStack = m_freeStack->nextNode;
 		new ( t ) T();
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Engine/Tools/Profiling/ObjectPoolBenchmark.hpp"
+#include "Engine/Tools/Profiling/ObjectPool.hpp"
+#include "Engine/Tools/Profiling/ConcurrentObjectPool.hpp"
+#include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+// Objects each thread holds at once, roughly a frame's worth of profile samples on one thread
+const unsigned int POOL_BENCHMARK_BATCH_SIZE = 64;
+const unsigned int DEFAULT_POOL_BENCHMARK_ALLOCS = 1000000;
+
+
+//-----------------------------------------------------------------------------------------------
+// Every thread allocates a batch, writes to each object, then frees the batch, over and over.
+// Returns the wall time from releasing the threads until the last one finishes.
+template < typename AllocFunction, typename FreeFunction >
+static double TimePoolThreads( unsigned int numThreads, unsigned int numAllocsPerThread, AllocFunction const &allocFunction,
+	FreeFunction const &freeFunction )
+{
+	std::atomic< bool > isStarted( false );
+	std::atomic< unsigned int > numThreadsReady( 0 );
+
+	auto poolThread = [ & ]()
+	{
+		ProfileSample* batch[ POOL_BENCHMARK_BATCH_SIZE ];
+
+		numThreadsReady++;
+		while ( !isStarted.load( std::memory_order_acquire ) )
+		{
+			std::this_thread::yield();
+		}
+
+		for ( unsigned int allocIndex = 0; allocIndex < numAllocsPerThread; allocIndex += POOL_BENCHMARK_BATCH_SIZE )
+		{
+			for ( unsigned int batchIndex = 0; batchIndex < POOL_BENCHMARK_BATCH_SIZE; ++batchIndex )
+			{
+				batch[ batchIndex ] = allocFunction();
+				batch[ batchIndex ]->startTime = allocIndex + batchIndex;
+			}
+
+			for ( unsigned int batchIndex = 0; batchIndex < POOL_BENCHMARK_BATCH_SIZE; ++batchIndex )
+			{
+				freeFunction( batch[ batchIndex ] );
+			}
+		}
+	};
+
+	std::vector< std::thread > threads;
+	for ( unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex )
+	{
+		threads.push_back( std::thread( poolThread ) );
+	}
+
+	while ( numThreadsReady.load() < numThreads )
+	{
+		std::this_thread::yield();
+	}
+
+	double startSeconds = GetCurrentTimeSeconds();
+	isStarted.store( true, std::memory_order_release );
+	for ( unsigned int threadIndex = 0; threadIndex < numThreads; ++threadIndex )
+	{
+		threads[ threadIndex ].join();
+	}
+
+	return GetCurrentTimeSeconds() - startSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Pools hand out profile samples, the objects g_samplePool holds
+double BenchmarkObjectPool( PoolBenchmarkAllocator allocator, unsigned int numThreads, unsigned int numAllocsPerThread )
+{
+	switch ( allocator )
+	{
+		case POOL_BENCHMARK_MALLOC:
+		{
+			return TimePoolThreads( numThreads, numAllocsPerThread,
+				[]() { return new ( malloc( sizeof( ProfileSample ) ) ) ProfileSample(); },
+				[]( ProfileSample* sample ) { sample->~ProfileSample(); free( sample ); } );
+		}
+
+		case POOL_BENCHMARK_LOCKED_OBJECT_POOL:
+		{
+			ObjectPool< ProfileSample > objectPool;
+			objectPool.Initialize( numThreads * POOL_BENCHMARK_BATCH_SIZE );
+			std::mutex poolLock;
+
+			double elapsedSeconds = TimePoolThreads( numThreads, numAllocsPerThread,
+				[ & ]() { std::lock_guard< std::mutex > lock( poolLock ); return objectPool.Alloc(); },
+				[ & ]( ProfileSample* sample ) { std::lock_guard< std::mutex > lock( poolLock ); objectPool.Delete( sample ); } );
+
+			objectPool.Shutdown();
+			return elapsedSeconds;
+		}
+
+		case POOL_BENCHMARK_CONCURRENT_POOL:
+		case POOL_BENCHMARK_CONCURRENT_POOL_ALIGNED:
+		{
+			ConcurrentObjectPool< ProfileSample > concurrentPool( allocator == POOL_BENCHMARK_CONCURRENT_POOL_ALIGNED );
+
+			double elapsedSeconds = TimePoolThreads( numThreads, numAllocsPerThread,
+				[ & ]() { return concurrentPool.Alloc(); },
+				[ & ]( ProfileSample* sample ) { concurrentPool.Delete( sample ); } );
+
+			concurrentPool.Shutdown();
+			return elapsedSeconds;
+		}
+
+		default:
+		{
+			ERROR_AND_DIE( "Unknown pool benchmark allocator" );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Prints nanoseconds per alloc and free pair for each allocator, for 1 to maxThreads threads
+void RunObjectPoolBenchmark( unsigned int maxThreads, unsigned int numAllocsPerThread )
+{
+	const char* ALLOCATOR_NAMES[ NUM_POOL_BENCHMARK_ALLOCATORS ] = { "malloc", "locked pool", "concurrent", "aligned" };
+
+	std::string header = Stringf( "Object pool benchmark: %u allocs per thread, ns per alloc+free", numAllocsPerThread );
+	LoggerPrintfWithTag( "memory", "%s\n", header.c_str() );
+	g_theDeveloperConsole->ConsolePrint( header );
+
+	for ( unsigned int numThreads = 1; numThreads <= maxThreads; ++numThreads )
+	{
+		std::string result = Stringf( "%2u threads:", numThreads );
+		for ( int allocatorIndex = 0; allocatorIndex < NUM_POOL_BENCHMARK_ALLOCATORS; ++allocatorIndex )
+		{
+			double elapsedSeconds = BenchmarkObjectPool( ( PoolBenchmarkAllocator ) allocatorIndex, numThreads, numAllocsPerThread );
+
+			// Threads run side by side, so this is the time per pair as seen by one thread
+			double nanosecondsPerAlloc = elapsedSeconds * 1000000000.0 / numAllocsPerThread;
+			result += Stringf( " %s %.1f", ALLOCATOR_NAMES[ allocatorIndex ], nanosecondsPerAlloc );
+		}
+
+		LoggerPrintfWithTag( "memory", "%s\n", result.c_str() );
+		g_theDeveloperConsole->ConsolePrint( result );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// pool_benchmark [maxThreads] [allocsPerThread]
+CONSOLE_COMMAND( pool_benchmark )
+{
+	int maxThreads = std::thread::hardware_concurrency();
+	int numAllocsPerThread = DEFAULT_POOL_BENCHMARK_ALLOCS;
+
+	if ( args.m_argList.size() > 0 )
+	{
+		SetTypeFromString( maxThreads, args.m_argList[ 0 ] );
+	}
+
+	if ( args.m_argList.size() > 1 )
+	{
+		SetTypeFromString( numAllocsPerThread, args.m_argList[ 1 ] );
+	}
+
+	if ( maxThreads <= 0 || numAllocsPerThread <= 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: pool_benchmark [maxThreads] [allocsPerThread]", Rgba::RED );
+		return;
+	}
+
+	RunObjectPoolBenchmark( maxThreads, numAllocsPerThread );
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+
+//-----------------------------------------------------------------------------------------------
+enum PoolBenchmarkAllocator
+{
+	POOL_BENCHMARK_MALLOC = 0,
+	POOL_BENCHMARK_LOCKED_OBJECT_POOL, // ObjectPool behind a mutex, it can't be shared otherwise
+	POOL_BENCHMARK_CONCURRENT_POOL,
+	POOL_BENCHMARK_CONCURRENT_POOL_ALIGNED, // Slots padded to a cache line
+	NUM_POOL_BENCHMARK_ALLOCATORS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+double BenchmarkObjectPool( PoolBenchmarkAllocator allocator, unsigned int numThreads, unsigned int numAllocsPerThread );
+void RunObjectPoolBenchmark( unsigned int maxThreads, unsigned int numAllocsPerThread );
\ No newline at end of file
@@ -0,0 +1,410 @@
+#include <intrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Engine/Tools/Profiling/ProfileEvents.hpp"
+#include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Config/BuildConfig.hpp" // Enable/disable profiling in this file
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t MAX_PROFILE_EVENT_THREAD_NAME_LENGTH = 64;
+static const char* DEFAULT_PROFILE_TRACE_FILE = "ProfileTrace.json";
+
+
+//-----------------------------------------------------------------------------------------------
+// Only the owning thread writes events. The ring is allocated the first time it records.
+struct ProfileEventThread
+{
+	char m_threadName[ MAX_PROFILE_EVENT_THREAD_NAME_LENGTH ];
+	unsigned int m_threadIndex;
+	ProfileEvent* m_events;
+	std::atomic< uint64_t > m_writeIndex;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Frees the thread's ring when it exits, its events aren't exported after that
+struct ProfileEventThreadHolder
+{
+	~ProfileEventThreadHolder();
+
+	ProfileEventThread* m_eventThread;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic< bool > s_isRecording( false );
+static std::atomic< char const* > s_tags[ MAX_PROFILE_EVENT_TAGS ];
+static std::mutex s_eventThreadsLock;
+static std::vector< ProfileEventThread* > s_eventThreads;
+static unsigned int s_numEventThreads = 0; // Ever registered, so exported thread IDs aren't reused
+static thread_local ProfileEventThreadHolder t_eventThread;
+static uint64_t s_recordingStartTimestamp = 0; // Against the performance count, to convert time stamps to seconds
+static uint64_t s_recordingStartCount = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+// Registers the calling thread the first time it records or is named
+static ProfileEventThread* GetProfileEventThread()
+{
+	if ( t_eventThread.m_eventThread != nullptr )
+	{
+		return t_eventThread.m_eventThread;
+	}
+
+	ProfileEventThread* eventThread = new ProfileEventThread();
+	eventThread->m_events = nullptr;
+	eventThread->m_writeIndex.store( 0, std::memory_order_relaxed );
+
+	s_eventThreadsLock.lock();
+	eventThread->m_threadIndex = s_numEventThreads++;
+	snprintf( eventThread->m_threadName, MAX_PROFILE_EVENT_THREAD_NAME_LENGTH, "Thread %u", eventThread->m_threadIndex );
+	s_eventThreads.push_back( eventThread );
+	s_eventThreadsLock.unlock();
+
+	t_eventThread.m_eventThread = eventThread;
+	return eventThread;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Unlinked under the lock, so an export never reads a ring that's been freed
+ProfileEventThreadHolder::~ProfileEventThreadHolder()
+{
+	ProfileEventThread* eventThread = m_eventThread;
+	if ( eventThread == nullptr )
+	{
+		return;
+	}
+
+	s_eventThreadsLock.lock();
+	s_eventThreads.erase( std::find( s_eventThreads.begin(), s_eventThreads.end(), eventThread ) );
+	s_eventThreadsLock.unlock();
+
+	free( eventThread->m_events );
+	delete eventThread;
+	m_eventThread = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Thread names and tags can hold anything, a quote or backslash would otherwise break the file
+static std::string EscapeJsonString( char const* text )
+{
+	std::string escapedText;
+	for ( char const* character = text; *character != '\0'; ++character )
+	{
+		if ( *character == '"' || *character == '\\' )
+		{
+			escapedText += '\\';
+			escapedText += *character;
+		}
+		else if ( ( unsigned char ) *character < 0x20 )
+		{
+			escapedText += Stringf( "\\u%04x", ( unsigned int ) ( unsigned char ) *character );
+		}
+		else
+		{
+			escapedText += *character;
+		}
+	}
+	return escapedText;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static double TimestampToMicroseconds( uint64_t timestamp, uint64_t originTimestamp, double timestampsPerSecond )
+{
+	if ( timestamp <= originTimestamp )
+	{
+		return 0.0;
+	}
+
+	return ( double ) ( timestamp - originTimestamp ) / timestampsPerSecond * 1000000.0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileEventsStartup()
+{
+	for ( unsigned int tagIndex = 0; tagIndex < MAX_PROFILE_EVENT_TAGS; ++tagIndex )
+	{
+		s_tags[ tagIndex ].store( nullptr, std::memory_order_relaxed );
+	}
+
+#ifdef PROGRAM_PROFILING
+	StartRecordingProfileEvents();
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileEventsShutdown()
+{
+	s_isRecording.store( false );
+
+	s_eventThreadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < s_eventThreads.size(); ++threadIndex )
+	{
+		free( s_eventThreads[ threadIndex ]->m_events );
+		delete s_eventThreads[ threadIndex ];
+	}
+	s_eventThreads.clear();
+	s_eventThreadsLock.unlock();
+	t_eventThread.m_eventThread = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void StartRecordingProfileEvents()
+{
+	s_isRecording.store( false );
+
+	s_eventThreadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < s_eventThreads.size(); ++threadIndex )
+	{
+		s_eventThreads[ threadIndex ]->m_writeIndex.store( 0, std::memory_order_relaxed );
+	}
+	s_recordingStartTimestamp = __rdtsc();
+	s_recordingStartCount = GetCurrentPerformanceCount();
+	s_isRecording.store( true, std::memory_order_release );
+	s_eventThreadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// What was recorded stays until the next start
+void StopRecordingProfileEvents()
+{
+	s_isRecording.store( false );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool IsRecordingProfileEvents()
+{
+	return s_isRecording.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RecordProfileEvent( ProfileEventType type, char const* tag )
+{
+	if ( !s_isRecording.load( std::memory_order_acquire ) )
+	{
+		return;
+	}
+
+	ProfileEventThread* eventThread = GetProfileEventThread();
+	if ( eventThread->m_events == nullptr )
+	{
+		// Not operator new, so the allocation checker doesn't see it
+		eventThread->m_events = ( ProfileEvent* ) malloc( PROFILE_EVENT_RING_SIZE * sizeof( ProfileEvent ) );
+	}
+
+	uint64_t writeIndex = eventThread->m_writeIndex.load( std::memory_order_relaxed );
+	ProfileEvent& newEvent = eventThread->m_events[ writeIndex & ( PROFILE_EVENT_RING_SIZE - 1 ) ];
+	newEvent.m_timestamp = __rdtsc();
+	newEvent.m_tagId = GetProfileEventTagId( tag );
+	newEvent.m_type = ( uint32_t ) type;
+	eventThread->m_writeIndex.store( writeIndex + 1, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Names the calling thread's lane in exported traces
+void SetProfileEventsThreadName( char const* threadName )
+{
+	ProfileEventThread* eventThread = GetProfileEventThread();
+
+	s_eventThreadsLock.lock();
+	strncpy( eventThread->m_threadName, threadName, MAX_PROFILE_EVENT_THREAD_NAME_LENGTH - 1 );
+	eventThread->m_threadName[ MAX_PROFILE_EVENT_THREAD_NAME_LENGTH - 1 ] = '\0';
+	s_eventThreadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Open addressing on the tag's address, with no lock. A slot never changes once claimed, so
+// lookups after the first are a hash and a load.
+uint32_t GetProfileEventTagId( char const* tag )
+{
+	uintptr_t hash = ( ( uintptr_t ) tag >> 3 ) * 0x9E3779B9u;
+	for ( unsigned int probe = 0; probe < MAX_PROFILE_EVENT_TAGS; ++probe )
+	{
+		uint32_t tagId = ( uint32_t ) ( ( hash + probe ) & ( MAX_PROFILE_EVENT_TAGS - 1 ) );
+		char const* slotTag = s_tags[ tagId ].load( std::memory_order_acquire );
+		if ( slotTag == tag )
+		{
+			return tagId;
+		}
+
+		if ( slotTag == nullptr )
+		{
+			if ( s_tags[ tagId ].compare_exchange_strong( slotTag, tag, std::memory_order_acq_rel ) || slotTag == tag )
+			{
+				return tagId;
+			}
+		}
+	}
+
+	return PROFILE_EVENT_UNKNOWN_TAG;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Writes Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev both open, one lane
+// per thread. Each ring is copied before it's read, and whatever its thread wrote over during
+// the copy is dropped, as is anything recorded after the export started. Ends whose begin fell
+// out of the ring are dropped too, and scopes still open are closed at the time of the export.
+bool ExportProfileEventsChromeTrace( char const* filePath, double windowSeconds )
+{
+	uint64_t exportTimestamp = __rdtsc();
+	uint64_t exportCount = GetCurrentPerformanceCount();
+	if ( s_recordingStartCount == 0 || exportCount == s_recordingStartCount )
+	{
+		return false;
+	}
+
+	std::ofstream traceFile( filePath, std::ios::binary );
+	if ( !traceFile.is_open() )
+	{
+		return false;
+	}
+
+	double timestampsPerSecond = ( double ) ( exportTimestamp - s_recordingStartTimestamp ) / PerformanceCountToSeconds( exportCount - s_recordingStartCount );
+	uint64_t windowTimestamps = ( uint64_t ) ( windowSeconds * timestampsPerSecond );
+	uint64_t windowStartTimestamp = s_recordingStartTimestamp;
+	if ( exportTimestamp - s_recordingStartTimestamp > windowTimestamps )
+	{
+		windowStartTimestamp = exportTimestamp - windowTimestamps;
+	}
+
+	ProfileEvent* events = ( ProfileEvent* ) malloc( PROFILE_EVENT_RING_SIZE * sizeof( ProfileEvent ) );
+	std::vector< ProfileEvent > openEvents;
+	bool isFirstEvent = true;
+	traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	s_eventThreadsLock.lock();
+
+	for ( unsigned int threadIndex = 0; threadIndex < s_eventThreads.size(); ++threadIndex )
+	{
+		ProfileEventThread* eventThread = s_eventThreads[ threadIndex ];
+		unsigned int threadId = eventThread->m_threadIndex + 1;
+
+		traceFile << ( isFirstEvent ? "" : ",\n" ) << Stringf( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			threadId, EscapeJsonString( eventThread->m_threadName ).c_str() );
+		isFirstEvent = false;
+
+		if ( eventThread->m_events == nullptr )
+		{
+			continue;
+		}
+
+		uint64_t endIndex = eventThread->m_writeIndex.load( std::memory_order_acquire );
+		memcpy( events, eventThread->m_events, PROFILE_EVENT_RING_SIZE * sizeof( ProfileEvent ) );
+		uint64_t overwrittenIndex = eventThread->m_writeIndex.load( std::memory_order_acquire );
+		uint64_t firstIndex = ( overwrittenIndex > PROFILE_EVENT_RING_SIZE ) ? overwrittenIndex - PROFILE_EVENT_RING_SIZE + 1 : 0;
+
+		openEvents.clear();
+		for ( uint64_t eventIndex = firstIndex; eventIndex < endIndex; ++eventIndex )
+		{
+			ProfileEvent const &traceEvent = events[ eventIndex & ( PROFILE_EVENT_RING_SIZE - 1 ) ];
+			if ( traceEvent.m_timestamp > exportTimestamp )
+			{
+				break;
+			}
+
+			if ( traceEvent.m_type == PROFILE_EVENT_BEGIN )
+			{
+				openEvents.push_back( traceEvent );
+				continue;
+			}
+
+			if ( openEvents.empty() || openEvents.back().m_tagId != traceEvent.m_tagId )
+			{
+				continue;
+			}
+
+			ProfileEvent beginEvent = openEvents.back();
+			openEvents.pop_back();
+			if ( traceEvent.m_timestamp < windowStartTimestamp )
+			{
+				continue;
+			}
+
+			char const* tag = ( beginEvent.m_tagId < MAX_PROFILE_EVENT_TAGS ) ? s_tags[ beginEvent.m_tagId ].load( std::memory_order_acquire ) : "unknown";
+			double beginMicroseconds = TimestampToMicroseconds( beginEvent.m_timestamp, windowStartTimestamp, timestampsPerSecond );
+			double endMicroseconds = TimestampToMicroseconds( traceEvent.m_timestamp, windowStartTimestamp, timestampsPerSecond );
+			traceFile << Stringf( ",\n{\"name\":\"%s\",\"cat\":\"profile\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+				EscapeJsonString( tag ).c_str(), beginMicroseconds, endMicroseconds - beginMicroseconds, threadId );
+		}
+
+		for ( unsigned int openIndex = 0; openIndex < openEvents.size(); ++openIndex )
+		{
+			ProfileEvent const &beginEvent = openEvents[ openIndex ];
+			char const* tag = ( beginEvent.m_tagId < MAX_PROFILE_EVENT_TAGS ) ? s_tags[ beginEvent.m_tagId ].load( std::memory_order_acquire ) : "unknown";
+			double beginMicroseconds = TimestampToMicroseconds( beginEvent.m_timestamp, windowStartTimestamp, timestampsPerSecond );
+			double endMicroseconds = TimestampToMicroseconds( exportTimestamp, windowStartTimestamp, timestampsPerSecond );
+			traceFile << Stringf( ",\n{\"name\":\"%s\",\"cat\":\"profile\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"open\":true}}",
+				EscapeJsonString( tag ).c_str(), beginMicroseconds, endMicroseconds - beginMicroseconds, threadId );
+		}
+	}
+
+	s_eventThreadsLock.unlock();
+
+	free( events );
+	traceFile << "\n]}\n";
+	return traceFile.good();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// profile_trace [start|stop|dump [file] [seconds]]
+CONSOLE_COMMAND( profile_trace )
+{
+	std::string subCommand = args.m_argList.empty() ? "" : args.m_argList[ 0 ];
+
+	if ( subCommand == "start" )
+	{
+		StartRecordingProfileEvents();
+		g_theDeveloperConsole->ConsolePrint( "Profile trace recording." );
+	}
+	else if ( subCommand == "stop" )
+	{
+		StopRecordingProfileEvents();
+		g_theDeveloperConsole->ConsolePrint( "Profile trace stopped." );
+	}
+	else if ( subCommand == "dump" )
+	{
+		std::string filePath = ( args.m_argList.size() > 1 ) ? args.m_argList[ 1 ] : DEFAULT_PROFILE_TRACE_FILE;
+		float windowSeconds = ( float ) DEFAULT_PROFILE_TRACE_SECONDS;
+		if ( args.m_argList.size() > 2 )
+		{
+			SetTypeFromString( windowSeconds, args.m_argList[ 2 ] );
+		}
+
+		if ( ExportProfileEventsChromeTrace( filePath.c_str(), windowSeconds ) )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Profile trace written to " + filePath + " (open in chrome://tracing or ui.perfetto.dev)" );
+		}
+		else
+		{
+			g_theDeveloperConsole->ConsolePrint( "Couldn't write " + filePath + ", is anything recorded?", Rgba::RED );
+		}
+	}
+	else
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: profile_trace [start|stop|dump [file] [seconds]]", Rgba::RED );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int PROFILE_EVENT_RING_SIZE = 1 << 16; // Events kept per thread, a power of two
+const unsigned int MAX_PROFILE_EVENT_TAGS = 4096; // A power of two
+const uint32_t PROFILE_EVENT_UNKNOWN_TAG = 0xFFFFFFFF; // The tag table was full
+const double DEFAULT_PROFILE_TRACE_SECONDS = 10.0;
+
+
+//-----------------------------------------------------------------------------------------------
+enum ProfileEventType
+{
+	PROFILE_EVENT_BEGIN = 0,
+	PROFILE_EVENT_END,
+	NUM_PROFILE_EVENT_TYPES
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// The thread is whoever's ring it's in
+struct ProfileEvent
+{
+	uint64_t m_timestamp; // Time stamp counter
+	uint32_t m_tagId;
+	uint32_t m_type;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// The event backend behind PushProfileSample and PopProfileSample. While recording, each thread
+// writes begin and end events into its own ring with no lock, so the rings always hold the last
+// few seconds of every thread, however long ago recording started. Export pairs them back up
+// into spans as Chrome trace JSON. PROGRAM_PROFILING builds record from startup, so hitch captures
+// and dumps always have the last few seconds. That costs every push and pop a time stamp read, a
+// tag lookup and an event write; stopping brings it down to one load.
+void ProfileEventsStartup();
+void ProfileEventsShutdown(); // After every other thread that recorded has stopped
+void StartRecordingProfileEvents(); // Clears what was recorded
+void StopRecordingProfileEvents();
+bool IsRecordingProfileEvents();
+void RecordProfileEvent( ProfileEventType type, char const* tag );
+void SetProfileEventsThreadName( char const* threadName );
+uint32_t GetProfileEventTagId( char const* tag ); // Interned by pointer, the same literal gets the same ID
+bool ExportProfileEventsChromeTrace( char const* filePath, double windowSeconds ); // The last windowSeconds, recording carries on
\ No newline at end of file
@@ -0,0 +1,641 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "Engine/Tools/Profiling/ProfileReport.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int MAX_PROFILE_REPORT_WINDOW = 36000; // Ten minutes at 60Hz
+const unsigned int COUNTER_HISTORY_STRIDE = NUM_HARDWARE_COUNTERS + 1; // The counters, then how many calls were counted
+const unsigned int MIN_PROFILE_REPORT_HISTORY = 64; // Frames the histories start out holding
+static const char* DEFAULT_PROFILE_REPORT_FILE = "ProfileReport.csv";
+
+
+//-----------------------------------------------------------------------------------------------
+// A call path. Lanes are the roots, one per thread. The histories hold a value per frame kept,
+// and the frame totals collect the frame being accumulated. Counter history is only allocated
+// once the path has a counted call.
+struct ProfileReportNode
+{
+	char const* m_tag;
+	unsigned int m_depth;
+	ProfileReportNode* m_parent;
+	ProfileReportNode* m_firstChild;
+	ProfileReportNode* m_lastChild;
+	ProfileReportNode* m_nextSibling;
+
+	uint64_t m_frameCalls;
+	uint64_t m_frameInclusiveCycles;
+	uint64_t m_frameExclusiveCycles;
+	uint64_t m_frameCounters[ COUNTER_HISTORY_STRIDE ];
+	uint32_t* m_callHistory;
+	uint64_t* m_inclusiveHistory;
+	uint64_t* m_exclusiveHistory;
+	uint64_t* m_counterHistory; // COUNTER_HISTORY_STRIDE per frame, or nullptr
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileReportNode* s_firstLaneNode = nullptr;
+static ProfileReportNode* s_lastLaneNode = nullptr;
+static unsigned int s_windowSize = DEFAULT_PROFILE_REPORT_WINDOW;
+static unsigned int s_historyCapacity = MIN_PROFILE_REPORT_HISTORY; // Frames every node's histories hold, doubles up to the window
+static unsigned int s_numFrames = 0;
+static unsigned int s_nextFrameSlot = 0; // Slots below s_numFrames are filled, order doesn't matter to the stats
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileReportNode* CreateNode( ProfileReportNode* parentNode, char const* tag )
+{
+	ProfileReportNode* node = new ProfileReportNode();
+	node->m_tag = tag;
+	node->m_depth = ( parentNode != nullptr ) ? parentNode->m_depth + 1 : 0;
+	node->m_parent = parentNode;
+	node->m_callHistory = new uint32_t[ s_historyCapacity ]();
+	node->m_inclusiveHistory = new uint64_t[ s_historyCapacity ]();
+	node->m_exclusiveHistory = new uint64_t[ s_historyCapacity ]();
+	node->m_counterHistory = nullptr;
+
+	if ( parentNode != nullptr )
+	{
+		if ( parentNode->m_firstChild == nullptr )
+		{
+			parentNode->m_firstChild = node;
+		}
+		else
+		{
+			parentNode->m_lastChild->m_nextSibling = node;
+		}
+		parentNode->m_lastChild = node;
+	}
+
+	return node;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void DeleteNode( ProfileReportNode* node )
+{
+	ProfileReportNode* childNode = node->m_firstChild;
+	while ( childNode != nullptr )
+	{
+		ProfileReportNode* nextChildNode = childNode->m_nextSibling;
+		DeleteNode( childNode );
+		childNode = nextChildNode;
+	}
+
+	delete[] node->m_callHistory;
+	delete[] node->m_inclusiveHistory;
+	delete[] node->m_exclusiveHistory;
+	delete[] node->m_counterHistory;
+	delete node;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template< typename T >
+static void GrowHistory( T*& history, unsigned int numFramesKept, unsigned int numValuesPerFrame, unsigned int newCapacity )
+{
+	if ( history == nullptr )
+	{
+		return;
+	}
+
+	T* newHistory = new T[ newCapacity * numValuesPerFrame ]();
+	memcpy( newHistory, history, numFramesKept * numValuesPerFrame * sizeof( T ) );
+	delete[] history;
+	history = newHistory;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Only while the window is still filling, when the frames kept are the first slots in order
+static void GrowNodeHistories( ProfileReportNode* node, unsigned int newCapacity )
+{
+	GrowHistory( node->m_callHistory, s_numFrames, 1, newCapacity );
+	GrowHistory( node->m_inclusiveHistory, s_numFrames, 1, newCapacity );
+	GrowHistory( node->m_exclusiveHistory, s_numFrames, 1, newCapacity );
+	GrowHistory( node->m_counterHistory, s_numFrames, COUNTER_HISTORY_STRIDE, newCapacity );
+
+	for ( ProfileReportNode* childNode = node->m_firstChild; childNode != nullptr; childNode = childNode->m_nextSibling )
+	{
+		GrowNodeHistories( childNode, newCapacity );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Thread names are interned, so threads that come and go under one name share a lane
+static ProfileReportNode* FindOrAddLaneNode( ProfileLane const &lane )
+{
+	for ( ProfileReportNode* laneNode = s_firstLaneNode; laneNode != nullptr; laneNode = laneNode->m_nextSibling )
+	{
+		if ( laneNode->m_tag == lane.m_threadName )
+		{
+			return laneNode;
+		}
+	}
+
+	// The name lives as long as the profiler, like the tags
+	ProfileReportNode* laneNode = CreateNode( nullptr, lane.m_threadName );
+	if ( s_firstLaneNode == nullptr )
+	{
+		s_firstLaneNode = laneNode;
+	}
+	else
+	{
+		s_lastLaneNode->m_nextSibling = laneNode;
+	}
+	s_lastLaneNode = laneNode;
+
+	return laneNode;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Tags are matched by pointer, the same as they're pushed
+static ProfileReportNode* FindOrAddChildNode( ProfileReportNode* parentNode, char const* tag )
+{
+	for ( ProfileReportNode* childNode = parentNode->m_firstChild; childNode != nullptr; childNode = childNode->m_nextSibling )
+	{
+		if ( childNode->m_tag == tag )
+		{
+			return childNode;
+		}
+	}
+
+	return CreateNode( parentNode, tag );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AccumulateSample( ProfileReportNode* parentNode, ProfileSample* sample )
+{
+	ProfileReportNode* node = FindOrAddChildNode( parentNode, sample->tag );
+	node->m_frameCalls++;
+	node->m_frameInclusiveCycles += sample->GetCycles();
+	node->m_frameExclusiveCycles += sample->GetSelfCycles();
+	if ( sample->hasHardwareCounters )
+	{
+		for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+		{
+			node->m_frameCounters[ counterIndex ] += sample->hardwareCounters.m_values[ counterIndex ];
+		}
+		node->m_frameCounters[ NUM_HARDWARE_COUNTERS ]++;
+	}
+
+	for ( ProfileSample* childSample = sample->firstChildSample; childSample != nullptr; childSample = childSample->nextSample )
+	{
+		AccumulateSample( node, childSample );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Every node gets a value for the frame, zero if it didn't run
+static void CloseNodeFrame( ProfileReportNode* node )
+{
+	node->m_callHistory[ s_nextFrameSlot ] = ( uint32_t ) node->m_frameCalls;
+	node->m_inclusiveHistory[ s_nextFrameSlot ] = node->m_frameInclusiveCycles;
+	node->m_exclusiveHistory[ s_nextFrameSlot ] = node->m_frameExclusiveCycles;
+	node->m_frameCalls = 0;
+	node->m_frameInclusiveCycles = 0;
+	node->m_frameExclusiveCycles = 0;
+
+	if ( node->m_counterHistory == nullptr && node->m_frameCounters[ NUM_HARDWARE_COUNTERS ] > 0 )
+	{
+		node->m_counterHistory = new uint64_t[ s_historyCapacity * COUNTER_HISTORY_STRIDE ]();
+	}
+
+	for ( unsigned int counterIndex = 0; counterIndex < COUNTER_HISTORY_STRIDE; ++counterIndex )
+	{
+		if ( node->m_counterHistory != nullptr )
+		{
+			node->m_counterHistory[ s_nextFrameSlot * COUNTER_HISTORY_STRIDE + counterIndex ] = node->m_frameCounters[ counterIndex ];
+		}
+		node->m_frameCounters[ counterIndex ] = 0;
+	}
+
+	for ( ProfileReportNode* childNode = node->m_firstChild; childNode != nullptr; childNode = childNode->m_nextSibling )
+	{
+		CloseNodeFrame( childNode );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Nearest rank, on a sorted window
+static double GetPercentileMilliseconds( std::vector< uint64_t > const &sortedCycles, double percentile )
+{
+	size_t rank = ( size_t ) ceil( percentile * sortedCycles.size() );
+	size_t index = ( rank > 0 ) ? rank - 1 : 0;
+	return PerformanceCountToSeconds( sortedCycles[ index ] ) * 1000.0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileTimeStats ComputeTimeStats( uint64_t const* cyclesPerFrame, std::vector< uint64_t >& scratchCycles )
+{
+	ProfileTimeStats stats;
+	memset( &stats, 0, sizeof( stats ) );
+	if ( s_numFrames == 0 )
+	{
+		return stats;
+	}
+
+	scratchCycles.assign( cyclesPerFrame, cyclesPerFrame + s_numFrames );
+	std::sort( scratchCycles.begin(), scratchCycles.end() );
+
+	uint64_t totalCycles = 0;
+	for ( unsigned int frameIndex = 0; frameIndex < s_numFrames; ++frameIndex )
+	{
+		totalCycles += scratchCycles[ frameIndex ];
+	}
+
+	stats.m_min = PerformanceCountToSeconds( scratchCycles.front() ) * 1000.0;
+	stats.m_average = PerformanceCountToSeconds( totalCycles ) * 1000.0 / s_numFrames;
+	stats.m_max = PerformanceCountToSeconds( scratchCycles.back() ) * 1000.0;
+	stats.m_p95 = GetPercentileMilliseconds( scratchCycles, 0.95 );
+	stats.m_p99 = GetPercentileMilliseconds( scratchCycles, 0.99 );
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileScopeStats ComputeScopeStats( char const* tag, std::string const &name, unsigned int depth, uint32_t const* callHistory,
+	uint64_t const* inclusiveHistory, uint64_t const* exclusiveHistory, uint64_t const* counterHistory, std::vector< uint64_t >& scratchCycles )
+{
+	ProfileScopeStats scopeStats;
+	scopeStats.m_name = name;
+	scopeStats.m_tag = tag;
+	scopeStats.m_depth = depth;
+	scopeStats.m_isLane = false;
+	scopeStats.m_numCalls = 0;
+	scopeStats.m_numFramesRun = 0;
+	for ( unsigned int frameIndex = 0; frameIndex < s_numFrames; ++frameIndex )
+	{
+		scopeStats.m_numCalls += callHistory[ frameIndex ];
+		scopeStats.m_numFramesRun += ( callHistory[ frameIndex ] > 0 ) ? 1 : 0;
+	}
+
+	memset( scopeStats.m_hardwareCounters, 0, sizeof( scopeStats.m_hardwareCounters ) );
+	scopeStats.m_numCountedCalls = 0;
+	for ( unsigned int frameIndex = 0; counterHistory != nullptr && frameIndex < s_numFrames; ++frameIndex )
+	{
+		uint64_t const* frameCounters = counterHistory + frameIndex * COUNTER_HISTORY_STRIDE;
+		for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+		{
+			scopeStats.m_hardwareCounters[ counterIndex ] += frameCounters[ counterIndex ];
+		}
+		scopeStats.m_numCountedCalls += frameCounters[ NUM_HARDWARE_COUNTERS ];
+	}
+
+	scopeStats.m_inclusive = ComputeTimeStats( inclusiveHistory, scratchCycles );
+	scopeStats.m_exclusive = ComputeTimeStats( exclusiveHistory, scratchCycles );
+	return scopeStats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AddHierarchicalScopes( ProfileReportNode* node, std::string const &parentPath, std::vector< ProfileScopeStats >& out_scopes,
+	std::vector< uint64_t >& scratchCycles )
+{
+	std::string path = parentPath.empty() ? node->m_tag : parentPath + "/" + node->m_tag;
+	out_scopes.push_back( ComputeScopeStats( node->m_tag, path, node->m_depth, node->m_callHistory, node->m_inclusiveHistory,
+		node->m_exclusiveHistory, node->m_counterHistory, scratchCycles ) );
+	out_scopes.back().m_isLane = ( node->m_parent == nullptr );
+
+	for ( ProfileReportNode* childNode = node->m_firstChild; childNode != nullptr; childNode = childNode->m_nextSibling )
+	{
+		AddHierarchicalScopes( childNode, path, out_scopes, scratchCycles );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Sums every path with the same tag, frame by frame. A tag nested under itself counts its
+// inclusive time once per level.
+struct FlatScopeTotals
+{
+	char const* m_tag;
+	std::vector< uint32_t > m_callHistory;
+	std::vector< uint64_t > m_inclusiveHistory;
+	std::vector< uint64_t > m_exclusiveHistory;
+	std::vector< uint64_t > m_counterHistory;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static void AddToFlatTotals( ProfileReportNode* node, std::map< std::string, FlatScopeTotals >& flatTotals )
+{
+	for ( ProfileReportNode* childNode = node->m_firstChild; childNode != nullptr; childNode = childNode->m_nextSibling )
+	{
+		FlatScopeTotals& totals = flatTotals[ childNode->m_tag ];
+		if ( totals.m_callHistory.empty() )
+		{
+			totals.m_tag = childNode->m_tag;
+			totals.m_callHistory.resize( s_numFrames, 0 );
+			totals.m_inclusiveHistory.resize( s_numFrames, 0 );
+			totals.m_exclusiveHistory.resize( s_numFrames, 0 );
+			totals.m_counterHistory.resize( s_numFrames * COUNTER_HISTORY_STRIDE, 0 );
+		}
+
+		for ( unsigned int frameIndex = 0; frameIndex < s_numFrames; ++frameIndex )
+		{
+			totals.m_callHistory[ frameIndex ] += childNode->m_callHistory[ frameIndex ];
+			totals.m_inclusiveHistory[ frameIndex ] += childNode->m_inclusiveHistory[ frameIndex ];
+			totals.m_exclusiveHistory[ frameIndex ] += childNode->m_exclusiveHistory[ frameIndex ];
+		}
+		for ( unsigned int counterIndex = 0; childNode->m_counterHistory != nullptr && counterIndex < s_numFrames * COUNTER_HISTORY_STRIDE; ++counterIndex )
+		{
+			totals.m_counterHistory[ counterIndex ] += childNode->m_counterHistory[ counterIndex ];
+		}
+
+		AddToFlatTotals( childNode, flatTotals );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsMoreExclusiveTime( ProfileScopeStats const &first, ProfileScopeStats const &second )
+{
+	return first.m_exclusive.m_average > second.m_exclusive.m_average;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileReportFrameMark( ProfileFrameView const &frameView )
+{
+	for ( unsigned int laneIndex = 0; laneIndex < frameView.m_lanes.size(); ++laneIndex )
+	{
+		ProfileLane const &lane = frameView.m_lanes[ laneIndex ];
+		ProfileReportNode* laneNode = FindOrAddLaneNode( lane );
+		laneNode->m_frameCalls += lane.m_numRootSamples;
+
+		for ( ProfileSample* rootSample = lane.m_firstRootSample; rootSample != nullptr; rootSample = rootSample->nextSample )
+		{
+			laneNode->m_frameInclusiveCycles += rootSample->GetCycles();
+			AccumulateSample( laneNode, rootSample );
+		}
+	}
+
+	if ( s_nextFrameSlot == s_historyCapacity )
+	{
+		s_historyCapacity = std::min( s_historyCapacity * 2, s_windowSize );
+		for ( ProfileReportNode* laneNode = s_firstLaneNode; laneNode != nullptr; laneNode = laneNode->m_nextSibling )
+		{
+			GrowNodeHistories( laneNode, s_historyCapacity );
+		}
+	}
+
+	for ( ProfileReportNode* laneNode = s_firstLaneNode; laneNode != nullptr; laneNode = laneNode->m_nextSibling )
+	{
+		CloseNodeFrame( laneNode );
+	}
+
+	s_nextFrameSlot = ( s_nextFrameSlot + 1 ) % s_windowSize;
+	s_numFrames = std::min( s_numFrames + 1, s_windowSize );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileReportShutdown()
+{
+	ClearProfileReport();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SetProfileReportWindow( unsigned int numFrames )
+{
+	ClearProfileReport();
+	s_windowSize = std::max( 1u, std::min( numFrames, MAX_PROFILE_REPORT_WINDOW ) );
+	s_historyCapacity = std::min( s_windowSize, MIN_PROFILE_REPORT_HISTORY );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ClearProfileReport()
+{
+	ProfileReportNode* laneNode = s_firstLaneNode;
+	while ( laneNode != nullptr )
+	{
+		ProfileReportNode* nextLaneNode = laneNode->m_nextSibling;
+		DeleteNode( laneNode );
+		laneNode = nextLaneNode;
+	}
+
+	s_firstLaneNode = nullptr;
+	s_lastLaneNode = nullptr;
+	s_numFrames = 0;
+	s_nextFrameSlot = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int GetProfileReportNumFrames()
+{
+	return s_numFrames;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Hierarchical scopes come in call order, flat ones by average exclusive time
+void GetProfileReport( ProfileReportView view, std::vector< ProfileScopeStats >& out_scopes )
+{
+	out_scopes.clear();
+	std::vector< uint64_t > scratchCycles;
+
+	if ( view == PROFILE_REPORT_HIERARCHICAL )
+	{
+		for ( ProfileReportNode* laneNode = s_firstLaneNode; laneNode != nullptr; laneNode = laneNode->m_nextSibling )
+		{
+			AddHierarchicalScopes( laneNode, "", out_scopes, scratchCycles );
+		}
+		return;
+	}
+
+	std::map< std::string, FlatScopeTotals > flatTotals;
+	for ( ProfileReportNode* laneNode = s_firstLaneNode; laneNode != nullptr; laneNode = laneNode->m_nextSibling )
+	{
+		AddToFlatTotals( laneNode, flatTotals );
+	}
+
+	for ( std::map< std::string, FlatScopeTotals >::iterator totalsIter = flatTotals.begin(); totalsIter != flatTotals.end(); ++totalsIter )
+	{
+		FlatScopeTotals const &totals = totalsIter->second;
+		out_scopes.push_back( ComputeScopeStats( totals.m_tag, totalsIter->first, 0, totals.m_callHistory.data(), totals.m_inclusiveHistory.data(),
+			totals.m_exclusiveHistory.data(), totals.m_counterHistory.data(), scratchCycles ) );
+	}
+
+	std::stable_sort( out_scopes.begin(), out_scopes.end(), IsMoreExclusiveTime );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Instructions per cycle and the misses per counted call
+static void GetCountersPerCall( ProfileScopeStats const &scope, double& out_instructionsPerCycle, double* out_countersPerCall )
+{
+	uint64_t const* counters = scope.m_hardwareCounters;
+	out_instructionsPerCycle = ( counters[ HARDWARE_COUNTER_CYCLES ] > 0 ) ? ( double ) counters[ HARDWARE_COUNTER_INSTRUCTIONS ] / counters[ HARDWARE_COUNTER_CYCLES ] : 0.0;
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		out_countersPerCall[ counterIndex ] = ( scope.m_numCountedCalls > 0 ) ? ( double ) counters[ counterIndex ] / scope.m_numCountedCalls : 0.0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Text is a table indented by depth, with counter columns if anything was counted. CSV has one
+// row per scope with every stat.
+std::string FormatProfileReport( std::vector< ProfileScopeStats > const &scopes, ProfileReportFormat format )
+{
+	std::string reportText;
+	double numFrames = ( s_numFrames > 0 ) ? ( double ) s_numFrames : 1.0;
+
+	if ( format == PROFILE_REPORT_CSV )
+	{
+		reportText += "scope,depth,calls,frames_run,calls_per_frame,"
+			"inclusive_min_ms,inclusive_avg_ms,inclusive_max_ms,inclusive_p95_ms,inclusive_p99_ms,"
+			"exclusive_min_ms,exclusive_avg_ms,exclusive_max_ms,exclusive_p95_ms,exclusive_p99_ms,"
+			"counted_calls,ipc,cycles_per_call,instructions_per_call,l1d_misses_per_call,llc_misses_per_call,branch_misses_per_call\n";
+
+		for ( unsigned int scopeIndex = 0; scopeIndex < scopes.size(); ++scopeIndex )
+		{
+			ProfileScopeStats const &scope = scopes[ scopeIndex ];
+			double instructionsPerCycle = 0.0;
+			double countersPerCall[ NUM_HARDWARE_COUNTERS ];
+			GetCountersPerCall( scope, instructionsPerCycle, countersPerCall );
+
+			reportText += Stringf( "\"%s\",%u,%llu,%u,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,", scope.m_name.c_str(), scope.m_depth,
+				scope.m_numCalls, scope.m_numFramesRun, scope.m_numCalls / numFrames,
+				scope.m_inclusive.m_min, scope.m_inclusive.m_average, scope.m_inclusive.m_max, scope.m_inclusive.m_p95, scope.m_inclusive.m_p99 );
+			reportText += scope.m_isLane ? ",,,,," : Stringf( "%.4f,%.4f,%.4f,%.4f,%.4f,", scope.m_exclusive.m_min, scope.m_exclusive.m_average,
+				scope.m_exclusive.m_max, scope.m_exclusive.m_p95, scope.m_exclusive.m_p99 );
+			reportText += Stringf( "%llu,%.3f,%.1f,%.1f,%.2f,%.2f,%.2f\n", scope.m_numCountedCalls, instructionsPerCycle,
+				countersPerCall[ HARDWARE_COUNTER_CYCLES ], countersPerCall[ HARDWARE_COUNTER_INSTRUCTIONS ], countersPerCall[ HARDWARE_COUNTER_L1D_MISSES ],
+				countersPerCall[ HARDWARE_COUNTER_LLC_MISSES ], countersPerCall[ HARDWARE_COUNTER_BRANCH_MISSES ] );
+		}
+		return reportText;
+	}
+
+	bool hasCounters = false;
+	for ( unsigned int scopeIndex = 0; scopeIndex < scopes.size(); ++scopeIndex )
+	{
+		hasCounters = hasCounters || ( scopes[ scopeIndex ].m_numCountedCalls > 0 );
+	}
+
+	reportText += Stringf( "%u frames, ms per frame%s\n", s_numFrames, hasCounters ? ", counters per call" : "" );
+	reportText += Stringf( "%-36s %8s %9s %9s %9s %9s %9s %9s", "scope", "calls/f", "incl avg", "incl p95", "incl p99", "incl max",
+		"excl avg", "excl p95" );
+	reportText += hasCounters ? Stringf( " %6s %10s %10s %10s\n", "IPC", "L1D miss", "LLC miss", "br miss" ) : "\n";
+
+	for ( unsigned int scopeIndex = 0; scopeIndex < scopes.size(); ++scopeIndex )
+	{
+		ProfileScopeStats const &scope = scopes[ scopeIndex ];
+		std::string label = std::string( scope.m_depth * 2, ' ' ) + scope.m_tag;
+		reportText += Stringf( "%-36.36s %8.2f %9.3f %9.3f %9.3f %9.3f", label.c_str(), scope.m_numCalls / numFrames,
+			scope.m_inclusive.m_average, scope.m_inclusive.m_p95, scope.m_inclusive.m_p99, scope.m_inclusive.m_max );
+		reportText += scope.m_isLane ? Stringf( " %9s %9s", "-", "-" ) : Stringf( " %9.3f %9.3f", scope.m_exclusive.m_average, scope.m_exclusive.m_p95 );
+
+		if ( !hasCounters )
+		{
+			reportText += "\n";
+			continue;
+		}
+
+		double instructionsPerCycle = 0.0;
+		double countersPerCall[ NUM_HARDWARE_COUNTERS ];
+		GetCountersPerCall( scope, instructionsPerCycle, countersPerCall );
+		reportText += Stringf( " %6.2f %10.1f %10.1f %10.1f\n", instructionsPerCycle, countersPerCall[ HARDWARE_COUNTER_L1D_MISSES ],
+			countersPerCall[ HARDWARE_COUNTER_LLC_MISSES ], countersPerCall[ HARDWARE_COUNTER_BRANCH_MISSES ] );
+	}
+	return reportText;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// profile_report [flat|tree] [text|csv] [file], profile_report window <frames>, profile_report clear
+CONSOLE_COMMAND( profile_report )
+{
+	std::string subCommand = args.m_argList.empty() ? "flat" : args.m_argList[ 0 ];
+
+	if ( subCommand == "window" )
+	{
+		int numFrames = 0;
+		if ( args.m_argList.size() > 1 )
+		{
+			SetTypeFromString( numFrames, args.m_argList[ 1 ] );
+		}
+
+		if ( numFrames <= 0 )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Usage: profile_report window <frames>", Rgba::RED );
+			return;
+		}
+
+		SetProfileReportWindow( ( unsigned int ) numFrames );
+		g_theDeveloperConsole->ConsolePrint( Stringf( "Profile report window is %d frames.", numFrames ) );
+		return;
+	}
+
+	if ( subCommand == "clear" )
+	{
+		ClearProfileReport();
+		return;
+	}
+
+	if ( subCommand != "flat" && subCommand != "tree" )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: profile_report [flat|tree] [text|csv] [file] | window <frames> | clear", Rgba::RED );
+		return;
+	}
+
+	if ( GetProfileReportNumFrames() == 0 )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No profiled frames yet, try toggle_profiling", Rgba::RED );
+		return;
+	}
+
+	ProfileReportView view = ( subCommand == "tree" ) ? PROFILE_REPORT_HIERARCHICAL : PROFILE_REPORT_FLAT;
+	ProfileReportFormat format = ( args.m_argList.size() > 1 && args.m_argList[ 1 ] == "csv" ) ? PROFILE_REPORT_CSV : PROFILE_REPORT_TEXT;
+
+	std::vector< ProfileScopeStats > scopes;
+	GetProfileReport( view, scopes );
+	std::string reportText = FormatProfileReport( scopes, format );
+
+	// CSV always goes to a file, text to the console unless a file is named
+	std::string filePath = ( args.m_argList.size() > 2 ) ? args.m_argList[ 2 ] : "";
+	if ( filePath.empty() && format == PROFILE_REPORT_CSV )
+	{
+		filePath = DEFAULT_PROFILE_REPORT_FILE;
+	}
+
+	if ( filePath.empty() )
+	{
+		size_t lineStart = 0;
+		while ( lineStart < reportText.size() )
+		{
+			size_t lineEnd = reportText.find( '\n', lineStart );
+			g_theDeveloperConsole->ConsolePrint( reportText.substr( lineStart, lineEnd - lineStart ) );
+			lineStart = ( lineEnd == std::string::npos ) ? reportText.size() : lineEnd + 1;
+		}
+		return;
+	}
+
+	std::ofstream reportFile( filePath.c_str(), std::ios::binary );
+	reportFile << reportText;
+	if ( reportFile.good() )
+	{
+		g_theDeveloperConsole->ConsolePrint( "Profile report written to " + filePath );
+	}
+	else
+	{
+		g_theDeveloperConsole->ConsolePrint( "Couldn't write " + filePath, Rgba::RED );
+	}
+}
\ No newline at end of file
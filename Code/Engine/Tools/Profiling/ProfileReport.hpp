@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Engine/Tools/Profiling/Profiler.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int DEFAULT_PROFILE_REPORT_WINDOW = 300; // Frames
+
+
+//-----------------------------------------------------------------------------------------------
+enum ProfileReportView
+{
+	PROFILE_REPORT_FLAT = 0, // One row per tag wherever it ran, by exclusive time
+	PROFILE_REPORT_HIERARCHICAL, // One row per call path under each thread's lane
+	NUM_PROFILE_REPORT_VIEWS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+enum ProfileReportFormat
+{
+	PROFILE_REPORT_TEXT = 0,
+	PROFILE_REPORT_CSV,
+	NUM_PROFILE_REPORT_FORMATS
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Milliseconds a frame spent in a scope, over every frame in the window
+struct ProfileTimeStats
+{
+	double m_min;
+	double m_average;
+	double m_max;
+	double m_p95;
+	double m_p99;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileScopeStats
+{
+	std::string m_name; // The tag, or the path from the lane down in the hierarchical view
+	char const* m_tag;
+	unsigned int m_depth; // 0 for a lane, and for every scope in the flat view
+	bool m_isLane; // A thread's total, which has no exclusive time of its own
+	uint64_t m_numCalls;
+	unsigned int m_numFramesRun;
+	ProfileTimeStats m_inclusive;
+	ProfileTimeStats m_exclusive;
+	uint64_t m_numCountedCalls; // Calls made while hardware counting was on
+	uint64_t m_hardwareCounters[ NUM_HARDWARE_COUNTERS ]; // Summed over the counted calls, inclusive
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Accumulates every profiled frame into a tree of call paths, each keeping its per-frame calls
+// and times for the last window of frames. Stats count every frame in the window, so a scope
+// that skips frames averages in its zeros, which is what it costs the frame budget. Fed from
+// ProfileFrameMark on the main thread; read from there too. Scopes timed while hardware counting
+// was on also report IPC and misses per call.
+void ProfileReportFrameMark( ProfileFrameView const &frameView );
+void ProfileReportShutdown();
+void SetProfileReportWindow( unsigned int numFrames ); // Clears what was accumulated
+void ClearProfileReport();
+unsigned int GetProfileReportNumFrames(); // Accumulated so far, up to the window
+void GetProfileReport( ProfileReportView view, std::vector< ProfileScopeStats >& out_scopes );
+std::string FormatProfileReport( std::vector< ProfileScopeStats > const &scopes, ProfileReportFormat format );
\ No newline at end of file
@@ -1,27 +1,272 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <string>
 
 #include "Engine/Tools/Profiling/Profiler.hpp"
+#include "Engine/Tools/Profiling/ProfileEvents.hpp"
+#include "Engine/Tools/Profiling/ProfileReport.hpp"
+#include "Engine/Tools/Profiling/HitchDetector.hpp"
+#include "Engine/Tools/Profiling/SamplingProfiler.hpp"
 #include "Engine/Tools/Logging/Logger.hpp"
 #include "Engine/Config/BuildConfig.hpp" // Enable/disable profiling in this file
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Input/DeveloperConsole.hpp"
 #include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Tools/Memory/FrameAllocationChecker.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
 const int MAX_NUMBER_OF_SAMPLES = 1024;
+const unsigned int MAX_PROFILE_THREADS = 64; // Lanes reserved up front, more still work
+char const* const FRAME_SAMPLE_TAG = "frame";
 
 
 //-----------------------------------------------------------------------------------------------
-ProfileSample* g_currentSample = nullptr;
-ProfileSample* g_currentFrame = nullptr;
-ProfileSample* g_previousFrame = nullptr;
-ObjectPool< ProfileSample > g_samplePool;
+// Only the owning thread touches its stack. The roots it closes wait under the lock until the
+// main thread collects them at the next frame mark, or until the thread exits.
+struct ProfileThread
+{
+	char const* m_threadName; // Interned, lanes and the report keep it after the thread exits
+	unsigned int m_threadIndex;
+	ProfileSample* m_currentSample;
+	std::mutex m_closedRootsLock;
+	ProfileSample* m_firstClosedRoot;
+	ProfileSample* m_lastClosedRoot;
+	unsigned int m_numClosedRoots;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Hands the thread's closed roots to the collector and frees it when the thread exits
+struct ProfileThreadHolder
+{
+	~ProfileThreadHolder();
+
+	ProfileThread* m_profileThread;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+ConcurrentObjectPool< ProfileSample > g_samplePool;
 bool g_enabled = false;
 bool g_desiredEnabled = false;
 
 
+//-----------------------------------------------------------------------------------------------
+static std::mutex s_profileThreadsLock;
+static std::vector< ProfileThread* > s_profileThreads;
+static std::vector< ProfileLane > s_exitedLanes; // Closed roots of threads that exited since the last frame mark
+static std::set< std::string > s_profileThreadNames; // Never shrinks, pools reuse their names
+static unsigned int s_numProfileThreads = 0; // Ever registered, for thread indices
+static thread_local ProfileThreadHolder t_profileThread;
+static ProfileSample* s_currentFrame = nullptr; // Main thread only, like everything below
+static ProfileSample* s_previousFrame = nullptr;
+static ProfileFrameView s_lastFrameView;
+static uint64_t s_frameNumber = 0;
+static uint64_t s_frameStartTime = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+// Called with the threads locked
+static char const* InternProfileThreadName( std::string const &threadName )
+{
+	return s_profileThreadNames.insert( threadName ).first->c_str();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Registers the calling thread the first time it profiles anything
+static ProfileThread* GetProfileThread()
+{
+	if ( t_profileThread.m_profileThread != nullptr )
+	{
+		return t_profileThread.m_profileThread;
+	}
+
+	ProfileThread* profileThread = new ProfileThread();
+
+	s_profileThreadsLock.lock();
+	profileThread->m_threadIndex = s_numProfileThreads++;
+	profileThread->m_threadName = InternProfileThreadName( Stringf( "Thread %u", profileThread->m_threadIndex ) );
+	s_profileThreads.push_back( profileThread );
+	s_profileThreadsLock.unlock();
+
+	t_profileThread.m_profileThread = profileThread;
+	return profileThread;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AddClosedRoot( ProfileThread* profileThread, ProfileSample* rootSample )
+{
+	profileThread->m_closedRootsLock.lock();
+	if ( profileThread->m_lastClosedRoot == nullptr )
+	{
+		profileThread->m_firstClosedRoot = rootSample;
+	}
+	else
+	{
+		profileThread->m_lastClosedRoot->nextSample = rootSample;
+	}
+	profileThread->m_lastClosedRoot = rootSample;
+	profileThread->m_numClosedRoots++;
+	profileThread->m_closedRootsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Turns the start values into counts over the scope, or drops them if counting stopped meanwhile
+static void EndHardwareCounters( ProfileSample* sample )
+{
+	if ( !sample->hasHardwareCounters )
+	{
+		return;
+	}
+
+	HardwareCounterValues endCounters;
+	sample->hasHardwareCounters = ReadHardwareCounters( endCounters );
+	for ( int counterIndex = 0; counterIndex < NUM_HARDWARE_COUNTERS; ++counterIndex )
+	{
+		sample->hardwareCounters.m_values[ counterIndex ] = endCounters.m_values[ counterIndex ] - sample->hardwareCounters.m_values[ counterIndex ];
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Roots are linked through nextSample, which DeleteProfileSample doesn't follow
+static void DeleteRootSamples( ProfileSample* firstRootSample )
+{
+	ProfileSample* rootSample = firstRootSample;
+	while ( rootSample != nullptr )
+	{
+		ProfileSample* nextRootSample = rootSample->nextSample;
+		DeleteProfileSample( rootSample );
+		rootSample = nextRootSample;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void DeleteFrameView( ProfileFrameView& frameView )
+{
+	for ( unsigned int laneIndex = 0; laneIndex < frameView.m_lanes.size(); ++laneIndex )
+	{
+		DeleteRootSamples( frameView.m_lanes[ laneIndex ].m_firstRootSample );
+	}
+	frameView.m_lanes.clear();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Takes every thread's closed roots. They become the new frame view if the frame was profiled,
+// otherwise they're thrown away and the last profiled frame stays up.
+static void CollectClosedRoots( bool wasFrameProfiled, uint64_t frameEndTime )
+{
+	if ( wasFrameProfiled )
+	{
+		DeleteFrameView( s_lastFrameView );
+		s_lastFrameView.m_frameNumber = s_frameNumber;
+		s_lastFrameView.m_startTime = s_frameStartTime;
+		s_lastFrameView.m_endTime = frameEndTime;
+	}
+
+	s_profileThreadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < s_profileThreads.size(); ++threadIndex )
+	{
+		ProfileThread* profileThread = s_profileThreads[ threadIndex ];
+
+		profileThread->m_closedRootsLock.lock();
+		ProfileLane lane;
+		lane.m_threadName = profileThread->m_threadName;
+		lane.m_threadIndex = profileThread->m_threadIndex;
+		lane.m_numRootSamples = profileThread->m_numClosedRoots;
+		lane.m_firstRootSample = profileThread->m_firstClosedRoot;
+		profileThread->m_firstClosedRoot = nullptr;
+		profileThread->m_lastClosedRoot = nullptr;
+		profileThread->m_numClosedRoots = 0;
+		profileThread->m_closedRootsLock.unlock();
+
+		if ( lane.m_firstRootSample == nullptr )
+		{
+			continue;
+		}
+
+		if ( wasFrameProfiled )
+		{
+			s_lastFrameView.m_lanes.push_back( lane );
+		}
+		else
+		{
+			DeleteRootSamples( lane.m_firstRootSample );
+		}
+	}
+
+	// Lanes stay in thread index order with exited threads' lanes among them
+	for ( unsigned int laneIndex = 0; laneIndex < s_exitedLanes.size(); ++laneIndex )
+	{
+		if ( wasFrameProfiled )
+		{
+			s_lastFrameView.m_lanes.push_back( s_exitedLanes[ laneIndex ] );
+		}
+		else
+		{
+			DeleteRootSamples( s_exitedLanes[ laneIndex ].m_firstRootSample );
+		}
+	}
+
+	if ( wasFrameProfiled && !s_exitedLanes.empty() )
+	{
+		std::sort( s_lastFrameView.m_lanes.begin(), s_lastFrameView.m_lanes.end(), []( ProfileLane const &a, ProfileLane const &b )
+		{
+			return a.m_threadIndex < b.m_threadIndex;
+		} );
+	}
+	s_exitedLanes.clear();
+	s_profileThreadsLock.unlock();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Scopes still open as the thread exits are thrown away, they never closed
+ProfileThreadHolder::~ProfileThreadHolder()
+{
+	ProfileThread* profileThread = m_profileThread;
+	if ( profileThread == nullptr )
+	{
+		return;
+	}
+
+	ProfileSample* openRootSample = profileThread->m_currentSample;
+	while ( openRootSample != nullptr && openRootSample->parentSample != nullptr )
+	{
+		openRootSample = openRootSample->parentSample;
+	}
+	DeleteProfileSample( openRootSample );
+
+	s_profileThreadsLock.lock();
+	if ( profileThread->m_firstClosedRoot != nullptr )
+	{
+		ProfileLane lane;
+		lane.m_threadName = profileThread->m_threadName;
+		lane.m_threadIndex = profileThread->m_threadIndex;
+		lane.m_numRootSamples = profileThread->m_numClosedRoots;
+		lane.m_firstRootSample = profileThread->m_firstClosedRoot;
+		s_exitedLanes.push_back( lane );
+	}
+	s_profileThreads.erase( std::find( s_profileThreads.begin(), s_profileThreads.end(), profileThread ) );
+	s_profileThreadsLock.unlock();
+
+	delete profileThread;
+	m_profileThread = nullptr;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 double GetPerformanceFrequency()
 {
@@ -57,17 +302,47 @@ double PerformanceCountToSeconds( uint64_t inCount )
 
 
 //-----------------------------------------------------------------------------------------------
+// From the main thread, which takes the first lane
 void ProfilerSystemStartup()
 {
-	// Set up object pool
+	// Set up object pool, it grows past this if a frame has more samples
 	g_samplePool.Initialize( MAX_NUMBER_OF_SAMPLES );
+	s_lastFrameView.m_lanes.reserve( MAX_PROFILE_THREADS );
+	ProfileEventsStartup();
+	ProfilerSetThreadName( "Main" );
+	s_frameStartTime = GetCurrentPerformanceCount();
 	g_desiredEnabled = true;
 }
 
 
 //-----------------------------------------------------------------------------------------------
+// After every other thread that profiled has stopped
 void ProfilerSystemShutdown()
 {
+	DeleteFrameView( s_lastFrameView );
+	DeleteProfileSample( s_currentFrame );
+	s_currentFrame = nullptr;
+	s_previousFrame = nullptr;
+
+	s_profileThreadsLock.lock();
+	for ( unsigned int threadIndex = 0; threadIndex < s_profileThreads.size(); ++threadIndex )
+	{
+		DeleteRootSamples( s_profileThreads[ threadIndex ]->m_firstClosedRoot );
+		delete s_profileThreads[ threadIndex ];
+	}
+	s_profileThreads.clear();
+	for ( unsigned int laneIndex = 0; laneIndex < s_exitedLanes.size(); ++laneIndex )
+	{
+		DeleteRootSamples( s_exitedLanes[ laneIndex ].m_firstRootSample );
+	}
+	s_exitedLanes.clear();
+	s_profileThreadsLock.unlock();
+	t_profileThread.m_profileThread = nullptr;
+
+	ProfileEventsShutdown();
+	ProfileReportShutdown();
+	SamplingProfilerShutdown();
+
 	// Clear object pool
 	g_samplePool.Shutdown();
 }
@@ -79,6 +354,7 @@ ProfileLogScoped::ProfileLogScoped( const char* tag )
 	UNUSED( tag );
 #ifdef PROGRAM_PROFILING
 	m_sample.tag = tag;
+	m_sample.hasHardwareCounters = ReadHardwareCounters( m_sample.hardwareCounters );
 	m_sample.Start();
 #endif
 }
@@ -89,29 +365,59 @@ ProfileLogScoped::~ProfileLogScoped()
 {
 #ifdef PROGRAM_PROFILING
 	m_sample.End();
-	LoggerPrintfWithTag( "profiler", "%s took %.8fms\n", m_sample.tag, m_sample.GetSeconds() * 1000.0f );
+	EndHardwareCounters( &m_sample );
+	if ( !m_sample.hasHardwareCounters )
+	{
+		LoggerPrintfWithTag( "profiler", "%s took %.8fms\n", m_sample.tag, m_sample.GetSeconds() * 1000.0f );
+		return;
+	}
+
+	uint64_t const* counters = m_sample.hardwareCounters.m_values;
+	double instructionsPerCycle = ( counters[ HARDWARE_COUNTER_CYCLES ] > 0 ) ? ( double ) counters[ HARDWARE_COUNTER_INSTRUCTIONS ] / counters[ HARDWARE_COUNTER_CYCLES ] : 0.0;
+	LoggerPrintfWithTag( "profiler", "%s took %.8fms, %llu cycles, IPC %.2f, %llu L1D misses, %llu LLC misses, %llu branch misses\n", m_sample.tag,
+		m_sample.GetSeconds() * 1000.0f, counters[ HARDWARE_COUNTER_CYCLES ], instructionsPerCycle, counters[ HARDWARE_COUNTER_L1D_MISSES ],
+		counters[ HARDWARE_COUNTER_LLC_MISSES ], counters[ HARDWARE_COUNTER_BRANCH_MISSES ] );
 #endif
 }
 
 
 //-----------------------------------------------------------------------------------------------
-// Indicates when a frame starts and a frame ends
+// Indicates when a frame starts and a frame ends, on the main thread
 void ProfileFrameMark()
 {
+	// Closes the checker's frame on the same boundary as the profiler's
+	FrameAllocationCheckerFrameMark();
+
+	ProfileThread* profileThread = GetProfileThread();
+	uint64_t frameEndTime = GetCurrentPerformanceCount();
+
 	if ( g_enabled )
 	{
-		ASSERT_OR_DIE( g_currentFrame == g_currentSample, "gCurrentFrame != g_currentSample" ); // Ensure we have popped everything up to this
-		PopProfileSample(); // Pops g_currentFrame
-		DeleteProfileSample( g_previousFrame ); // Performs a NULL check and deletes children
-		g_previousFrame = g_currentFrame;
+		ASSERT_OR_DIE( s_currentFrame == profileThread->m_currentSample, "Profile samples are still open at the frame mark" );
+		PopProfileSample(); // Pops s_currentFrame into the main thread's closed roots
+		s_previousFrame = s_currentFrame;
+		s_currentFrame = nullptr;
 	}
 
+	CollectClosedRoots( g_enabled, frameEndTime );
+
+	// Before the report takes the frame, so a hitch is compared against the frames before it
+	bool wasHitchCaptured = HitchDetectorFrameMark( s_frameNumber, frameEndTime - s_frameStartTime, g_enabled ? &s_lastFrameView : nullptr );
+	if ( g_enabled )
+	{
+		ProfileReportFrameMark( s_lastFrameView );
+	}
+
+	// Writing a capture isn't held against the next frame
+	s_frameNumber++;
+	s_frameStartTime = wasHitchCaptured ? GetCurrentPerformanceCount() : frameEndTime;
+
 	g_enabled = g_desiredEnabled;
 
 	if ( g_enabled )
 	{
-		PushProfileSample( "frame" ); // Have "frame" be a constant somewhere
-		g_currentFrame = g_currentSample;
+		PushProfileSample( FRAME_SAMPLE_TAG );
+		s_currentFrame = profileThread->m_currentSample;
 	}
 }
 
@@ -119,9 +425,53 @@ void ProfileFrameMark()
 //-----------------------------------------------------------------------------------------------
 void PopProfileSample()
 {
-	ASSERT_OR_DIE( g_currentSample != nullptr, "gCurrentSample == nullptr" );
-	g_currentSample->End();
-	g_currentSample = g_currentSample->parentSample;
+	ProfileThread* profileThread = GetProfileThread();
+	ProfileSample* sample = profileThread->m_currentSample;
+	ASSERT_OR_DIE( sample != nullptr, "No profile sample to pop on this thread" );
+	sample->End();
+	EndHardwareCounters( sample );
+	RecordProfileEvent( PROFILE_EVENT_END, sample->tag );
+	profileThread->m_currentSample = sample->parentSample;
+
+	if ( sample->parentSample == nullptr )
+	{
+		AddClosedRoot( profileThread, sample );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Frees the innermost sample and its children instead of keeping them for the frame view
+void PopAndDeleteProfileSample()
+{
+	ProfileThread* profileThread = GetProfileThread();
+	ProfileSample* sample = profileThread->m_currentSample;
+	ASSERT_OR_DIE( sample != nullptr, "No profile sample to pop on this thread" );
+	RecordProfileEvent( PROFILE_EVENT_END, sample->tag );
+	profileThread->m_currentSample = sample->parentSample;
+
+	// Pushed after its siblings, so it's the parent's last child
+	ProfileSample* parentSample = sample->parentSample;
+	if ( parentSample != nullptr )
+	{
+		if ( parentSample->firstChildSample == sample )
+		{
+			parentSample->firstChildSample = nullptr;
+			parentSample->lastChildSample = nullptr;
+		}
+		else
+		{
+			ProfileSample* previousSample = parentSample->firstChildSample;
+			while ( previousSample->nextSample != sample )
+			{
+				previousSample = previousSample->nextSample;
+			}
+			previousSample->nextSample = nullptr;
+			parentSample->lastChildSample = previousSample;
+		}
+	}
+
+	DeleteProfileSample( sample );
 }
 
 
@@ -156,24 +506,59 @@ void DeleteProfileSample( ProfileSample* sample )
 //-----------------------------------------------------------------------------------------------
 void PushProfileSample( const char* tag )
 {
+	ProfileThread* profileThread = GetProfileThread();
+	ProfileSample* currentSample = profileThread->m_currentSample;
+
 	ProfileSample* newSample = g_samplePool.Alloc();
 	newSample->tag = tag;
-	newSample->parentSample = g_currentSample;
+	newSample->parentSample = currentSample;
 
-	if ( g_currentSample != nullptr )
+	if ( currentSample != nullptr )
 	{
-		g_currentSample->AddChildSample( newSample );
+		currentSample->AddChildSample( newSample );
 	}
 
-	g_currentSample = newSample;	
-	g_currentSample->Start();
+	profileThread->m_currentSample = newSample;
+	RecordProfileEvent( PROFILE_EVENT_BEGIN, tag );
+	newSample->hasHardwareCounters = ReadHardwareCounters( newSample->hardwareCounters );
+	newSample->Start();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfilerSetThreadName( char const* threadName )
+{
+	ProfileThread* profileThread = GetProfileThread();
+
+	s_profileThreadsLock.lock();
+	profileThread->m_threadName = InternProfileThreadName( threadName );
+	s_profileThreadsLock.unlock();
+
+	SetProfileEventsThreadName( threadName );
+	SamplingProfilerRegisterThread( threadName );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Doesn't register the thread, so it's safe from inside operator new
+ProfileSample* ProfilerGetCurrentSample()
+{
+	ProfileThread* profileThread = t_profileThread.m_profileThread;
+	return ( profileThread != nullptr ) ? profileThread->m_currentSample : nullptr;
 }
 
 
 //-----------------------------------------------------------------------------------------------
 ProfileSample* ProfilerGetLastFrame()
 {
-	return g_previousFrame;
+	return s_previousFrame;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ProfileFrameView const& ProfilerGetLastFrameView()
+{
+	return s_lastFrameView;
 }
 
 
@@ -191,4 +576,40 @@ CONSOLE_COMMAND( toggle_profiling )
 	UNUSED( args );
 	g_desiredEnabled = !g_desiredEnabled;
 }
+
+
+//-----------------------------------------------------------------------------------------------
+// Time each thread spent in the scopes it closed during the last profiled frame
+CONSOLE_COMMAND( profile_lanes )
+{
+	UNUSED( args );
+
+	ProfileFrameView const& frameView = ProfilerGetLastFrameView();
+	if ( frameView.m_lanes.empty() )
+	{
+		g_theDeveloperConsole->ConsolePrint( "No profiled frame yet, try toggle_profiling", Rgba::RED );
+		return;
+	}
+
+	double frameSeconds = PerformanceCountToSeconds( frameView.m_endTime - frameView.m_startTime );
+	g_theDeveloperConsole->ConsolePrint( Stringf( "Frame %llu took %.3fms", frameView.m_frameNumber, frameSeconds * 1000.0 ) );
+
+	s_profileThreadsLock.lock();
+	for ( unsigned int laneIndex = 0; laneIndex < frameView.m_lanes.size(); ++laneIndex )
+	{
+		ProfileLane const &lane = frameView.m_lanes[ laneIndex ];
+
+		uint64_t laneCycles = 0;
+		for ( ProfileSample* rootSample = lane.m_firstRootSample; rootSample != nullptr; rootSample = rootSample->nextSample )
+		{
+			laneCycles += rootSample->GetCycles();
+		}
+
+		double laneSeconds = PerformanceCountToSeconds( laneCycles );
+		double laneFraction = ( frameSeconds > 0.0 ) ? ( laneSeconds / frameSeconds ) : 0.0;
+		g_theDeveloperConsole->ConsolePrint( Stringf( "  %-24s %5u scopes %9.3fms %6.1f%%", lane.m_threadName, lane.m_numRootSamples,
+			laneSeconds * 1000.0, laneFraction * 100.0 ) );
+	}
+	s_profileThreadsLock.unlock();
+}
 #endif
\ No newline at end of file
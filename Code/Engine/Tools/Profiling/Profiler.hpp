@@ -1,8 +1,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <vector>
 
-#include "Engine/Tools/Profiling/ObjectPool.hpp"
+#include "Engine/Tools/Profiling/ConcurrentObjectPool.hpp"
+#include "Engine/Tools/Profiling/HardwareCounters.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -36,15 +38,10 @@ struct ProfileSample
 		uint64_t totalChildrenCycles = 0;
 
 		ProfileSample* currentChildSample = firstChildSample;
-		if ( currentChildSample != nullptr )
+		while ( currentChildSample != nullptr )
 		{
-			totalChildrenCycles = currentChildSample->GetCycles();
-
-			while ( currentChildSample->nextSample != nullptr )
-			{
-				currentChildSample = currentChildSample->nextSample;
-				totalChildrenCycles = currentChildSample->GetCycles();
-			}
+			totalChildrenCycles += currentChildSample->GetCycles();
+			currentChildSample = currentChildSample->nextSample;
 		}
 
 		return ( GetCycles() - totalChildrenCycles );
@@ -60,16 +57,13 @@ struct ProfileSample
 		if ( firstChildSample == nullptr )
 		{
 			firstChildSample = childSample;
-			return;
 		}
-
-		ProfileSample* lastChildSample = firstChildSample;
-		while ( lastChildSample->nextSample != nullptr )
+		else
 		{
-			lastChildSample = lastChildSample->nextSample;
+			lastChildSample->nextSample = childSample;
 		}
 
-		lastChildSample->nextSample = childSample;
+		lastChildSample = childSample;
 	}
 
 	const char* tag;
@@ -77,7 +71,10 @@ struct ProfileSample
 	uint64_t endTime;
 	ProfileSample* parentSample;
 	ProfileSample* firstChildSample;
+	ProfileSample* lastChildSample; // So adding a child doesn't walk its siblings
 	ProfileSample* nextSample;
+	HardwareCounterValues hardwareCounters; // Start values while open, counts over the scope once popped
+	bool hasHardwareCounters;
 };
 
 
@@ -98,18 +95,44 @@ public:
 
 
 //-----------------------------------------------------------------------------------------------
-extern ProfileSample* g_currentSample;
-extern ProfileSample* g_currentFrame;
-extern ProfileSample* g_previousFrame;
-extern ObjectPool< ProfileSample > g_samplePool;
+// One thread's samples from a frame. The roots are the scopes it closed during the frame, linked
+// through nextSample, so a job still open at a frame mark shows up in the next frame.
+struct ProfileLane
+{
+	char const* m_threadName; // Interned, so it outlives the thread and threads of one name share it
+	unsigned int m_threadIndex; // Order the thread first profiled in
+	unsigned int m_numRootSamples;
+	ProfileSample* m_firstRootSample;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileFrameView
+{
+	uint64_t m_frameNumber;
+	uint64_t m_startTime; // Between the main thread's frame marks
+	uint64_t m_endTime;
+	std::vector< ProfileLane > m_lanes; // Only threads that closed a scope, by thread index
+};
+
+
+//-----------------------------------------------------------------------------------------------
+extern ConcurrentObjectPool< ProfileSample > g_samplePool;
 extern bool g_enabled;
 extern bool g_desiredEnabled;
 
 
 //-----------------------------------------------------------------------------------------------
+// Every thread pushes and pops on its own sample stack, registering with the profiler the first
+// time it does. ProfileFrameMark is called from the main thread, which collects what each thread
+// closed since the last mark into the frame view and frees the view before it.
 void ProfileFrameMark();
 void PopProfileSample();
+void PopAndDeleteProfileSample(); // For harnesses running many frames inside one
 void DeleteProfileSample( ProfileSample* sample );
 void PushProfileSample( const char* tag );
-ProfileSample* ProfilerGetLastFrame();
+void ProfilerSetThreadName( char const* threadName ); // Names the calling thread's lane
+ProfileSample* ProfilerGetCurrentSample(); // The calling thread's innermost open sample
+ProfileSample* ProfilerGetLastFrame(); // The main thread's "frame" sample
+ProfileFrameView const& ProfilerGetLastFrameView();
 void ProfilerEnable( bool enable );
\ No newline at end of file
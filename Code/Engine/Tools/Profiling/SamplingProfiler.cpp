@@ -0,0 +1,630 @@
+#if defined( __linux__ )
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid // Older glibc doesn't name it
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Tools/Profiling/SamplingProfiler.hpp"
+#include "Engine/Tools/Memory/Callstack.hpp"
+#include "Engine/Tools/Logging/Logger.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Input/DeveloperConsole.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const int UNREGISTERED_SAMPLING_THREAD = -1;
+const unsigned int MAX_SIGNAL_HANDLER_FRAMES = 8; // Searched for the interrupted frame, any wrapping handlers included
+static const char* DEFAULT_FOLDED_STACKS_FILE = "Samples.folded";
+
+
+//-----------------------------------------------------------------------------------------------
+// Written by whoever claimed it, read once sampling has stopped
+struct SampledCallstack
+{
+	std::atomic< bool > m_isWritten;
+	int m_threadNameIndex;
+	unsigned int m_numFrames;
+	void* m_frames[ MAX_SAMPLED_FRAMES ]; // Innermost first
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// A live registered thread. The slot is freed when the thread exits.
+struct SamplingThread
+{
+	bool m_isLive;
+#if defined( __linux__ )
+	pthread_t m_thread;
+	pid_t m_threadId;
+	timer_t m_timer;
+	bool m_hasTimer;
+#endif
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Frees the thread's slot, and its timer, when the thread exits
+struct SamplingThreadRegistration
+{
+	~SamplingThreadRegistration();
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic< bool > s_isSampling( false );
+static SampledCallstack* s_samples = nullptr;
+static std::atomic< uint64_t > s_numClaimedSamples( 0 );
+static std::atomic< uint64_t > s_numDroppedSamples( 0 );
+static double s_startSeconds = 0.0;
+static double s_stopSeconds = 0.0;
+static std::mutex s_samplingThreadsLock;
+static SamplingThread s_samplingThreads[ MAX_SAMPLING_THREADS ];
+static std::vector< std::string > s_samplingThreadNames; // One per registration, so samples keep a thread's name after it exits
+static thread_local int t_samplingThreadIndex = UNREGISTERED_SAMPLING_THREAD;
+static thread_local int t_samplingThreadNameIndex = UNREGISTERED_SAMPLING_THREAD;
+static thread_local SamplingThreadRegistration t_samplingThreadRegistration;
+#if defined( __linux__ )
+static bool s_isHandlerInstalled = false;
+static struct sigaction s_previousAction;
+static long s_sampleIntervalNanoseconds = 1000000;
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// Never blocks or allocates, it runs inside a signal handler
+static SampledCallstack* ClaimSample()
+{
+	uint64_t sampleIndex = s_numClaimedSamples.fetch_add( 1, std::memory_order_relaxed );
+	if ( sampleIndex >= MAX_SAMPLED_CALLSTACKS )
+	{
+		s_numDroppedSamples.fetch_add( 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	return &s_samples[ sampleIndex ];
+}
+
+
+#if defined( __linux__ )
+//-----------------------------------------------------------------------------------------------
+// Runs on whichever thread the timer interrupted. Anyone can send SIGPROF, so it's dropped on
+// threads that aren't registered.
+static void HandleProfilingSignal( int signalNumber, siginfo_t* signalInfo, void* userContext )
+{
+	( void ) signalNumber;
+	( void ) signalInfo;
+
+	int threadNameIndex = t_samplingThreadNameIndex;
+	if ( !s_isSampling.load( std::memory_order_relaxed ) || threadNameIndex == UNREGISTERED_SAMPLING_THREAD )
+	{
+		return;
+	}
+
+	int savedErrno = errno;
+	SampledCallstack* sample = ClaimSample();
+	if ( sample != nullptr )
+	{
+		sample->m_threadNameIndex = threadNameIndex;
+		sample->m_numFrames = CallstackCaptureFrames( sample->m_frames, MAX_SAMPLED_FRAMES, 0 );
+
+		// Drops the handler frames down to the instruction the signal interrupted. How many there
+		// are depends on what else wraps signal handlers, sanitizers for one.
+		mcontext_t const &machineContext = ( ( ucontext_t const* ) userContext )->uc_mcontext;
+#if defined( __x86_64__ )
+		void* interruptedAddress = ( void* ) machineContext.gregs[ REG_RIP ];
+#elif defined( __i386__ )
+		void* interruptedAddress = ( void* ) machineContext.gregs[ REG_EIP ];
+#elif defined( __aarch64__ )
+		void* interruptedAddress = ( void* ) machineContext.pc;
+#endif
+		unsigned int numHandlerFrames = std::min( sample->m_numFrames, MAX_SIGNAL_HANDLER_FRAMES );
+		for ( unsigned int frameIndex = 0; frameIndex < numHandlerFrames; ++frameIndex )
+		{
+			if ( sample->m_frames[ frameIndex ] == interruptedAddress )
+			{
+				sample->m_numFrames -= frameIndex;
+				memmove( sample->m_frames, sample->m_frames + frameIndex, sample->m_numFrames * sizeof( void* ) );
+				break;
+			}
+		}
+		sample->m_isWritten.store( true, std::memory_order_release );
+	}
+	errno = savedErrno;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// On the thread's own CPU clock, signalling just that thread. A process wide timer would almost
+// always signal the main thread, whoever spent the time. Called with the threads locked, on live
+// threads only.
+static void StartThreadTimer( SamplingThread& samplingThread )
+{
+#if defined( __linux__ )
+	clockid_t threadClock;
+	if ( pthread_getcpuclockid( samplingThread.m_thread, &threadClock ) != 0 )
+	{
+		return;
+	}
+
+	struct sigevent timerEvent;
+	memset( &timerEvent, 0, sizeof( timerEvent ) );
+	timerEvent.sigev_notify = SIGEV_THREAD_ID;
+	timerEvent.sigev_signo = SIGPROF;
+	timerEvent.sigev_notify_thread_id = samplingThread.m_threadId;
+	if ( timer_create( threadClock, &timerEvent, &samplingThread.m_timer ) != 0 )
+	{
+		return;
+	}
+
+	struct itimerspec interval;
+	interval.it_interval.tv_sec = 0;
+	interval.it_interval.tv_nsec = s_sampleIntervalNanoseconds;
+	interval.it_value = interval.it_interval;
+	timer_settime( samplingThread.m_timer, 0, &interval, nullptr );
+	samplingThread.m_hasTimer = true;
+#else
+	( void ) samplingThread;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Called with the threads locked
+static void StopThreadTimer( SamplingThread& samplingThread )
+{
+#if defined( __linux__ )
+	if ( samplingThread.m_hasTimer )
+	{
+		timer_delete( samplingThread.m_timer );
+		samplingThread.m_hasTimer = false;
+	}
+#else
+	( void ) samplingThread;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SamplingThreadRegistration::~SamplingThreadRegistration()
+{
+	std::lock_guard< std::mutex > lock( s_samplingThreadsLock );
+
+	// Any signal still on its way is dropped from here on
+	t_samplingThreadNameIndex = UNREGISTERED_SAMPLING_THREAD;
+	if ( t_samplingThreadIndex != UNREGISTERED_SAMPLING_THREAD )
+	{
+		SamplingThread& samplingThread = s_samplingThreads[ t_samplingThreadIndex ];
+		StopThreadTimer( samplingThread );
+		samplingThread.m_isLive = false;
+		t_samplingThreadIndex = UNREGISTERED_SAMPLING_THREAD;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SamplingProfilerShutdown()
+{
+	StopSamplingProfiler();
+
+	free( s_samples );
+	s_samples = nullptr;
+
+#if defined( __linux__ )
+	if ( s_isHandlerInstalled )
+	{
+		sigaction( SIGPROF, &s_previousAction, nullptr );
+		s_isHandlerInstalled = false;
+	}
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Naming a registered thread again just renames it. Past MAX_SAMPLING_THREADS live threads the
+// rest aren't sampled.
+void SamplingProfilerRegisterThread( char const* threadName )
+{
+	std::lock_guard< std::mutex > lock( s_samplingThreadsLock );
+
+	if ( t_samplingThreadIndex == UNREGISTERED_SAMPLING_THREAD )
+	{
+		int freeThreadIndex = UNREGISTERED_SAMPLING_THREAD;
+		for ( unsigned int threadIndex = 0; threadIndex < MAX_SAMPLING_THREADS && freeThreadIndex == UNREGISTERED_SAMPLING_THREAD; ++threadIndex )
+		{
+			freeThreadIndex = s_samplingThreads[ threadIndex ].m_isLive ? UNREGISTERED_SAMPLING_THREAD : ( int ) threadIndex;
+		}
+
+		if ( freeThreadIndex == UNREGISTERED_SAMPLING_THREAD )
+		{
+			LoggerPrintfWithTag( "profiler", "More than %u threads registered, %s won't be sampled\n", MAX_SAMPLING_THREADS, threadName );
+			return;
+		}
+
+		// Touching the registration is what makes it free the slot on exit
+		( void ) &t_samplingThreadRegistration;
+
+		SamplingThread& samplingThread = s_samplingThreads[ freeThreadIndex ];
+		samplingThread.m_isLive = true;
+#if defined( __linux__ )
+		samplingThread.m_thread = pthread_self();
+		samplingThread.m_threadId = ( pid_t ) syscall( SYS_gettid );
+		samplingThread.m_hasTimer = false;
+#endif
+		t_samplingThreadIndex = freeThreadIndex;
+		t_samplingThreadNameIndex = ( int ) s_samplingThreadNames.size();
+		s_samplingThreadNames.push_back( threadName );
+
+		if ( s_isSampling.load( std::memory_order_relaxed ) )
+		{
+			StartThreadTimer( samplingThread );
+		}
+		return;
+	}
+
+	s_samplingThreadNames[ t_samplingThreadNameIndex ] = threadName;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Only Linux has a sampler, see the header
+bool StartSamplingProfiler( unsigned int samplesPerSecond )
+{
+#if defined( __linux__ )
+	StopSamplingProfiler();
+	samplesPerSecond = std::max( 1u, std::min( samplesPerSecond, 10000u ) );
+
+	if ( s_samples == nullptr )
+	{
+		s_samples = ( SampledCallstack* ) malloc( MAX_SAMPLED_CALLSTACKS * sizeof( SampledCallstack ) );
+		if ( s_samples == nullptr )
+		{
+			return false;
+		}
+	}
+
+	for ( unsigned int sampleIndex = 0; sampleIndex < MAX_SAMPLED_CALLSTACKS; ++sampleIndex )
+	{
+		s_samples[ sampleIndex ].m_isWritten.store( false, std::memory_order_relaxed );
+	}
+	s_numClaimedSamples.store( 0, std::memory_order_relaxed );
+	s_numDroppedSamples.store( 0, std::memory_order_relaxed );
+
+	// The first backtrace loads the unwinder, which allocates, so it mustn't be in the handler
+	void* warmupFrames[ 1 ];
+	CallstackCaptureFrames( warmupFrames, 1, 0 );
+
+	if ( !s_isHandlerInstalled )
+	{
+		struct sigaction action;
+		memset( &action, 0, sizeof( action ) );
+		action.sa_sigaction = HandleProfilingSignal;
+		action.sa_flags = SA_SIGINFO | SA_RESTART;
+		sigemptyset( &action.sa_mask );
+		if ( sigaction( SIGPROF, &action, &s_previousAction ) != 0 )
+		{
+			return false;
+		}
+		s_isHandlerInstalled = true;
+	}
+
+	s_sampleIntervalNanoseconds = 1000000000L / samplesPerSecond;
+	s_startSeconds = GetCurrentTimeSeconds();
+
+	std::lock_guard< std::mutex > lock( s_samplingThreadsLock );
+	s_isSampling.store( true, std::memory_order_release );
+	for ( unsigned int threadIndex = 0; threadIndex < MAX_SAMPLING_THREADS; ++threadIndex )
+	{
+		if ( s_samplingThreads[ threadIndex ].m_isLive )
+		{
+			StartThreadTimer( s_samplingThreads[ threadIndex ] );
+		}
+	}
+	return true;
+#else
+	( void ) samplesPerSecond;
+	return false;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void StopSamplingProfiler()
+{
+	if ( !s_isSampling.exchange( false ) )
+	{
+		return;
+	}
+
+	// A handler already running on another thread still finishes its sample, which is why
+	// samples are only read once they're marked written
+	std::lock_guard< std::mutex > lock( s_samplingThreadsLock );
+	for ( unsigned int threadIndex = 0; threadIndex < MAX_SAMPLING_THREADS; ++threadIndex )
+	{
+		StopThreadTimer( s_samplingThreads[ threadIndex ] );
+	}
+	s_stopSeconds = GetCurrentTimeSeconds();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool IsSamplingProfilerRunning()
+{
+	return s_isSampling.load( std::memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SamplingProfilerStats GetSamplingProfilerStats()
+{
+	SamplingProfilerStats stats;
+	uint64_t numClaimedSamples = s_numClaimedSamples.load( std::memory_order_relaxed );
+	stats.m_numSamples = std::min( numClaimedSamples, ( uint64_t ) MAX_SAMPLED_CALLSTACKS );
+	stats.m_numDroppedSamples = s_numDroppedSamples.load( std::memory_order_relaxed );
+	stats.m_seconds = ( IsSamplingProfilerRunning() ? GetCurrentTimeSeconds() : s_stopSeconds ) - s_startSeconds;
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Each address is symbolized once. Return addresses are looked up a byte back, inside the call.
+static char const* GetSampledFrameName( void* address, bool isReturnAddress, std::unordered_map< void*, std::string >& frameNames )
+{
+	std::unordered_map< void*, std::string >::iterator nameIter = frameNames.find( address );
+	if ( nameIter != frameNames.end() )
+	{
+		return nameIter->second.c_str();
+	}
+
+	void* lookupAddress = isReturnAddress ? ( void* ) ( ( uintptr_t ) address - 1 ) : address;
+	std::string& frameName = frameNames[ address ];
+	if ( CallstackGetSymbolMode() == CALLSTACK_SYMBOLS_RAW_ADDRESSES )
+	{
+		char text[ 512 ];
+		CallstackFormatFrame( lookupAddress, text, sizeof( text ) );
+		frameName = text;
+	}
+	else
+	{
+		CallstackLine line;
+		CallstackSymbolizeAddress( lookupAddress, line );
+		frameName = line.functionName;
+	}
+
+	// Semicolons separate frames in the folded format
+	std::replace( frameName.begin(), frameName.end(), ';', ':' );
+	return frameName.c_str();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Only once sampling has stopped, so nothing else is writing
+template< typename SampleVisitor >
+static void ForEachSampledCallstack( SampleVisitor visitSample )
+{
+	if ( s_samples == nullptr || IsSamplingProfilerRunning() )
+	{
+		return;
+	}
+
+	uint64_t numSamples = std::min( s_numClaimedSamples.load( std::memory_order_acquire ), ( uint64_t ) MAX_SAMPLED_CALLSTACKS );
+	for ( uint64_t sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex )
+	{
+		SampledCallstack const &sample = s_samples[ sampleIndex ];
+		if ( sample.m_isWritten.load( std::memory_order_acquire ) && sample.m_numFrames > 0 )
+		{
+			visitSample( sample );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Symbolizes every address sampled, which with addr2line is a process per address the first time
+bool WriteSampledFoldedStacks( char const* filePath )
+{
+	if ( s_samples == nullptr || IsSamplingProfilerRunning() )
+	{
+		return false;
+	}
+
+	s_samplingThreadsLock.lock();
+	std::vector< std::string > threadNames = s_samplingThreadNames;
+	s_samplingThreadsLock.unlock();
+
+	std::unordered_map< void*, std::string > frameNames;
+	std::map< std::string, uint64_t > stackCounts;
+	std::string stackText;
+	ForEachSampledCallstack( [ & ]( SampledCallstack const &sample )
+	{
+		bool isKnownThread = sample.m_threadNameIndex >= 0 && ( size_t ) sample.m_threadNameIndex < threadNames.size();
+		stackText = isKnownThread ? threadNames[ sample.m_threadNameIndex ] : "Unknown thread";
+		std::replace( stackText.begin(), stackText.end(), ';', ':' );
+		for ( unsigned int frameIndex = sample.m_numFrames; frameIndex-- > 0; )
+		{
+			stackText += ';';
+			stackText += GetSampledFrameName( sample.m_frames[ frameIndex ], frameIndex > 0, frameNames );
+		}
+		stackCounts[ stackText ]++;
+	} );
+
+	std::ofstream foldedFile( filePath, std::ios::binary );
+	if ( !foldedFile.is_open() )
+	{
+		return false;
+	}
+
+	for ( std::map< std::string, uint64_t >::iterator stackIter = stackCounts.begin(); stackIter != stackCounts.end(); ++stackIter )
+	{
+		foldedFile << stackIter->first << ' ' << stackIter->second << '\n';
+	}
+
+	if ( CallstackGetSymbolMode() == CALLSTACK_SYMBOLS_RAW_ADDRESSES )
+	{
+		CallstackWriteModuleMap( Stringf( "%s.modules", filePath ).c_str() );
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsMoreSelfSampled( SampledFunction const &first, SampledFunction const &second )
+{
+	if ( first.m_numSelfSamples != second.m_numSelfSamples )
+	{
+		return first.m_numSelfSamples > second.m_numSelfSamples;
+	}
+	return first.m_numTotalSamples > second.m_numTotalSamples;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Functions are by name, so every address inside one adds up
+void GetSampledTopFunctions( std::vector< SampledFunction >& out_functions, unsigned int maxFunctions )
+{
+	out_functions.clear();
+
+	std::unordered_map< void*, std::string > frameNames;
+	std::unordered_map< std::string, SampledFunction > functions;
+	std::vector< char const* > namesInSample;
+	ForEachSampledCallstack( [ & ]( SampledCallstack const &sample )
+	{
+		namesInSample.clear();
+		for ( unsigned int frameIndex = 0; frameIndex < sample.m_numFrames; ++frameIndex )
+		{
+			char const* frameName = GetSampledFrameName( sample.m_frames[ frameIndex ], frameIndex > 0, frameNames );
+			SampledFunction& function = functions[ frameName ];
+			function.m_numSelfSamples += ( frameIndex == 0 ) ? 1 : 0;
+
+			// Recursion counts once toward the total
+			bool isAlreadyInSample = false;
+			for ( unsigned int nameIndex = 0; nameIndex < namesInSample.size(); ++nameIndex )
+			{
+				isAlreadyInSample = isAlreadyInSample || strcmp( namesInSample[ nameIndex ], frameName ) == 0;
+			}
+			if ( !isAlreadyInSample )
+			{
+				function.m_numTotalSamples++;
+				namesInSample.push_back( frameName );
+			}
+		}
+	} );
+
+	out_functions.reserve( functions.size() );
+	for ( std::unordered_map< std::string, SampledFunction >::iterator functionIter = functions.begin(); functionIter != functions.end(); ++functionIter )
+	{
+		functionIter->second.m_name = functionIter->first;
+		out_functions.push_back( functionIter->second );
+	}
+
+	std::sort( out_functions.begin(), out_functions.end(), IsMoreSelfSampled );
+	if ( out_functions.size() > maxFunctions )
+	{
+		out_functions.resize( maxFunctions );
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+std::string FormatSampledTopFunctions( std::vector< SampledFunction > const &functions )
+{
+	SamplingProfilerStats stats = GetSamplingProfilerStats();
+	double numSamples = ( stats.m_numSamples > 0 ) ? ( double ) stats.m_numSamples : 1.0;
+
+	std::string tableText = Stringf( "%llu samples over %.2fs, %llu dropped\n", stats.m_numSamples, stats.m_seconds, stats.m_numDroppedSamples );
+	tableText += Stringf( "%7s %7s %8s  %s\n", "self %", "total %", "self", "function" );
+	for ( unsigned int functionIndex = 0; functionIndex < functions.size(); ++functionIndex )
+	{
+		SampledFunction const &function = functions[ functionIndex ];
+		tableText += Stringf( "%7.2f %7.2f %8llu  %s\n", 100.0 * function.m_numSelfSamples / numSamples,
+			100.0 * function.m_numTotalSamples / numSamples, function.m_numSelfSamples, function.m_name.c_str() );
+	}
+	return tableText;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// profile_sample [start [samples per second]|stop|dump [file] [top N]]
+CONSOLE_COMMAND( profile_sample )
+{
+	std::string subCommand = args.m_argList.empty() ? "" : args.m_argList[ 0 ];
+
+	if ( subCommand == "start" )
+	{
+		int samplesPerSecond = DEFAULT_SAMPLES_PER_SECOND;
+		if ( args.m_argList.size() > 1 )
+		{
+			SetTypeFromString( samplesPerSecond, args.m_argList[ 1 ] );
+		}
+
+		if ( samplesPerSecond > 0 && StartSamplingProfiler( ( unsigned int ) samplesPerSecond ) )
+		{
+			g_theDeveloperConsole->ConsolePrint( Stringf( "Sampling at %dHz.", samplesPerSecond ) );
+		}
+		else
+		{
+			g_theDeveloperConsole->ConsolePrint( "Couldn't start the sampling profiler, it's Linux only.", Rgba::RED );
+		}
+	}
+	else if ( subCommand == "stop" )
+	{
+		StopSamplingProfiler();
+		SamplingProfilerStats stats = GetSamplingProfilerStats();
+		g_theDeveloperConsole->ConsolePrint( Stringf( "Sampling stopped, %llu samples.", stats.m_numSamples ) );
+	}
+	else if ( subCommand == "dump" )
+	{
+		StopSamplingProfiler();
+
+		std::string filePath = ( args.m_argList.size() > 1 ) ? args.m_argList[ 1 ] : DEFAULT_FOLDED_STACKS_FILE;
+		int numTopFunctions = DEFAULT_SAMPLED_TOP_FUNCTIONS;
+		if ( args.m_argList.size() > 2 )
+		{
+			SetTypeFromString( numTopFunctions, args.m_argList[ 2 ] );
+		}
+
+		if ( !WriteSampledFoldedStacks( filePath.c_str() ) )
+		{
+			g_theDeveloperConsole->ConsolePrint( "Couldn't write " + filePath + ", has anything been sampled?", Rgba::RED );
+			return;
+		}
+
+		std::vector< SampledFunction > functions;
+		GetSampledTopFunctions( functions, ( unsigned int ) std::max( numTopFunctions, 0 ) );
+		std::string tableText = FormatSampledTopFunctions( functions );
+		LoggerPrintfWithTag( "profiler", "%s", tableText.c_str() );
+
+		size_t lineStart = 0;
+		while ( lineStart < tableText.size() )
+		{
+			size_t lineEnd = tableText.find( '\n', lineStart );
+			g_theDeveloperConsole->ConsolePrint( tableText.substr( lineStart, lineEnd - lineStart ) );
+			lineStart = ( lineEnd == std::string::npos ) ? tableText.size() : lineEnd + 1;
+		}
+		g_theDeveloperConsole->ConsolePrint( "Folded stacks written to " + filePath + " (flamegraph.pl or speedscope.app)" );
+	}
+	else
+	{
+		g_theDeveloperConsole->ConsolePrint( "Usage: profile_sample [start [samples per second]|stop|dump [file] [top N]]", Rgba::RED );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int MAX_SAMPLED_CALLSTACKS = 1 << 16; // About a minute of one busy thread at 1kHz, later samples are dropped
+const unsigned int MAX_SAMPLED_FRAMES = 48; // Innermost frames kept per sample
+const unsigned int MAX_SAMPLING_THREADS = 64;
+const unsigned int DEFAULT_SAMPLES_PER_SECOND = 1000;
+const unsigned int DEFAULT_SAMPLED_TOP_FUNCTIONS = 20;
+
+
+//-----------------------------------------------------------------------------------------------
+// Percentages are of every sample taken
+struct SampledFunction
+{
+	std::string m_name;
+	uint64_t m_numSelfSamples; // Samples where it was the innermost frame
+	uint64_t m_numTotalSamples; // Samples where it was anywhere on the stack, once per sample
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct SamplingProfilerStats
+{
+	uint64_t m_numSamples;
+	uint64_t m_numDroppedSamples; // After the buffer filled
+	double m_seconds; // Spent sampling
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Statistical profiler for the code nobody wrapped in a profile scope, Linux only for now. Samples
+// the live threads registered through ProfilerSetThreadName, by the CPU time each spends, so idle
+// threads cost nothing. Each has a timer on its own CPU clock that raises SIGPROF on it, and the
+// handler captures the stack into a preallocated buffer claimed with one atomic add. The kernel
+// checks those timers on its scheduler tick, so rates above CONFIG_HZ come out at CONFIG_HZ.
+// Nothing is symbolized until the samples are written out after stopping. Elsewhere, starting
+// fails and registering does nothing but keep the name.
+void SamplingProfilerShutdown();
+void SamplingProfilerRegisterThread( char const* threadName ); // From the thread being registered
+bool StartSamplingProfiler( unsigned int samplesPerSecond ); // Clears what was sampled
+void StopSamplingProfiler();
+bool IsSamplingProfilerRunning();
+SamplingProfilerStats GetSamplingProfilerStats();
+bool WriteSampledFoldedStacks( char const* filePath ); // One "thread;outer;...;inner count" line per stack, for flamegraph.pl
+void GetSampledTopFunctions( std::vector< SampledFunction >& out_functions, unsigned int maxFunctions ); // By self samples
+std::string FormatSampledTopFunctions( std::vector< SampledFunction > const &functions );
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Engine/Tools/Parsers/xmlParser.h"
 #include "Engine/Audio/AudioSystem.hpp"
 #include "Engine/Input/InputSystem.hpp"
+#include "Engine/Tools/Memory/MemoryTags.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -15,6 +16,8 @@ bool		g_waitForRKeyUp = false;
 //-----------------------------------------------------------------------------------------------
 UISystem::UISystem()
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_UI );
+
 	LoadUIFromXML();
 	RegisterUIEvents();
 }
@@ -23,6 +26,8 @@ UISystem::UISystem()
 //-----------------------------------------------------------------------------------------------
 void UISystem::Update( float deltaSeconds )
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_UI );
+
 	deltaSeconds;
 
 	CheckForUIReloadKey();
@@ -83,6 +88,8 @@ void UISystem::Render() const
 //-----------------------------------------------------------------------------------------------
 void UISystem::LoadUIFromXML()
 {
+	MEMORY_TAG_SCOPE( MEMORY_TAG_UI );
+
 	std::vector< std::string > uiFiles = EnumerateFilesInFolder( "Data/UI", "*.xml" );
 
 	for ( std::string file : uiFiles )
@@ -228,4 +235,4 @@ AABB2 UISystem::CalculateWidgetBounds( int widgetWidth, int widgetHeight,
 	Vector2 widgetMaxs( widgetCenterPosition.x + halfWidgetWidth, widgetCenterPosition.y + halfWidgetHeight );
 
 	return AABB2( widgetMins, widgetMaxs );
-}
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------------------------
+// Offline reader for the .heapsnap files memory_snapshot writes. Needs nothing from the engine but
+// HeapSnapshot.cpp, so it builds on its own from the Code folder:
+//   cl /EHsc /I. Tools\HeapDiff\HeapDiff.cpp Engine\Tools\Memory\HeapSnapshot.cpp
+//   g++ -std=c++11 -I. Tools/HeapDiff/HeapDiff.cpp Engine/Tools/Memory/HeapSnapshot.cpp
+//
+//   HeapDiff <snapshot> [count]               biggest live allocation sites
+//   HeapDiff <before> <after> [count]         top growers between two snapshots
+//-----------------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "Engine/Tools/Memory/HeapSnapshot.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const unsigned int DEFAULT_GROUP_COUNT = 20;
+const unsigned int MAX_PRINTED_FRAMES = 16;
+
+
+//-----------------------------------------------------------------------------------------------
+static bool LoadOrComplain( char const* filename, HeapSnapshot& out_snapshot )
+{
+	if ( !LoadHeapSnapshot( filename, out_snapshot ) )
+	{
+		fprintf( stderr, "Couldn't read heap snapshot %s\n", filename );
+		return false;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void PrintSnapshotHeader( char const* filename, HeapSnapshot const &snapshot )
+{
+	printf( "%s: %llu allocs, %llu bytes at %.1fs, %u groups, sampling every %llu %s\n", filename,
+		( unsigned long long ) snapshot.m_totalAllocations, ( unsigned long long ) snapshot.m_totalBytes, snapshot.m_captureSeconds,
+		( unsigned int ) snapshot.m_groups.size(), ( unsigned long long ) snapshot.m_samplingInterval,
+		( snapshot.m_samplingMode == 1 ) ? "bytes" : "allocs" );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+	if ( argc < 2 || argc > 4 )
+	{
+		fprintf( stderr, "Usage: HeapDiff <snapshot> [count]\n       HeapDiff <before> <after> [count]\n" );
+		return 1;
+	}
+
+	bool isDiff = ( argc == 4 ) || ( argc == 3 && atoi( argv[ 2 ] ) <= 0 );
+	unsigned int maxGroups = DEFAULT_GROUP_COUNT;
+	if ( ( isDiff && argc == 4 ) || ( !isDiff && argc == 3 ) )
+	{
+		maxGroups = ( unsigned int ) atoi( argv[ argc - 1 ] );
+	}
+
+	HeapSnapshot before;
+	HeapSnapshot after;
+	if ( !LoadOrComplain( argv[ 1 ], before ) )
+	{
+		return 1;
+	}
+	PrintSnapshotHeader( argv[ 1 ], before );
+
+	// A single snapshot is diffed against nothing, which lists its biggest sites
+	if ( isDiff )
+	{
+		if ( !LoadOrComplain( argv[ 2 ], after ) )
+		{
+			return 1;
+		}
+		PrintSnapshotHeader( argv[ 2 ], after );
+	}
+	else
+	{
+		after = before;
+		before = HeapSnapshot();
+	}
+
+	std::vector< HeapSnapshotGrowth > growth;
+	DiffHeapSnapshots( before, after, growth );
+
+	std::vector< std::string > lines;
+	FormatHeapSnapshotGrowth( growth, maxGroups, MAX_PRINTED_FRAMES, lines );
+	for ( unsigned int lineIndex = 0; lineIndex < lines.size(); ++lineIndex )
+	{
+		printf( "%s\n", lines[ lineIndex ].c_str() );
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+//-----------------------------------------------------------------------------------------------
+// Offline symbolizer for callstacks logged with CALLSTACK_RAW_ADDRESSES or callstack_symbols raw.
+// Needs nothing from the engine but Callstack.cpp, so it builds on its own from the Code folder:
+//   cl /EHsc /I. Tools\Symbolize\Symbolize.cpp Engine\Tools\Memory\Callstack.cpp
+//   g++ -std=c++11 -I. Tools/Symbolize/Symbolize.cpp Engine/Tools/Memory/Callstack.cpp -ldl
+//
+//   Symbolize <log> [moduleMap]     prints the log with each raw frame symbolized
+//
+// Modules come from "module" lines in the log and the optional map, and are matched to frames by
+// file name. The binaries and their symbols have to be the ones that were run.
+//-----------------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Engine/Tools/Memory/Callstack.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+const size_t MAX_LINE_LENGTH = 8192;
+
+
+//-----------------------------------------------------------------------------------------------
+static void ReadModules( char const* filename, std::vector< CallstackModule >& out_modules )
+{
+	FILE* file = fopen( filename, "r" );
+	if ( file == nullptr )
+	{
+		return;
+	}
+
+	char line[ MAX_LINE_LENGTH ];
+	while ( fgets( line, MAX_LINE_LENGTH, file ) != nullptr )
+	{
+		CallstackModule module;
+		if ( CallstackParseModule( line, module ) )
+		{
+			out_modules.push_back( module );
+		}
+	}
+
+	fclose( file );
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static CallstackModule const* FindModuleByFilename( std::vector< CallstackModule > const &modules, char const* moduleFilename )
+{
+	for ( unsigned int moduleIndex = 0; moduleIndex < modules.size(); ++moduleIndex )
+	{
+		char const* path = modules[ moduleIndex ].m_path;
+		size_t pathLength = strlen( path );
+		size_t filenameLength = strlen( moduleFilename );
+		if ( pathLength < filenameLength || strcmp( path + pathLength - filenameLength, moduleFilename ) != 0 )
+		{
+			continue;
+		}
+
+		char separator = ( pathLength > filenameLength ) ? path[ pathLength - filenameLength - 1 ] : '/';
+		if ( separator == '/' || separator == '\\' )
+		{
+			return &modules[ moduleIndex ];
+		}
+	}
+
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Frames that can't be symbolized are left as they are
+static std::string SymbolizeLine( char const* line, std::vector< CallstackModule > const &modules )
+{
+	std::string symbolizedLine;
+	char moduleFilename[ MAX_CALLSTACK_MODULE_PATH_LENGTH ];
+	uint64_t offset = 0;
+	size_t frameLength = 0;
+
+	char const* remaining = line;
+	char const* frameStart = CallstackFindRawFrame( remaining, moduleFilename, MAX_CALLSTACK_MODULE_PATH_LENGTH, offset, frameLength );
+	while ( frameStart != nullptr )
+	{
+		symbolizedLine.append( remaining, frameStart - remaining );
+
+		CallstackModule const* module = FindModuleByFilename( modules, moduleFilename );
+		CallstackLine frameLine;
+		if ( module != nullptr && CallstackSymbolizeOffline( *module, offset, frameLine ) )
+		{
+			char frameText[ MAX_LINE_LENGTH ];
+			snprintf( frameText, MAX_LINE_LENGTH, "%s(%u): %s", frameLine.filename, frameLine.line, frameLine.functionName );
+			symbolizedLine += frameText;
+		}
+		else
+		{
+			symbolizedLine.append( frameStart, frameLength );
+		}
+
+		remaining = frameStart + frameLength;
+		frameStart = CallstackFindRawFrame( remaining, moduleFilename, MAX_CALLSTACK_MODULE_PATH_LENGTH, offset, frameLength );
+	}
+
+	symbolizedLine += remaining;
+	return symbolizedLine;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+	if ( argc < 2 || argc > 3 )
+	{
+		fprintf( stderr, "Usage: Symbolize <log> [moduleMap]\n" );
+		return 1;
+	}
+
+	std::vector< CallstackModule > modules;
+	ReadModules( argv[ 1 ], modules );
+	if ( argc == 3 )
+	{
+		ReadModules( argv[ 2 ], modules );
+	}
+
+	if ( modules.empty() )
+	{
+		fprintf( stderr, "No module map in %s%s%s\n", argv[ 1 ], ( argc == 3 ) ? " or " : "", ( argc == 3 ) ? argv[ 2 ] : "" );
+		return 1;
+	}
+
+	FILE* log = fopen( argv[ 1 ], "r" );
+	if ( log == nullptr )
+	{
+		fprintf( stderr, "Couldn't read %s\n", argv[ 1 ] );
+		return 1;
+	}
+
+	char line[ MAX_LINE_LENGTH ];
+	while ( fgets( line, MAX_LINE_LENGTH, log ) != nullptr )
+	{
+		fputs( SymbolizeLine( line, modules ).c_str(), stdout );
+	}
+
+	fclose( log );
+	CallstackShutdown();
+	return 0;
+}
\ No newline at end of file